@@ -0,0 +1,245 @@
+#ifndef ARC_INTERPOLATOR_H
+#define ARC_INTERPOLATOR_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+/**
+ * @class ArcInterpolator
+ * @brief Целочисленная пошаговая интерполяция дуги окружности в шагах осей Z и X
+ *
+ * Оси имеют разную цену шага, поэтому окружность строится в общих целочисленных
+ * координатах: u = z * a - cz * s, v = x * b - cx * s, где z, x - позиция в шагах,
+ * cz, cx - центр в деци-микронах, а множители a, b, s подобраны так, что
+ * z * a / s и x * b / s - позиция в деци-микронах без остатка.
+ *
+ * На каждом шаге выбирается одно из трех соседних положений (шаг по Z, по X или
+ * по обеим осям в направлении обхода) с наименьшим отклонением
+ * F = u² + v² - r². Отклонение обновляется приращениями, поэтому стоимость
+ * шага - несколько целочисленных сложений и умножений независимо от радиуса,
+ * а траектория не отходит от окружности больше чем на шаг оси.
+ *
+ * Плоскость ZX (G18): Z направлена вправо, X вверх, G3 - обход против часовой
+ * стрелки, G2 - по часовой.
+ */
+class ArcInterpolator {
+private:
+    long long a, b, s;          // Множители перевода шагов Z, X и деци-микронов в общие координаты
+
+    long long u, v;             // Текущая точка относительно центра
+    long long ue, ve;           // Конечная точка относительно центра
+    long long f;                // Отклонение u² + v² - r² от окружности
+    int dir;                    // Направление обхода: 1 - против часовой (G3), -1 - по часовой (G2)
+    int quadrant;               // Текущий квадрант точки (0..3 против часовой стрелки)
+    int quadrantsLeft;          // Число переходов между квадрантами до конечного
+    long z, x;                  // Текущая позиция в шагах
+    long stepsLeft;             // Защитный предел числа шагов
+    long chunkSteps;            // Число шагов дуги между целями, выдаваемыми осям
+    bool active;                // Дуга не завершена
+
+public:
+    /**
+     * @brief Конструктор интерполятора
+     * @param motorStepsZ Шагов двигателя Z на оборот
+     * @param screwZ Шаг винта Z в деци-микронах
+     * @param motorStepsX Шагов двигателя X на оборот
+     * @param screwX Шаг винта X в деци-микронах
+     */
+    ArcInterpolator(long motorStepsZ, long screwZ, long motorStepsX, long screwX)
+        : u(0), v(0), ue(0), ve(0), f(0), dir(1), quadrant(0), quadrantsLeft(0),
+          z(0), x(0), stepsLeft(0), chunkSteps(1), active(false) {
+        // Шаг Z = screwZ / motorStepsZ деци-микрон; s - наименьший общий знаменатель
+        long denomZ = motorStepsZ / gcd(screwZ, motorStepsZ);
+        long denomX = motorStepsX / gcd(screwX, motorStepsX);
+        s = (long long)denomZ / gcd(denomZ, denomX) * denomX;
+        a = s * screwZ / motorStepsZ;
+        b = s * screwX / motorStepsX;
+    }
+
+    /**
+     * @brief Начало новой дуги
+     * @param startZ Начальная позиция Z в шагах
+     * @param startX Начальная позиция X в шагах
+     * @param endZ Конечная позиция Z в шагах
+     * @param endX Конечная позиция X в шагах
+     * @param centerZ Центр по Z в деци-микронах
+     * @param centerX Центр по X в деци-микронах
+     * @param clockwise true для G2, false для G3
+     *
+     * Радиус берется по начальной точке. Конечная точка, если она не лежит
+     * точно на окружности, используется только для определения конца обхода.
+     * Совпадающие начало и конец задают полную окружность.
+     */
+    void begin(long startZ, long startX, long endZ, long endX, long centerZ, long centerX, bool clockwise) {
+        z = startZ;
+        x = startX;
+        u = startZ * a - centerZ * s;
+        v = startX * b - centerX * s;
+        ue = endZ * a - centerZ * s;
+        ve = endX * b - centerX * s;
+        f = 0;
+        dir = clockwise ? -1 : 1;
+
+        quadrant = quadrantOf(u, v);
+        int endQuadrant = quadrantOf(ue, ve);
+        quadrantsLeft = ((endQuadrant - quadrant) * dir + 4) % 4;
+        if (quadrantsLeft == 0 && dir * (u * ve - v * ue) <= 0) {
+            quadrantsLeft = 4; // Конец позади начала в том же квадранте - почти полная окружность
+        }
+
+        // Полная окружность занимает не больше 4r шагов по каждой оси
+        long long r = llabs(u) + llabs(v);
+        stepsLeft = (long)(4 * r / a + 4 * r / b + 16);
+        active = r > 0;
+
+        // Порция, для которой стрелка хорды c²/8R не больше LINEAR_INTERPOLATION_PRECISION
+        // шага самой точной оси (один расчет с плавающей точкой на дугу)
+        float radius = sqrt((float)u * u + (float)v * v);
+        float chord = sqrt(8 * radius * LINEAR_INTERPOLATION_PRECISION * min(a, b));
+        long maxChunk = max(1L, (long)ceil(1.0 / LINEAR_INTERPOLATION_PRECISION));
+        chunkSteps = constrain((long)(chord / sqrt((float)(a * a + b * b))), 1L, maxChunk);
+    }
+
+    /**
+     * @brief Один шаг вдоль дуги
+     * @return false если дуга уже пройдена и шаг не сделан
+     */
+    bool step() {
+        if (!active) {
+            return false;
+        }
+
+        // Направление касательной dir * (-v, u); на осях - знак, который примет координата
+        int dz = v != 0 ? (v > 0 ? -dir : dir) : (u > 0 ? -1 : 1);
+        int dx = u != 0 ? (u > 0 ? dir : -dir) : (v > 0 ? -1 : 1);
+
+        // Отклонение для шага по Z, по X и по обеим осям
+        long long fz = f + 2 * u * dz * a + a * a;
+        long long fx = f + 2 * v * dx * b + b * b;
+        long long fd = fz + fx - f;
+
+        long long best = llabs(fd);
+        int stepZ = dz, stepX = dx;
+        if (llabs(fz) < best) {
+            best = llabs(fz);
+            stepX = 0;
+        }
+        if (llabs(fx) < best) {
+            stepZ = 0;
+            stepX = dx;
+        }
+
+        if (stepZ != 0) {
+            u += stepZ * a;
+            z += stepZ;
+        }
+        if (stepX != 0) {
+            v += stepX * b;
+            x += stepX;
+        }
+        f = stepZ != 0 ? (stepX != 0 ? fd : fz) : fx;
+
+        int newQuadrant = quadrantOf(u, v);
+        if (newQuadrant != quadrant) {
+            quadrant = newQuadrant;
+            quadrantsLeft--;
+        }
+
+        // В последнем квадранте дуга заканчивается, когда точка доходит до направления на конец
+        if ((quadrantsLeft <= 0 && dir * (ue * v - ve * u) >= 0) || --stepsLeft <= 0) {
+            active = false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Число шагов дуги, которое можно выдать осям одной прямой порцией
+     */
+    long getChunkSteps() const { return chunkSteps; }
+
+    // Текущая позиция в шагах
+    long getZ() const { return z; }
+    long getX() const { return x; }
+    bool isActive() const { return active; }
+
+    /**
+     * @brief Поиск центра дуги, заданной радиусом (форма R)
+     * @param startZ Начальная точка Z в деци-микронах
+     * @param startX Начальная точка X в деци-микронах
+     * @param endZ Конечная точка Z в деци-микронах
+     * @param endX Конечная точка X в деци-микронах
+     * @param radius Радиус в деци-микронах (отрицательный - дуга больше 180°)
+     * @param clockwise true для G2, false для G3
+     * @param centerZ Найденный центр по Z
+     * @param centerX Найденный центр по X
+     * @return false если точки дальше друг от друга, чем диаметр (с допуском GCODE_ARC_TOLERANCE_DU)
+     */
+    static bool centerFromRadius(long startZ, long startX, long endZ, long endX, long radius,
+                                 bool clockwise, long& centerZ, long& centerX) {
+        long long dz = (long long)endZ - startZ;
+        long long dx = (long long)endX - startX;
+        long long chord2 = dz * dz + dx * dx;
+        long long r = llabs(radius);
+        if (chord2 == 0) {
+            return false;
+        }
+
+        // Расстояние от середины хорды до центра: h = sqrt(r² - chord²/4)
+        long long h2 = r * r - chord2 / 4;
+        if (h2 < 0) {
+            long long halfChord = isqrt(chord2) / 2;
+            if (halfChord - r > GCODE_ARC_TOLERANCE_DU) {
+                return false;
+            }
+            h2 = 0; // Полуокружность с погрешностью округления
+        }
+        long long chord = isqrt(chord2);
+        long long h = isqrt(h2);
+
+        // Центр слева от хорды для G3 с R > 0, справа для G2; отрицательный R меняет сторону
+        int side = (clockwise ? -1 : 1) * (radius < 0 ? -1 : 1);
+        centerZ = (long)((startZ + endZ) / 2 - side * h * dx / chord);
+        centerX = (long)((startX + endX) / 2 + side * h * dz / chord);
+        return true;
+    }
+
+    /**
+     * @brief Целочисленный квадратный корень
+     * @param value Неотрицательное число
+     * @return floor(sqrt(value))
+     */
+    static long long isqrt(long long value) {
+        if (value <= 0) {
+            return 0;
+        }
+        long long root = (long long)sqrt((double)value);
+        while (root * root > value) root--;
+        while ((root + 1) * (root + 1) <= value) root++;
+        return root;
+    }
+
+private:
+    /**
+     * @brief Номер квадранта точки относительно центра
+     *
+     * Точки на осях относятся к квадранту, который начинается с них при обходе
+     * против часовой стрелки, поэтому переход считается ровно один раз.
+     */
+    static int quadrantOf(long long pu, long long pv) {
+        if (pu > 0 && pv >= 0) return 0;
+        if (pu <= 0 && pv > 0) return 1;
+        if (pu < 0 && pv <= 0) return 2;
+        return 3;
+    }
+
+    static long gcd(long p, long q) {
+        while (q != 0) {
+            long t = p % q;
+            p = q;
+            q = t;
+        }
+        return p;
+    }
+};
+
+#endif // ARC_INTERPOLATOR_H
@@ -225,12 +225,17 @@ public:
     void update() {
         // Если нет ожидающих шагов - постепенно снижаем скорость до начальной
         if (pendingPos == 0) {
-            if (speed > config.speedStart) {
+            if (speed > effectiveSpeedStart()) {
                 speed--;
             }
             return;
         }
         
+        // Ограничение могло быть снижено во время простоя или движения
+        if (speed > speedMax) {
+            speed = speedMax;
+        }
+        
         // Проверка времени для следующего шага
         unsigned long nowUs = micros();
         float delayUs = 1000000.0 / speed; // Время между шагами в микросекундах
@@ -280,8 +285,8 @@ public:
                 // Ограничение скорости
                 if (speed > speedMax) {
                     speed = speedMax;
-                } else if (speed < config.speedStart) {
-                    speed = config.speedStart;
+                } else if (speed < effectiveSpeedStart()) {
+                    speed = effectiveSpeedStart();
                 }
                 
                 // Запоминаем время шага
@@ -425,6 +430,24 @@ public:
         return pos; 
     }
     
+    /**
+     * @brief Перевод расстояния из деци-микронов в шаги двигателя
+     * @param du Расстояние в деци-микронах (или скорость в деци-микронах/секунду)
+     * @return Расстояние в шагах (или скорость в шагах/секунду)
+     */
+    long duToSteps(long du) const {
+        return round(du * config.motorSteps / config.screwPitch);
+    }
+    
+    /**
+     * @brief Перевод расстояния из шагов двигателя в деци-микроны
+     * @param steps Расстояние в шагах
+     * @return Расстояние в деци-микронах
+     */
+    long stepsToDu(long steps) const {
+        return round(steps * config.screwPitch / config.motorSteps);
+    }
+    
     /**
      * @brief Проверка движения оси
      * @return true если ось движется (есть ожидающие шаги или недавно был шаг)
@@ -445,6 +468,9 @@ public:
     /**
      * @brief Установка максимальной скорости
      * @param maxSpeed Максимальная скорость в шагах/секунду
+     *
+     * Ограничение ниже начальной скорости снижает и ее: ось трогается,
+     * движется и тормозит не быстрее ограничения.
      */
     void setMaxSpeed(long maxSpeed) { 
         speedMax = maxSpeed; 
@@ -467,8 +493,25 @@ public:
     long getMotorPos() const { return motorPos; }
     long getOriginPos() const { return originPos; }
     long getPosGlobal() const { return posGlobal; }
+    long getMotorSteps() const { return lround(config.motorSteps); }
+    long getScrewPitch() const { return lround(config.screwPitch); }
+    long getSpeedLimit() const { return config.speedManualMove; }
+    long getSpeedStart() const { return config.speedStart; }
+    long getAcceleration() const { return acceleration; }
+    long getMaxTravelMm() const { return config.maxTravelMm; }
+    int getPendingSteps() const { return pendingPos; }
+    long getStepRate() const { return pendingPos != 0 ? speed : 0; } // Текущая скорость, шагов/с
+    unsigned long getLastStepUs() const { return stepStartUs; } // Время последнего шага (micros)
 
 private:
+    /**
+     * @brief Начальная скорость с учетом ограничения максимальной скорости
+     * @return Скорость в шагах/секунду, с которой ось трогается и до которой тормозит
+     */
+    long effectiveSpeedStart() const {
+        return min(config.speedStart, speedMax);
+    }
+    
     /**
      * @brief Установка направления движения
      * @param dir Направление (true - прямое, false - обратное)
@@ -479,7 +522,7 @@ private:
     void setDirection(bool dir) {
         if (direction != dir || !directionInitialized) {
             // Сброс скорости при смене направления
-            speed = config.speedStart;
+            speed = effectiveSpeedStart();
             direction = dir;
             directionInitialized = true;
             
@@ -0,0 +1,558 @@
+#ifndef CANNED_CYCLE_H
+#define CANNED_CYCLE_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "GCodeParser.h"
+#include "ArcInterpolator.h"
+
+/**
+ * @class CannedCycle
+ * @brief Построение кадров циклов G71 (черновое точение), G70 (чистовой проход)
+ * и G76 (нарезание резьбы)
+ *
+ * Цикл выдает интерпретатору обычные кадры G0/G1 по одному, когда предыдущий
+ * кадр исполнен, поэтому проходы не хранятся целиком ни в программе, ни в памяти.
+ * Для G71 контур (кадры от N=P до N=Q) один раз переводится в ломаную в буфере
+ * фиксированного размера GCODE_CYCLE_POINTS, дуги контура разбиваются на хорды
+ * со стрелкой не больше GCODE_ARC_TOLERANCE_DU. Поддерживается контур типа I:
+ * X и Z меняются монотонно (наружное точение и расточка).
+ *
+ * Порядок G71: проходы вдоль Z с шагом по X, равным глубине резания, каждый до
+ * пересечения с контуром, смещенным на припуск (U, W), отвод под 45° и
+ * возврат на ускоренной подаче; затем получистовой проход по контуру с
+ * припуском и возврат в начальную точку. G70 исполняет кадры контура как есть
+ * и тоже возвращается в начальную точку.
+ *
+ * Порядок G76: глубина n-го прохода равна Q * sqrt(n) (постоянное сечение
+ * стружки), но не меньше предыдущей плюс минимальная глубина; после чернового
+ * прохода на высоте профиля без припуска выполняются чистовой и зачистные
+ * проходы. Каждый проход - кадр G33 с углом начала, соответствующим заходу,
+ * со сбегом под 45° и врезанием вдоль боковой стороны профиля (смещение по Z
+ * на глубину * tg(угол / 2)). Число проходов считается до начала первого.
+ */
+class CannedCycle {
+private:
+    // Этапы цикла
+    enum Stage {
+        STAGE_PLUNGE,           // Переход на следующий уровень по X
+        STAGE_CUT,              // Проход вдоль Z до контура
+        STAGE_RETRACT,          // Отвод от поверхности
+        STAGE_RETURN,           // Возврат к начальной точке по Z
+        STAGE_CONTOUR_ENTRY,    // Подход к началу контура
+        STAGE_CONTOUR,          // Получистовой проход по контуру
+        STAGE_FINISH,           // Кадры контура для G70
+        STAGE_EXIT,             // Отвод по X в начальную точку
+        STAGE_HOME,             // Возврат по Z в начальную точку
+        STAGE_THREAD_ENTRY,     // Подход к началу прохода резьбы
+        STAGE_THREAD_CUT,       // Проход резьбы G33
+        STAGE_THREAD_CHAMFER,   // Сбег резьбы G33 под 45°
+        STAGE_THREAD_RETRACT,   // Отвод по X после прохода резьбы
+        STAGE_THREAD_RETURN,    // Возврат по Z к началу прохода
+        STAGE_DONE
+    };
+
+    long pointZ[GCODE_CYCLE_POINTS];    // Контур с припуском, Z в деци-микронах
+    long pointX[GCODE_CYCLE_POINTS];    // Контур с припуском, X в деци-микронах
+    int pointCount;                     // Число точек контура
+    int pointIndex;                     // Следующая точка получистового прохода
+
+    const GCodeBlock* blocks;           // Образ программы (для G70)
+    uint32_t blockIndex;                // Следующий кадр контура для G70
+    uint32_t lastIndex;                 // Последний кадр контура
+
+    Stage stage;                        // Текущий этап
+    uint32_t line;                      // Строка кадра цикла (для отображения и ошибок)
+    long startZ, startX;                // Начальная точка цикла
+    long depth;                         // Глубина резания
+    long retract;                       // Отвод после прохода
+    long feed;                          // Подача черновых проходов
+    int dirZ;                           // Направление резания по Z (+1/-1)
+    int dirX;                           // Направление врезания по X (-1 - наружное точение)
+    bool entryRapid;                    // Подход к контуру на ускоренной подаче (первый кадр - G0)
+    long level;                         // Текущий уровень прохода по X
+    long cutEndZ;                       // Конец текущего прохода по Z
+
+    // Параметры цикла G76
+    long threadEndZ;                    // Конец резьбы по Z
+    long threadCrestX;                  // Вершина профиля по X
+    long threadHeight;                  // Высота профиля
+    long threadFirst;                   // Глубина первого прохода
+    long threadMinStep;                 // Минимальное приращение глубины
+    long threadRoughLimit;              // Глубина последнего чернового прохода
+    long threadLead;                    // Ход (шаг * число заходов)
+    long threadChamfer;                 // Длина сбега
+    float threadFlank;                  // Смещение по Z на единицу глубины (tg половины угла)
+    int threadStarts;                   // Число заходов
+    int threadStart;                    // Текущий заход
+    int threadPass;                     // Номер чернового прохода
+    int springLeft;                     // Оставшиеся зачистные проходы
+    int passCount;                      // Общее число проходов (на один заход)
+    long threadDepth;                   // Глубина текущего прохода
+    const char* error;                  // Описание ошибки построения цикла
+
+public:
+    /**
+     * @brief Конструктор генератора циклов
+     */
+    CannedCycle() : pointCount(0), pointIndex(0), blocks(nullptr), blockIndex(0), lastIndex(0),
+                    stage(STAGE_DONE), line(0), startZ(0), startX(0), depth(0), retract(0),
+                    feed(0), dirZ(-1), dirX(-1), entryRapid(true), level(0), cutEndZ(0),
+                    threadEndZ(0), threadCrestX(0), threadHeight(0), threadFirst(0), threadMinStep(1),
+                    threadRoughLimit(0), threadLead(0), threadChamfer(0), threadFlank(0),
+                    threadStarts(1), threadStart(0), threadPass(0), springLeft(0), passCount(0),
+                    threadDepth(0), error(nullptr) {}
+
+    /**
+     * @brief Подготовка чернового цикла G71
+     * @param image Образ программы
+     * @param first Индекс первого кадра контура (N=P)
+     * @param last Индекс последнего кадра контура (N=Q)
+     * @param cycle Кадр G71 с параметрами цикла
+     * @param z Начальная точка Z (текущая запрограммированная позиция)
+     * @param x Начальная точка X
+     * @param feedDuSec Подача черновых проходов
+     * @return false если контур не подходит для цикла (описание в getError())
+     */
+    bool beginRoughing(const GCodeBlock* image, uint32_t first, uint32_t last,
+                       const GCodeBlock& cycle, long z, long x, long feedDuSec) {
+        start(cycle.line, z, x);
+        depth = cycle.i;
+        retract = cycle.r;
+        feed = feedDuSec;
+
+        if (!buildContour(image, first, last)) {
+            return false;
+        }
+        for (int i = 0; i < pointCount; i++) {
+            pointZ[i] += cycle.z;
+            pointX[i] += cycle.x;
+        }
+
+        // Направления резания определяются контуром и начальной точкой
+        long spanZ = pointZ[pointCount - 1] - pointZ[0];
+        if (spanZ == 0 || startX == pointX[0]) {
+            return fail("Контур G71 не задает точение");
+        }
+        dirZ = spanZ > 0 ? 1 : -1;
+        dirX = startX > pointX[0] ? -1 : 1;
+
+        // Контур типа I: по ходу контура деталь только расширяется (для расточки - сужается)
+        for (int i = 1; i < pointCount; i++) {
+            if ((pointX[i] - pointX[i - 1]) * dirX > 0 || (pointZ[i] - pointZ[i - 1]) * dirZ < 0) {
+                return fail("Контур G71 не монотонный");
+            }
+        }
+
+        level = startX;
+        stage = STAGE_PLUNGE;
+        return true;
+    }
+
+    /**
+     * @brief Подготовка чистового цикла G70
+     * @param image Образ программы
+     * @param first Индекс первого кадра контура (N=P)
+     * @param last Индекс последнего кадра контура (N=Q)
+     * @param cycleLine Строка кадра G70
+     * @param z Начальная точка Z
+     * @param x Начальная точка X
+     * @return false если в контуре есть вложенный цикл
+     */
+    bool beginFinishing(const GCodeBlock* image, uint32_t first, uint32_t last,
+                        uint32_t cycleLine, long z, long x) {
+        start(cycleLine, z, x);
+        for (uint32_t i = first; i <= last; i++) {
+            if (isCycle(image[i].motion) || image[i].command != GCODE_CMD_NONE) {
+                return fail("Недопустимый кадр в контуре G70");
+            }
+        }
+        blocks = image;
+        blockIndex = first;
+        lastIndex = last;
+        stage = STAGE_FINISH;
+        return true;
+    }
+
+    /**
+     * @brief Подготовка цикла нарезания резьбы G76
+     * @param cycle Кадр G76 с параметрами цикла
+     * @param z Начальная точка Z (вне детали, до начала резьбы)
+     * @param x Начальная точка X (над вершиной профиля)
+     * @return false если параметры не задают резьбу (описание в getError())
+     *
+     * Наружная резьба нарезается, если начальная точка дальше от оси, чем дно
+     * резьбы, внутренняя - если ближе.
+     */
+    bool beginThreading(const GCodeBlock& cycle, long z, long x) {
+        start(cycle.line, z, x);
+        bool relative = cycle.flags & GCODE_RELATIVE;
+        threadEndZ = (cycle.flags & GCODE_HAS_Z) ? (relative ? z + cycle.z : cycle.z) : z;
+        long rootX = (cycle.flags & GCODE_HAS_X) ? (relative ? x + cycle.x : cycle.x) : x;
+        if (threadEndZ == startZ || rootX == startX) {
+            return fail("Резьба G76 нулевой длины или глубины");
+        }
+        dirZ = threadEndZ > startZ ? 1 : -1;
+        dirX = startX > rootX ? -1 : 1;
+
+        threadHeight = cycle.p;
+        threadCrestX = rootX - dirX * threadHeight;
+        if ((startX - threadCrestX) * dirX > 0) {
+            return fail("Начальная точка G76 внутри профиля резьбы");
+        }
+        if (cycle.r >= threadHeight) {
+            return fail("Припуск G76 больше высоты профиля");
+        }
+
+        threadFirst = min((long)cycle.q, threadHeight);
+        threadMinStep = max(1L, (long)cycle.i);
+        threadRoughLimit = threadHeight - cycle.r;
+        threadStarts = max(1, (int)cycle.starts);
+        threadLead = cycle.k * threadStarts;
+        threadChamfer = min((long)cycle.chamfer * threadLead / 10, labs(threadEndZ - startZ));
+        threadFlank = tan(cycle.angle * PI / 360);
+
+        // Планирование: число проходов известно до начала первого
+        threadDepth = 0;
+        threadPass = 0;
+        springLeft = cycle.springPasses;
+        passCount = 0;
+        while (nextDepth()) {
+            if (++passCount > GCODE_THREAD_PASSES_MAX) {
+                return fail("Слишком много проходов G76");
+            }
+        }
+        threadDepth = 0;
+        threadPass = 0;
+        springLeft = cycle.springPasses;
+
+        nextDepth();
+        threadStart = 0;
+        stage = STAGE_THREAD_ENTRY;
+        return true;
+    }
+
+    /**
+     * @brief Получение следующего кадра цикла
+     * @param block Кадр для исполнения
+     * @return false если цикл завершен
+     */
+    bool next(GCodeBlock& block) {
+        switch (stage) {
+            case STAGE_PLUNGE:
+                // Уровни идут от начальной точки к началу контура, последний слой снимает получистовой проход
+                level += dirX * depth;
+                if ((level - pointX[0]) * dirX >= 0) {
+                    stage = STAGE_CONTOUR_ENTRY;
+                    return next(block);
+                }
+                cutEndZ = intersect(level);
+                makeMove(block, GCODE_MOTION_RAPID, startZ, level);
+                stage = STAGE_CUT;
+                return true;
+
+            case STAGE_CUT:
+                makeMove(block, GCODE_MOTION_LINEAR, cutEndZ, level);
+                stage = STAGE_RETRACT;
+                return true;
+
+            case STAGE_RETRACT:
+                makeMove(block, GCODE_MOTION_RAPID, cutEndZ - dirZ * retract, level - dirX * retract);
+                stage = STAGE_RETURN;
+                return true;
+
+            case STAGE_RETURN:
+                makeMove(block, GCODE_MOTION_RAPID, startZ, level - dirX * retract);
+                stage = STAGE_PLUNGE;
+                return true;
+
+            case STAGE_CONTOUR_ENTRY:
+                makeMove(block, entryRapid ? GCODE_MOTION_RAPID : GCODE_MOTION_LINEAR, pointZ[0], pointX[0]);
+                pointIndex = 1;
+                stage = STAGE_CONTOUR;
+                return true;
+
+            case STAGE_CONTOUR:
+                if (pointIndex < pointCount) {
+                    makeMove(block, GCODE_MOTION_LINEAR, pointZ[pointIndex], pointX[pointIndex]);
+                    pointIndex++;
+                    return true;
+                }
+                stage = STAGE_EXIT;
+                return next(block);
+
+            case STAGE_FINISH:
+                if (blockIndex <= lastIndex) {
+                    block = blocks[blockIndex++];
+                    return true;
+                }
+                stage = STAGE_EXIT;
+                return next(block);
+
+            case STAGE_EXIT:
+                makeMove(block, GCODE_MOTION_RAPID, LONG_MIN, startX);
+                stage = STAGE_HOME;
+                return true;
+
+            case STAGE_HOME:
+                makeMove(block, GCODE_MOTION_RAPID, startZ, LONG_MIN);
+                stage = STAGE_DONE;
+                return true;
+
+            case STAGE_THREAD_ENTRY:
+                // Врезание вдоль боковой стороны профиля - смещение начала прохода по Z
+                level = threadCrestX + dirX * threadDepth;
+                makeMove(block, GCODE_MOTION_RAPID, startZ + dirZ * (long)(threadDepth * threadFlank), level);
+                stage = STAGE_THREAD_CUT;
+                return true;
+
+            case STAGE_THREAD_CUT:
+                makeThread(block, threadEndZ - dirZ * threadChamfer, level,
+                           360L * 10000 * threadStart / threadStarts);
+                stage = threadChamfer > 0 ? STAGE_THREAD_CHAMFER : STAGE_THREAD_RETRACT;
+                return true;
+
+            case STAGE_THREAD_CHAMFER:
+                makeThread(block, threadEndZ, level - dirX * threadChamfer, 0);
+                stage = STAGE_THREAD_RETRACT;
+                return true;
+
+            case STAGE_THREAD_RETRACT:
+                makeMove(block, GCODE_MOTION_RAPID, LONG_MIN, startX);
+                stage = STAGE_THREAD_RETURN;
+                return true;
+
+            case STAGE_THREAD_RETURN:
+                makeMove(block, GCODE_MOTION_RAPID, startZ, LONG_MIN);
+                // Все заходы на текущей глубине, затем следующая глубина
+                if (++threadStart >= threadStarts) {
+                    threadStart = 0;
+                    if (!nextDepth()) {
+                        stage = STAGE_DONE;
+                        return true;
+                    }
+                }
+                stage = STAGE_THREAD_ENTRY;
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * @brief Описание ошибки построения цикла
+     */
+    const char* getError() const {
+        return error;
+    }
+
+    /**
+     * @brief Число проходов цикла G76 на один заход (известно после beginThreading)
+     */
+    int getPassCount() const {
+        return passCount;
+    }
+
+    /**
+     * @brief Проверка типа движения на цикл G70/G71/G76
+     */
+    static bool isCycle(uint8_t motion) {
+        return motion == GCODE_MOTION_ROUGH || motion == GCODE_MOTION_FINISH ||
+               motion == GCODE_MOTION_THREAD_CYCLE;
+    }
+
+private:
+    /**
+     * @brief Общая подготовка цикла
+     */
+    void start(uint32_t cycleLine, long z, long x) {
+        line = cycleLine;
+        startZ = z;
+        startX = x;
+        pointCount = 0;
+        error = nullptr;
+        stage = STAGE_DONE;
+    }
+
+    /**
+     * @brief Перевод кадров контура в ломаную
+     * @return false при ошибке в контуре или переполнении буфера
+     */
+    bool buildContour(const GCodeBlock* image, uint32_t first, uint32_t last) {
+        long z = startZ;
+        long x = startX;
+        bool entry = true;
+
+        for (uint32_t index = first; index <= last; index++) {
+            const GCodeBlock& block = image[index];
+            if (isCycle(block.motion) || block.motion == GCODE_MOTION_THREAD || block.command != GCODE_CMD_NONE) {
+                return fail("Недопустимый кадр в контуре G71");
+            }
+            if (GCodeParser::hasVariables(block)) {
+                return fail("Переменные в контуре G71 не поддерживаются");
+            }
+            if (block.motion == GCODE_MOTION_NONE || block.motion == GCODE_MOTION_DWELL) {
+                continue;
+            }
+
+            long fromZ = z;
+            long fromX = x;
+            bool relative = block.flags & GCODE_RELATIVE;
+            if (block.flags & GCODE_HAS_Z) {
+                z = relative ? z + block.z : block.z;
+            }
+            if (block.flags & GCODE_HAS_X) {
+                x = relative ? x + block.x : block.x;
+            }
+
+            if (entry) {
+                // Первый кадр контура - подход из начальной точки, его конец - начало контура
+                entryRapid = block.motion == GCODE_MOTION_RAPID;
+                entry = false;
+                if (!addPoint(z, x)) return false;
+            } else if (block.motion == GCODE_MOTION_ARC_CW || block.motion == GCODE_MOTION_ARC_CCW) {
+                if (!addArc(block, fromZ, fromX, z, x)) return false;
+            } else if (!addPoint(z, x)) {
+                return false;
+            }
+        }
+
+        if (pointCount < 2) {
+            return fail("Контур G71 пуст");
+        }
+        return true;
+    }
+
+    /**
+     * @brief Добавление дуги контура в виде хорд
+     *
+     * Выполняется один раз при подготовке цикла, поэтому используется
+     * тригонометрия с плавающей точкой.
+     */
+    bool addArc(const GCodeBlock& block, long fromZ, long fromX, long toZ, long toX) {
+        bool clockwise = block.motion == GCODE_MOTION_ARC_CW;
+        long centerZ, centerX;
+        if (block.flags & GCODE_HAS_R) {
+            if (!ArcInterpolator::centerFromRadius(fromZ, fromX, toZ, toX, block.r, clockwise, centerZ, centerX)) {
+                return fail("Радиус дуги меньше половины хорды");
+            }
+        } else {
+            centerZ = fromZ + block.k;
+            centerX = fromX + block.i;
+        }
+
+        float radius = sqrt(sq((float)fromZ - centerZ) + sq((float)fromX - centerX));
+        float a0 = atan2((float)fromX - centerX, (float)fromZ - centerZ);
+        float a1 = atan2((float)toX - centerX, (float)toZ - centerZ);
+        float sweep = clockwise ? a0 - a1 : a1 - a0;
+        while (sweep <= 0) {
+            sweep += 2 * PI;
+        }
+
+        // Угол хорды со стрелкой GCODE_ARC_TOLERANCE_DU: 2 * acos(1 - tol / R)
+        float chordAngle = radius > GCODE_ARC_TOLERANCE_DU ?
+                           2 * acos(1 - (float)GCODE_ARC_TOLERANCE_DU / radius) : PI / 2;
+        int chords = max(1, (int)ceil(sweep / chordAngle));
+        for (int k = 1; k < chords; k++) {
+            float angle = a0 + (clockwise ? -sweep : sweep) * k / chords;
+            if (!addPoint(centerZ + (long)round(radius * cos(angle)), centerX + (long)round(radius * sin(angle)))) {
+                return false;
+            }
+        }
+        return addPoint(toZ, toX);
+    }
+
+    /**
+     * @brief Переход к глубине следующего прохода G76
+     * @return false если все проходы выполнены
+     */
+    bool nextDepth() {
+        if (threadDepth < threadRoughLimit) {
+            threadPass++;
+            long depth = (long)ArcInterpolator::isqrt((long long)threadFirst * threadFirst * threadPass);
+            threadDepth = min(max(depth, threadDepth + threadMinStep), threadRoughLimit);
+            return true;
+        }
+        if (threadDepth < threadHeight) {
+            threadDepth = threadHeight; // Чистовой проход на полную высоту профиля
+            return true;
+        }
+        if (springLeft > 0) {
+            springLeft--;
+            return true;
+        }
+        return false;
+    }
+
+    bool addPoint(long z, long x) {
+        if (pointCount >= GCODE_CYCLE_POINTS) {
+            return fail("Контур G71 слишком длинный");
+        }
+        pointZ[pointCount] = z;
+        pointX[pointCount] = x;
+        pointCount++;
+        return true;
+    }
+
+    /**
+     * @brief Конец прохода по Z на уровне X - пересечение с контуром
+     * @param x Уровень прохода
+     * @return Координата Z пересечения (конец контура, если уровень выше контура)
+     */
+    long intersect(long x) const {
+        for (int i = 1; i < pointCount; i++) {
+            // По ходу контура X монотонно удаляется от оси, первый сегмент, дошедший до уровня, - искомый
+            if ((pointX[i] - x) * dirX <= 0) {
+                long spanX = pointX[i] - pointX[i - 1];
+                if (spanX == 0) {
+                    return pointZ[i];
+                }
+                return pointZ[i - 1] + (long)((long long)(pointZ[i] - pointZ[i - 1]) * (x - pointX[i - 1]) / spanX);
+            }
+        }
+        return pointZ[pointCount - 1];
+    }
+
+    /**
+     * @brief Заполнение кадра абсолютного перемещения
+     * @param z Координата Z (LONG_MIN - без перемещения по Z)
+     * @param x Координата X (LONG_MIN - без перемещения по X)
+     */
+    void makeMove(GCodeBlock& block, uint8_t motion, long z, long x) const {
+        memset(&block, 0, sizeof(block));
+        block.line = line;
+        block.motion = motion;
+        if (z != LONG_MIN) {
+            block.z = z;
+            block.flags |= GCODE_HAS_Z;
+        }
+        if (x != LONG_MIN) {
+            block.x = x;
+            block.flags |= GCODE_HAS_X;
+        }
+        if (motion == GCODE_MOTION_LINEAR) {
+            block.feed = feed;
+            block.flags |= GCODE_HAS_F;
+        }
+    }
+
+    /**
+     * @brief Заполнение кадра G33 (абсолютные координаты)
+     * @param phase Угол начала в 0.0001° (номер захода)
+     */
+    void makeThread(GCodeBlock& block, long z, long x, long phase) const {
+        makeMove(block, GCODE_MOTION_THREAD, z, x);
+        block.k = threadLead;
+        block.q = phase;
+        block.flags |= GCODE_HAS_K | GCODE_HAS_Q;
+    }
+
+    bool fail(const char* message) {
+        error = message;
+        stage = STAGE_DONE;
+        return false;
+    }
+};
+
+#endif // CANNED_CYCLE_H
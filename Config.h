@@ -203,6 +203,12 @@ const float LINEAR_INTERPOLATION_PRECISION = 0.1;
 // Допуск ожидания завершения движения в шагах
 const long GCODE_WAIT_EPSILON_STEPS = 10;
 
+// Число кадров упреждающего просмотра для расчета скорости на стыках отрезков (G64)
+const int GCODE_LOOKAHEAD_BLOCKS = 16;
+
+// Допустимое отклонение от угла на стыке отрезков в деци-микронах (больше - быстрее углы)
+const long GCODE_JUNCTION_DEVIATION_DU = 100;
+
 // Останавливать ли выполнение G-кода при остановке шпинделя
 const bool SPINDLE_PAUSES_GCODE = true;
 
@@ -215,6 +221,41 @@ const long GCODE_FEED_DEFAULT_DU_SEC = 20000;
 // Минимальная скорость подачи для G-кода (деци-микроны в секунду) - F1
 const float GCODE_FEED_MIN_DU_SEC = 167;
 
+// Наибольшая подача, принимаемая в программе G-кода (мм/мин)
+const long GCODE_FEED_MAX_MM_MIN = 10000;
+
+// Допустимое расхождение радиуса дуги в начальной и конечной точках (деци-микроны)
+const long GCODE_ARC_TOLERANCE_DU = 50;
+
+// Размер буфера точек контура цикла G71 (дуги контура занимают несколько точек)
+const int GCODE_CYCLE_POINTS = 128;
+
+// Угол профиля резьбы G76 по умолчанию и наибольший допустимый (градусы)
+const int GCODE_THREAD_ANGLE_DEFAULT = 60;
+const int GCODE_THREAD_ANGLE_MAX = 80;
+
+// Наибольшее число зачистных проходов G76
+const int GCODE_THREAD_SPRING_MAX = 9;
+
+// Наибольшее число проходов G76 (защита от слишком малой глубины прохода)
+const int GCODE_THREAD_PASSES_MAX = 200;
+
+// Число переменных #1..#(GCODE_VARIABLE_COUNT - 1), не больше 128
+const int GCODE_VARIABLE_COUNT = 100;
+
+// Наибольшая вложенность вызовов подпрограмм M98
+const int GCODE_CALL_DEPTH = 4;
+
+// Наибольшая вложенность циклов WHILE/END (номера DO1..DOn) в одной подпрограмме
+const int GCODE_LOOP_DEPTH = 3;
+
+// Число запоминаемых положений подпрограмм в образе (повторный вызов без поиска)
+const int GCODE_SUBPROGRAM_CACHE = 8;
+
+// Наибольшее число кадров переходов и присваиваний за один цикл задачи движения
+// (цикл WHILE без перемещений не занимает задачу движения целиком)
+const int GCODE_FLOW_STEPS_MAX = 32;
+
 // =============================================================================
 // КОНСТАНТЫ РУЧНОГО УПРАВЛЕНИЯ
 // =============================================================================
@@ -235,6 +276,34 @@ const long MOVE_STEP_IMP_1 = 25400; // 1/10"
 const long MOVE_STEP_IMP_2 = 2540;  // 1/100"
 const long MOVE_STEP_IMP_3 = 254;   // 1/1000" (1 thou)
 
+// Наибольшее время сна задачи клавиатуры без прерывания, мс. Очередь TCA8418
+// проверяется и без него, если фронт INT потерян или линия не подключена
+const unsigned long KEYPAD_POLL_MS = 50;
+
+// Глубина очереди событий TCA8418
+const int KEYPAD_FIFO_SIZE = 10;
+
+// Повтор удерживаемых клавиш (+, -, забой): первый повтор через задержку,
+// каждые KEY_REPEAT_ACCEL_COUNT повторов период уменьшается вдвое до наименьшего
+const unsigned long KEY_REPEAT_DELAY_MS = 400;
+const unsigned long KEY_REPEAT_INTERVAL_MS = 150;
+const unsigned long KEY_REPEAT_MIN_INTERVAL_MS = 25;
+const int KEY_REPEAT_ACCEL_COUNT = 5;
+
+// Удержание кнопки ВЫКЛ для сброса системы, мс
+const unsigned long KEY_RESET_HOLD_MS = 3000;
+
+// Замер задержки от нажатия до движения (KeyLatency): верхняя граница первой
+// корзины гистограммы, мкс (каждая следующая вдвое больше)
+const unsigned long KEY_LATENCY_FIRST_BUCKET_US = 128;
+
+// Ожидание первого шага после изменения состояния кнопкой, мс. Дольше - шаг
+// зависит уже не от кнопки (например, шпиндель стоит)
+const unsigned long KEY_LATENCY_STEP_TIMEOUT_MS = 2000;
+
+// Отчет о задержках в журнал через каждые столько нажатий
+const unsigned long KEY_LATENCY_REPORT_TRACES = 20;
+
 // =============================================================================
 // ВЕРСИИ СИСТЕМЫ И НАСТРОЙКИ ПАМЯТИ
 // =============================================================================
@@ -251,8 +320,109 @@ const long MOVE_STEP_IMP_3 = 254;   // 1/1000" (1 thou)
 // Пространство имен для хранения основных настроек
 #define PREF_NAMESPACE "h4"
 
-// Пространство имен для хранения G-код программ
-#define GCODE_NAMESPACE "gc"
+// =============================================================================
+// ХРАНЕНИЕ ПРОГРАММ G-КОДА (ФАЙЛОВАЯ СИСТЕМА LITTLEFS)
+// =============================================================================
+
+// Метка раздела флеш-памяти с файловой системой программ (раздел данных по умолчанию)
+#define GCODE_FS_PARTITION "spiffs"
+
+// Точка монтирования файловой системы программ
+#define GCODE_FS_BASE_PATH "/littlefs"
+
+// Каталог программ G-кода на файловой системе
+#define GCODE_DIR "/gc"
+
+// Файл индекса каталога программ (список программ без обхода каталога)
+#define GCODE_INDEX_FILE "/gc/index"
+
+// Максимальное число программ в индексе
+const int GCODE_MAX_PROGRAMS = 32;
+
+// Максимальная длина имени программы (не длиннее строки дисплея)
+const int GCODE_NAME_MAX = 20;
+
+// Размер блока чтения программы из флеш-памяти в байтах
+const int GCODE_READ_CHUNK = 256;
+
+// Максимальная длина одной строки G-кода в символах
+const int GCODE_LINE_MAX = 96;
+
+// Емкость очереди разобранных кадров между задачей G-кода и задачей движения
+const int GCODE_QUEUE_BLOCKS = 16;
+
+// Метка раздела флеш-памяти со скомпилированными образами программ (см. partitions.csv)
+#define GCODE_IMAGE_PARTITION "gcode"
+
+// Число кадров, записываемых во флеш-память за одну операцию при компиляции
+const int GCODE_IMAGE_WRITE_BLOCKS = 16;
+
+// Число кадров образа между контрольными точками модального состояния (продолжение с произвольной строки)
+const int GCODE_CHECKPOINT_BLOCKS = 256;
+
+// =============================================================================
+// ПОТОКОВАЯ ПЕРЕДАЧА И ЗАГРУЗКА G-КОДА ПО ПОСЛЕДОВАТЕЛЬНОМУ ПОРТУ
+// =============================================================================
+
+// Скорость последовательного порта (журнал и поток G-кода)
+const long SERIAL_BAUD = 115200;
+
+// Размер буфера приема строк G-кода (и буфера UART) в байтах - окно подсчета символов на стороне хоста
+const int GCODE_SERIAL_RX_BUFFER = 1024;
+
+// Наибольший размер данных в одной порции загрузки программы по порту в байтах
+const int GCODE_UPLOAD_CHUNK = 256;
+
+// Время, за которое порция загрузки должна прийти целиком, в миллисекундах
+const unsigned long GCODE_UPLOAD_FRAME_TIMEOUT_MS = 1000;
+
+// =============================================================================
+// ЖК-ДИСПЛЕЙ
+// =============================================================================
+
+// Размер дисплея HD44780 в знакоместах
+const int LCD_COLS = 20;
+const int LCD_ROWS = 4;
+
+// Тайминги шины HD44780 (RW не подключен, флаг занятости не читается).
+// Время выполнения команды по datasheet - 37 мкс при 270 кГц; контроллерам-клонам
+// с медленным генератором может понадобиться до 55 мкс
+const unsigned long LCD_EXEC_US = 40;
+const unsigned long LCD_CLEAR_US = 1600;        // Очистка экрана
+const unsigned long LCD_POWER_ON_MS = 50;       // Пауза после подачи питания
+const unsigned long LCD_INIT_FIRST_US = 4100;   // После первой команды выбора шины
+const unsigned long LCD_INIT_NEXT_US = 100;     // После второй команды выбора шины
+// Такты процессора 240 МГц: установка RS и данных до строба (от 40 нс)
+// и ширина строба E (от 450 нс)
+const uint32_t LCD_SETUP_CYCLES = 16;
+const uint32_t LCD_ENABLE_PULSE_CYCLES = 120;
+
+// Неизменные знакоместа внутри серии изменений, которые переписываются вместо
+// установки курсора (установка курсора - одна команда, как и запись символа)
+const int LCD_RUN_GAP_MAX = 1;
+
+// Наибольшее время одной порции вывода на дисплей в микросекундах. Между порциями
+// задача дисплея уступает ядро 0 задаче клавиатуры, поэтому вывод кадра задерживает
+// обработку нажатия не больше чем на это время (запись знакоместа - около 40 мкс)
+const unsigned long LCD_SLICE_BUDGET_US = 500;
+
+// Время показа заставки при включении, мс
+const unsigned long DISPLAY_SPLASH_MS = 2000;
+
+// Наименьший промежуток между кадрами, мс: события за это время дают один кадр
+const unsigned long DISPLAY_MIN_INTERVAL_MS = 50;
+
+// Перерисовка без событий (время, сообщения G-кода и прочее без уведомлений), мс
+const unsigned long DISPLAY_IDLE_REFRESH_MS = 1000;
+
+// Сдвиг оси, после которого позиция на дисплее обновляется, в деци-микронах (0.001 мм)
+const long DISPLAY_POSITION_STEP_DU = 10;
+
+// Ширина диапазона оборотов шпинделя, смена которого обновляет дисплей, об/мин
+const int DISPLAY_RPM_STEP = 5;
+
+// Окно накопления показателей страниц диагностики, мс
+const unsigned long DIAG_WINDOW_MS = 1000;
 
 // =============================================================================
 // КОНТАКТЫ ОБОРУДОВАНИЯ (ПИНЫ ESP32)
@@ -272,6 +442,7 @@ const long MOVE_STEP_IMP_3 = 254;   // 1/1000" (1 thou)
 #define BUZZ 4      // Пьезопищалка
 #define SCL 5       // I2C SCL для клавиатуры
 #define SDA 6       // I2C SDA для клавиатуры
+#define KEY_INT 3   // Прерывание клавиатуры TCA8418 (INT, открытый сток, активный низкий)
 
 // Контакты оси A1
 #define A11 9
@@ -429,9 +600,6 @@ const long RPM_BULK = ENCODER_STEPS_INT;
 // Не обновлять RPM чаще чем раз в секунду (избежание мерцания)
 const long RPM_UPDATE_INTERVAL_MICROS = 1000000;
 
-// Начальное значение хэша для дисплея (случайное число которое вряд ли возникнет естественно)
-#define LCD_HASH_INITIAL -3845709
-
 // Макросы для удобства работы с пинами
 #define DREAD(x) digitalRead(x)
 #define DHIGH(x) digitalWrite(x, HIGH)
@@ -0,0 +1,208 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "RussianLogger.h"
+#include "AxisController.h"
+#include "SpindleEncoder.h"
+
+// Оси в снимке диагностики
+#define DIAG_AXIS_Z 0
+#define DIAG_AXIS_X 1
+#define DIAG_AXES 2
+
+// Наибольшее число задач, запас стека которых отслеживается
+#define DIAG_TASKS_MAX 4
+
+/**
+ * @struct DiagnosticsSnapshot
+ * @brief Показатели работы за последнее завершенное окно DIAG_WINDOW_MS
+ */
+struct DiagnosticsSnapshot {
+    unsigned long windowCount;          // Номер окна (0 - окон еще не было)
+    unsigned long loopCount;            // Циклов движения за окно
+    unsigned long loopPeriodUs;         // Средний период цикла движения
+    unsigned long loopWorstUs;          // Наибольший период цикла движения
+    long stepRate[DIAG_AXES];           // Наибольшая скорость оси, шагов/с
+    long lagDu[DIAG_AXES];              // Наибольшее отставание оси от цели, деци-микроны
+    int rpm;                            // Обороты шпинделя в конце окна
+    int rpmMin;                         // Наименьшие обороты за окно
+    int rpmMax;                         // Наибольшие обороты за окно
+
+    // Заполняются при чтении снимка
+    uint32_t freeHeap;                  // Свободная куча, байт
+    uint32_t minFreeHeap;               // Наименьшая свободная куча с запуска, байт
+    uint32_t stackFree;                 // Наименьший запас стека среди задач, байт
+    const char* stackTask;              // Задача с наименьшим запасом стека
+    unsigned long logDropped;           // Вытесненных из буфера журнала записей
+};
+
+/**
+ * @class Diagnostics
+ * @brief Сбор показателей работы для страниц диагностики дисплея
+ *
+ * recordMotionCycle() вызывается задачей движения в начале каждого цикла:
+ * измеряет период цикла и собирает наибольшие скорости и отставания осей и
+ * разброс оборотов шпинделя за окно DIAG_WINDOW_MS. По окончании окна итоги
+ * публикуются в снимок.
+ *
+ * Снимок читается другими задачами без блокировки задачи движения: писатель
+ * делает счетчик версии нечетным на время записи, читатель копирует снимок и
+ * повторяет чтение, если версия была нечетной или изменилась за время копирования.
+ */
+class Diagnostics {
+private:
+    AxisController& zAxis;              // Ось Z
+    AxisController& xAxis;              // Ось X
+    SpindleEncoder& spindle;            // Энкодер шпинделя
+
+    // Текущее окно (только задача движения)
+    unsigned long windowStartUs;        // Начало окна
+    unsigned long lastCycleUs;          // Начало предыдущего цикла (0 - циклов не было)
+    unsigned long loopCount;
+    unsigned long loopWorstUs;
+    long stepRateMax[DIAG_AXES];
+    long lagStepsMax[DIAG_AXES];
+    int rpmMin;
+    int rpmMax;
+
+    // Опубликованный снимок
+    DiagnosticsSnapshot published;
+    volatile uint32_t version;          // Нечетный во время записи снимка
+
+    // Отслеживаемые задачи
+    TaskHandle_t tasks[DIAG_TASKS_MAX];
+    const char* taskNames[DIAG_TASKS_MAX];
+    int taskCount;
+
+public:
+    /**
+     * @brief Конструктор сборщика показателей
+     * @param zAxisCtrl Ссылка на ось Z
+     * @param xAxisCtrl Ссылка на ось X
+     * @param spindleEnc Ссылка на энкодер шпинделя
+     */
+    Diagnostics(AxisController& zAxisCtrl, AxisController& xAxisCtrl, SpindleEncoder& spindleEnc)
+        : zAxis(zAxisCtrl), xAxis(xAxisCtrl), spindle(spindleEnc), windowStartUs(0),
+          lastCycleUs(0), version(0), taskCount(0) {
+        memset(&published, 0, sizeof(published));
+        startWindow();
+    }
+
+    /**
+     * @brief Добавление задачи для отслеживания запаса стека
+     * @param name Имя задачи для отображения
+     * @param handle Хэндл задачи
+     */
+    void addTask(const char* name, TaskHandle_t handle) {
+        if (taskCount >= DIAG_TASKS_MAX || handle == NULL) {
+            LOG_WARNING("Диагностика", "Задача " + String(name) + " не отслеживается");
+            return;
+        }
+        taskNames[taskCount] = name;
+        tasks[taskCount] = handle;
+        taskCount++;
+    }
+
+    /**
+     * @brief Учет цикла движения (вызывать задаче движения в начале каждого цикла)
+     */
+    void recordMotionCycle() {
+        unsigned long nowUs = micros();
+        if (lastCycleUs != 0) {
+            loopWorstUs = max(loopWorstUs, nowUs - lastCycleUs);
+            loopCount++;
+        } else {
+            windowStartUs = nowUs;
+        }
+        lastCycleUs = nowUs;
+
+        sampleAxis(DIAG_AXIS_Z, zAxis);
+        sampleAxis(DIAG_AXIS_X, xAxis);
+        int rpm = spindle.getRpm();
+        rpmMin = min(rpmMin, rpm);
+        rpmMax = max(rpmMax, rpm);
+
+        if (nowUs - windowStartUs >= DIAG_WINDOW_MS * 1000UL) {
+            publish(nowUs, rpm);
+            windowStartUs = nowUs;
+            startWindow();
+        }
+    }
+
+    /**
+     * @brief Чтение снимка показателей (из любой задачи, кроме задачи движения)
+     * @param out Снимок
+     */
+    void read(DiagnosticsSnapshot& out) const {
+        uint32_t before;
+        do {
+            before = version;
+            __sync_synchronize();
+            out = published;
+            __sync_synchronize();
+        } while ((before & 1) != 0 || before != version);
+
+        out.freeHeap = ESP.getFreeHeap();
+        out.minFreeHeap = ESP.getMinFreeHeap();
+        out.stackFree = UINT32_MAX;
+        out.stackTask = "-";
+        for (int i = 0; i < taskCount; i++) {
+            uint32_t free = uxTaskGetStackHighWaterMark(tasks[i]);
+            if (free < out.stackFree) {
+                out.stackFree = free;
+                out.stackTask = taskNames[i];
+            }
+        }
+        out.logDropped = Logger.getDroppedCount();
+    }
+
+private:
+    /**
+     * @brief Начало нового окна накопления
+     */
+    void startWindow() {
+        loopCount = 0;
+        loopWorstUs = 0;
+        for (int i = 0; i < DIAG_AXES; i++) {
+            stepRateMax[i] = 0;
+            lagStepsMax[i] = 0;
+        }
+        rpmMin = INT_MAX;
+        rpmMax = 0;
+    }
+
+    /**
+     * @brief Учет скорости и отставания оси
+     */
+    void sampleAxis(int index, const AxisController& axis) {
+        stepRateMax[index] = max(stepRateMax[index], axis.getStepRate());
+        lagStepsMax[index] = max(lagStepsMax[index], (long)abs(axis.getPendingSteps()));
+    }
+
+    /**
+     * @brief Публикация итогов окна в снимок
+     * @param nowUs Конец окна
+     * @param rpm Обороты шпинделя в конце окна
+     */
+    void publish(unsigned long nowUs, int rpm) {
+        version++;
+        __sync_synchronize();
+        published.windowCount++;
+        published.loopCount = loopCount;
+        published.loopPeriodUs = loopCount > 0 ? (nowUs - windowStartUs) / loopCount : 0;
+        published.loopWorstUs = loopWorstUs;
+        published.stepRate[DIAG_AXIS_Z] = stepRateMax[DIAG_AXIS_Z];
+        published.stepRate[DIAG_AXIS_X] = stepRateMax[DIAG_AXIS_X];
+        published.lagDu[DIAG_AXIS_Z] = zAxis.stepsToDu(lagStepsMax[DIAG_AXIS_Z]);
+        published.lagDu[DIAG_AXIS_X] = xAxis.stepsToDu(lagStepsMax[DIAG_AXIS_X]);
+        published.rpm = rpm;
+        published.rpmMin = rpmMin == INT_MAX ? rpm : rpmMin;
+        published.rpmMax = rpmMax;
+        __sync_synchronize();
+        version++;
+    }
+};
+
+#endif // DIAGNOSTICS_H
@@ -0,0 +1,129 @@
+#ifndef DISPLAY_EVENTS_H
+#define DISPLAY_EVENTS_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "MotionController.h"
+#include "AxisController.h"
+#include "SpindleEncoder.h"
+
+// События, по которым перерисовывается дисплей (биты уведомления задачи дисплея)
+#define DISPLAY_EVENT_STATE 0x01        // Режим, включение, шаг, заходы, проходы или система измерений
+#define DISPLAY_EVENT_POSITION 0x02     // Позиция оси сдвинулась на видимую величину
+#define DISPLAY_EVENT_RPM 0x04          // Обороты перешли в другой диапазон
+#define DISPLAY_EVENT_INPUT 0x08        // Обработано нажатие клавиши
+
+/**
+ * @class DisplayEvents
+ * @brief Уведомление задачи дисплея об изменениях, видимых на дисплее
+ *
+ * Задача дисплея подписывается на уведомления и спит, пока их нет. poll()
+ * вызывается задачей движения после каждого цикла и сравнивает отображаемое
+ * состояние с последним отправленным по полям: позиции - с точностью
+ * DISPLAY_POSITION_STEP_DU, обороты - диапазонами DISPLAY_RPM_STEP. Задача
+ * клавиатуры уведомляет о нажатиях сама через notify(). Уведомления копятся
+ * битами, поэтому несколько событий до пробуждения дают один кадр.
+ */
+class DisplayEvents {
+private:
+    MotionController& motionController; // Режим, шаг и состояние
+    AxisController& zAxis;              // Ось Z
+    AxisController& xAxis;              // Ось X
+    SpindleEncoder& spindle;            // Обороты шпинделя
+
+    TaskHandle_t subscriber;            // Задача дисплея (NULL - уведомления не нужны)
+
+    // Состояние на момент последнего уведомления (только задача движения)
+    int mode;
+    bool enabled;
+    long pitch;
+    int starts;
+    int turnPasses;
+    int measure;
+    long zPositionDu;
+    long xPositionDu;
+    int rpmBucket;
+
+public:
+    /**
+     * @brief Конструктор источника уведомлений
+     * @param motionCtrl Ссылка на контроллер движения
+     * @param zAxisCtrl Ссылка на ось Z
+     * @param xAxisCtrl Ссылка на ось X
+     * @param spindleEnc Ссылка на энкодер шпинделя
+     */
+    DisplayEvents(MotionController& motionCtrl, AxisController& zAxisCtrl,
+                  AxisController& xAxisCtrl, SpindleEncoder& spindleEnc)
+        : motionController(motionCtrl), zAxis(zAxisCtrl), xAxis(xAxisCtrl), spindle(spindleEnc),
+          subscriber(NULL), mode(-1), enabled(false), pitch(0), starts(0), turnPasses(0), measure(-1),
+          zPositionDu(0), xPositionDu(0), rpmBucket(-1) {}
+
+    /**
+     * @brief Подписка задачи на уведомления (вызывать из самой задачи)
+     */
+    void subscribe(TaskHandle_t task) {
+        subscriber = task;
+    }
+
+    /**
+     * @brief Уведомление подписчика о событиях (из любой задачи)
+     * @param events Биты DISPLAY_EVENT_*
+     */
+    void notify(uint32_t events) {
+        if (subscriber != NULL) {
+            xTaskNotify(subscriber, events, eSetBits);
+        }
+    }
+
+    /**
+     * @brief Ожидание событий (вызывать подписчику)
+     * @param timeoutTicks Наибольшее время ожидания в тиках
+     * @return Накопленные биты DISPLAY_EVENT_* или 0 по истечении времени
+     */
+    uint32_t wait(TickType_t timeoutTicks) {
+        uint32_t events = 0;
+        xTaskNotifyWait(0, 0xFFFFFFFF, &events, timeoutTicks);
+        return events;
+    }
+
+    /**
+     * @brief Проверка отображаемого состояния и уведомление об изменениях
+     *
+     * Вызывается задачей движения после каждого цикла.
+     */
+    void poll() {
+        uint32_t events = 0;
+
+        if (motionController.getOperationMode() != mode || motionController.isEnabled() != enabled ||
+            motionController.getPitch() != pitch || motionController.getStarts() != starts ||
+            motionController.getTurnPasses() != turnPasses || motionController.getMeasure() != measure) {
+            mode = motionController.getOperationMode();
+            enabled = motionController.isEnabled();
+            pitch = motionController.getPitch();
+            starts = motionController.getStarts();
+            turnPasses = motionController.getTurnPasses();
+            measure = motionController.getMeasure();
+            events |= DISPLAY_EVENT_STATE;
+        }
+
+        long z = zAxis.getPositionDu();
+        long x = xAxis.getPositionDu();
+        if (abs(z - zPositionDu) >= DISPLAY_POSITION_STEP_DU || abs(x - xPositionDu) >= DISPLAY_POSITION_STEP_DU) {
+            zPositionDu = z;
+            xPositionDu = x;
+            events |= DISPLAY_EVENT_POSITION;
+        }
+
+        int bucket = spindle.getRpm() / DISPLAY_RPM_STEP;
+        if (bucket != rpmBucket) {
+            rpmBucket = bucket;
+            events |= DISPLAY_EVENT_RPM;
+        }
+
+        if (events != 0) {
+            notify(events);
+        }
+    }
+};
+
+#endif // DISPLAY_EVENTS_H
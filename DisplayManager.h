@@ -2,35 +2,43 @@
 #define DISPLAY_MANAGER_H
 
 #include <Arduino.h>
-#include <LiquidCrystal.h>
 #include "Config.h"
 #include "RussianLogger.h"
 #include "MotionController.h"
 #include "AxisController.h"
+#include "LcdParallel.h"
+#include "LcdFrameBuffer.h"
+#include "Diagnostics.h"
+#include "KeyLatency.h"
+
+// Страницы диагностики (весь дисплей)
+#define DIAG_PAGE_NONE 0            // Обычное отображение
+#define DIAG_PAGE_LOOP 1            // Цикл движения
+#define DIAG_PAGE_AXES 2            // Оси и шпиндель
+#define DIAG_PAGE_SYSTEM 3          // Память и журнал
+#define DIAG_PAGE_KEYS 4            // Задержка нажатий
+#define DIAG_PAGES 4
 
 /**
  * @class DisplayManager
  * @brief Управление ЖК-дисплеем и отображение информации о состоянии системы
  * 
- * Класс оптимизирует обновление дисплея, перерисовывая только измененные области
- * и реализует всю логику форматирования и отображения данных на русском языке.
- * Использует хэширование для определения необходимости обновления каждой строки.
+ * Каждый кадр рисуется целиком в теневой буфер знакомест LcdFrameBuffer, на
+ * дисплей уходят только изменившиеся знакоместа. Класс реализует всю логику
+ * форматирования и отображения данных на русском языке.
  */
 class DisplayManager {
 private:
-    LiquidCrystal& lcd;                 // Ссылка на объект дисплея
+    LcdParallel& lcd;                   // Ссылка на объект дисплея
     MotionController& motionController; // Ссылка на контроллер движения
-    
-    // Хэши для отслеживания изменений (оптимизация перерисовки)
-    long lineHashes[4];                 // Хэши для каждой из 4 строк дисплея
-    static constexpr long INITIAL_HASH = -3845709; // Начальное значение хэша
-    
-    // Пользовательские символы для дисплея
-    uint8_t customChars[7][8];          // Массив для хранения пользовательских символов
+    LcdFrameBuffer frame;               // Теневой буфер знакомест
+    Diagnostics& diagnostics;           // Показатели для страниц диагностики
+    KeyLatency& keyLatency;             // Задержка нажатий для страницы диагностики
     
     // Состояние отображения
     bool showAngle;                     // Показывать угол шпинделя
     bool showTacho;                     // Показывать обороты шпинделя
+    int diagPage;                       // Страница диагностики (DIAG_PAGE_*)
     bool splashScreen;                  // Показывать заставку
     unsigned long splashStartTime;      // Время начала показа заставки
     
@@ -41,32 +49,29 @@ private:
 public:
     /**
      * @brief Конструктор менеджера дисплея
-     * @param lcdRef Ссылка на объект дисплея LiquidCrystal
+     * @param lcdRef Ссылка на драйвер дисплея
      * @param motionCtrlRef Ссылка на контроллер движения
+     * @param diagnosticsRef Ссылка на сборщик показателей диагностики
+     * @param keyLatencyRef Ссылка на замер задержки нажатий
      */
-    DisplayManager(LiquidCrystal& lcdRef, MotionController& motionCtrlRef)
-        : lcd(lcdRef), motionController(motionCtrlRef), showAngle(false), 
-          showTacho(false), splashScreen(true), splashStartTime(millis()),
-          cachedRpm(0), lastRpmUpdate(0) {
-        
-        // Инициализация хэшей
-        for (int i = 0; i < 4; i++) {
-            lineHashes[i] = INITIAL_HASH;
-        }
-    }
+    DisplayManager(LcdParallel& lcdRef, MotionController& motionCtrlRef, Diagnostics& diagnosticsRef,
+                   KeyLatency& keyLatencyRef)
+        : lcd(lcdRef), motionController(motionCtrlRef), diagnostics(diagnosticsRef),
+          keyLatency(keyLatencyRef), showAngle(false), 
+          showTacho(false), diagPage(DIAG_PAGE_NONE), splashScreen(true), splashStartTime(millis()),
+          cachedRpm(0), lastRpmUpdate(0) {}
     
     /**
-     * @brief Инициализация дисплея и создание пользовательских символов
+     * @brief Инициализация дисплея
      * 
-     * Настраивает дисплей, создает пользовательские символы (значки ограничений, мм и т.д.)
-     * и выводит начальную заставку.
+     * Настраивает дисплей и выводит начальную заставку. Пользовательские символы
+     * (кириллица, значки ограничений, мм и т.д.) загружаются по мере появления
+     * на дисплее.
      */
     void begin() {
-        // Инициализация дисплея 20x4
-        lcd.begin(20, 4);
-        
-        // Создание пользовательских символов
-        createCustomCharacters();
+        // Инициализация дисплея 20x4 (дисплей очищается)
+        lcd.begin(LCD_COLS, LCD_ROWS);
+        frame.markCleared();
         
         // Показ заставки
         showSplashScreen();
@@ -75,41 +80,58 @@ public:
     }
     
     /**
-     * @brief Обновление отображения (должен вызываться периодически)
+     * @brief Обновление отображения (вызывается по событиям DisplayEvents)
+     * @return true если кадр нарисован, false пока показывается заставка
      * 
-     * Проверяет изменения в состоянии системы и обновляет соответствующие
-     * строки дисплея. Использует хэширование для оптимизации.
+     * Рисует кадр по текущему состоянию системы в теневой буфер. На дисплей
+     * отличия от показанного выводит flush().
      */
-    void update() {
-        // Показ заставки если активна
+    bool update() {
+        // Заставка держится на дисплее, пока не истечет время показа
         if (splashScreen) {
-            if (millis() - splashStartTime > 2000) { // Показывать 2 секунды
-                splashScreen = false;
-                lcd.clear();
-                // Сброс хэшей для принудительного обновления
-                for (int i = 0; i < 4; i++) {
-                    lineHashes[i] = INITIAL_HASH;
-                }
+            if (millis() - splashStartTime <= DISPLAY_SPLASH_MS) {
+                return false;
             }
-            return;
+            splashScreen = false;
         }
         
-        // Обновление строк если данные изменились
-        updateStatusLine();     // Строка 0: Режим и состояние
-        updatePitchLine();      // Строка 1: Шаг и заходы
-        updatePositionLine();   // Строка 2: Позиции осей
-        updateInfoLine();       // Строка 3: Информация и подсказки
+        frame.clear();
+        if (diagPage != DIAG_PAGE_NONE) {
+            renderDiagnostics();
+            frame.endFrame();
+            return true;
+        }
+        renderStatusLine();     // Строка 0: Режим и состояние
+        renderPitchLine();      // Строка 1: Шаг и заходы
+        renderPositionLine();   // Строка 2: Позиции осей
+        renderInfoLine();       // Строка 3: Информация и подсказки
+        frame.endFrame();
+        return true;
+    }
+    
+    /**
+     * @brief Вывод нарисованного кадра на дисплей порцией с ограничением времени
+     * @param budgetUs Время порции в микросекундах
+     * @return true если кадр выведен целиком
+     */
+    bool flush(unsigned long budgetUs) {
+        return frame.flush(lcd, budgetUs);
     }
     
     /**
      * @brief Отображение экрана заставки
      */
     void showSplashScreen() {
-        lcd.clear();
-        lcd.setCursor(6, 1);
-        lcd.print("NanoELS");
-        lcd.setCursor(6, 2);
-        lcd.print("H" + String(HARDWARE_VERSION) + " V" + String(SOFTWARE_VERSION));
+        frame.clear();
+        frame.setCursor(6, 1);
+        frame.print("NanoELS");
+        frame.setCursor(6, 2);
+        frame.print("H");
+        frame.print((long)HARDWARE_VERSION);
+        frame.print(" V");
+        frame.print((long)SOFTWARE_VERSION);
+        frame.endFrame();
+        frame.flush(lcd);
         
         LOG_INFO("Дисплей", "Показана заставка");
     }
@@ -117,23 +139,25 @@ public:
     /**
      * @brief Переключение отображаемой информации на нижней строке
      * 
-     * Циклически переключает между показом угла шпинделя, оборотов и другой информации.
+     * Циклически переключает между показом угла шпинделя, оборотов, страницами
+     * диагностики и другой информацией.
      */
     void toggleDisplayMode() {
-        if (!showAngle && !showTacho) {
+        if (diagPage != DIAG_PAGE_NONE) {
+            diagPage = diagPage < DIAG_PAGES ? diagPage + 1 : DIAG_PAGE_NONE;
+        } else if (!showAngle && !showTacho) {
             showAngle = true;
         } else if (showAngle) {
             showAngle = false;
             showTacho = true;
         } else {
             showTacho = false;
+            diagPage = DIAG_PAGE_LOOP;
         }
         
-        // Сброс хэша информационной строки для принудительного обновления
-        lineHashes[3] = INITIAL_HASH;
-        
         LOG_DEBUG("Дисплей", "Режим отображения: " + 
-                 String(showAngle ? "Угол" : showTacho ? "Обороты" : "Информация"));
+                 String(diagPage != DIAG_PAGE_NONE ? "Диагностика " + String(diagPage) :
+                        showAngle ? "Угол" : showTacho ? "Обороты" : "Информация"));
     }
     
     /**
@@ -144,100 +168,89 @@ public:
     void setDisplayMode(bool showAng, bool showTach) {
         showAngle = showAng;
         showTacho = showTach;
-        lineHashes[3] = INITIAL_HASH; // Принудительное обновление
+        diagPage = DIAG_PAGE_NONE;
     }
 
-private:
     /**
-     * @brief Обновление строки дисплея если данные изменились
-     * @param lineIndex Индекс строки (0-3)
-     * @param newHash Хэш новых данных для строки
+     * @brief Перерисовка всего дисплея при следующем обновлении
+     * 
+     * Нужна, если содержимое дисплея могло быть испорчено помехой на шине.
      */
-    void updateLineIfChanged(int lineIndex, long newHash) {
-        if (lineHashes[lineIndex] != newHash) {
-            lineHashes[lineIndex] = newHash;
-            // Строка будет обновлена в специализированном методе
-        }
+    void redraw() {
+        frame.invalidate();
     }
-    
+
     /**
-     * @brief Обновление верхней строки (режим и состояние)
+     * @brief Теневой буфер (статистика вывода на дисплей)
+     */
+    const LcdFrameBuffer& getFrameBuffer() const { return frame; }
+
+private:
+    /**
+     * @brief Вывод верхней строки (режим и состояние)
      * 
      * Отображает текущий режим работы, состояние системы (ВКЛ/ВЫКЛ),
-     * установленные ограничения и другую служебную информацию.
+     * число проходов в режимах точения и другую служебную информацию.
      */
-    void updateStatusLine() {
-        long newHash = motionController.getOperationMode() + 
-                      (motionController.isEnabled() ? 1 : 0) +
-                      turnPasses * 10;
+    void renderStatusLine() {
+        frame.setCursor(0, 0);
+        
+        // Отображение режима работы
+        printMode();
         
-        if (lineHashes[0] != newHash) {
-            lineHashes[0] = newHash;
-            lcd.setCursor(0, 0);
-            
-            // Отображение режима работы
-            printMode();
-            
-            // Отображение состояния системы
-            lcd.print(motionController.isEnabled() ? "ВКЛ " : "выкл ");
-            
-            // TODO: Отображение ограничений и другой информации
-            // в соответствии с оригинальной логикой
-            
-            fillRemainingSpaces(8); // Заполнение оставшегося места
+        // Отображение состояния системы
+        frame.print(motionController.isEnabled() ? "ВКЛ " : "выкл ");
+        
+        // Число проходов в режимах с автоматическими проходами
+        int mode = motionController.getOperationMode();
+        if (mode == MODE_TURN || mode == MODE_FACE || mode == MODE_CUT) {
+            frame.print((long)motionController.getTurnPasses());
+            frame.print("пр");
         }
+        
+        // TODO: Отображение ограничений и другой информации
+        // в соответствии с оригинальной логикой
+        
+        frame.fillLine();
     }
     
     /**
-     * @brief Обновление строки с шагом резьбы
+     * @brief Вывод строки с шагом резьбы
      * 
      * Отображает текущий шаг резьбы в выбранной системе измерений
      * и число заходов для многозаходной резьбы.
      */
-    void updatePitchLine() {
-        long newHash = motionController.getPitch() + 
-                      motionController.getStarts() * 1000000L;
+    void renderPitchLine() {
+        frame.setCursor(0, 1);
+        frame.print("Шаг ");
+        printPitch(motionController.getPitch());
         
-        if (lineHashes[1] != newHash) {
-            lineHashes[1] = newHash;
-            lcd.setCursor(0, 1);
-            lcd.print("Шаг ");
-            
-            // TODO: Реализация форматированного вывода шага
-            // в метрической, дюймовой или TPI системе
-            
-            // Отображение числа заходов если больше 1
-            if (motionController.getStarts() != 1) {
-                lcd.print(" x");
-                lcd.print(motionController.getStarts());
-            }
-            
-            fillRemainingSpaces(10);
+        // Отображение числа заходов если больше 1
+        if (motionController.getStarts() != 1) {
+            frame.print(" x");
+            frame.print((long)motionController.getStarts());
         }
+        
+        frame.fillLine();
     }
     
     /**
-     * @brief Обновление строки с позициями осей
+     * @brief Вывод строки с позициями осей
      * 
      * Отображает текущие позиции осей Z и X в выбранной системе измерений.
      * Для вращательной оси A1 отображает угол в градусах.
      */
-    void updatePositionLine() {
-        long newHash = 0; // TODO: Расчет хэша на основе позиций осей
+    void renderPositionLine() {
+        frame.setCursor(0, 2);
         
-        if (lineHashes[2] != newHash) {
-            lineHashes[2] = newHash;
-            lcd.setCursor(0, 2);
-            
-            // TODO: Отображение позиций осей Z и X
-            // в соответствии с оригинальной логикой
-            
-            fillRemainingSpaces(10);
-        }
+        // TODO: Отображение позиций осей Z и X
+        // в соответствии с оригинальной логикой
+        
+        frame.fillLine();
     }
     
     /**
-     * @brief Обновление информационной строки
+     * @brief Вывод информационной строки
      * 
      * Отображает различную информацию в зависимости от режима работы:
      * - Угол шпинделя или обороты
@@ -245,17 +258,111 @@ private:
      * - Текущий проход в автоматических режимах
      * - Сообщения G-кода
      */
-    void updateInfoLine() {
-        long newHash = 0; // TODO: Расчет хэша на основе отображаемой информации
+    void renderInfoLine() {
+        frame.setCursor(0, 3);
+        
+        // TODO: Реализация логики отображения информации
+        // в соответствии с оригинальным кодом
         
-        if (lineHashes[3] != newHash) {
-            lineHashes[3] = newHash;
-            lcd.setCursor(0, 3);
-            
-            // TODO: Реализация логики отображения информации
-            // в соответствии с оригинальным кодом
-            
-            fillRemainingSpaces(0);
+        frame.fillLine();
+    }
+    
+    /**
+     * @brief Вывод страницы диагностики на весь дисплей
+     * 
+     * Показатели берутся из снимка последнего окна Diagnostics, задача
+     * движения при этом не останавливается.
+     */
+    void renderDiagnostics() {
+        DiagnosticsSnapshot snapshot;
+        diagnostics.read(snapshot);
+        
+        frame.setCursor(0, 0);
+        frame.print("ДИАГ ");
+        frame.print((long)diagPage);
+        frame.print("/");
+        frame.print((long)DIAG_PAGES);
+        frame.print(" ");
+        switch (diagPage) {
+            case DIAG_PAGE_LOOP:
+                frame.print("ЦИКЛ");
+                frame.setCursor(0, 1);
+                frame.print("Период ");
+                frame.print((long)snapshot.loopPeriodUs, 6);
+                frame.print("мкс");
+                frame.setCursor(0, 2);
+                frame.print("Худший ");
+                frame.print((long)snapshot.loopWorstUs, 6);
+                frame.print("мкс");
+                frame.setCursor(0, 3);
+                frame.print("Циклов ");
+                frame.print((long)snapshot.loopCount);
+                frame.print(" за ");
+                frame.print((long)DIAG_WINDOW_MS);
+                frame.print("мс");
+                break;
+            case DIAG_PAGE_AXES:
+                frame.print("ОСИ");
+                frame.setCursor(0, 1);
+                frame.print("Z ");
+                frame.print(snapshot.stepRate[DIAG_AXIS_Z], 6);
+                frame.print("ш/с ");
+                printDeciMicrons(snapshot.lagDu[DIAG_AXIS_Z], 3, 6);
+                frame.setCursor(0, 2);
+                frame.print("X ");
+                frame.print(snapshot.stepRate[DIAG_AXIS_X], 6);
+                frame.print("ш/с ");
+                printDeciMicrons(snapshot.lagDu[DIAG_AXIS_X], 3, 6);
+                frame.setCursor(0, 3);
+                frame.print("Ш ");
+                frame.print((long)snapshot.rpm, 4);
+                frame.print(" ");
+                frame.print((long)snapshot.rpmMin, 4);
+                frame.print("-");
+                frame.print((long)snapshot.rpmMax);
+                frame.print("об");
+                break;
+            case DIAG_PAGE_SYSTEM:
+                frame.print("СИСТЕМА");
+                frame.setCursor(0, 1);
+                frame.print("Куча ");
+                frame.print((long)snapshot.freeHeap, 6);
+                frame.print("/");
+                frame.print((long)snapshot.minFreeHeap);
+                frame.setCursor(0, 2);
+                frame.print("Стек ");
+                frame.print((long)snapshot.stackFree, 5);
+                frame.print(" ");
+                frame.print(snapshot.stackTask);
+                frame.setCursor(0, 3);
+                frame.print("Журнал потеряно ");
+                frame.print((long)snapshot.logDropped);
+                break;
+            case DIAG_PAGE_KEYS:
+                renderKeyLatency();
+                break;
+        }
+    }
+    
+    /**
+     * @brief Страница задержки нажатий: по классу клавиш число нажатий, средняя
+     * и наибольшая полная задержка в мс
+     */
+    void renderKeyLatency() {
+        static const char* const labels[KEY_CLASSES] = {"ВКЛ", "ХОД", "ПРЧ"};
+        KeyLatencyStats stats;
+        keyLatency.read(stats);
+        
+        frame.print("КЛАВИШИ мс");
+        for (int keyClass = 0; keyClass < KEY_CLASSES; keyClass++) {
+            const KeyLatencyHistogram& total = stats.stages[keyClass][KEY_STAGE_TOTAL];
+            frame.setCursor(0, keyClass + 1);
+            frame.print(labels[keyClass]);
+            frame.print((long)total.count, 5);
+            if (total.count > 0) {
+                printMillis((unsigned long)(total.sumUs / total.count), 6);
+                printMillis(total.worstUs, 6);
+            }
         }
     }
     
@@ -263,22 +370,37 @@ private:
      * @brief Форматирование и вывод значения в деци-микронах
      * @param deciMicrons Значение в деци-микронах (0.0001 мм)
      * @param maxPrecision Максимальное число знаков после запятой
+     * @param width Наименьшая ширина (выравнивание вправо)
      * @return Число выведенных символов
      */
-    int printDeciMicrons(long deciMicrons, int maxPrecision) {
-        // TODO: Реализация форматированного вывода
-        // в соответствии с оригинальной логикой
-        return lcd.print(deciMicrons / 10000.0, maxPrecision);
+    int printDeciMicrons(long deciMicrons, int maxPrecision, int width = 0) {
+        char text[LCD_NUMBER_MAX];
+        formatDeciMicrons(text, deciMicrons, maxPrecision, width);
+        return frame.print(text);
     }
     
     /**
      * @brief Форматирование и вывод угла в градусах
      * @param degrees10000 Угол в градусах * 10000
+     * @param width Наименьшая ширина (выравнивание вправо)
+     * @return Число выведенных символов
+     */
+    int printDegrees(long degrees10000, int width = 0) {
+        char text[LCD_NUMBER_MAX];
+        formatDegrees(text, degrees10000, 2, width);
+        return frame.print(text);
+    }
+    
+    /**
+     * @brief Вывод времени в миллисекундах с одним знаком после точки
+     * @param us Время в микросекундах
+     * @param width Наименьшая ширина (выравнивание вправо)
      * @return Число выведенных символов
      */
-    int printDegrees(long degrees10000) {
-        // TODO: Реализация форматированного вывода угла
-        return lcd.print(degrees10000 / 10000.0, 2);
+    int printMillis(unsigned long us, int width = 0) {
+        char text[LCD_NUMBER_MAX];
+        formatFixed(text, us, 3, 1, width);
+        return frame.print(text);
     }
     
     /**
@@ -287,8 +409,18 @@ private:
      * @return Число выведенных символов
      */
     int printPitch(long pitch) {
-        // TODO: Реализация в зависимости от системы измерений
-        return lcd.print(pitch);
+        char text[LCD_NUMBER_MAX];
+        switch (motionController.getMeasure()) {
+            case MEASURE_INCH:
+                formatInches(text, pitch, 4);
+                return frame.print(text) + frame.print("\"");
+            case MEASURE_TPI:
+                formatTpi(text, pitch, 1);
+                return frame.print(text) + frame.print("tpi");
+            default:
+                formatDeciMicrons(text, pitch, 3);
+                return frame.print(text);
+        }
     }
     
     /**
@@ -297,69 +429,19 @@ private:
      */
     int printMode() {
         switch(motionController.getOperationMode()) {
-            case MODE_NORMAL: return lcd.print("РЕЗЬБА ");
-            case MODE_ASYNC: return lcd.print("АСИНХР ");
-            case MODE_CONE: return lcd.print("КОНУС ");
-            case MODE_TURN: return lcd.print("ПРОДОЛ ");
-            case MODE_FACE: return lcd.print("ТОРЕЦ ");
-            case MODE_CUT: return lcd.print("ПРОРЕЗ ");
-            case MODE_THREAD: return lcd.print("РЕЗЬБА ");
-            case MODE_ELLIPSE: return lcd.print("ЭЛЛИПС ");
-            case MODE_GCODE: return lcd.print("G-КОД ");
-            case MODE_A1: return lcd.print("ОСЬ A1 ");
-            default: return lcd.print("НЕИЗВ ");
+            case MODE_NORMAL: return frame.print("РЕЗЬБА ");
+            case MODE_ASYNC: return frame.print("АСИНХР ");
+            case MODE_CONE: return frame.print("КОНУС ");
+            case MODE_TURN: return frame.print("ПРОДОЛ ");
+            case MODE_FACE: return frame.print("ТОРЕЦ ");
+            case MODE_CUT: return frame.print("ПРОРЕЗ ");
+            case MODE_THREAD: return frame.print("РЕЗЬБА ");
+            case MODE_ELLIPSE: return frame.print("ЭЛЛИПС ");
+            case MODE_GCODE: return frame.print("G-КОД ");
+            case MODE_A1: return frame.print("ОСЬ A1 ");
+            default: return frame.print("НЕИЗВ ");
         }
     }
-    
-    /**
-     * @brief Дозаполнение строки пробелами
-     * @param charsPrinted Число уже выведенных символов
-     */
-    void fillRemainingSpaces(int charsPrinted) {
-        for (int i = charsPrinted; i < 20; i++) {
-            lcd.print(" ");
-        }
-    }
-    
-    /**
-     * @brief Создание пользовательских символов для дисплея
-     * 
-     * Создает значки для отображения ограничений, единиц измерения и другой
-     * служебной информации в соответствии с оригинальным кодом.
-     */
-    void createCustomCharacters() {
-        // Символ мм (две буквы m со смещением)
-        byte customCharMm[] = {
-            B11010,
-            B10101,
-            B10101,
-            B00000,
-            B11010,
-            B10101,
-            B10101,
-            B00000
-        };
-        
-        // Символ верхнего ограничения
-        byte customCharLimUp[] = {
-            B11111,
-            B00100,
-            B01110,
-            B10101,
-            B00100,
-            B00100,
-            B00000,
-            B00000
-        };
-        
-        // TODO: Создание остальных пользовательских символов
-        // в соответствии с оригинальным кодом
-        
-        lcd.createChar(0, customCharMm);
-        lcd.createChar(1, customCharLimUp);
-        
-        LOG_DEBUG("Дисплей", "Созданы пользовательские символы");
-    }
 };
 
 #endif // DISPLAY_MANAGER_H
\ No newline at end of file
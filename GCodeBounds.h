@@ -0,0 +1,431 @@
+#ifndef GCODE_BOUNDS_H
+#define GCODE_BOUNDS_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "GCodeParser.h"
+#include "ArcInterpolator.h"
+
+// Оси в массивах границ
+#define GCODE_BOUNDS_AXIS_Z 0
+#define GCODE_BOUNDS_AXIS_X 1
+#define GCODE_BOUNDS_AXES 2
+
+// Флаги границ программы
+#define GCODE_BOUNDS_Z 0x01         // Найдена хотя бы одна точка с известной координатой Z
+#define GCODE_BOUNDS_X 0x02         // Найдена хотя бы одна точка с известной координатой X
+#define GCODE_BOUNDS_PARTIAL 0x04   // Часть перемещений зависит от исполнения и не учтена
+
+/**
+ * @struct GCodeBounds
+ * @brief Границы перемещений и наибольшие скорости программы
+ *
+ * Собираются компилятором за один проход и хранятся в заголовке образа,
+ * поэтому проверка программы перед запуском не просматривает кадры и занимает
+ * одинаковое время для программы любой длины. Для каждой величины запоминается
+ * строка, на которой она достигнута, - ее и получает оператор в сообщении.
+ *
+ * Скорость оси - наибольшая составляющая подачи G1/G2/G3 вдоль оси в
+ * деци-микронах в секунду, ход резьбы - наибольшее перемещение оси за оборот
+ * шпинделя в G33/G76: требуемая скорость резьбы зависит от оборотов в момент
+ * запуска. Структура входит в формат образа (см. GCODE_IMAGE_VERSION).
+ */
+struct GCodeBounds {
+    int32_t low[GCODE_BOUNDS_AXES];         // Наименьшая координата Z, X в деци-микронах
+    int32_t high[GCODE_BOUNDS_AXES];        // Наибольшая координата
+    uint32_t lowLine[GCODE_BOUNDS_AXES];    // Строки, где достигнуты low
+    uint32_t highLine[GCODE_BOUNDS_AXES];   // Строки, где достигнуты high
+    int32_t speed[GCODE_BOUNDS_AXES];       // Наибольшая скорость оси при подаче, du/s
+    uint32_t speedLine[GCODE_BOUNDS_AXES];  // Строки, где она достигнута
+    int32_t lead[GCODE_BOUNDS_AXES];        // Наибольший ход резьбы вдоль оси, du/об
+    uint32_t leadLine[GCODE_BOUNDS_AXES];   // Строки, где он достигнут
+    uint32_t flags;                         // Флаги GCODE_BOUNDS_*
+
+    /**
+     * @brief Пустые границы перед компиляцией
+     */
+    void begin() {
+        memset(this, 0, sizeof(*this));
+    }
+
+    /**
+     * @brief Известна ли хотя бы одна координата оси
+     * @param axis GCODE_BOUNDS_AXIS_Z или GCODE_BOUNDS_AXIS_X
+     */
+    bool hasAxis(int axis) const {
+        return flags & (axis == GCODE_BOUNDS_AXIS_Z ? GCODE_BOUNDS_Z : GCODE_BOUNDS_X);
+    }
+
+    /**
+     * @brief Учет точки траектории
+     */
+    void includePoint(int axis, int32_t value, uint32_t line) {
+        if (!hasAxis(axis)) {
+            flags |= axis == GCODE_BOUNDS_AXIS_Z ? GCODE_BOUNDS_Z : GCODE_BOUNDS_X;
+            low[axis] = high[axis] = value;
+            lowLine[axis] = highLine[axis] = line;
+            return;
+        }
+        if (value < low[axis]) {
+            low[axis] = value;
+            lowLine[axis] = line;
+        }
+        if (value > high[axis]) {
+            high[axis] = value;
+            highLine[axis] = line;
+        }
+    }
+
+    /**
+     * @brief Учет скорости оси при подаче
+     */
+    void includeSpeed(int axis, int32_t value, uint32_t line) {
+        if (value > speed[axis]) {
+            speed[axis] = value;
+            speedLine[axis] = line;
+        }
+    }
+
+    /**
+     * @brief Учет хода резьбы вдоль оси
+     */
+    void includeLead(int axis, int32_t value, uint32_t line) {
+        if (value > lead[axis]) {
+            lead[axis] = value;
+            leadLine[axis] = line;
+        }
+    }
+};
+
+static_assert(sizeof(GCodeBounds) == 68, "Размер GCodeBounds входит в формат образа программы");
+
+/**
+ * @class GCodeBoundsTracker
+ * @brief Сбор границ программы по кадрам образа при компиляции
+ *
+ * Повторяет учет позиции интерпретатора: абсолютная координата задает
+ * позицию, относительная сдвигает известную. Дуги учитываются вместе с
+ * крайними точками окружности, которые они проходят, циклы G71 и G76 - точками
+ * контура и конечной точкой резьбы, после цикла позиция возвращается в
+ * начальную точку.
+ *
+ * Позиция, которая зависит от исполнения (переменные в координатах, повторы
+ * WHILE и M98, начало подпрограммы, относительное перемещение до первой
+ * абсолютной координаты), считается неизвестной до следующей абсолютной
+ * координаты, а программа помечается флагом GCODE_BOUNDS_PARTIAL.
+ */
+class GCodeBoundsTracker {
+private:
+    GCodeBounds bounds;         // Собранные границы
+    int32_t position[GCODE_BOUNDS_AXES]; // Запрограммированная позиция Z, X
+    bool known[GCODE_BOUNDS_AXES];       // Позиция оси известна при компиляции
+    int32_t feed;               // Модальная подача, du/s
+    uint32_t skipLabel;         // Номер N конца контура G71 (0 - вне контура)
+    int32_t allowance[GCODE_BOUNDS_AXES]; // Чистовой припуск G71 по Z, X
+    int32_t cycleStart[GCODE_BOUNDS_AXES]; // Начальная точка цикла G71
+    bool cycleKnown[GCODE_BOUNDS_AXES];    // Известность начальной точки цикла
+    int loopDepth;              // Вложенность циклов WHILE
+    bool inSubprogram;          // Кадры подпрограммы O...M99
+
+public:
+    GCodeBoundsTracker() {
+        begin();
+    }
+
+    /**
+     * @brief Подготовка к новому проходу по программе
+     */
+    void begin() {
+        bounds.begin();
+        for (int a = 0; a < GCODE_BOUNDS_AXES; a++) {
+            position[a] = 0;
+            known[a] = false;
+            allowance[a] = 0;
+            cycleStart[a] = 0;
+            cycleKnown[a] = false;
+        }
+        feed = GCODE_FEED_DEFAULT_DU_SEC;
+        skipLabel = 0;
+        loopDepth = 0;
+        inSubprogram = false;
+    }
+
+    /**
+     * @brief Учет очередного кадра образа
+     * @param b Кадр в порядке образа
+     */
+    void apply(const GCodeBlock& b) {
+        switch (b.command) {
+            case GCODE_CMD_WHILE:
+                loopDepth++;
+                break;
+            case GCODE_CMD_LOOP_END:
+                // Число повторов известно только при исполнении
+                loopDepth = max(0, loopDepth - 1);
+                forget();
+                break;
+            case GCODE_CMD_CALL:
+                forget();
+                break;
+            case GCODE_CMD_PROGRAM:
+                inSubprogram = true;
+                forget(); // Подпрограмма вызывается из любой точки
+                break;
+            case GCODE_CMD_RETURN:
+                inSubprogram = false;
+                break;
+        }
+        if (b.command != GCODE_CMD_NONE) {
+            return; // Служебный кадр (его I и K - операнды выражения)
+        }
+
+        if (b.flags & GCODE_HAS_F) {
+            if (b.varF) {
+                bounds.flags |= GCODE_BOUNDS_PARTIAL;
+            } else {
+                feed = b.feed;
+            }
+        }
+
+        switch (b.motion) {
+            case GCODE_MOTION_RAPID:
+            case GCODE_MOTION_LINEAR:
+            case GCODE_MOTION_THREAD:
+                applyLine(b);
+                break;
+            case GCODE_MOTION_ARC_CW:
+            case GCODE_MOTION_ARC_CCW:
+                applyArc(b);
+                break;
+            case GCODE_MOTION_ROUGH:
+                for (int a = 0; a < GCODE_BOUNDS_AXES; a++) {
+                    cycleStart[a] = position[a];
+                    cycleKnown[a] = known[a];
+                }
+                allowance[GCODE_BOUNDS_AXIS_Z] = b.z;
+                allowance[GCODE_BOUNDS_AXIS_X] = b.x;
+                skipLabel = b.q;
+                bounds.includeSpeed(GCODE_BOUNDS_AXIS_Z, feed, b.line); // Черновые проходы вдоль Z
+                return;
+            case GCODE_MOTION_THREAD_CYCLE:
+                applyThreadCycle(b);
+                break;
+            default:
+                break; // G70 проходит по уже учтенному контуру
+        }
+
+        if (skipLabel && b.label == skipLabel) {
+            // Цикл G71 заканчивается в начальной точке
+            skipLabel = 0;
+            for (int a = 0; a < GCODE_BOUNDS_AXES; a++) {
+                position[a] = cycleStart[a];
+                known[a] = cycleKnown[a];
+                allowance[a] = 0;
+            }
+        }
+    }
+
+    const GCodeBounds& getBounds() const { return bounds; }
+
+private:
+    /**
+     * @brief Позиция зависит от исполнения - ее задаст следующая абсолютная координата
+     */
+    void forget() {
+        for (int a = 0; a < GCODE_BOUNDS_AXES; a++) {
+            known[a] = false;
+        }
+    }
+
+    /**
+     * @brief Конечная точка кадра по оси
+     * @param b Кадр перемещения
+     * @param axis Ось
+     * @param delta Перемещение по оси, если оно известно
+     * @param deltaKnown Известно ли перемещение
+     *
+     * Обновляет позицию оси. Перемещение известно и без позиции, если кадр
+     * относительный или ось в кадре не задана.
+     */
+    void moveAxis(const GCodeBlock& b, int axis, int32_t& delta, bool& deltaKnown) {
+        uint16_t hasFlag = axis == GCODE_BOUNDS_AXIS_Z ? GCODE_HAS_Z : GCODE_HAS_X;
+        uint8_t var = axis == GCODE_BOUNDS_AXIS_Z ? b.varZ : b.varX;
+        int32_t value = axis == GCODE_BOUNDS_AXIS_Z ? b.z : b.x;
+        delta = 0;
+        deltaKnown = true;
+        if (!(b.flags & hasFlag)) {
+            return;
+        }
+        if (var) {
+            deltaKnown = false;
+            known[axis] = false;
+            bounds.flags |= GCODE_BOUNDS_PARTIAL;
+            return;
+        }
+        if (b.flags & GCODE_RELATIVE) {
+            delta = value;
+            position[axis] += value;
+            if (!known[axis] || loopDepth > 0 || inSubprogram) {
+                // Сдвиг от точки, зависящей от исполнения
+                known[axis] = false;
+                bounds.flags |= GCODE_BOUNDS_PARTIAL;
+            }
+            return;
+        }
+        deltaKnown = known[axis];
+        delta = value - position[axis];
+        position[axis] = value;
+        known[axis] = true;
+    }
+
+    /**
+     * @brief Учет текущей позиции как точки траектории
+     */
+    void includePosition(uint32_t line) {
+        for (int a = 0; a < GCODE_BOUNDS_AXES; a++) {
+            if (known[a]) {
+                bounds.includePoint(a, position[a], line);
+                if (skipLabel) {
+                    bounds.includePoint(a, position[a] + allowance[a], line); // Контур G71 с припуском
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Учет отрезка G0, G1 или G33
+     */
+    void applyLine(const GCodeBlock& b) {
+        int32_t delta[GCODE_BOUNDS_AXES];
+        bool deltaKnown[GCODE_BOUNDS_AXES];
+        for (int a = 0; a < GCODE_BOUNDS_AXES; a++) {
+            moveAxis(b, a, delta[a], deltaKnown[a]);
+        }
+        includePosition(b.line);
+        if (b.motion == GCODE_MOTION_RAPID) {
+            return;
+        }
+
+        // Составляющие скорости; при неизвестном перемещении - вся подача или весь ход
+        bool allKnown = deltaKnown[GCODE_BOUNDS_AXIS_Z] && deltaKnown[GCODE_BOUNDS_AXIS_X];
+        float dz = fabs((float)delta[GCODE_BOUNDS_AXIS_Z]);
+        float dx = fabs((float)delta[GCODE_BOUNDS_AXIS_X]);
+        for (int a = 0; a < GCODE_BOUNDS_AXES; a++) {
+            float share;
+            if (!allKnown) {
+                share = deltaKnown[a] && delta[a] == 0 ? 0 : 1;
+            } else if (b.motion == GCODE_MOTION_THREAD) {
+                // Ход G33 задан вдоль ведущей оси - той, что перемещается больше
+                float leading = max(dz, dx);
+                share = leading > 0 ? fabs((float)delta[a]) / leading : 0;
+            } else {
+                float length = sqrtf(dz * dz + dx * dx);
+                share = length > 0 ? fabs((float)delta[a]) / length : 0;
+            }
+            if (b.motion == GCODE_MOTION_THREAD) {
+                bounds.includeLead(a, lroundf(b.k * share), b.line);
+            } else {
+                bounds.includeSpeed(a, lroundf(feed * share), b.line);
+            }
+        }
+    }
+
+    /**
+     * @brief Учет дуги G2/G3 вместе с пройденными крайними точками окружности
+     */
+    void applyArc(const GCodeBlock& b) {
+        long fromZ = position[GCODE_BOUNDS_AXIS_Z];
+        long fromX = position[GCODE_BOUNDS_AXIS_X];
+        bool fromKnown = known[GCODE_BOUNDS_AXIS_Z] && known[GCODE_BOUNDS_AXIS_X];
+        int32_t delta[GCODE_BOUNDS_AXES];
+        bool deltaKnown[GCODE_BOUNDS_AXES];
+        for (int a = 0; a < GCODE_BOUNDS_AXES; a++) {
+            moveAxis(b, a, delta[a], deltaKnown[a]);
+        }
+        includePosition(b.line);
+
+        // Вдоль дуги обе составляющие скорости доходят до полной подачи
+        for (int a = 0; a < GCODE_BOUNDS_AXES; a++) {
+            bounds.includeSpeed(a, feed, b.line);
+        }
+
+        long toZ = position[GCODE_BOUNDS_AXIS_Z];
+        long toX = position[GCODE_BOUNDS_AXIS_X];
+        bool clockwise = b.motion == GCODE_MOTION_ARC_CW;
+        if (!fromKnown || !known[GCODE_BOUNDS_AXIS_Z] || !known[GCODE_BOUNDS_AXIS_X] || b.varI || b.varK || b.varR) {
+            bounds.flags |= GCODE_BOUNDS_PARTIAL;
+            return;
+        }
+        long centerZ, centerX;
+        if (b.flags & GCODE_HAS_R) {
+            if (!ArcInterpolator::centerFromRadius(fromZ, fromX, toZ, toX, b.r, clockwise, centerZ, centerX)) {
+                return; // Неверная дуга прерывает программу при исполнении
+            }
+        } else {
+            centerZ = fromZ + b.k;
+            centerX = fromX + b.i;
+        }
+
+        // Переходы между квадрантами в направлении обхода проходят крайние точки окружности
+        long long su = fromZ - centerZ, sv = fromX - centerX;
+        long long eu = toZ - centerZ, ev = toX - centerX;
+        long radius = ArcInterpolator::isqrt(su * su + sv * sv);
+        int dir = clockwise ? -1 : 1;
+        int quadrant = quadrantOf(su, sv);
+        int endQuadrant = quadrantOf(eu, ev);
+        long long cross = su * ev - sv * eu;
+        int crossings = (endQuadrant - quadrant) * dir;
+        crossings = ((crossings % 4) + 4) % 4;
+        if (crossings == 0 && cross * dir <= 0) {
+            crossings = 4; // Конец позади начала в том же квадранте - почти полная окружность
+        }
+        for (int i = 0; i < crossings; i++) {
+            // Граница между квадрантом q и q + 1 - крайняя точка номер q + 1
+            int boundary = dir > 0 ? quadrant + 1 : quadrant;
+            switch (boundary & 3) {
+                case 0: bounds.includePoint(GCODE_BOUNDS_AXIS_Z, centerZ + radius, b.line); break;
+                case 1: bounds.includePoint(GCODE_BOUNDS_AXIS_X, centerX + radius, b.line); break;
+                case 2: bounds.includePoint(GCODE_BOUNDS_AXIS_Z, centerZ - radius, b.line); break;
+                case 3: bounds.includePoint(GCODE_BOUNDS_AXIS_X, centerX - radius, b.line); break;
+            }
+            quadrant = (quadrant + dir + 4) & 3;
+        }
+    }
+
+    /**
+     * @brief Учет цикла G76: конечная точка по дну резьбы и ход вдоль Z
+     */
+    void applyThreadCycle(const GCodeBlock& b) {
+        int32_t saved[GCODE_BOUNDS_AXES];
+        bool savedKnown[GCODE_BOUNDS_AXES];
+        for (int a = 0; a < GCODE_BOUNDS_AXES; a++) {
+            saved[a] = position[a];
+            savedKnown[a] = known[a];
+        }
+        int32_t delta;
+        bool deltaKnown;
+        for (int a = 0; a < GCODE_BOUNDS_AXES; a++) {
+            moveAxis(b, a, delta, deltaKnown);
+        }
+        includePosition(b.line);
+
+        // Цикл возвращается в начальную точку
+        for (int a = 0; a < GCODE_BOUNDS_AXES; a++) {
+            position[a] = saved[a];
+            known[a] = savedKnown[a];
+        }
+        bounds.includeLead(GCODE_BOUNDS_AXIS_Z, b.k * max(1, (int)b.starts), b.line);
+    }
+
+    /**
+     * @brief Номер квадранта точки относительно центра (как в ArcInterpolator)
+     */
+    static int quadrantOf(long long pu, long long pv) {
+        if (pu > 0 && pv >= 0) return 0;
+        if (pu <= 0 && pv > 0) return 1;
+        if (pu < 0 && pv <= 0) return 2;
+        return 3;
+    }
+};
+
+#endif // GCODE_BOUNDS_H
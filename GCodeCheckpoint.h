@@ -0,0 +1,184 @@
+#ifndef GCODE_CHECKPOINT_H
+#define GCODE_CHECKPOINT_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "GCodeParser.h"
+
+// Флаги контрольной точки
+#define GCODE_CHECKPOINT_Z 0x01     // Позиция Z задана программой
+#define GCODE_CHECKPOINT_X 0x02     // Позиция X задана программой
+#define GCODE_CHECKPOINT_FEED 0x04  // Подача задана программой
+#define GCODE_CHECKPOINT_MACRO 0x08 // Были переменные, циклы или вызовы - состояние зависит от исполнения
+
+/**
+ * @struct GCodeCheckpoint
+ * @brief Модальное состояние программы перед кадром образа
+ *
+ * Единицы, режим координат и режим стыков уже записаны в каждом кадре, поэтому
+ * состояние содержит только то, что интерпретатор накапливает по ходу
+ * программы: подачу и запрограммированную позицию. Компилятор сохраняет точку
+ * через каждые GCODE_CHECKPOINT_BLOCKS кадров после кадров образа; состояние
+ * перед любым кадром получается от ближайшей предыдущей точки применением
+ * не больше GCODE_CHECKPOINT_BLOCKS - 1 кадров.
+ *
+ * Продолжать можно только с кадра основной программы вне цикла WHILE и вне
+ * пропускаемого контура G71, если до него не было переменных и вызовов:
+ * иначе состояние определяется исполнением, а не текстом программы.
+ * Структура входит в формат образа (см. GCODE_IMAGE_VERSION).
+ */
+struct GCodeCheckpoint {
+    uint32_t block;         // Номер кадра образа, перед которым снято состояние
+    int32_t feed;           // Подача в деци-микронах в секунду
+    int32_t z;              // Запрограммированная позиция Z в деци-микронах
+    int32_t x;              // Запрограммированная позиция X в деци-микронах
+    uint32_t skipLabel;     // Номер N конца контура G71, до которого кадры пропускаются (0 - нет)
+    uint8_t flags;          // Флаги GCODE_CHECKPOINT_*
+    uint8_t loopDepth;      // Вложенность циклов WHILE
+    uint8_t inSubprogram;   // Кадр внутри подпрограммы O...M99
+    uint8_t ended;          // Основная программа завершена M2/M30
+
+    /**
+     * @brief Состояние перед первым кадром программы
+     */
+    void begin() {
+        memset(this, 0, sizeof(*this));
+    }
+
+    /**
+     * @brief Переход к состоянию после кадра
+     * @param b Кадр образа с номером block
+     */
+    void apply(const GCodeBlock& b) {
+        block++;
+        if (skipLabel) {
+            // Контур G71 исполняется циклом, программа продолжается за ним
+            if (b.label == skipLabel) {
+                skipLabel = 0;
+            }
+            return;
+        }
+
+        switch (b.command) {
+            case GCODE_CMD_ASSIGN:
+            case GCODE_CMD_CALL:
+                flags |= GCODE_CHECKPOINT_MACRO;
+                break;
+            case GCODE_CMD_WHILE:
+                flags |= GCODE_CHECKPOINT_MACRO;
+                loopDepth++;
+                break;
+            case GCODE_CMD_LOOP_END:
+                if (loopDepth > 0) {
+                    loopDepth--;
+                }
+                break;
+            case GCODE_CMD_PROGRAM:
+                inSubprogram = 1;
+                break;
+            case GCODE_CMD_RETURN:
+                ended = ended || !inSubprogram;
+                inSubprogram = 0;
+                break;
+            case GCODE_CMD_END:
+                ended = ended || !inSubprogram;
+                break;
+        }
+        if (GCodeParser::hasVariables(b)) {
+            flags |= GCODE_CHECKPOINT_MACRO;
+        }
+
+        if (b.flags & GCODE_HAS_F) {
+            feed = b.feed;
+            flags |= GCODE_CHECKPOINT_FEED;
+        }
+
+        switch (b.motion) {
+            case GCODE_MOTION_RAPID:
+            case GCODE_MOTION_LINEAR:
+            case GCODE_MOTION_ARC_CW:
+            case GCODE_MOTION_ARC_CCW:
+            case GCODE_MOTION_THREAD:
+                applyCoordinate(b, GCODE_HAS_Z, GCODE_CHECKPOINT_Z, b.z, z);
+                applyCoordinate(b, GCODE_HAS_X, GCODE_CHECKPOINT_X, b.x, x);
+                break;
+            case GCODE_MOTION_ROUGH:
+                skipLabel = b.q;
+                break;
+            default:
+                break; // G70 и G76 возвращаются в начальную точку
+        }
+    }
+
+    /**
+     * @brief Можно ли начать исполнение с кадра этого состояния
+     */
+    bool isResumable() const {
+        return !(flags & GCODE_CHECKPOINT_MACRO) && loopDepth == 0 && !inSubprogram &&
+               !ended && skipLabel == 0;
+    }
+
+    /**
+     * @brief Число контрольных точек образа из blockCount кадров
+     */
+    static uint32_t countFor(uint32_t blockCount) {
+        return (blockCount + GCODE_CHECKPOINT_BLOCKS - 1) / GCODE_CHECKPOINT_BLOCKS;
+    }
+
+    /**
+     * @brief Поиск первого кадра строки и состояния перед ним
+     * @param blocks Кадры образа (номера строк возрастают)
+     * @param count Число кадров
+     * @param checkpoints Контрольные точки образа
+     * @param checkpointCount Число контрольных точек
+     * @param line Номер строки программы
+     * @param state Состояние перед первым кадром с номером строки не меньше line
+     * @return true если с этого кадра можно продолжить программу
+     *
+     * Кадр ищется двоичным поиском, состояние восстанавливается от ближайшей
+     * контрольной точки.
+     */
+    static bool seek(const GCodeBlock* blocks, uint32_t count, const GCodeCheckpoint* checkpoints,
+                     uint32_t checkpointCount, uint32_t line, GCodeCheckpoint& state) {
+        uint32_t low = 0;
+        uint32_t high = count;
+        while (low < high) {
+            uint32_t middle = low + (high - low) / 2;
+            if (blocks[middle].line < line) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        uint32_t index = low / GCODE_CHECKPOINT_BLOCKS;
+        if (low >= count || index >= checkpointCount) {
+            return false;
+        }
+
+        state = checkpoints[index];
+        while (state.block < low) {
+            state.apply(blocks[state.block]);
+        }
+        return state.isResumable();
+    }
+
+private:
+    /**
+     * @brief Применение координаты перемещения
+     */
+    void applyCoordinate(const GCodeBlock& b, uint16_t hasFlag, uint8_t knownFlag, int32_t value, int32_t& position) {
+        if (!(b.flags & hasFlag)) {
+            return;
+        }
+        if (b.flags & GCODE_RELATIVE) {
+            position += value; // Относительное перемещение от неизвестной точки ее не определяет
+        } else {
+            position = value;
+            flags |= knownFlag;
+        }
+    }
+};
+
+static_assert(sizeof(GCodeCheckpoint) == 24, "Размер GCodeCheckpoint входит в формат образа программы");
+
+#endif // GCODE_CHECKPOINT_H
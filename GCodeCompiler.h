@@ -0,0 +1,222 @@
+#ifndef GCODE_COMPILER_H
+#define GCODE_COMPILER_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "GCodeParser.h"
+#include "GCodeReader.h"
+#include "GCodeCheckpoint.h"
+#include "GCodeBounds.h"
+
+// Сигнатура и версия формата скомпилированного образа программы
+#define GCODE_IMAGE_MAGIC 0x4D494347    // "GCIM"
+#define GCODE_IMAGE_VERSION 7
+
+/**
+ * @struct GCodeImageHeader
+ * @brief Заголовок скомпилированного образа программы во флеш-памяти
+ *
+ * Записывается последним, поэтому образ с неверной сигнатурой считается
+ * незавершенным. За заголовком подряд следуют blockCount кадров GCodeBlock,
+ * за ними checkpointCount контрольных точек GCodeCheckpoint. Границы программы
+ * хранятся в самом заголовке для проверки перед запуском.
+ */
+struct GCodeImageHeader {
+    uint32_t magic;         // GCODE_IMAGE_MAGIC
+    uint16_t version;       // GCODE_IMAGE_VERSION
+    uint16_t blockSize;     // sizeof(GCodeBlock) на момент компиляции
+    uint32_t blockCount;    // Число кадров в образе
+    uint32_t sourceSize;    // Размер исходного текста в байтах
+    uint32_t checkpointCount; // Число контрольных точек модального состояния
+    GCodeBounds bounds;     // Границы перемещений и наибольшие скорости
+};
+
+/**
+ * @class GCodeCompiler
+ * @brief Компиляция текста программы в последовательность исполняемых кадров
+ *
+ * Выдает только кадры, которые что-то делают или могут быть целью цикла G70/G71:
+ * пустые строки, комментарии и чисто модальные кадры без номера N (G20, G90 и т.д.)
+ * уже учтены разборщиком в соседних кадрах. Кадры после M2/M30 сохраняются, так
+ * как там располагаются подпрограммы O...M99, а программа без M2/M30 получает
+ * завершающий кадр автоматически. Вложенность WHILE/END проверяется здесь же,
+ * поэтому при исполнении каждому WHILE DOn найдется свой ENDn.
+ *
+ * Используется дважды при сохранении программы: первый проход полностью
+ * проверяет программу и считает кадры, второй записывает образ. Перед каждым
+ * GCODE_CHECKPOINT_BLOCKS-м кадром компилятор запоминает модальное состояние
+ * (контрольную точку), которое забирается вызовом takeCheckpoint(), и собирает
+ * границы перемещений программы (getBounds()).
+ */
+class GCodeCompiler {
+private:
+    GCodeParser parser;     // Разборщик строк
+    int error;              // Код первой ошибки (GCODE_ERR_*)
+    uint32_t errorLine;     // Строка первой ошибки
+    bool ended;             // Выдан кадр M2/M30
+    bool done;              // Программа прочитана до конца
+    uint8_t loops[GCODE_LOOP_DEPTH]; // Номера открытых циклов WHILE DOn
+    int loopDepth;          // Число открытых циклов
+    GCodeCheckpoint state;  // Модальное состояние перед следующим кадром
+    GCodeCheckpoint checkpoint; // Последняя контрольная точка
+    bool checkpointReady;   // Контрольная точка еще не забрана
+    GCodeBoundsTracker bounds; // Границы перемещений выданных кадров
+
+public:
+    /**
+     * @brief Конструктор компилятора
+     */
+    GCodeCompiler() : error(GCODE_OK), errorLine(0), ended(false), done(false), loopDepth(0),
+                      checkpointReady(false) {
+        state.begin();
+    }
+
+    /**
+     * @brief Подготовка к новому проходу по программе
+     */
+    void reset() {
+        parser.reset();
+        error = GCODE_OK;
+        errorLine = 0;
+        ended = false;
+        done = false;
+        loopDepth = 0;
+        state.begin();
+        checkpointReady = false;
+        bounds.begin();
+    }
+
+    /**
+     * @brief Получение следующего исполняемого кадра программы
+     * @param reader Открытый читатель исходного текста
+     * @param block Кадр для заполнения
+     * @return true если кадр получен, false в конце программы или при ошибке
+     */
+    bool next(GCodeReader& reader, GCodeBlock& block) {
+        if (done || error != GCODE_OK) {
+            return false;
+        }
+
+        char line[GCODE_LINE_MAX];
+        while (reader.readLine(line, sizeof(line))) {
+            if (!parser.parseLine(line, block)) {
+                error = parser.getError();
+                errorLine = parser.getLineNumber();
+                return false;
+            }
+            if (block.motion == GCODE_MOTION_NONE && block.command == GCODE_CMD_NONE &&
+                !(block.flags & GCODE_HAS_F) && block.label == 0) {
+                continue; // Пустая строка или только модальные коды (кадры с номером N нужны циклам)
+            }
+            if (!checkLoops(block)) {
+                return false;
+            }
+            ended = ended || block.command == GCODE_CMD_END;
+            emit(block);
+            return true;
+        }
+
+        done = true;
+        if (loopDepth > 0) {
+            failLoop(parser.getLineNumber());
+            return false;
+        }
+        if (ended) {
+            return false;
+        }
+
+        // Конец файла без M2/M30 - завершаем программу явно
+        memset(&block, 0, sizeof(block));
+        block.line = parser.getLineNumber() + 1;
+        block.command = GCODE_CMD_END;
+        ended = true;
+        emit(block);
+        return true;
+    }
+
+    /**
+     * @brief Полная проверка программы без сохранения
+     * @param reader Читатель, открытый на начале программы
+     * @param blockCount Число кадров, которое займет образ
+     * @return true если программа не содержит ошибок
+     */
+    bool validate(GCodeReader& reader, uint32_t& blockCount) {
+        reset();
+        blockCount = 0;
+        GCodeBlock block;
+        while (next(reader, block)) {
+            blockCount++;
+        }
+        return error == GCODE_OK;
+    }
+
+    /**
+     * @brief Получение контрольной точки, снятой перед последним выданным кадром
+     * @param out Контрольная точка
+     * @return true если перед последним кадром была контрольная точка
+     */
+    bool takeCheckpoint(GCodeCheckpoint& out) {
+        if (!checkpointReady) {
+            return false;
+        }
+        checkpointReady = false;
+        out = checkpoint;
+        return true;
+    }
+
+    // Геттеры результата компиляции
+    int getError() const { return error; }
+    uint32_t getErrorLine() const { return errorLine; }
+    const GCodeBounds& getBounds() const { return bounds.getBounds(); }
+
+private:
+    /**
+     * @brief Учет выдаваемого кадра в модальном состоянии
+     */
+    void emit(const GCodeBlock& block) {
+        if (state.block % GCODE_CHECKPOINT_BLOCKS == 0) {
+            checkpoint = state;
+            checkpointReady = true;
+        }
+        state.apply(block);
+        bounds.apply(block);
+    }
+
+    /**
+     * @brief Проверка вложенности циклов WHILE DOn / ENDn
+     * @param block Очередной кадр программы
+     * @return false если цикл не закрыт, закрыт чужим ENDn или вложен слишком глубоко
+     *
+     * Номер цикла не может повторяться среди открытых циклов, а подпрограмма
+     * O начинается только после закрытия всех циклов предыдущей части.
+     */
+    bool checkLoops(const GCodeBlock& block) {
+        if (block.command == GCODE_CMD_WHILE) {
+            for (int i = 0; i < loopDepth; i++) {
+                if (loops[i] == block.p) {
+                    return failLoop(block.line);
+                }
+            }
+            if (loopDepth >= GCODE_LOOP_DEPTH) {
+                return failLoop(block.line);
+            }
+            loops[loopDepth++] = block.p;
+        } else if (block.command == GCODE_CMD_LOOP_END) {
+            if (loopDepth == 0 || loops[loopDepth - 1] != block.p) {
+                return failLoop(block.line);
+            }
+            loopDepth--;
+        } else if (block.command == GCODE_CMD_PROGRAM && loopDepth > 0) {
+            return failLoop(block.line);
+        }
+        return true;
+    }
+
+    bool failLoop(uint32_t line) {
+        error = GCODE_ERR_LOOP;
+        errorLine = line;
+        return false;
+    }
+};
+
+#endif // GCODE_COMPILER_H
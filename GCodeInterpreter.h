@@ -0,0 +1,933 @@
+#ifndef GCODE_INTERPRETER_H
+#define GCODE_INTERPRETER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include "Config.h"
+#include "RussianLogger.h"
+#include "GCodeParser.h"
+#include "SpindleEncoder.h"
+#include "AxisController.h"
+#include "ArcInterpolator.h"
+#include "CannedCycle.h"
+#include "Gearbox.h"
+#include "MotionPlanner.h"
+#include "GCodeMacro.h"
+#include "GCodeCheckpoint.h"
+#include "GCodeBounds.h"
+
+/**
+ * @class GCodeInterpreter
+ * @brief Исполнение разобранных кадров G-кода осями Z и X
+ *
+ * Кадры берутся напрямую из скомпилированного образа программы, отображенного
+ * из флеш-памяти (runImage), либо поступают через очередь FreeRTOS из задачи
+ * G-кода, и исполняются в задаче движения вызовом update().
+ * Метод update() никогда не блокируется: если оси еще не дошли до цели, он
+ * просто возвращает управление до следующего цикла.
+ *
+ * Линейные перемещения выдаются осям порциями по 1/LINEAR_INTERPOLATION_PRECISION
+ * шагов ведущей оси, следующая порция выдается когда оси подошли к цели ближе
+ * чем на GCODE_WAIT_EPSILON_STEPS. Дуги G2/G3 строятся по шагам целочисленным
+ * интерполятором ArcInterpolator и выдаются осям такими же порциями.
+ *
+ * Кадры читаются впереди исполняемого в окно MotionPlanner. Скорость осей на
+ * каждой порции отрезка G1 ограничивается профилем разгона от скорости входа и
+ * торможения до скорости выхода, рассчитанных планировщиком. Если скорость
+ * выхода не нулевая (G64), последняя порция выдается в непрерывном режиме и
+ * следующий отрезок начинается, не дожидаясь остановки осей.
+ *
+ * Циклы G71/G70 доступны только для программ из образа: кадры контура читаются
+ * из образа по номерам N, а проходы выдает CannedCycle по одному кадру.
+ *
+ * Присваивания переменных, циклы WHILE/END и вызовы подпрограмм M98/M99
+ * исполняет GCodeMacro при чтении кадров в окно планировщика, значения
+ * переменных подставляются в кадр до планировщика.
+ *
+ * Кадры G33 (и проходы G76) исполняются через ту же электронную гитару
+ * Gearbox, что и режимы клавиатуры: ведущая ось следует за позицией шпинделя
+ * от момента прохождения угла начала, поэтому каждый проход попадает в ту же
+ * нитку. Подряд идущие кадры G33 продолжают синхронизацию без ожидания угла.
+ */
+class GCodeInterpreter {
+private:
+    AxisController& zAxis;              // Ось Z
+    AxisController& xAxis;              // Ось X
+    SpindleEncoder& spindle;            // Энкодер шпинделя (пауза при остановке)
+
+    QueueHandle_t blockQueue;           // Очередь кадров от задачи G-кода
+    volatile bool resetRequested;       // Запрос сброса из другой задачи
+    volatile bool finished;             // Программа завершена (M2/M30 или ошибка)
+    volatile bool paused;               // Программа остановлена по M0/M1
+    volatile bool held;                 // Подача остановлена командой с порта
+    volatile uint32_t runId;            // Номер текущего запуска программы
+
+    // Скомпилированный образ программы в отображенной флеш-памяти
+    const GCodeBlock* volatile pendingImage; // Образ, переданный из задачи G-кода
+    volatile uint32_t pendingImageCount;     // Число кадров переданного образа
+    volatile bool imageRequested;            // Передан новый образ
+    GCodeCheckpoint pendingResume;           // Состояние продолжения с середины образа
+    volatile bool resumeRequested;           // Образ исполняется с кадра pendingResume.block
+    const GCodeBlock* image;                 // Исполняемый образ (nullptr - очередь)
+    uint32_t imageCount;                     // Число кадров исполняемого образа
+    uint32_t imageIndex;                     // Номер следующего кадра образа
+
+    // Модальное состояние
+    long feedDuSec;                     // Текущая подача в деци-микронах в секунду
+    long programZ;                      // Запрограммированная позиция Z в деци-микронах
+    long programX;                      // Запрограммированная позиция X в деци-микронах
+
+    // Состояние исполняемого кадра
+    bool executing;                     // Кадр исполняется
+    uint32_t currentLine;               // Номер строки исполняемого кадра
+    uint8_t pendingCommand;             // Служебная команда кадра, ожидающая конца движения
+    long startZ, startX;                // Начальная позиция отрезка в шагах
+    long deltaZ, deltaX;                // Перемещение отрезка в шагах
+    long segmentSteps;                  // Длина отрезка в шагах ведущей оси
+    long segmentIndex;                  // Выданная осям часть отрезка в шагах ведущей оси
+    unsigned long dwellEndMs;           // Время окончания паузы G4
+
+    // Состояние дуги G2/G3
+    ArcInterpolator arc;                // Пошаговый построитель дуги
+    bool arcMove;                       // Исполняемый кадр - дуга
+    bool arcEndIssued;                  // Выдана цель в точную конечную точку дуги
+    long endZ, endX;                    // Конечная точка дуги в шагах
+    long arcCenterZ, arcCenterX;        // Центр дуги в деци-микронах
+
+    // Состояние цикла G70/G71
+    CannedCycle cycle;                  // Генератор кадров цикла
+    bool cycleActive;                   // Кадры берутся из цикла
+    uint32_t cycleResumeIndex;          // Кадр образа, с которого программа продолжается после цикла
+
+    // Упреждающий просмотр
+    MotionPlanner planner;              // Окно прочитанных вперед кадров
+    bool plannedMove;                   // Исполняемый кадр - отрезок G1 с профилем скорости
+    bool blendIssued;                   // Последняя порция выдана без остановки в конце
+
+    GCodeMacro macro;                   // Переменные, циклы и подпрограммы
+
+    // Состояние перемещения G33, синхронного со шпинделем
+    Gearbox gear;                       // Передаточное отношение шпиндель - ведущая ось
+    bool syncMove;                      // Исполняемый кадр - G33
+    bool syncWaiting;                   // Ожидание угла начала
+    bool syncEndIssued;                 // Выдана цель в конечную точку
+    bool syncChained;                   // Предыдущий кадр - G33, синхронизация продолжается
+    long syncSpindle;                   // Позиция шпинделя начала перемещения
+    long syncEndSpindle;                // Позиция шпинделя конца предыдущего кадра G33
+    long syncSteps;                     // Длина перемещения по ведущей оси в шагах
+    long syncTravel;                    // Выданная осям часть перемещения в шагах ведущей оси
+
+public:
+    /**
+     * @brief Конструктор интерпретатора G-кода
+     * @param zAxisCtrl Ссылка на контроллер оси Z
+     * @param xAxisCtrl Ссылка на контроллер оси X
+     * @param spindleEnc Ссылка на энкодер шпинделя
+     */
+    GCodeInterpreter(AxisController& zAxisCtrl, AxisController& xAxisCtrl, SpindleEncoder& spindleEnc)
+        : zAxis(zAxisCtrl), xAxis(xAxisCtrl), spindle(spindleEnc),
+          resetRequested(false), finished(false), paused(false), held(false), runId(0),
+          pendingImage(nullptr), pendingImageCount(0), imageRequested(false), resumeRequested(false),
+          image(nullptr), imageCount(0), imageIndex(0),
+          feedDuSec(GCODE_FEED_DEFAULT_DU_SEC), programZ(0), programX(0),
+          executing(false), currentLine(0), pendingCommand(GCODE_CMD_NONE), startZ(0), startX(0), deltaZ(0), deltaX(0),
+          segmentSteps(0), segmentIndex(0), dwellEndMs(0),
+          arc(MOTOR_STEPS_Z, SCREW_Z_DU, MOTOR_STEPS_X, SCREW_X_DU),
+          arcMove(false), arcEndIssued(false), endZ(0), endX(0), arcCenterZ(0), arcCenterX(0),
+          cycleActive(false), cycleResumeIndex(0), plannedMove(false), blendIssued(false),
+          syncMove(false), syncWaiting(false), syncEndIssued(false), syncChained(false),
+          syncSpindle(0), syncEndSpindle(0), syncSteps(0), syncTravel(-1) {
+
+        // Очередь кадров между задачей G-кода и задачей движения
+        blockQueue = xQueueCreate(GCODE_QUEUE_BLOCKS, sizeof(GCodeBlock));
+    }
+
+    /**
+     * @brief Подготовка к запуску новой программы
+     *
+     * Вызывается при включении режима G-кода. Запрограммированная позиция
+     * берется из текущих позиций осей относительно нуля.
+     */
+    void start() {
+        xQueueReset(blockQueue);
+        imageRequested = false;
+        resetRequested = true;
+        finished = false;
+        paused = false;
+        held = false;
+        runId++;
+        LOG_INFO("G-код", "Запуск программы");
+    }
+
+    /**
+     * @brief Остановка исполнения и очистка очереди
+     *
+     * Может вызываться из любой задачи: фактический сброс состояния выполняется
+     * в задаче движения при следующем вызове update().
+     */
+    void stop() {
+        xQueueReset(blockQueue);
+        resetRequested = true;
+        LOG_INFO("G-код", "Исполнение остановлено");
+    }
+
+    /**
+     * @brief Исполнение скомпилированного образа программы
+     * @param blocks Первый кадр образа (память должна оставаться доступной до конца программы)
+     * @param count Число кадров в образе
+     * @param resume Состояние перед кадром, с которого продолжается программа (nullptr - с начала)
+     *
+     * Кадры читаются задачей движения прямо по указателю, без копирования в
+     * очередь и без разбора текста. При продолжении с середины программы оси
+     * сначала выходят на ускоренной подаче в запрограммированную точку перед
+     * кадром продолжения (по осям, позиция которых известна).
+     */
+    void runImage(const GCodeBlock* blocks, uint32_t count, const GCodeCheckpoint* resume = nullptr) {
+        if (resume) {
+            pendingResume = *resume;
+        }
+        resumeRequested = resume != nullptr;
+        pendingImage = blocks;
+        pendingImageCount = count;
+        imageRequested = true;
+        LOG_INFO("G-код", "Исполнение образа программы, кадров: " + String(count));
+    }
+
+    /**
+     * @brief Постановка кадра в очередь исполнения
+     * @param block Разобранный кадр
+     * @param timeout Время ожидания свободного места в тиках
+     * @return true если кадр поставлен в очередь
+     */
+    bool queueBlock(const GCodeBlock& block, TickType_t timeout = 0) {
+        return xQueueSend(blockQueue, &block, timeout) == pdTRUE;
+    }
+
+    /**
+     * @brief Число свободных мест в очереди кадров
+     * @return Число кадров, которые можно поставить без ожидания
+     */
+    int getQueueSpace() const {
+        return uxQueueSpacesAvailable(blockQueue);
+    }
+
+    /**
+     * @brief Обработка очереди и исполнение текущего кадра (вызывать из задачи движения)
+     */
+    void update() {
+        if (resetRequested) {
+            resetState();
+        }
+
+        if (imageRequested) {
+            imageRequested = false;
+            image = pendingImage;
+            imageCount = pendingImageCount;
+            imageIndex = 0;
+            if (resumeRequested) {
+                resumeRequested = false;
+                beginResume(pendingResume);
+            }
+        }
+
+        if (finished || paused) {
+            return;
+        }
+
+        // Остановка подачи: новые порции не выдаются, проход резьбы G33 дорабатывается
+        if (held && !syncMove) {
+            return;
+        }
+
+        // Пауза программы при остановленном шпинделе
+        if (SPINDLE_PAUSES_GCODE && (!spindle.isSpinning() || spindle.getRpm() < GCODE_MIN_RPM)) {
+            return;
+        }
+
+        if (executing) {
+            continueBlock();
+            if (executing) {
+                return;
+            }
+        }
+
+        // Кадры без движения и отрезок, сменяющий отрезок без остановки, начинаются в этом же цикле
+        for (int i = 0; i < GCODE_LOOKAHEAD_BLOCKS && !executing && !finished && !paused; i++) {
+            fillPlanner();
+            if (planner.isEmpty()) {
+                return;
+            }
+            beginBlock(planner.next());
+        }
+    }
+
+    /**
+     * @brief Остановка подачи (вызывать из задачи движения)
+     *
+     * Оси останавливаются в конце уже выданной короткой порции отрезка или дуги,
+     * следующие порции и кадры не выдаются до resume(). Синхронное со шпинделем
+     * перемещение G33 прервать нельзя, поэтому остановка наступает после него.
+     */
+    void hold() {
+        if (!held && !finished) {
+            held = true;
+            LOG_INFO("G-код", "Остановка подачи в строке " + String(currentLine));
+        }
+    }
+
+    /**
+     * @brief Продолжение программы после остановки подачи или M0/M1
+     */
+    void resume() {
+        if (held) {
+            held = false;
+            LOG_INFO("G-код", "Продолжение подачи в строке " + String(currentLine));
+        }
+        if (paused) {
+            paused = false;
+            LOG_INFO("G-код", "Продолжение программы после строки " + String(currentLine));
+        }
+    }
+
+    /**
+     * @brief Завершение программы из-за ошибки в задаче чтения
+     * @param line Номер строки с ошибкой
+     * @param message Описание ошибки
+     */
+    void abort(uint32_t line, const char* message) {
+        stop();
+        finished = true;
+        currentLine = line; // Строка ошибки видна на экране, даже если программа не начиналась
+        LOG_ERROR("G-код", "Строка " + String(line) + ": " + String(message));
+    }
+
+    /**
+     * @brief Проверка программы по ее границам перед запуском (вызывать до runImage)
+     * @param bounds Границы перемещений и скорости, найденные при компиляции
+     * @return false если программа выходит за пределы хода или упоры либо резьба
+     *         требует скорости выше допустимой при текущих оборотах (программа прервана)
+     *
+     * Проверка не просматривает кадры и не зависит от длины программы. Подача
+     * выше предела оси только снижается планировщиком, поэтому о ней выводится
+     * предупреждение.
+     */
+    bool checkProgram(const GCodeBounds& bounds) {
+        AxisController* axes[GCODE_BOUNDS_AXES] = {&zAxis, &xAxis};
+        for (int a = 0; a < GCODE_BOUNDS_AXES; a++) {
+            if (!checkAxisBounds(*axes[a], bounds, a)) {
+                return false;
+            }
+        }
+        if (bounds.flags & GCODE_BOUNDS_PARTIAL) {
+            LOG_WARNING("G-код", "Часть перемещений зависит от переменных и повторов и проверена не будет");
+        }
+        return true;
+    }
+
+    // Геттеры состояния
+    bool isFinished() const { return finished; }
+    bool isPaused() const { return paused; }
+    bool isHeld() const { return held; }
+    bool isExecuting() const { return executing; }
+    uint32_t getRunId() const { return runId; }
+    uint32_t getCurrentLine() const { return currentLine; }
+
+private:
+    /**
+     * @brief Сброс состояния исполнения (в задаче движения)
+     */
+    void resetState() {
+        resetRequested = false;
+        held = false;
+        executing = false;
+        arcMove = false;
+        cycleActive = false;
+        syncMove = false;
+        syncChained = false;
+        image = nullptr;
+        pendingCommand = GCODE_CMD_NONE;
+        feedDuSec = GCODE_FEED_DEFAULT_DU_SEC;
+        programZ = zAxis.getPositionDu();
+        programX = xAxis.getPositionDu();
+        zAxis.resetMaxSpeed();
+        xAxis.resetMaxSpeed();
+        plannedMove = false;
+        blendIssued = false;
+        planner.reset(zAxis, xAxis, programZ, programX, feedDuSec);
+        macro.reset();
+    }
+
+    /**
+     * @brief Подготовка продолжения программы с середины образа
+     * @param state Модальное состояние перед кадром продолжения
+     */
+    void beginResume(const GCodeCheckpoint& state) {
+        imageIndex = state.block;
+        if (state.flags & GCODE_CHECKPOINT_FEED) {
+            feedDuSec = max((long)state.feed, (long)GCODE_FEED_MIN_DU_SEC);
+            planner.reset(zAxis, xAxis, programZ, programX, feedDuSec);
+        }
+
+        // Выход в точку перед кадром продолжения
+        GCodeBlock approach;
+        memset(&approach, 0, sizeof(approach));
+        approach.line = image[imageIndex].line;
+        approach.motion = GCODE_MOTION_RAPID;
+        if (state.flags & GCODE_CHECKPOINT_Z) {
+            approach.z = state.z;
+            approach.flags |= GCODE_HAS_Z;
+        }
+        if (state.flags & GCODE_CHECKPOINT_X) {
+            approach.x = state.x;
+            approach.flags |= GCODE_HAS_X;
+        }
+        if (approach.flags) {
+            planner.push(approach);
+        }
+        LOG_INFO("G-код", "Продолжение программы со строки " + String(approach.line));
+    }
+
+    /**
+     * @brief Чтение кадров в окно планировщика из цикла, образа или очереди
+     *
+     * Служебные кадры переменных, циклов и подпрограмм в окно не попадают,
+     * за один вызов их исполняется не больше GCODE_FLOW_STEPS_MAX.
+     */
+    void fillPlanner() {
+        int flowSteps = 0;
+        while (planner.canFetch() && flowSteps < GCODE_FLOW_STEPS_MAX) {
+            GCodeBlock block;
+            if (cycleActive) {
+                if (!cycle.next(block)) {
+                    cycleActive = false;
+                    imageIndex = cycleResumeIndex;
+                    continue;
+                }
+            } else if (image) {
+                if (imageIndex >= imageCount) {
+                    return;
+                }
+                block = image[imageIndex++];
+            } else if (xQueueReceive(blockQueue, &block, 0) != pdTRUE) {
+                return;
+            }
+
+            if (block.command == GCODE_CMD_RETURN && !macro.isInSubprogram()) {
+                block.command = GCODE_CMD_END; // M99 в основной программе завершает ее
+            } else if (GCodeMacro::isFlow(block.command)) {
+                flowSteps++;
+                if (!macro.execute(block, image, imageCount, imageIndex)) {
+                    abort(block.line, macro.getError());
+                    return;
+                }
+                continue;
+            }
+            if (!macro.resolve(block)) {
+                abort(block.line, macro.getError());
+                return;
+            }
+            planner.push(block);
+        }
+    }
+
+    /**
+     * @brief Начало исполнения нового кадра
+     * @param planned Кадр из окна планировщика
+     */
+    void beginBlock(const PlannerBlock& planned) {
+        const GCodeBlock& block = planned.block;
+        currentLine = block.line;
+
+        if (block.flags & GCODE_HAS_F) {
+            feedDuSec = max((long)block.feed, (long)GCODE_FEED_MIN_DU_SEC);
+        }
+        if (block.motion != GCODE_MOTION_THREAD) {
+            syncChained = false;
+        }
+
+        if (CannedCycle::isCycle(block.motion)) {
+            beginCycle(block);
+            return;
+        }
+
+        if (block.motion == GCODE_MOTION_DWELL) {
+            dwellEndMs = millis() + block.p;
+            segmentSteps = 0;
+            arcMove = false;
+            executing = true;
+        } else if (MotionPlanner::isMove(block)) {
+            beginMove(planned);
+            if (finished) {
+                return; // Ошибка в параметрах дуги
+            }
+        }
+
+        // Служебные команды исполняются после движения этого же кадра
+        pendingCommand = block.command;
+        if (!executing) {
+            finishBlock();
+        }
+    }
+
+    /**
+     * @brief Запуск цикла G70/G71
+     * @param block Кадр цикла
+     */
+    void beginCycle(const GCodeBlock& block) {
+        if (block.motion == GCODE_MOTION_THREAD_CYCLE) {
+            beginThreadCycle(block);
+            return;
+        }
+        if (!image || cycleActive) {
+            abort(block.line, "Цикл доступен только в сохраненной программе");
+            return;
+        }
+        long first = findLabel(block.p);
+        long last = findLabel(block.q);
+        if (first < 0 || last < first) {
+            abort(block.line, "Не найдены кадры контура P/Q");
+            return;
+        }
+
+        bool ok = block.motion == GCODE_MOTION_ROUGH ?
+            cycle.beginRoughing(image, first, last, block, programZ, programX, feedDuSec) :
+            cycle.beginFinishing(image, first, last, block.line, programZ, programX);
+        if (!ok) {
+            abort(block.line, cycle.getError());
+            return;
+        }
+
+        // После G71 программа продолжается за контуром, после G70 - за кадром G70
+        cycleResumeIndex = block.motion == GCODE_MOTION_ROUGH ? last + 1 : imageIndex;
+        cycleActive = true;
+    }
+
+    /**
+     * @brief Запуск цикла нарезания резьбы G76
+     * @param block Кадр цикла
+     *
+     * Цикл не ссылается на другие кадры, поэтому доступен и при потоковой
+     * передаче. Скорость оси Z проверяется при текущих оборотах до первого прохода.
+     */
+    void beginThreadCycle(const GCodeBlock& block) {
+        if (cycleActive) {
+            abort(block.line, "Вложенный цикл");
+            return;
+        }
+        if (!cycle.beginThreading(block, programZ, programX)) {
+            abort(block.line, cycle.getError());
+            return;
+        }
+        if (!checkThreadSpeed(zAxis, block.k * block.starts, block.line)) {
+            return;
+        }
+
+        // Расстояние разгона до скорости резьбы - запас по Z перед деталью
+        Gearbox threadGear;
+        threadGear.set(zAxis.getMotorSteps(), zAxis.getScrewPitch(), block.k * block.starts);
+        long speed = threadGear.getAxisSpeed(spindle.getRpm());
+        long accelSteps = (long)((long long)speed * speed / (2 * max(1L, zAxis.getAcceleration())));
+        LOG_INFO("G-код", "Цикл G76: проходов " + String(cycle.getPassCount()) + " x " +
+                 String(max(1, (int)block.starts)) + ", разгон Z " + String(zAxis.stepsToDu(accelSteps)) + " du");
+
+        cycleResumeIndex = imageIndex;
+        cycleActive = true;
+    }
+
+    /**
+     * @brief Проверка, что ось успевает за шпинделем при текущих оборотах
+     * @param axis Ведущая ось
+     * @param leadDu Перемещение за оборот шпинделя в деци-микронах
+     * @param line Строка кадра (для сообщения об ошибке)
+     * @return false если скорость превышает предел оси (программа прервана)
+     */
+    bool checkThreadSpeed(AxisController& axis, long leadDu, uint32_t line) {
+        Gearbox threadGear;
+        threadGear.set(axis.getMotorSteps(), axis.getScrewPitch(), leadDu);
+        long speed = threadGear.getAxisSpeed(spindle.getRpm());
+        if (speed > axis.getSpeedLimit()) {
+            LOG_ERROR("G-код", "Ось " + String(axis.getName()) + ": нужно " + String(speed) +
+                      " шаг/с, допустимо " + String(axis.getSpeedLimit()));
+            abort(line, "Обороты шпинделя слишком высоки для резьбы");
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Проверка границ и скоростей программы по одной оси
+     * @param axis Ось
+     * @param bounds Границы программы
+     * @param index GCODE_BOUNDS_AXIS_Z или GCODE_BOUNDS_AXIS_X
+     * @return false если программа прервана
+     */
+    bool checkAxisBounds(AxisController& axis, const GCodeBounds& bounds, int index) {
+        String name = "Ось " + String(axis.getName()) + ": ";
+        if (bounds.hasAxis(index)) {
+            long travel = axis.getMaxTravelMm() * 10000;
+            long low = bounds.low[index];
+            long high = bounds.high[index];
+            if (high > travel || low < -travel) {
+                bool above = high > travel;
+                LOG_ERROR("G-код", name + "точка " + String((above ? high : low) / 10000.0, 4) +
+                          " мм за пределом хода " + String(axis.getMaxTravelMm()) + " мм");
+                abort(above ? bounds.highLine[index] : bounds.lowLine[index], "Программа выходит за предел хода");
+                return false;
+            }
+            if (axis.getLeftStop() != LONG_MAX && high > axis.stepsToDu(axis.getLeftStop())) {
+                LOG_ERROR("G-код", name + "точка " + String(high / 10000.0, 4) + " мм за левым упором " +
+                          String(axis.stepsToDu(axis.getLeftStop()) / 10000.0, 4) + " мм");
+                abort(bounds.highLine[index], "Программа выходит за упор");
+                return false;
+            }
+            if (axis.getRightStop() != LONG_MIN && low < axis.stepsToDu(axis.getRightStop())) {
+                LOG_ERROR("G-код", name + "точка " + String(low / 10000.0, 4) + " мм за правым упором " +
+                          String(axis.stepsToDu(axis.getRightStop()) / 10000.0, 4) + " мм");
+                abort(bounds.lowLine[index], "Программа выходит за упор");
+                return false;
+            }
+        }
+
+        if (axis.duToSteps(bounds.speed[index]) > axis.getSpeedLimit()) {
+            LOG_WARNING("G-код", name + "подача в строке " + String(bounds.speedLine[index]) + " требует " +
+                        String(axis.duToSteps(bounds.speed[index])) + " шаг/с, будет снижена до " +
+                        String(axis.getSpeedLimit()));
+        }
+
+        // Резьба проверяется при текущих оборотах; при остановленном шпинделе - при запуске прохода
+        if (bounds.lead[index] > 0 && spindle.getRpm() >= GCODE_MIN_RPM &&
+            !checkThreadSpeed(axis, bounds.lead[index], bounds.leadLine[index])) {
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Поиск кадра образа по номеру N
+     * @param label Номер кадра
+     * @return Индекс кадра в образе или -1
+     */
+    long findLabel(uint32_t label) const {
+        for (uint32_t i = 0; i < imageCount; i++) {
+            if (image[i].label == label) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Завершение кадра и исполнение его служебной команды
+     */
+    void finishBlock() {
+        executing = false;
+        if (pendingCommand == GCODE_CMD_END) {
+            finished = true;
+            zAxis.resetMaxSpeed();
+            xAxis.resetMaxSpeed();
+            LOG_INFO("G-код", "Программа завершена в строке " + String(currentLine));
+        } else if (pendingCommand == GCODE_CMD_PAUSE) {
+            paused = true;
+            LOG_INFO("G-код", "Остановка программы в строке " + String(currentLine));
+        }
+        pendingCommand = GCODE_CMD_NONE;
+    }
+
+    /**
+     * @brief Подготовка перемещения
+     * @param planned Кадр с перемещением G0/G1/G2/G3/G33 и его точками из планировщика
+     */
+    void beginMove(const PlannerBlock& planned) {
+        const GCodeBlock& block = planned.block;
+        long fromZ = planned.startZ;
+        long fromX = planned.startX;
+        programZ = planned.endZ;
+        programX = planned.endX;
+
+        startZ = zAxis.getPositionSteps();
+        startX = xAxis.getPositionSteps();
+        deltaZ = zAxis.duToSteps(programZ) - startZ;
+        deltaX = xAxis.duToSteps(programX) - startX;
+        segmentSteps = max(labs(deltaZ), labs(deltaX));
+        segmentIndex = 0;
+        syncMove = false;
+        plannedMove = false;
+        blendIssued = false;
+        arcMove = block.motion == GCODE_MOTION_ARC_CW || block.motion == GCODE_MOTION_ARC_CCW;
+
+        if (arcMove) {
+            beginArc(block, fromZ, fromX);
+            return;
+        }
+        if (segmentSteps == 0) {
+            return;
+        }
+        if (block.motion == GCODE_MOTION_THREAD) {
+            beginSync(block, labs(programZ - fromZ) >= labs(programX - fromX));
+            return;
+        }
+
+        if (block.motion == GCODE_MOTION_RAPID) {
+            zAxis.resetMaxSpeed();
+            xAxis.resetMaxSpeed();
+        } else if (planned.kind == PLANNER_LINEAR) {
+            plannedMove = true;
+        } else {
+            applyFeed(programZ - (float)zAxis.getPositionDu(), programX - (float)xAxis.getPositionDu());
+        }
+
+        executing = true;
+        continueBlock();
+    }
+
+    /**
+     * @brief Подготовка дуги G2/G3
+     * @param block Кадр с дугой
+     * @param fromZ Запрограммированная начальная точка Z в деци-микронах
+     * @param fromX Запрограммированная начальная точка X в деци-микронах
+     */
+    void beginArc(const GCodeBlock& block, long fromZ, long fromX) {
+        bool clockwise = block.motion == GCODE_MOTION_ARC_CW;
+        long centerZ, centerX;
+        if (block.flags & GCODE_HAS_R) {
+            if (!ArcInterpolator::centerFromRadius(fromZ, fromX, programZ, programX, block.r,
+                                                   clockwise, centerZ, centerX)) {
+                abort(block.line, "Радиус дуги меньше половины хорды");
+                return;
+            }
+        } else {
+            centerZ = fromZ + block.k;
+            centerX = fromX + block.i;
+            long long startRadius = ArcInterpolator::isqrt(sq((long long)fromZ - centerZ) + sq((long long)fromX - centerX));
+            long long endRadius = ArcInterpolator::isqrt(sq((long long)programZ - centerZ) + sq((long long)programX - centerX));
+            if (llabs(startRadius - endRadius) > GCODE_ARC_TOLERANCE_DU) {
+                abort(block.line, "Конечная точка дуги не лежит на окружности");
+                return;
+            }
+        }
+
+        endZ = startZ + deltaZ;
+        endX = startX + deltaX;
+        arcCenterZ = centerZ;
+        arcCenterX = centerX;
+        arc.begin(startZ, startX, endZ, endX, centerZ, centerX, clockwise);
+        arcEndIssued = false;
+        executing = true;
+        continueBlock();
+    }
+
+    /**
+     * @brief Подготовка перемещения G33, синхронного со шпинделем
+     * @param block Кадр G33
+     * @param majorZ Ведущая ось - Z (ход задается вдоль более длинной оси)
+     *
+     * Без предыдущего кадра G33 движение начинается, когда шпиндель проходит
+     * угол начала (q), отсчитанный от нулевого импульса энкодера.
+     */
+    void beginSync(const GCodeBlock& block, bool majorZ) {
+        AxisController& major = majorZ ? zAxis : xAxis;
+        if (!checkThreadSpeed(major, block.k, block.line)) {
+            return;
+        }
+        gear.set(major.getMotorSteps(), major.getScrewPitch(), block.k);
+        syncSteps = labs(majorZ ? deltaZ : deltaX);
+
+        if (syncChained) {
+            syncSpindle = syncEndSpindle;
+            syncWaiting = false;
+        } else {
+            long now = spindle.getAveragePosition();
+            long phase = (long)((long long)block.q * ENCODER_STEPS_INT / (360L * 10000));
+            syncSpindle = now + spindle.normalizePosition(phase - now);
+            syncWaiting = true;
+        }
+
+        zAxis.resetMaxSpeed();
+        xAxis.resetMaxSpeed();
+        syncMove = true;
+        syncEndIssued = false;
+        syncTravel = -1;
+        executing = true;
+        continueBlock();
+    }
+
+    /**
+     * @brief Слежение осей за шпинделем в кадре G33
+     *
+     * Цель ведущей оси пересчитывается от позиции шпинделя на каждом цикле,
+     * вторая ось движется пропорционально (конусная резьба и сбег).
+     */
+    void continueSync() {
+        long elapsed = spindle.getAveragePosition() - syncSpindle;
+        if (syncWaiting) {
+            if (elapsed < 0) {
+                return;
+            }
+            syncWaiting = false;
+        }
+
+        long travel = constrain(gear.toAxisSteps(elapsed), 0L, syncSteps);
+        if (travel < syncSteps) {
+            if (travel != syncTravel) {
+                syncTravel = travel;
+                zAxis.moveTo(startZ + (long)((long long)deltaZ * travel / syncSteps), true);
+                xAxis.moveTo(startX + (long)((long long)deltaX * travel / syncSteps), true);
+            }
+            return;
+        }
+
+        if (!syncEndIssued) {
+            // Следующий кадр G33 продолжит отсчет от позиции шпинделя конца этого кадра
+            syncEndIssued = true;
+            syncEndSpindle = syncSpindle + gear.toSpindlePulses(syncSteps);
+            zAxis.moveTo(startZ + deltaZ);
+            xAxis.moveTo(startX + deltaX);
+            return;
+        }
+
+        if (zAxis.isTargetReached() && xAxis.isTargetReached()) {
+            syncMove = false;
+            syncChained = true;
+            finishBlock();
+        }
+    }
+
+    /**
+     * @brief Распределение подачи по осям пропорционально их доле в перемещении
+     * @param dz Перемещение по Z в деци-микронах
+     * @param dx Перемещение по X в деци-микронах
+     *
+     * Ось с малой долей перемещения не замедляется ниже начальной скорости
+     * или подачи, если она меньше (limitAxisSpeed): на дуге ось, почти не
+     * движущаяся на этой порции, еще дорабатывает шаги предыдущей порции, и
+     * при скорости в единицы шагов в секунду каждый такой шаг задерживал бы
+     * выдачу следующей порции.
+     */
+    void applyFeed(float dz, float dx) {
+        float length = sqrt(dz * dz + dx * dx);
+        if (length > 0) {
+            limitAxisSpeed(zAxis, feedDuSec * fabs(dz) / length, feedDuSec);
+            limitAxisSpeed(xAxis, feedDuSec * fabs(dx) / length, feedDuSec);
+        }
+    }
+
+    /**
+     * @brief Продолжение исполнения текущего кадра
+     *
+     * Выдает осям следующую порцию отрезка когда они подошли к предыдущей цели.
+     */
+    void continueBlock() {
+        if (syncMove) {
+            continueSync();
+            return;
+        }
+        if (segmentSteps == 0 && !arcMove) {
+            // Пауза G4
+            if ((long)(millis() - dwellEndMs) >= 0) {
+                finishBlock();
+            }
+            return;
+        }
+
+        if (!zAxis.isTargetReached(GCODE_WAIT_EPSILON_STEPS) ||
+            !xAxis.isTargetReached(GCODE_WAIT_EPSILON_STEPS)) {
+            return;
+        }
+
+        if (arcMove) {
+            continueArc();
+            return;
+        }
+
+        if (segmentIndex >= segmentSteps) {
+            // Последняя порция выдана - ждем точного прихода в конечную точку,
+            // а при стыке без остановки оси уже подошли достаточно близко
+            if (blendIssued || (zAxis.isTargetReached() && xAxis.isTargetReached())) {
+                finishBlock();
+            }
+            return;
+        }
+
+        long chunk = max(1L, (long)ceil(1.0 / LINEAR_INTERPOLATION_PRECISION));
+        long fromIndex = segmentIndex;
+        segmentIndex = min(segmentSteps, segmentIndex + chunk);
+        bool last = segmentIndex == segmentSteps;
+        if (plannedMove) {
+            applyPlannedSpeed(fromIndex, segmentIndex);
+            blendIssued = last && planner.getExitSpeed() > 0;
+        }
+
+        // Промежуточные цели выдаются в непрерывном режиме, чтобы оси не тормозили
+        zAxis.moveTo(startZ + (long)((long long)deltaZ * segmentIndex / segmentSteps), !last || blendIssued);
+        xAxis.moveTo(startX + (long)((long long)deltaX * segmentIndex / segmentSteps), !last || blendIssued);
+    }
+
+    /**
+     * @brief Ограничение скорости осей на порции отрезка по профилю планировщика
+     * @param fromIndex Начало порции в шагах ведущей оси
+     * @param toIndex Конец порции в шагах ведущей оси
+     *
+     * Скорость оси не опускается ниже начальной (с нее ось трогается и
+     * останавливается без разгона), если подача это позволяет. Порции выдаются
+     * по ведущей оси, поэтому более быстрая ведомая ось не уходит с траектории,
+     * а лишь раньше приходит к цели порции - в том числе дорабатывает остаток
+     * предыдущего отрезка после стыка без остановки.
+     */
+    void applyPlannedSpeed(long fromIndex, long toIndex) {
+        const PlannerBlock& planned = planner.getCurrent();
+        float speed = planner.getSpeedLimit(planned.length * fromIndex / segmentSteps,
+                                            planned.length * toIndex / segmentSteps);
+        limitAxisSpeed(zAxis, speed * fabsf(planned.unitZ), planned.nominalSpeed);
+        limitAxisSpeed(xAxis, speed * fabsf(planned.unitX), planned.nominalSpeed);
+    }
+
+    /**
+     * @brief Ограничение скорости одной оси
+     * @param axis Ось
+     * @param speedDu Скорость оси по профилю в деци-микронах в секунду
+     * @param feedDu Запрограммированная скорость вдоль отрезка
+     */
+    void limitAxisSpeed(AxisController& axis, float speedDu, float feedDu) {
+        long floor = max(1L, min(axis.getSpeedStart(), axis.duToSteps(feedDu)));
+        axis.setMaxSpeed(max(floor, axis.duToSteps(speedDu)));
+    }
+
+    /**
+     * @brief Выдача осям следующей порции дуги
+     *
+     * Подача каждой порции распределяется по осям по касательной в середине
+     * порции, поэтому скорость вдоль дуги остается равной запрограммированной.
+     * Хорда порции из нескольких шагов задает направление слишком грубо: доли
+     * осей скакали бы от порции к порции, и ось после каждого снижения
+     * скорости заново разгонялась бы до подачи.
+     */
+    void continueArc() {
+        if (arc.isActive()) {
+            long fromZ = arc.getZ();
+            long fromX = arc.getX();
+            for (long i = 0; i < arc.getChunkSteps() && arc.step(); i++) {}
+
+            // Касательная перпендикулярна радиусу: доля Z равна доле радиуса по X и наоборот
+            applyFeed(xAxis.stepsToDu(fromX + arc.getX()) / 2 - arcCenterX,
+                      zAxis.stepsToDu(fromZ + arc.getZ()) / 2 - arcCenterZ);
+            zAxis.moveTo(arc.getZ(), true);
+            xAxis.moveTo(arc.getX(), true);
+            return;
+        }
+
+        if (!arcEndIssued) {
+            // Доводка в точную конечную точку (не дальше шага оси от последней точки дуги)
+            arcEndIssued = true;
+            zAxis.moveTo(endZ);
+            xAxis.moveTo(endX);
+            return;
+        }
+
+        if (zAxis.isTargetReached() && xAxis.isTargetReached()) {
+            finishBlock();
+        }
+    }
+};
+
+#endif // GCODE_INTERPRETER_H
@@ -0,0 +1,347 @@
+#ifndef GCODE_MACRO_H
+#define GCODE_MACRO_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "GCodeParser.h"
+
+/**
+ * @class GCodeMacro
+ * @brief Переменные, циклы WHILE/END и подпрограммы M98/M99 программы из образа
+ *
+ * Служебные кадры исполняются при чтении кадров вперед, до планировщика:
+ * присваивание меняет переменную, переходы меняют номер следующего кадра
+ * образа. Тело цикла и подпрограмма повторяются из уже скомпилированных
+ * кадров образа, поэтому повторы не требуют разбора текста, а перемещения
+ * на стыке с переходом сливаются планировщиком как обычные соседние кадры.
+ * Положения подпрограмм в образе запоминаются в небольшом кэше, чтобы
+ * повторный вызов не искал метку O заново.
+ *
+ * Значения переменных хранятся с четырьмя знаками после запятой (как числа
+ * разборщика) и переводятся в деци-микроны при подстановке в кадр. При
+ * потоковой передаче кадры не повторяются, поэтому там доступны только
+ * переменные.
+ */
+class GCodeMacro {
+private:
+    // Вызов подпрограммы
+    struct CallFrame {
+        uint32_t start;                 // Кадр O подпрограммы
+        uint32_t returnIndex;           // Кадр, следующий за M98
+        int32_t remaining;              // Оставшееся число повторов
+        int loopBase;                   // Глубина циклов на момент вызова
+    };
+
+    // Исполняемый цикл WHILE
+    struct LoopFrame {
+        uint32_t start;                 // Кадр WHILE
+        int32_t id;                     // Номер цикла DOn
+    };
+
+    int32_t variables[GCODE_VARIABLE_COUNT]; // Значения #0..#n (#0 всегда 0)
+    CallFrame calls[GCODE_CALL_DEPTH];  // Стек вызовов подпрограмм
+    int callDepth;                      // Число вызовов в стеке
+    LoopFrame loops[GCODE_LOOP_DEPTH * (GCODE_CALL_DEPTH + 1)]; // Стек циклов всех уровней вызова
+    int loopDepth;                      // Число циклов в стеке
+
+    int32_t cacheNumber[GCODE_SUBPROGRAM_CACHE]; // Номера O найденных подпрограмм
+    uint32_t cacheIndex[GCODE_SUBPROGRAM_CACHE]; // Их кадры в образе
+    int cacheCount;                     // Число занятых записей кэша
+    int cacheNext;                      // Запись, заменяемая следующей
+
+    const char* error;                  // Описание последней ошибки
+
+public:
+    /**
+     * @brief Конструктор
+     */
+    GCodeMacro() : callDepth(0), loopDepth(0), cacheCount(0), cacheNext(0), error("") {
+        memset(variables, 0, sizeof(variables));
+    }
+
+    /**
+     * @brief Сброс переменных, стеков и кэша перед новой программой
+     */
+    void reset() {
+        memset(variables, 0, sizeof(variables));
+        callDepth = 0;
+        loopDepth = 0;
+        cacheCount = 0;
+        cacheNext = 0;
+    }
+
+    /**
+     * @brief Проверка, что команда кадра исполняется при чтении, а не осями
+     * @param command Служебная команда кадра
+     */
+    static bool isFlow(uint8_t command) {
+        return command >= GCODE_CMD_ASSIGN && command <= GCODE_CMD_PROGRAM;
+    }
+
+    /**
+     * @brief Исполняется ли подпрограмма (M99 возвращает из нее, а не завершает программу)
+     */
+    bool isInSubprogram() const {
+        return callDepth > 0;
+    }
+
+    /**
+     * @brief Исполнение служебного кадра
+     * @param block Кадр присваивания, цикла или подпрограммы
+     * @param image Образ программы (nullptr - потоковая передача)
+     * @param count Число кадров образа
+     * @param index Номер следующего кадра образа, меняется переходом
+     * @return false при ошибке (описание в getError())
+     */
+    bool execute(const GCodeBlock& block, const GCodeBlock* image, uint32_t count, uint32_t& index) {
+        if (block.command == GCODE_CMD_ASSIGN) {
+            int32_t value;
+            if (!evaluate(block, value)) {
+                return false;
+            }
+            variables[block.p] = value;
+            return true;
+        }
+        if (block.command == GCODE_CMD_PROGRAM) {
+            return true; // Начало подпрограммы при последовательном исполнении пропускается
+        }
+        if (!image) {
+            return fail("Переходы доступны только в сохраненной программе");
+        }
+
+        switch (block.command) {
+            case GCODE_CMD_WHILE:
+                return executeWhile(block, image, count, index);
+
+            case GCODE_CMD_LOOP_END: {
+                int base = callDepth > 0 ? calls[callDepth - 1].loopBase : 0;
+                if (loopDepth <= base || loops[loopDepth - 1].id != block.p) {
+                    return fail("END без WHILE");
+                }
+                index = loops[loopDepth - 1].start; // Условие проверяется заново
+                return true;
+            }
+
+            case GCODE_CMD_CALL: {
+                if (callDepth >= GCODE_CALL_DEPTH) {
+                    return fail("Слишком глубокая вложенность подпрограмм");
+                }
+                long start = findProgram(block.p, image, count);
+                if (start < 0) {
+                    return fail("Подпрограмма не найдена");
+                }
+                calls[callDepth++] = {(uint32_t)start, index, block.q, loopDepth};
+                index = start + 1;
+                return true;
+            }
+
+            case GCODE_CMD_RETURN: {
+                if (callDepth == 0) {
+                    return fail("M99 вне подпрограммы");
+                }
+                CallFrame& frame = calls[callDepth - 1];
+                loopDepth = frame.loopBase; // Циклы подпрограммы завершаются вместе с ней
+                if (--frame.remaining > 0) {
+                    index = frame.start + 1;
+                } else {
+                    index = frame.returnIndex;
+                    callDepth--;
+                }
+                return true;
+            }
+        }
+        return fail("Неизвестная служебная команда");
+    }
+
+    /**
+     * @brief Подстановка значений переменных в слова кадра
+     * @param block Кадр перемещения или подачи
+     * @return false если значение недопустимо для слова (описание в getError())
+     */
+    bool resolve(GCodeBlock& block) {
+        if (!GCodeParser::hasVariables(block)) {
+            return true;
+        }
+        bool inches = block.flags & GCODE_INCHES;
+        if (!resolveLength(block.varX, inches, block.x) || !resolveLength(block.varZ, inches, block.z) ||
+            !resolveLength(block.varI, inches, block.i) || !resolveLength(block.varK, inches, block.k) ||
+            !resolveLength(block.varR, inches, block.r)) {
+            return false;
+        }
+        if (block.varR && block.r == 0) {
+            return fail("Нулевой радиус дуги");
+        }
+        if (block.varF) {
+            // Подача задается в единицах в минуту, пределы те же, что у слова F
+            block.feed = GCodeParser::toFeed(getValue(block.varF), inches);
+            if (block.feed == 0) {
+                return fail("Подача из переменной вне диапазона");
+            }
+        }
+        block.varX = block.varZ = block.varF = block.varI = block.varK = block.varR = 0;
+        return true;
+    }
+
+    /**
+     * @brief Значение переменной
+     * @param index Номер переменной
+     * @return Значение * 10000
+     */
+    int32_t getVariable(int index) const {
+        return index > 0 && index < GCODE_VARIABLE_COUNT ? variables[index] : 0;
+    }
+
+    const char* getError() const { return error; }
+
+private:
+    /**
+     * @brief Исполнение кадра WHILE
+     *
+     * Первое прохождение открывает цикл, переход с ENDn возвращает на тот же
+     * кадр. Ложное условие закрывает цикл и переносит чтение за его ENDn.
+     */
+    bool executeWhile(const GCodeBlock& block, const GCodeBlock* image, uint32_t count, uint32_t& index) {
+        uint32_t at = index - 1;
+        int base = callDepth > 0 ? calls[callDepth - 1].loopBase : 0;
+        bool open = loopDepth > base && loops[loopDepth - 1].start == at;
+
+        int32_t a = getOperand(block.i, block.varI);
+        int32_t b = getOperand(block.k, block.varK);
+        bool condition;
+        switch (block.op) {
+            case GCODE_OP_EQ: condition = a == b; break;
+            case GCODE_OP_NE: condition = a != b; break;
+            case GCODE_OP_GT: condition = a > b; break;
+            case GCODE_OP_GE: condition = a >= b; break;
+            case GCODE_OP_LT: condition = a < b; break;
+            case GCODE_OP_LE: condition = a <= b; break;
+            default: return fail("Неверное условие WHILE");
+        }
+
+        if (condition) {
+            if (!open) {
+                if (loopDepth >= (int)(sizeof(loops) / sizeof(loops[0]))) {
+                    return fail("Слишком глубокая вложенность циклов");
+                }
+                loops[loopDepth++] = {at, block.p};
+            }
+            return true;
+        }
+
+        if (open) {
+            loopDepth--;
+        }
+        for (uint32_t i = index; i < count; i++) {
+            if (image[i].command == GCODE_CMD_LOOP_END && image[i].p == block.p) {
+                index = i + 1;
+                return true;
+            }
+        }
+        return fail("WHILE без END");
+    }
+
+    /**
+     * @brief Вычисление выражения кадра присваивания
+     * @param block Кадр присваивания
+     * @param value Результат * 10000
+     * @return false при делении на ноль или переполнении
+     */
+    bool evaluate(const GCodeBlock& block, int32_t& value) {
+        long long a = getOperand(block.i, block.varI);
+        long long b = getOperand(block.k, block.varK);
+        long long result;
+        switch (block.op) {
+            case GCODE_OP_NONE: result = a; break;
+            case GCODE_OP_ADD: result = a + b; break;
+            case GCODE_OP_SUB: result = a - b; break;
+            case GCODE_OP_MUL: result = roundedDivide(a * b, 10000); break;
+            case GCODE_OP_DIV:
+                if (b == 0) {
+                    return fail("Деление на ноль");
+                }
+                result = roundedDivide(a * 10000, b);
+                break;
+            default: return fail("Неверная операция выражения");
+        }
+        if (result > INT32_MAX || result < -INT32_MAX) {
+            return fail("Переполнение в выражении");
+        }
+        value = (int32_t)result;
+        return true;
+    }
+
+    /**
+     * @brief Деление с округлением к ближайшему
+     */
+    static long long roundedDivide(long long a, long long b) {
+        if (b < 0) {
+            a = -a;
+            b = -b;
+        }
+        return (a >= 0 ? a + b / 2 : a - b / 2) / b;
+    }
+
+    /**
+     * @brief Подстановка переменной в координату
+     * @param var Ссылка на переменную (0 - значение задано числом)
+     * @param inches Кадр в дюймах
+     * @param field Поле кадра
+     */
+    bool resolveLength(uint8_t var, bool inches, int32_t& field) {
+        if (!var) {
+            return true;
+        }
+        long du = GCodeParser::toDeciMicrons(getValue(var), inches);
+        long limit = max(MAX_TRAVEL_MM_Z, MAX_TRAVEL_MM_X) * 10000;
+        if (du > limit || du < -limit) {
+            return fail("Значение переменной вне диапазона");
+        }
+        field = du;
+        return true;
+    }
+
+    /**
+     * @brief Значение операнда: числа или переменной
+     */
+    int32_t getOperand(int32_t value, uint8_t var) const {
+        return var ? getValue(var) : value;
+    }
+
+    /**
+     * @brief Значение ссылки на переменную с учетом знака
+     */
+    int32_t getValue(uint8_t var) const {
+        int32_t value = variables[var & ~GCODE_VAR_NEGATE];
+        return (var & GCODE_VAR_NEGATE) ? -value : value;
+    }
+
+    /**
+     * @brief Поиск кадра O подпрограммы в образе с запоминанием в кэше
+     * @param number Номер подпрограммы
+     * @return Индекс кадра O или -1
+     */
+    long findProgram(int32_t number, const GCodeBlock* image, uint32_t count) {
+        for (int i = 0; i < cacheCount; i++) {
+            if (cacheNumber[i] == number) {
+                return cacheIndex[i];
+            }
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            if (image[i].command == GCODE_CMD_PROGRAM && image[i].p == number) {
+                cacheNumber[cacheNext] = number;
+                cacheIndex[cacheNext] = i;
+                cacheNext = (cacheNext + 1) % GCODE_SUBPROGRAM_CACHE;
+                cacheCount = min(cacheCount + 1, GCODE_SUBPROGRAM_CACHE);
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    bool fail(const char* message) {
+        error = message;
+        return false;
+    }
+};
+
+#endif // GCODE_MACRO_H
@@ -0,0 +1,1048 @@
+#ifndef GCODE_PARSER_H
+#define GCODE_PARSER_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// =============================================================================
+// ТИПЫ ДВИЖЕНИЯ КАДРА
+// =============================================================================
+
+#define GCODE_MOTION_NONE 0         // Кадр без движения
+#define GCODE_MOTION_RAPID 1        // G0 - ускоренное перемещение
+#define GCODE_MOTION_LINEAR 2       // G1 - линейная интерполяция с подачей
+#define GCODE_MOTION_DWELL 3        // G4 - пауза
+#define GCODE_MOTION_ARC_CW 4       // G2 - дуга по часовой стрелке
+#define GCODE_MOTION_ARC_CCW 5      // G3 - дуга против часовой стрелки
+#define GCODE_MOTION_FINISH 6       // G70 - чистовой проход по контуру
+#define GCODE_MOTION_ROUGH 7        // G71 - черновое продольное точение по контуру
+#define GCODE_MOTION_THREAD 8       // G33 - перемещение, синхронное со шпинделем
+#define GCODE_MOTION_THREAD_CYCLE 9 // G76 - многопроходный цикл нарезания резьбы
+
+// =============================================================================
+// СЛУЖЕБНЫЕ КОМАНДЫ КАДРА
+// =============================================================================
+
+#define GCODE_CMD_NONE 0            // Нет команды
+#define GCODE_CMD_PAUSE 1           // M0/M1 - остановка программы до нажатия ВКЛ
+#define GCODE_CMD_END 2             // M2/M30 - конец программы
+#define GCODE_CMD_ASSIGN 3          // #n = выражение - присваивание переменной
+#define GCODE_CMD_WHILE 4           // WHILE [условие] DOn - начало цикла
+#define GCODE_CMD_LOOP_END 5        // ENDn - конец цикла
+#define GCODE_CMD_CALL 6            // M98 P(номер) L(повторы) - вызов подпрограммы
+#define GCODE_CMD_RETURN 7          // M99 - конец подпрограммы
+#define GCODE_CMD_PROGRAM 8         // O(номер) - начало подпрограммы
+
+// =============================================================================
+// ОПЕРАЦИИ ВЫРАЖЕНИЙ И УСЛОВИЙ
+// =============================================================================
+
+#define GCODE_OP_NONE 0             // Значение первого операнда
+#define GCODE_OP_ADD 1              // a + b
+#define GCODE_OP_SUB 2              // a - b
+#define GCODE_OP_MUL 3              // a * b
+#define GCODE_OP_DIV 4              // a / b
+#define GCODE_OP_EQ 5               // a EQ b
+#define GCODE_OP_NE 6               // a NE b
+#define GCODE_OP_GT 7               // a GT b
+#define GCODE_OP_GE 8               // a GE b
+#define GCODE_OP_LT 9               // a LT b
+#define GCODE_OP_LE 10              // a LE b
+
+#define GCODE_VAR_NEGATE 0x80       // Ссылка на переменную со знаком минус (-#n)
+
+// =============================================================================
+// ФЛАГИ КАДРА
+// =============================================================================
+
+#define GCODE_HAS_X 0x01            // В кадре задана координата X
+#define GCODE_HAS_Z 0x02            // В кадре задана координата Z
+#define GCODE_HAS_F 0x04            // В кадре задана подача
+#define GCODE_RELATIVE 0x08         // Координаты кадра относительные (G91)
+#define GCODE_HAS_I 0x10            // Задано смещение центра дуги по X
+#define GCODE_HAS_K 0x20            // Задано смещение центра дуги по Z
+#define GCODE_HAS_R 0x40            // Задан радиус дуги
+#define GCODE_HAS_P 0x80            // Задан параметр P
+#define GCODE_HAS_Q 0x100           // Задан параметр Q
+#define GCODE_HAS_U 0x200           // Задан параметр U
+#define GCODE_HAS_W 0x400           // Задан параметр W
+#define GCODE_HAS_L 0x800           // Задан параметр L
+#define GCODE_EXACT_STOP 0x1000     // Точная остановка в конце кадра (G61)
+#define GCODE_INCHES 0x2000         // Кадр в дюймах (G20) - для перевода значений переменных
+
+// =============================================================================
+// КОДЫ ОШИБОК РАЗБОРА
+// =============================================================================
+
+#define GCODE_OK 0                  // Кадр разобран успешно
+#define GCODE_ERR_CHARACTER 1       // Недопустимый символ
+#define GCODE_ERR_NUMBER 2          // Неверный формат числа
+#define GCODE_ERR_UNSUPPORTED_G 3   // Неподдерживаемый G-код
+#define GCODE_ERR_UNSUPPORTED_M 4   // Неподдерживаемый M-код
+#define GCODE_ERR_WORD 5            // Неподдерживаемое слово
+#define GCODE_ERR_RANGE 6           // Значение вне допустимого диапазона
+#define GCODE_ERR_ARC 7             // Дуга без центра или радиуса
+#define GCODE_ERR_CYCLE 8           // Неверные параметры цикла G70/G71
+#define GCODE_ERR_THREAD 9          // Неверные параметры резьбы G33/G76
+#define GCODE_ERR_VARIABLE 10       // Неверная переменная или выражение
+#define GCODE_ERR_LOOP 11           // Неверная вложенность WHILE/END
+#define GCODE_ERR_CALL 12           // Неверный вызов или начало подпрограммы
+
+/**
+ * @struct GCodeBlock
+ * @brief Один разобранный кадр G-кода в целочисленном виде
+ *
+ * Все координаты уже переведены в деци-микроны, подача - в деци-микроны в секунду,
+ * поэтому исполнителю не требуется знать систему единиц программы.
+ *
+ * В кадре цикла G71 поля имеют особый смысл: p и q - номера N первого и
+ * последнего кадра контура, x и z - чистовой припуск по X (U) и Z (W),
+ * i - глубина резания, r - отвод инструмента. В кадре G70 заданы только p и q.
+ * В кадре G33 k - ход (перемещение за оборот шпинделя), q - угол начала
+ * в 0.0001°. В кадре G76 x и z - конечная точка по дну резьбы, k - шаг,
+ * p - высота профиля, q - глубина первого прохода, i - минимальная глубина
+ * прохода, r - чистовой припуск, starts, springPasses, chamfer, angle -
+ * число заходов, зачистных проходов, длина сбега и угол профиля.
+ *
+ * Слова X, Z, F, I, K, R могут ссылаться на переменную (X#1, Z-#2): номер
+ * переменной записывается в поле var*, а значение подставляется при исполнении.
+ * В кадрах присваивания и WHILE p - номер переменной или цикла, i и k (или
+ * varI и varK) - операнды, op - операция; в M98 p - номер подпрограммы,
+ * q - число повторов; в O p - номер подпрограммы; в ENDn p - номер цикла.
+ * Структура является форматом хранения скомпилированной программы во флеш-памяти,
+ * поэтому ее размер и порядок полей фиксированы (см. GCODE_IMAGE_VERSION).
+ *
+ * Кадр фиксированной длины больше строки текста (56 байт против 20-25 байт
+ * типичной строки G1 из CAM), зато исполняется на месте по указателю без
+ * разбора, а переходы M98/WHILE, поиск контура G71 по N и контрольные точки
+ * адресуют кадр по номеру. Поля G76 и переменных (12 байт) остаются в кадре:
+ * та же структура передается через очередь при потоковой передаче, а вынос
+ * этих полей в отдельную таблицу сократил бы кадр лишь до 48 байт ценой
+ * второго формата и косвенного чтения в задаче движения. Раздел образов
+ * вмещает около 16 тысяч кадров.
+ */
+struct GCodeBlock {
+    uint32_t line;          // Номер строки исходного текста (с 1)
+    uint8_t motion;         // Тип движения (GCODE_MOTION_*)
+    uint8_t command;        // Служебная команда (GCODE_CMD_*)
+    uint16_t flags;         // Флаги кадра (GCODE_HAS_*, GCODE_RELATIVE, GCODE_EXACT_STOP)
+    int32_t x;              // Координата X в деци-микронах
+    int32_t z;              // Координата Z в деци-микронах
+    int32_t feed;           // Подача в деци-микронах в секунду
+    int32_t p;              // Параметр P (длительность паузы в миллисекундах)
+    int32_t i;              // Смещение центра дуги по X от начальной точки в деци-микронах
+    int32_t k;              // Смещение центра дуги по Z от начальной точки в деци-микронах
+    int32_t r;              // Радиус дуги в деци-микронах (отрицательный - больше 180°)
+    int32_t q;              // Параметр Q (последний кадр контура цикла)
+    uint32_t label;         // Номер кадра N (0 - без номера)
+    uint8_t starts;         // Число заходов резьбы G76
+    uint8_t springPasses;   // Число зачистных проходов G76 на полной глубине
+    uint8_t chamfer;        // Длина сбега резьбы G76 в десятых долях хода
+    uint8_t angle;          // Угол профиля резьбы G76 в градусах
+    uint8_t varX;           // Переменная слова X (0 - нет, с флагом GCODE_VAR_NEGATE - со знаком минус)
+    uint8_t varZ;           // Переменная слова Z
+    uint8_t varF;           // Переменная слова F
+    uint8_t varI;           // Переменная слова I или первого операнда
+    uint8_t varK;           // Переменная слова K или второго операнда
+    uint8_t varR;           // Переменная слова R
+    uint8_t op;             // Операция выражения или условия (GCODE_OP_*)
+    uint8_t reserved;       // Выравнивание
+};
+
+static_assert(sizeof(GCodeBlock) == 56, "Размер GCodeBlock входит в формат образа программы");
+
+/**
+ * @class GCodeParser
+ * @brief Разбор строк G-кода в кадры с фиксированной точкой
+ *
+ * Числа разбираются без использования float: значение хранится с четырьмя
+ * знаками после запятой, что для миллиметров совпадает с деци-микронами.
+ * Модальное состояние единиц (G20/G21) и режима координат (G90/G91) хранится
+ * в разборщике, так как влияет на перевод значений каждого следующего кадра.
+ * Режим стыков G61/G64 так же модален и передается флагом каждого кадра.
+ *
+ * Строки "#n = a", "#n = a + b" (а также - * /), "WHILE [a LT b] DOn" (а также
+ * EQ NE GT GE LE) и "ENDn" разбираются целиком как служебные кадры: a и b -
+ * числа или переменные, скобки вокруг выражения необязательны. Значения хранятся
+ * без перевода единиц и переводятся при подстановке в слово кадра.
+ */
+class GCodeParser {
+private:
+    bool inches;            // Текущие единицы - дюймы (G20)
+    bool relative;          // Текущий режим координат - относительный (G91)
+    bool exactStop;         // Точная остановка в конце каждого кадра (G61), иначе стыки без остановки (G64)
+    uint8_t motion;         // Текущий модальный тип движения (G0/G1/G2/G3)
+    long roughDepth;        // Глубина резания G71 (из кадра G71 U R)
+    long roughRetract;      // Отвод инструмента G71 (из кадра G71 U R)
+    long wordU, wordW;      // Значения U и W текущей строки
+    long wordL;             // Значение L текущей строки
+    long threadLead;        // Ход резьбы G33 (модальный, из слова K)
+    uint8_t threadSpring;   // Зачистные проходы G76 (из кадра G76 P Q R)
+    uint8_t threadChamfer;  // Сбег G76 в десятых долях хода
+    uint8_t threadAngle;    // Угол профиля G76 в градусах
+    long threadMinDepth;    // Минимальная глубина прохода G76
+    long threadAllowance;   // Чистовой припуск G76
+    uint32_t lineNumber;    // Номер последней разобранной строки
+    int error;              // Код последней ошибки (GCODE_ERR_*)
+
+public:
+    /**
+     * @brief Конструктор разборщика
+     */
+    GCodeParser() : inches(false), relative(false), exactStop(false), motion(GCODE_MOTION_NONE),
+                    roughDepth(0), roughRetract(0), wordU(0), wordW(0), wordL(0), threadLead(0),
+                    threadSpring(0), threadChamfer(0), threadAngle(GCODE_THREAD_ANGLE_DEFAULT),
+                    threadMinDepth(0), threadAllowance(0),
+                    lineNumber(0), error(GCODE_OK) {}
+
+    /**
+     * @brief Сброс модального состояния перед новой программой
+     */
+    void reset() {
+        inches = false;
+        relative = false;
+        exactStop = false;
+        motion = GCODE_MOTION_NONE;
+        roughDepth = 0;
+        roughRetract = 0;
+        threadLead = 0;
+        threadSpring = 0;
+        threadChamfer = 0;
+        threadAngle = GCODE_THREAD_ANGLE_DEFAULT;
+        threadMinDepth = 0;
+        threadAllowance = 0;
+        lineNumber = 0;
+        error = GCODE_OK;
+    }
+
+    /**
+     * @brief Разбор одной строки G-кода
+     * @param text Строка программы (комментарии в скобках и после ';' допускаются)
+     * @param block Кадр для заполнения
+     * @return true если строка разобрана без ошибок
+     */
+    bool parseLine(const char* text, GCodeBlock& block) {
+        memset(&block, 0, sizeof(block));
+        block.line = ++lineNumber;
+        error = GCODE_OK;
+
+        const char* s = text;
+        skipBlank(s);
+        if (*s == '#') {
+            return parseAssignment(s, block);
+        }
+        if (matchKeyword(s, "WHILE")) {
+            return parseWhile(s, block);
+        }
+        if (matchKeyword(s, "END")) {
+            return parseLoopEnd(s, block);
+        }
+
+        while (*s) {
+            char c = toupper(*s);
+
+            // Пропуск пробелов, комментариев и символа начала/конца программы
+            if (c == ' ' || c == '\t' || c == '%') {
+                s++;
+                continue;
+            }
+            if (c == ';') {
+                break;
+            }
+            if (c == '(') {
+                while (*s && *s != ')') s++;
+                if (*s) s++;
+                continue;
+            }
+            if (c < 'A' || c > 'Z') {
+                return fail(GCODE_ERR_CHARACTER);
+            }
+
+            s++;
+            while (*s == ' ') s++;
+            if (*s == '#' || (*s == '-' && s[1] == '#')) {
+                uint8_t var;
+                if (!parseVariable(s, var)) {
+                    return fail(GCODE_ERR_VARIABLE);
+                }
+                if (!applyVariable(c, var, block)) {
+                    return fail(GCODE_ERR_WORD);
+                }
+                continue;
+            }
+
+            long value;
+            if (!parseNumber(s, value)) {
+                return fail(GCODE_ERR_NUMBER);
+            }
+
+            if (!applyWord(c, value, block)) {
+                return false;
+            }
+        }
+
+        if (relative) {
+            block.flags |= GCODE_RELATIVE;
+        }
+        if (exactStop) {
+            block.flags |= GCODE_EXACT_STOP;
+        }
+        if (inches) {
+            block.flags |= GCODE_INCHES;
+        }
+
+        // Координаты без G-кода движения продолжают последний G0/G1/G2/G3/G33
+        if (block.motion == GCODE_MOTION_RAPID || block.motion == GCODE_MOTION_LINEAR ||
+            isArc(block.motion) || block.motion == GCODE_MOTION_THREAD) {
+            motion = block.motion;
+        } else if (block.motion == GCODE_MOTION_NONE &&
+                   (block.flags & (GCODE_HAS_X | GCODE_HAS_Z | GCODE_HAS_I | GCODE_HAS_K | GCODE_HAS_R))) {
+            block.motion = motion;
+        }
+
+        if (block.command == GCODE_CMD_CALL || block.command == GCODE_CMD_RETURN ||
+            block.command == GCODE_CMD_PROGRAM) {
+            return finishSubprogram(block);
+        }
+
+        // Переменные подставляются только в перемещения G0/G1/G2/G3 и подачу
+        if (hasVariables(block) && block.motion != GCODE_MOTION_NONE && block.motion != GCODE_MOTION_RAPID &&
+            block.motion != GCODE_MOTION_LINEAR && !isArc(block.motion)) {
+            return fail(GCODE_ERR_VARIABLE);
+        }
+
+        if (!finishParameters(block)) {
+            return false;
+        }
+
+        // Дуге нужен либо центр (I/K), либо радиус (R); полная окружность - только через центр
+        if (isArc(block.motion)) {
+            bool hasCenter = block.flags & (GCODE_HAS_I | GCODE_HAS_K);
+            bool hasRadius = block.flags & GCODE_HAS_R;
+            bool hasEnd = block.flags & (GCODE_HAS_X | GCODE_HAS_Z);
+            if (hasCenter == hasRadius || (hasRadius && (!hasEnd || (block.r == 0 && !block.varR)))) {
+                return fail(GCODE_ERR_ARC);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Код последней ошибки разбора
+     * @return GCODE_OK или один из GCODE_ERR_*
+     */
+    int getError() const {
+        return error;
+    }
+
+    /**
+     * @brief Номер последней разобранной строки
+     * @return Номер строки начиная с 1
+     */
+    uint32_t getLineNumber() const {
+        return lineNumber;
+    }
+
+    /**
+     * @brief Текстовое описание кода ошибки
+     * @param code Код ошибки GCODE_ERR_*
+     * @return Описание на русском языке
+     */
+    static const char* getErrorText(int code) {
+        switch(code) {
+            case GCODE_OK: return "Нет ошибки";
+            case GCODE_ERR_CHARACTER: return "Недопустимый символ";
+            case GCODE_ERR_NUMBER: return "Неверный формат числа";
+            case GCODE_ERR_UNSUPPORTED_G: return "Неподдерживаемый G-код";
+            case GCODE_ERR_UNSUPPORTED_M: return "Неподдерживаемый M-код";
+            case GCODE_ERR_WORD: return "Неподдерживаемое слово";
+            case GCODE_ERR_RANGE: return "Значение вне диапазона";
+            case GCODE_ERR_ARC: return "Неверно задана дуга";
+            case GCODE_ERR_CYCLE: return "Неверные параметры цикла";
+            case GCODE_ERR_THREAD: return "Неверные параметры резьбы";
+            case GCODE_ERR_VARIABLE: return "Неверная переменная или выражение";
+            case GCODE_ERR_LOOP: return "Неверная вложенность WHILE/END";
+            case GCODE_ERR_CALL: return "Неверный вызов подпрограммы";
+            default: return "Неизвестная ошибка";
+        }
+    }
+
+    /**
+     * @brief Проверка, что в словах кадра есть ссылки на переменные
+     * @param block Кадр перемещения или подачи
+     * @return true если значения подставляются при исполнении
+     */
+    static bool hasVariables(const GCodeBlock& block) {
+        return block.varX || block.varZ || block.varF || block.varI || block.varK || block.varR;
+    }
+
+    /**
+     * @brief Перевод значения в заданных единицах в деци-микроны
+     * @param value Значение * 10000 (мм или дюймы)
+     * @param inches Значение в дюймах
+     * @return Значение в деци-микронах
+     */
+    static long toDeciMicrons(long value, bool inches) {
+        if (!inches) {
+            return value; // 0.0001 мм = 1 деци-микрон
+        }
+        // 0.0001 дюйма = 25.4 деци-микрона, округление к ближайшему
+        long long du = ((long long)value * 254 + (value >= 0 ? 5 : -5)) / 10;
+        return (long)max(min(du, (long long)LONG_MAX), (long long)-LONG_MAX); // Насыщение для проверки диапазона
+    }
+
+    /**
+     * @brief Перевод подачи в единицах в минуту в деци-микроны в секунду
+     * @param value Подача * 10000 (мм/мин или дюйм/мин)
+     * @param inches Подача в дюймах в минуту
+     * @return Подача в деци-микронах в секунду или 0 если она вне (0, GCODE_FEED_MAX_MM_MIN]
+     *
+     * Считается в long long: насыщенное значение toDeciMicrons() переполнило бы
+     * long при округлении.
+     */
+    static long toFeed(long value, bool inches) {
+        if (value <= 0) {
+            return 0;
+        }
+        long long du = inches ? ((long long)value * 254 + 5) / 10 : value;
+        if (du > (long long)GCODE_FEED_MAX_MM_MIN * 10000) {
+            return 0;
+        }
+        return (long)((du + 30) / 60);
+    }
+
+private:
+    /**
+     * @brief Применение одного слова (буква + число) к кадру
+     * @param letter Буква слова в верхнем регистре
+     * @param value Значение слова * 10000
+     * @param block Заполняемый кадр
+     * @return true если слово допустимо
+     */
+    bool applyWord(char letter, long value, GCodeBlock& block) {
+        switch(letter) {
+            case 'G': {
+                if (value % 10000 != 0) {
+                    return fail(GCODE_ERR_UNSUPPORTED_G);
+                }
+                switch(value / 10000) {
+                    case 0: block.motion = GCODE_MOTION_RAPID; break;
+                    case 1: block.motion = GCODE_MOTION_LINEAR; break;
+                    case 2: block.motion = GCODE_MOTION_ARC_CW; break;
+                    case 3: block.motion = GCODE_MOTION_ARC_CCW; break;
+                    case 4: block.motion = GCODE_MOTION_DWELL; break;
+                    case 33: block.motion = GCODE_MOTION_THREAD; break;
+                    case 70: block.motion = GCODE_MOTION_FINISH; break;
+                    case 71: block.motion = GCODE_MOTION_ROUGH; break;
+                    case 76: block.motion = GCODE_MOTION_THREAD_CYCLE; break;
+                    case 20: inches = true; break;
+                    case 21: inches = false; break;
+                    case 90: relative = false; break;
+                    case 91: relative = true; break;
+                    case 61: exactStop = true; break;
+                    case 64: exactStop = false; break;
+                    default: return fail(GCODE_ERR_UNSUPPORTED_G);
+                }
+                return true;
+            }
+            case 'M': {
+                if (value % 10000 != 0) {
+                    return fail(GCODE_ERR_UNSUPPORTED_M);
+                }
+                switch(value / 10000) {
+                    case 0:
+                    case 1: block.command = GCODE_CMD_PAUSE; break;
+                    case 2:
+                    case 30: block.command = GCODE_CMD_END; break;
+                    case 3:
+                    case 4:
+                    case 5: break; // Шпиндель управляется вручную
+                    case 98: block.command = GCODE_CMD_CALL; break;
+                    case 99: block.command = GCODE_CMD_RETURN; break;
+                    default: return fail(GCODE_ERR_UNSUPPORTED_M);
+                }
+                return true;
+            }
+            case 'X':
+                block.x = toDeciMicrons(value);
+                block.flags |= GCODE_HAS_X;
+                return checkCoordinate(block.x);
+            case 'Z':
+                block.z = toDeciMicrons(value);
+                block.flags |= GCODE_HAS_Z;
+                return checkCoordinate(block.z);
+            case 'I':
+                block.i = toDeciMicrons(value);
+                block.flags |= GCODE_HAS_I;
+                return checkCoordinate(block.i);
+            case 'K':
+                block.k = toDeciMicrons(value);
+                block.flags |= GCODE_HAS_K;
+                return checkCoordinate(block.k);
+            case 'R':
+                block.r = toDeciMicrons(value);
+                block.flags |= GCODE_HAS_R;
+                return checkCoordinate(block.r);
+            case 'F':
+                // Подача задается в единицах в минуту
+                block.feed = toFeed(value, inches);
+                if (block.feed == 0) {
+                    return fail(GCODE_ERR_RANGE);
+                }
+                block.flags |= GCODE_HAS_F;
+                return true;
+            case 'P':
+            case 'Q':
+                if (value < 0) {
+                    return fail(GCODE_ERR_RANGE);
+                }
+                // Смысл P и Q зависит от G-кода кадра и определяется в finishParameters()
+                if (letter == 'P') {
+                    block.p = value;
+                    block.flags |= GCODE_HAS_P;
+                } else {
+                    block.q = value;
+                    block.flags |= GCODE_HAS_Q;
+                }
+                return true;
+            case 'U':
+                wordU = toDeciMicrons(value);
+                block.flags |= GCODE_HAS_U;
+                return checkCoordinate(wordU);
+            case 'W':
+                wordW = toDeciMicrons(value);
+                block.flags |= GCODE_HAS_W;
+                return checkCoordinate(wordW);
+            case 'L':
+                if (value <= 0 || value % 10000 != 0) {
+                    return fail(GCODE_ERR_RANGE);
+                }
+                wordL = value / 10000;
+                block.flags |= GCODE_HAS_L;
+                return true;
+            case 'N':
+                if (value <= 0 || value % 10000 != 0) {
+                    return fail(GCODE_ERR_RANGE);
+                }
+                block.label = value / 10000;
+                return true;
+            case 'O':
+                if (value <= 0 || value % 10000 != 0 || block.command != GCODE_CMD_NONE) {
+                    return fail(GCODE_ERR_CALL);
+                }
+                block.command = GCODE_CMD_PROGRAM;
+                block.p = value / 10000;
+                return true;
+            case 'S':
+            case 'T':
+                return true; // Обороты и инструмент не используются
+            default:
+                return fail(GCODE_ERR_WORD);
+        }
+    }
+
+    /**
+     * @brief Перевод значения в текущих единицах в деци-микроны
+     * @param value Значение * 10000 (мм или дюймы)
+     * @return Значение в деци-микронах
+     */
+    long toDeciMicrons(long value) const {
+        return toDeciMicrons(value, inches);
+    }
+
+    /**
+     * @brief Перевод параметров P, Q, U, W, R в значения для типа движения кадра
+     * @param block Разобранный кадр
+     * @return true если параметры допустимы для кадра
+     *
+     * Цикл G71 задается двумя кадрами: "G71 U(глубина) R(отвод)" запоминается
+     * разборщиком, а "G71 P Q U(припуск X) W(припуск Z) F" получает эти значения.
+     */
+    bool finishParameters(GCodeBlock& block) {
+        if (block.motion == GCODE_MOTION_THREAD) {
+            return finishThread(block);
+        }
+        if (block.motion == GCODE_MOTION_THREAD_CYCLE) {
+            return finishThreadCycle(block);
+        }
+        if (block.flags & GCODE_HAS_L) {
+            return fail(GCODE_ERR_WORD);
+        }
+
+        bool cycle = block.motion == GCODE_MOTION_ROUGH || block.motion == GCODE_MOTION_FINISH;
+        if (!cycle) {
+            if (block.flags & (GCODE_HAS_Q | GCODE_HAS_U | GCODE_HAS_W)) {
+                return fail(GCODE_ERR_WORD);
+            }
+            if (block.motion == GCODE_MOTION_DWELL) {
+                block.p = (block.p + 5) / 10; // Пауза задается в секундах
+            } else {
+                block.p = 0;
+            }
+            return true;
+        }
+
+        if (block.motion == GCODE_MOTION_ROUGH && !(block.flags & GCODE_HAS_P)) {
+            // Кадр параметров G71 U R - исполняемого движения нет
+            if (!(block.flags & GCODE_HAS_U) || wordU <= 0 || block.r < 0) {
+                return fail(GCODE_ERR_CYCLE);
+            }
+            roughDepth = wordU;
+            roughRetract = block.r;
+            block.motion = GCODE_MOTION_NONE;
+            block.flags &= GCODE_HAS_F | GCODE_RELATIVE;
+            block.r = 0;
+            return true;
+        }
+
+        // Номера кадров контура - целые числа
+        if (!(block.flags & GCODE_HAS_P) || !(block.flags & GCODE_HAS_Q) ||
+            block.p % 10000 != 0 || block.q % 10000 != 0 || block.p == 0 || block.q == 0 ||
+            (block.flags & (GCODE_HAS_X | GCODE_HAS_Z | GCODE_HAS_I | GCODE_HAS_K | GCODE_HAS_R))) {
+            return fail(GCODE_ERR_CYCLE);
+        }
+        block.p /= 10000;
+        block.q /= 10000;
+
+        if (block.motion == GCODE_MOTION_ROUGH) {
+            if (roughDepth <= 0) {
+                return fail(GCODE_ERR_CYCLE); // Не было кадра G71 U R
+            }
+            block.x = (block.flags & GCODE_HAS_U) ? wordU : 0;
+            block.z = (block.flags & GCODE_HAS_W) ? wordW : 0;
+            block.i = roughDepth;
+            block.r = roughRetract;
+        } else if (block.flags & (GCODE_HAS_U | GCODE_HAS_W)) {
+            return fail(GCODE_ERR_CYCLE);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Проверка кадра G33 "X Z K(ход) Q(угол начала)"
+     * @param block Кадр с движением G33
+     * @return true если кадр допустим
+     *
+     * Ход модальный: последующие кадры G33 без K используют предыдущее значение.
+     */
+    bool finishThread(GCodeBlock& block) {
+        if (block.flags & (GCODE_HAS_I | GCODE_HAS_R | GCODE_HAS_P | GCODE_HAS_U | GCODE_HAS_W | GCODE_HAS_L)) {
+            return fail(GCODE_ERR_WORD);
+        }
+        if (block.flags & GCODE_HAS_K) {
+            if (block.k <= 0 || block.k > DUPR_MAX) {
+                return fail(GCODE_ERR_THREAD);
+            }
+            threadLead = block.k;
+        }
+        // Угол начала задается в градусах и остается в единицах 0.0001°
+        if (threadLead == 0 || !(block.flags & (GCODE_HAS_X | GCODE_HAS_Z)) ||
+            block.q < 0 || block.q >= 360L * 10000) {
+            return fail(GCODE_ERR_THREAD);
+        }
+        block.k = threadLead;
+        block.p = 0;
+        return true;
+    }
+
+    /**
+     * @brief Перевод параметров цикла G76
+     * @param block Кадр с движением G76
+     * @return true если параметры допустимы
+     *
+     * Цикл задается двумя кадрами (как G71): "G76 P(mmrraa) Q(мин. глубина) R(припуск)",
+     * где mm - число зачистных проходов, rr - сбег в десятых долях хода, aa - угол
+     * профиля, запоминается разборщиком; "G76 X Z P(высота) Q(первый проход) K(шаг) L(заходы)"
+     * получает эти значения. Ход задается словом K, так как F - подача в минуту.
+     */
+    bool finishThreadCycle(GCodeBlock& block) {
+        if (!(block.flags & (GCODE_HAS_X | GCODE_HAS_Z))) {
+            // Кадр параметров G76 P Q R - исполняемого движения нет
+            long code = block.p / 10000;
+            if (block.p % 10000 != 0 || block.q < 0 || block.r < 0 ||
+                (block.flags & (GCODE_HAS_I | GCODE_HAS_K | GCODE_HAS_U | GCODE_HAS_W | GCODE_HAS_L)) ||
+                code / 10000 > GCODE_THREAD_SPRING_MAX || code % 100 > GCODE_THREAD_ANGLE_MAX) {
+                return fail(GCODE_ERR_THREAD);
+            }
+            if (block.flags & GCODE_HAS_P) {
+                threadSpring = code / 10000;
+                threadChamfer = code / 100 % 100;
+                threadAngle = code % 100;
+            }
+            if (block.flags & GCODE_HAS_Q) {
+                threadMinDepth = toDeciMicrons(block.q);
+            }
+            if (block.flags & GCODE_HAS_R) {
+                threadAllowance = block.r;
+            }
+            block.p = 0;
+            block.q = 0;
+            block.r = 0;
+            block.motion = GCODE_MOTION_NONE;
+            block.flags &= GCODE_HAS_F | GCODE_RELATIVE;
+            return true;
+        }
+
+        // Конусная резьба (R) и смещения центра не поддерживаются
+        if (!(block.flags & GCODE_HAS_P) || !(block.flags & GCODE_HAS_Q) || !(block.flags & GCODE_HAS_K) ||
+            (block.flags & (GCODE_HAS_I | GCODE_HAS_R | GCODE_HAS_U | GCODE_HAS_W))) {
+            return fail(GCODE_ERR_THREAD);
+        }
+        long starts = (block.flags & GCODE_HAS_L) ? wordL : 1;
+        block.p = toDeciMicrons(block.p);
+        block.q = toDeciMicrons(block.q);
+        if (block.p <= 0 || block.q <= 0 || block.k <= 0 || starts > STARTS_MAX ||
+            (long long)block.k * starts > DUPR_MAX) {
+            return fail(GCODE_ERR_THREAD);
+        }
+        block.i = threadMinDepth;
+        block.r = threadAllowance;
+        block.starts = starts;
+        block.springPasses = threadSpring;
+        block.chamfer = threadChamfer;
+        block.angle = threadAngle;
+        return true;
+    }
+
+    /**
+     * @brief Проверка типа движения на дугу
+     */
+    static bool isArc(uint8_t motion) {
+        return motion == GCODE_MOTION_ARC_CW || motion == GCODE_MOTION_ARC_CCW;
+    }
+
+    /**
+     * @brief Проверка координаты на физическую допустимость
+     * @param du Координата в деци-микронах
+     * @return true если координата не превышает ход самой длинной оси
+     */
+    bool checkCoordinate(long du) {
+        long limit = max(MAX_TRAVEL_MM_Z, MAX_TRAVEL_MM_X) * 10000;
+        if (du > limit || du < -limit) {
+            return fail(GCODE_ERR_RANGE);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Разбор числа с фиксированной точкой
+     * @param s Указатель на текст, сдвигается за конец числа
+     * @param value Результат * 10000 с округлением пятого знака
+     * @return true если число разобрано
+     */
+    static bool parseNumber(const char*& s, long& value) {
+        while (*s == ' ') s++;
+
+        bool negative = false;
+        if (*s == '-' || *s == '+') {
+            negative = *s == '-';
+            s++;
+        }
+
+        long whole = 0;
+        long fraction = 0;
+        int fractionDigits = 0;
+        bool roundUp = false;
+        bool anyDigits = false;
+
+        while (*s >= '0' && *s <= '9') {
+            whole = whole * 10 + (*s - '0');
+            if (whole > 200000) {
+                return false; // Защита от переполнения (значение * 10000 в long)
+            }
+            anyDigits = true;
+            s++;
+        }
+        if (*s == '.') {
+            s++;
+            while (*s >= '0' && *s <= '9') {
+                if (fractionDigits < 4) {
+                    fraction = fraction * 10 + (*s - '0');
+                    fractionDigits++;
+                } else if (fractionDigits == 4) {
+                    roundUp = *s >= '5';
+                    fractionDigits++;
+                }
+                anyDigits = true;
+                s++;
+            }
+        }
+        if (!anyDigits) {
+            return false;
+        }
+
+        while (fractionDigits < 4) {
+            fraction *= 10;
+            fractionDigits++;
+        }
+        value = whole * 10000 + fraction + (roundUp ? 1 : 0);
+        if (negative) {
+            value = -value;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Разбор строки присваивания "#n = a [op b]"
+     * @param s Указатель на символ '#'
+     * @param block Кадр для заполнения
+     * @return true если строка разобрана
+     */
+    bool parseAssignment(const char* s, GCodeBlock& block) {
+        uint8_t target;
+        if (!parseVariable(s, target) || (target & GCODE_VAR_NEGATE)) {
+            return fail(GCODE_ERR_VARIABLE);
+        }
+        skipBlank(s);
+        if (*s != '=') {
+            return fail(GCODE_ERR_VARIABLE);
+        }
+        s++;
+        skipBlank(s);
+        bool bracket = *s == '[';
+        if (bracket) {
+            s++;
+        }
+
+        long a, b = 0;
+        uint8_t op = GCODE_OP_NONE;
+        if (!parseOperand(s, a, block.varI)) {
+            return fail(GCODE_ERR_VARIABLE);
+        }
+        skipBlank(s);
+        switch (*s) {
+            case '+': op = GCODE_OP_ADD; break;
+            case '-': op = GCODE_OP_SUB; break;
+            case '*': op = GCODE_OP_MUL; break;
+            case '/': op = GCODE_OP_DIV; break;
+        }
+        if (op != GCODE_OP_NONE) {
+            s++;
+            if (!parseOperand(s, b, block.varK)) {
+                return fail(GCODE_ERR_VARIABLE);
+            }
+        }
+        if (!closeBracket(s, bracket) || !isLineEnd(s)) {
+            return fail(GCODE_ERR_VARIABLE);
+        }
+
+        block.command = GCODE_CMD_ASSIGN;
+        block.p = target;
+        block.i = a;
+        block.k = b;
+        block.op = op;
+        return true;
+    }
+
+    /**
+     * @brief Разбор строки "WHILE [a EQ|NE|GT|GE|LT|LE b] DOn" (после слова WHILE)
+     */
+    bool parseWhile(const char* s, GCodeBlock& block) {
+        static const char* const names[] = {"EQ", "NE", "GT", "GE", "LT", "LE"};
+
+        skipBlank(s);
+        if (*s != '[') {
+            return fail(GCODE_ERR_VARIABLE);
+        }
+        s++;
+        long a, b;
+        if (!parseOperand(s, a, block.varI)) {
+            return fail(GCODE_ERR_VARIABLE);
+        }
+        skipBlank(s);
+        uint8_t op = GCODE_OP_NONE;
+        for (int i = 0; i < 6 && op == GCODE_OP_NONE; i++) {
+            if (matchKeyword(s, names[i])) {
+                op = GCODE_OP_EQ + i;
+            }
+        }
+        if (op == GCODE_OP_NONE || !parseOperand(s, b, block.varK) || !closeBracket(s, true)) {
+            return fail(GCODE_ERR_VARIABLE);
+        }
+
+        long loop;
+        skipBlank(s);
+        if (!matchKeyword(s, "DO") || !parseIndex(s, GCODE_LOOP_DEPTH, loop) || !isLineEnd(s)) {
+            return fail(GCODE_ERR_LOOP);
+        }
+        block.command = GCODE_CMD_WHILE;
+        block.p = loop;
+        block.i = a;
+        block.k = b;
+        block.op = op;
+        return true;
+    }
+
+    /**
+     * @brief Разбор строки "ENDn" (после слова END)
+     */
+    bool parseLoopEnd(const char* s, GCodeBlock& block) {
+        long loop;
+        while (*s == ' ') s++;
+        if (!parseIndex(s, GCODE_LOOP_DEPTH, loop) || !isLineEnd(s)) {
+            return fail(GCODE_ERR_LOOP);
+        }
+        block.command = GCODE_CMD_LOOP_END;
+        block.p = loop;
+        return true;
+    }
+
+    /**
+     * @brief Ссылка слова кадра на переменную
+     * @param letter Буква слова в верхнем регистре
+     * @param var Номер переменной с флагом GCODE_VAR_NEGATE
+     * @param block Заполняемый кадр
+     * @return true если слово допускает переменную
+     */
+    bool applyVariable(char letter, uint8_t var, GCodeBlock& block) {
+        switch (letter) {
+            case 'X': block.varX = var; block.flags |= GCODE_HAS_X; return true;
+            case 'Z': block.varZ = var; block.flags |= GCODE_HAS_Z; return true;
+            case 'F': block.varF = var; block.flags |= GCODE_HAS_F; return true;
+            case 'I': block.varI = var; block.flags |= GCODE_HAS_I; return true;
+            case 'K': block.varK = var; block.flags |= GCODE_HAS_K; return true;
+            case 'R': block.varR = var; block.flags |= GCODE_HAS_R; return true;
+            default: return false;
+        }
+    }
+
+    /**
+     * @brief Проверка кадров M98 P(номер) L(повторы), M99 и O(номер)
+     * @param block Кадр с командой подпрограммы
+     * @return true если кадр допустим
+     */
+    bool finishSubprogram(GCodeBlock& block) {
+        if (block.motion != GCODE_MOTION_NONE ||
+            (block.flags & (GCODE_HAS_X | GCODE_HAS_Z | GCODE_HAS_F | GCODE_HAS_I | GCODE_HAS_K |
+                            GCODE_HAS_R | GCODE_HAS_Q | GCODE_HAS_U | GCODE_HAS_W))) {
+            return fail(GCODE_ERR_CALL);
+        }
+        if (block.command == GCODE_CMD_CALL) {
+            if (!(block.flags & GCODE_HAS_P) || block.p <= 0 || block.p % 10000 != 0) {
+                return fail(GCODE_ERR_CALL);
+            }
+            block.p /= 10000;
+            block.q = (block.flags & GCODE_HAS_L) ? wordL : 1;
+            return true;
+        }
+        if (block.flags & (GCODE_HAS_P | GCODE_HAS_L)) {
+            return fail(GCODE_ERR_CALL);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Разбор операнда выражения: числа или переменной
+     * @param s Указатель на текст, сдвигается за конец операнда
+     * @param value Число * 10000 (0 для переменной)
+     * @param var Номер переменной (0 для числа)
+     * @return true если операнд разобран
+     */
+    static bool parseOperand(const char*& s, long& value, uint8_t& var) {
+        skipBlank(s);
+        value = 0;
+        var = 0;
+        if (*s == '#' || (*s == '-' && s[1] == '#')) {
+            return parseVariable(s, var);
+        }
+        return parseNumber(s, value);
+    }
+
+    /**
+     * @brief Разбор ссылки на переменную "#n" или "-#n"
+     * @param s Указатель на '#' или '-', сдвигается за номер
+     * @param var Номер переменной с флагом GCODE_VAR_NEGATE
+     * @return true если номер допустим
+     */
+    static bool parseVariable(const char*& s, uint8_t& var) {
+        bool negative = *s == '-';
+        if (negative) {
+            s++;
+        }
+        s++; // '#'
+        long index;
+        if (!parseIndex(s, GCODE_VARIABLE_COUNT - 1, index)) {
+            return false;
+        }
+        var = index | (negative ? GCODE_VAR_NEGATE : 0);
+        return true;
+    }
+
+    /**
+     * @brief Разбор целого номера от 1 до limit
+     */
+    static bool parseIndex(const char*& s, long limit, long& value) {
+        value = 0;
+        const char* start = s;
+        while (*s >= '0' && *s <= '9' && value <= limit) {
+            value = value * 10 + (*s - '0');
+            s++;
+        }
+        return s != start && value >= 1 && value <= limit;
+    }
+
+    /**
+     * @brief Сравнение начала текста со словом без учета регистра
+     * @param s Указатель на текст, при совпадении сдвигается за слово
+     * @param word Слово в верхнем регистре
+     * @return true если текст начинается со слова
+     */
+    static bool matchKeyword(const char*& s, const char* word) {
+        int length = 0;
+        while (word[length]) {
+            if (toupper(s[length]) != word[length]) {
+                return false;
+            }
+            length++;
+        }
+        s += length;
+        return true;
+    }
+
+    /**
+     * @brief Пропуск пробелов и комментариев в скобках
+     */
+    static void skipBlank(const char*& s) {
+        while (*s == ' ' || *s == '\t' || *s == '(') {
+            if (*s == '(') {
+                while (*s && *s != ')') s++;
+                if (*s) s++;
+            } else {
+                s++;
+            }
+        }
+    }
+
+    /**
+     * @brief Пропуск закрывающей скобки выражения
+     * @param required Скобка должна быть
+     */
+    static bool closeBracket(const char*& s, bool required) {
+        skipBlank(s);
+        if (*s == ']') {
+            s++;
+            return required;
+        }
+        return !required;
+    }
+
+    /**
+     * @brief Проверка, что до конца строки остались только комментарии
+     */
+    static bool isLineEnd(const char* s) {
+        skipBlank(s);
+        return *s == 0 || *s == ';';
+    }
+
+    /**
+     * @brief Запоминание ошибки разбора
+     * @param code Код ошибки
+     * @return Всегда false
+     */
+    bool fail(int code) {
+        error = code;
+        return false;
+    }
+};
+
+#endif // GCODE_PARSER_H
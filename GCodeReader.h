@@ -0,0 +1,119 @@
+#ifndef GCODE_READER_H
+#define GCODE_READER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <LittleFS.h>
+#include "Config.h"
+#include "RussianLogger.h"
+
+/**
+ * @class GCodeReader
+ * @brief Потоковое чтение программы G-кода построчно блоками фиксированного размера
+ *
+ * Программа никогда не загружается в память целиком: файл читается блоками по
+ * GCODE_READ_CHUNK байт, из которых выделяются строки. Размер программы ограничен
+ * только объемом флеш-памяти.
+ */
+class GCodeReader {
+private:
+    File file;                          // Открытый файл программы
+    char chunk[GCODE_READ_CHUNK];       // Буфер текущего блока чтения
+    int chunkLength;                    // Число байт в буфере
+    int chunkPos;                       // Позиция чтения внутри буфера
+    uint32_t lineNumber;                // Номер последней прочитанной строки (с 1)
+
+public:
+    /**
+     * @brief Конструктор потокового читателя
+     */
+    GCodeReader() : chunkLength(0), chunkPos(0), lineNumber(0) {}
+
+    /**
+     * @brief Открытие файла программы для чтения
+     * @param path Полный путь к файлу программы
+     * @return true если файл открыт
+     */
+    bool open(const char* path) {
+        close();
+        file = LittleFS.open(path, "r");
+        if (!file) {
+            LOG_ERROR("G-код", "Не удалось открыть программу " + String(path));
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Закрытие файла и сброс буфера
+     */
+    void close() {
+        if (file) {
+            file.close();
+        }
+        chunkLength = 0;
+        chunkPos = 0;
+        lineNumber = 0;
+    }
+
+    /**
+     * @brief Чтение следующей строки программы
+     * @param line Буфер для строки (завершается нулем, без символов перевода строки)
+     * @param maxLength Размер буфера строки
+     * @return true если строка прочитана, false в конце файла
+     *
+     * Слишком длинные строки обрезаются до размера буфера, остаток строки пропускается.
+     */
+    bool readLine(char* line, int maxLength) {
+        int length = 0;
+        bool gotData = false;
+
+        while (true) {
+            // Подкачка следующего блока при исчерпании буфера
+            if (chunkPos >= chunkLength) {
+                if (!file) {
+                    break;
+                }
+                int bytesRead = file.read((uint8_t*)chunk, GCODE_READ_CHUNK);
+                if (bytesRead <= 0) {
+                    break; // Конец файла
+                }
+                chunkLength = bytesRead;
+                chunkPos = 0;
+            }
+
+            char c = chunk[chunkPos++];
+            gotData = true;
+            if (c == '\n') {
+                break;
+            }
+            if (c != '\r' && length < maxLength - 1) {
+                line[length++] = c;
+            }
+        }
+
+        line[length] = 0;
+        if (gotData) {
+            lineNumber++;
+        }
+        return gotData;
+    }
+
+    /**
+     * @brief Проверка открытия файла
+     * @return true если файл открыт
+     */
+    bool isOpen() const {
+        return (bool)file;
+    }
+
+    /**
+     * @brief Номер последней прочитанной строки
+     * @return Номер строки начиная с 1
+     */
+    uint32_t getLineNumber() const {
+        return lineNumber;
+    }
+};
+
+#endif // GCODE_READER_H
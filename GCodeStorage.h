@@ -0,0 +1,598 @@
+#ifndef GCODE_STORAGE_H
+#define GCODE_STORAGE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <LittleFS.h>
+#include <esp_partition.h>
+#include "Config.h"
+#include "RussianLogger.h"
+#include "GCodeReader.h"
+#include "GCodeCompiler.h"
+
+/**
+ * @class GCodeStorage
+ * @brief Хранилище программ G-кода на разделе LittleFS с индексом каталога
+ *
+ * Программы хранятся отдельными файлами в каталоге GCODE_DIR под числовыми
+ * идентификаторами. Имена, размеры и идентификаторы программ собраны в файле
+ * индекса, который целиком держится в памяти: получение числа программ и
+ * имени программы по номеру не требует обхода каталога.
+ *
+ * При сохранении программа полностью проверяется и компилируется в массив
+ * кадров GCodeBlock, который записывается в отдельный раздел GCODE_IMAGE_PARTITION.
+ * Раздел отображается в адресное пространство один раз при запуске, и
+ * интерпретатор читает кадры прямо из флеш-памяти без копирования и разбора.
+ */
+class GCodeStorage {
+private:
+    // Запись индекса каталога (фиксированный размер, хранится в файле индекса как есть)
+    struct DirEntry {
+        char name[GCODE_NAME_MAX + 1];  // Имя программы для отображения
+        uint32_t size;                  // Размер программы в байтах
+        uint32_t id;                    // Идентификатор файла программы
+        uint32_t imageOffset;           // Смещение образа в разделе образов
+        uint32_t imageBlocks;           // Число кадров в образе
+    };
+
+    // Заголовок файла индекса
+    struct IndexHeader {
+        uint32_t magic;                 // Сигнатура файла индекса
+        uint16_t version;               // Версия формата индекса
+        uint16_t count;                 // Число записей
+        uint32_t nextId;                // Следующий свободный идентификатор
+    };
+
+    static constexpr uint32_t INDEX_MAGIC = 0x58444347; // "GCDX"
+    static constexpr uint16_t INDEX_VERSION = 2;
+    static constexpr uint32_t IMAGE_ALIGN = 4096;       // Размер сектора стирания флеш-памяти
+
+    DirEntry entries[GCODE_MAX_PROGRAMS]; // Копия индекса в памяти
+    int programCount;                   // Число программ в индексе
+    uint32_t nextId;                    // Следующий свободный идентификатор файла
+    bool mounted;                       // Файловая система смонтирована
+
+    // Раздел скомпилированных образов
+    const esp_partition_t* imagePartition; // Раздел образов (nullptr - не найден)
+    const uint8_t* imageBase;           // Начало отображения раздела в памяти
+    spi_flash_mmap_handle_t imageMap;   // Дескриптор отображения раздела
+    GCodeCompiler compiler;             // Компилятор программ при сохранении
+    int lastError;                      // Ошибка компиляции последней сохраняемой программы
+    uint32_t lastErrorLine;             // Строка ошибки компиляции
+
+    // Состояние незавершенной записи программы
+    uint32_t pendingId;                 // Идентификатор записываемой программы (0 - нет записи)
+    char pendingName[GCODE_NAME_MAX + 1]; // Имя записываемой программы
+    File pendingFile;                   // Временный файл записываемой программы
+
+public:
+    /**
+     * @brief Конструктор хранилища программ
+     */
+    GCodeStorage() : programCount(0), nextId(1), mounted(false),
+                     imagePartition(nullptr), imageBase(nullptr), imageMap(0),
+                     lastError(GCODE_OK), lastErrorLine(0), pendingId(0) {
+        pendingName[0] = 0;
+    }
+
+    /**
+     * @brief Монтирование файловой системы и загрузка индекса каталога
+     * @return true если хранилище готово к работе
+     */
+    bool begin() {
+        // Форматирование раздела при первом запуске или повреждении
+        if (!LittleFS.begin(true, GCODE_FS_BASE_PATH, 4, GCODE_FS_PARTITION)) {
+            LOG_ERROR("Хранилище", "Не удалось смонтировать LittleFS на разделе " + String(GCODE_FS_PARTITION));
+            return false;
+        }
+        mounted = true;
+
+        if (!LittleFS.exists(GCODE_DIR)) {
+            LittleFS.mkdir(GCODE_DIR);
+        }
+
+        loadIndex();
+
+        // Отображение раздела образов выполняется один раз: запись через
+        // esp_partition_write сбрасывает кэш, и отображение остается актуальным
+        imagePartition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                  GCODE_IMAGE_PARTITION);
+        const void* mapped = nullptr;
+        if (!imagePartition ||
+            esp_partition_mmap(imagePartition, 0, imagePartition->size, SPI_FLASH_MMAP_DATA,
+                               &mapped, &imageMap) != ESP_OK) {
+            LOG_ERROR("Хранилище", "Раздел образов программ " + String(GCODE_IMAGE_PARTITION) + " недоступен");
+            imagePartition = nullptr;
+            return false;
+        }
+        imageBase = (const uint8_t*)mapped;
+
+        LOG_INFO("Хранилище", "Программ G-кода: " + String(programCount) +
+                ", Занято: " + String(LittleFS.usedBytes()) + " из " + String(LittleFS.totalBytes()) + " байт");
+        return true;
+    }
+
+    /**
+     * @brief Получение числа программ
+     * @return Число программ в индексе
+     */
+    int getProgramCount() const {
+        return programCount;
+    }
+
+    /**
+     * @brief Получение имени программы по номеру
+     * @param index Номер программы [0, getProgramCount()-1]
+     * @return Имя программы или пустая строка при неверном номере
+     */
+    const char* getProgramName(int index) const {
+        if (index < 0 || index >= programCount) {
+            return "";
+        }
+        return entries[index].name;
+    }
+
+    /**
+     * @brief Получение размера программы по номеру
+     * @param index Номер программы
+     * @return Размер программы в байтах
+     */
+    uint32_t getProgramSize(int index) const {
+        if (index < 0 || index >= programCount) {
+            return 0;
+        }
+        return entries[index].size;
+    }
+
+    /**
+     * @brief Открытие программы для потокового чтения
+     * @param index Номер программы
+     * @param reader Читатель, который будет связан с файлом программы
+     * @return true если программа открыта
+     */
+    bool openProgram(int index, GCodeReader& reader) {
+        if (!mounted || index < 0 || index >= programCount) {
+            LOG_ERROR("Хранилище", "Неверный номер программы: " + String(index));
+            return false;
+        }
+        char path[32];
+        programPath(entries[index].id, path, sizeof(path));
+        return reader.open(path);
+    }
+
+    /**
+     * @brief Получение скомпилированного образа программы
+     * @param index Номер программы
+     * @param blocks Указатель на первый кадр образа в отображенной флеш-памяти
+     * @param count Число кадров в образе
+     * @return true если образ цел и готов к исполнению
+     */
+    bool getImage(int index, const GCodeBlock*& blocks, uint32_t& count) const {
+        if (!imageBase || index < 0 || index >= programCount) {
+            LOG_ERROR("Хранилище", "Неверный номер программы: " + String(index));
+            return false;
+        }
+        const DirEntry& entry = entries[index];
+        const GCodeImageHeader* header = (const GCodeImageHeader*)(imageBase + entry.imageOffset);
+        if (header->magic != GCODE_IMAGE_MAGIC || header->version != GCODE_IMAGE_VERSION ||
+            header->blockSize != sizeof(GCodeBlock) || header->blockCount != entry.imageBlocks ||
+            header->checkpointCount != GCodeCheckpoint::countFor(entry.imageBlocks)) {
+            LOG_ERROR("Хранилище", "Образ программы " + String(entry.name) + " поврежден");
+            return false;
+        }
+        blocks = (const GCodeBlock*)(header + 1);
+        count = header->blockCount;
+        return true;
+    }
+
+    /**
+     * @brief Получение границ перемещений программы, найденных при компиляции
+     * @param index Номер программы
+     * @param bounds Границы и наибольшие скорости программы
+     * @return true если образ цел
+     */
+    bool getBounds(int index, GCodeBounds& bounds) const {
+        const GCodeBlock* blocks;
+        uint32_t count;
+        if (!getImage(index, blocks, count)) {
+            return false;
+        }
+        bounds = ((const GCodeImageHeader*)blocks - 1)->bounds;
+        return true;
+    }
+
+    /**
+     * @brief Поиск места продолжения программы с заданной строки
+     * @param index Номер программы
+     * @param line Номер строки (продолжение с первого кадра не раньше нее)
+     * @param state Модальное состояние перед найденным кадром
+     * @return true если с этой строки можно продолжить программу
+     *
+     * Кадр находится двоичным поиском по образу, состояние восстанавливается
+     * от ближайшей контрольной точки без просмотра начала программы.
+     */
+    bool findResumePoint(int index, uint32_t line, GCodeCheckpoint& state) const {
+        const GCodeBlock* blocks;
+        uint32_t count;
+        if (!getImage(index, blocks, count)) {
+            return false;
+        }
+        const GCodeImageHeader* header = (const GCodeImageHeader*)blocks - 1;
+        const GCodeCheckpoint* checkpoints = (const GCodeCheckpoint*)(blocks + count);
+        if (!GCodeCheckpoint::seek(blocks, count, checkpoints, header->checkpointCount, line, state)) {
+            LOG_ERROR("Хранилище", "Со строки " + String(line) + " продолжить нельзя: она за концом программы, " +
+                     "в цикле, подпрограмме или после переменных");
+            return false;
+        }
+        LOG_INFO("Хранилище", "Продолжение со строки " + String(blocks[state.block].line) +
+                ", кадр " + String(state.block));
+        return true;
+    }
+
+    /**
+     * @brief Начало записи новой программы
+     * @param name Имя программы (обрезается до GCODE_NAME_MAX символов)
+     * @return Файл для последовательной записи текста программы
+     *
+     * Запись ведется во временный файл. Программа появляется в индексе только
+     * после вызова commitProgram(), прерванная запись не портит хранилище.
+     * Незавершенная предыдущая запись отменяется: ее файл закрывается и удаляется.
+     */
+    File beginProgram(const char* name) {
+        if (pendingId != 0) {
+            LOG_WARNING("Хранилище", "Незавершенная запись " + String(pendingName) + " отменена");
+            abortProgram(pendingFile);
+        }
+        if (!mounted || programCount >= GCODE_MAX_PROGRAMS) {
+            LOG_ERROR("Хранилище", "Нет места для новой программы");
+            return File();
+        }
+
+        strncpy(pendingName, name, GCODE_NAME_MAX);
+        pendingName[GCODE_NAME_MAX] = 0;
+        pendingId = nextId++;
+
+        char path[32];
+        tempPath(pendingId, path, sizeof(path));
+        pendingFile = LittleFS.open(path, "w");
+        return pendingFile;
+    }
+
+    /**
+     * @brief Завершение записи программы, компиляция и добавление ее в индекс
+     * @param file Файл, полученный из beginProgram() (будет закрыт)
+     * @return Номер новой программы или -1 при ошибке
+     *
+     * Программа с ошибкой не сохраняется: код и строка ошибки доступны через
+     * getLastError() и getLastErrorLine().
+     */
+    int commitProgram(File& file) {
+        if (pendingId == 0) {
+            return -1;
+        }
+        uint32_t size = file.size();
+        file.close();
+        pendingFile.close();
+
+        char tmp[32], path[32];
+        tempPath(pendingId, tmp, sizeof(tmp));
+        programPath(pendingId, path, sizeof(path));
+
+        DirEntry& entry = entries[programCount];
+        if (!compileImage(tmp, size, entry) || !LittleFS.rename(tmp, path)) {
+            LOG_ERROR("Хранилище", "Не удалось сохранить программу " + String(pendingName));
+            LittleFS.remove(tmp);
+            pendingId = 0;
+            return -1;
+        }
+
+        memcpy(entry.name, pendingName, sizeof(entry.name));
+        entry.size = size;
+        entry.id = pendingId;
+        programCount++;
+        pendingId = 0;
+
+        saveIndex();
+        LOG_INFO("Хранилище", "Сохранена программа " + String(entry.name) + ", " + String(size) +
+                " байт, " + String(entry.imageBlocks) + " кадров");
+        return programCount - 1;
+    }
+
+    /**
+     * @brief Код ошибки компиляции последней сохраняемой программы
+     * @return GCODE_OK или один из GCODE_ERR_*
+     */
+    int getLastError() const {
+        return lastError;
+    }
+
+    /**
+     * @brief Строка с ошибкой компиляции последней сохраняемой программы
+     * @return Номер строки начиная с 1
+     */
+    uint32_t getLastErrorLine() const {
+        return lastErrorLine;
+    }
+
+    /**
+     * @brief Отмена незавершенной записи программы
+     * @param file Файл, полученный из beginProgram() (будет закрыт и удален)
+     */
+    void abortProgram(File& file) {
+        if (file) {
+            file.close();
+        }
+        pendingFile.close();
+        if (pendingId != 0) {
+            char tmp[32];
+            tempPath(pendingId, tmp, sizeof(tmp));
+            LittleFS.remove(tmp);
+            pendingId = 0;
+        }
+    }
+
+    /**
+     * @brief Удаление программы
+     * @param index Номер программы
+     * @return true если программа удалена
+     */
+    bool removeProgram(int index) {
+        if (!mounted || index < 0 || index >= programCount) {
+            return false;
+        }
+        char path[32];
+        programPath(entries[index].id, path, sizeof(path));
+        LittleFS.remove(path);
+
+        LOG_INFO("Хранилище", "Удалена программа " + String(entries[index].name));
+        for (int i = index; i < programCount - 1; i++) {
+            entries[i] = entries[i + 1];
+        }
+        programCount--;
+        saveIndex();
+        return true;
+    }
+
+private:
+    /**
+     * @brief Проверка и компиляция программы в образ во флеш-памяти
+     * @param sourcePath Путь к тексту программы
+     * @param sourceSize Размер текста в байтах
+     * @param entry Запись индекса, получающая расположение образа
+     * @return true если программа без ошибок и образ записан
+     *
+     * Первый проход только проверяет программу и считает кадры, поэтому
+     * программа с ошибкой не трогает флеш-память. Заголовок образа пишется
+     * последним и только если записаны все кадры и контрольные точки:
+     * прерванная или неудачная запись оставляет образ с неверной сигнатурой.
+     */
+    bool compileImage(const char* sourcePath, uint32_t sourceSize, DirEntry& entry) {
+        lastError = GCODE_OK;
+        lastErrorLine = 0;
+        if (!imagePartition) {
+            return false;
+        }
+
+        GCodeReader reader;
+        uint32_t blockCount = 0;
+        if (!reader.open(sourcePath)) {
+            return false;
+        }
+        bool valid = compiler.validate(reader, blockCount);
+        reader.close();
+        if (!valid) {
+            lastError = compiler.getError();
+            lastErrorLine = compiler.getErrorLine();
+            LOG_ERROR("Хранилище", "Строка " + String(lastErrorLine) + ": " +
+                     GCodeParser::getErrorText(lastError));
+            return false;
+        }
+
+        uint32_t bytes = imageBytes(blockCount);
+        uint32_t offset;
+        if (!allocateImage(bytes, offset)) {
+            LOG_ERROR("Хранилище", "Нет места в разделе образов для " + String(bytes) + " байт");
+            return false;
+        }
+        if (esp_partition_erase_range(imagePartition, offset, alignImage(bytes)) != ESP_OK) {
+            return false;
+        }
+
+        // Второй проход записывает кадры пачками после места под заголовок,
+        // а контрольные точки - сразу на их места за кадрами
+        GCodeBlock batch[GCODE_IMAGE_WRITE_BLOCKS];
+        int batchCount = 0;
+        uint32_t written = 0;
+        uint32_t writeOffset = offset + sizeof(GCodeImageHeader);
+        uint32_t checkpointOffset = writeOffset + blockCount * sizeof(GCodeBlock);
+        uint32_t checkpointCount = GCodeCheckpoint::countFor(blockCount);
+        GCodeCheckpoint checkpoint;
+        bool writeOk = true;
+        reader.open(sourcePath);
+        compiler.reset();
+        while (compiler.next(reader, batch[batchCount])) {
+            if (compiler.takeCheckpoint(checkpoint) && checkpoint.block / GCODE_CHECKPOINT_BLOCKS < checkpointCount &&
+                esp_partition_write(imagePartition,
+                                    checkpointOffset + checkpoint.block / GCODE_CHECKPOINT_BLOCKS * sizeof(checkpoint),
+                                    &checkpoint, sizeof(checkpoint)) != ESP_OK) {
+                writeOk = false;
+                break;
+            }
+            if (++batchCount == GCODE_IMAGE_WRITE_BLOCKS) {
+                if (esp_partition_write(imagePartition, writeOffset, batch, sizeof(batch)) != ESP_OK) {
+                    writeOk = false;
+                    break;
+                }
+                writeOffset += sizeof(batch);
+                written += batchCount;
+                batchCount = 0;
+            }
+        }
+        reader.close();
+        if (writeOk && batchCount > 0) {
+            writeOk = esp_partition_write(imagePartition, writeOffset, batch, batchCount * sizeof(GCodeBlock)) == ESP_OK;
+            written += batchCount;
+        }
+        // Без заголовка образ остается недействительным, даже если часть кадров записана
+        if (!writeOk) {
+            LOG_ERROR("Хранилище", "Ошибка записи образа во флеш-память");
+            return false;
+        }
+        if (written != blockCount) {
+            LOG_ERROR("Хранилище", "Программа изменилась во время компиляции");
+            return false;
+        }
+
+        GCodeImageHeader header = {GCODE_IMAGE_MAGIC, GCODE_IMAGE_VERSION, sizeof(GCodeBlock),
+                                   blockCount, sourceSize, checkpointCount, compiler.getBounds()};
+        if (esp_partition_write(imagePartition, offset, &header, sizeof(header)) != ESP_OK) {
+            LOG_ERROR("Хранилище", "Ошибка записи заголовка образа");
+            return false;
+        }
+
+        entry.imageOffset = offset;
+        entry.imageBlocks = blockCount;
+        return true;
+    }
+
+    /**
+     * @brief Размер образа, округленный до сектора стирания
+     */
+    static uint32_t alignImage(uint32_t bytes) {
+        return (bytes + IMAGE_ALIGN - 1) / IMAGE_ALIGN * IMAGE_ALIGN;
+    }
+
+    /**
+     * @brief Размер образа из blockCount кадров вместе с контрольными точками
+     */
+    static uint32_t imageBytes(uint32_t blockCount) {
+        return sizeof(GCodeImageHeader) + blockCount * sizeof(GCodeBlock) +
+               GCodeCheckpoint::countFor(blockCount) * sizeof(GCodeCheckpoint);
+    }
+
+    /**
+     * @brief Место, занимаемое образом программы в разделе
+     */
+    static uint32_t imageExtent(const DirEntry& entry) {
+        return alignImage(imageBytes(entry.imageBlocks));
+    }
+
+    /**
+     * @brief Поиск свободного места в разделе образов (первый подходящий промежуток)
+     * @param bytes Требуемый размер образа
+     * @param offset Найденное смещение, кратное сектору стирания
+     * @return true если место найдено
+     */
+    bool allocateImage(uint32_t bytes, uint32_t& offset) const {
+        uint32_t need = alignImage(bytes);
+        offset = 0;
+        // Кандидаты - начало раздела и концы существующих образов
+        for (int candidate = -1; candidate < programCount; candidate++) {
+            uint32_t start = candidate < 0 ? 0 : entries[candidate].imageOffset + imageExtent(entries[candidate]);
+            if (start + need > imagePartition->size) {
+                continue;
+            }
+            bool overlaps = false;
+            for (int i = 0; i < programCount && !overlaps; i++) {
+                uint32_t otherStart = entries[i].imageOffset;
+                uint32_t otherEnd = otherStart + imageExtent(entries[i]);
+                overlaps = start < otherEnd && otherStart < start + need;
+            }
+            if (!overlaps) {
+                offset = start;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Загрузка индекса каталога в память
+     *
+     * При отсутствии или повреждении индекса хранилище начинается пустым.
+     */
+    void loadIndex() {
+        programCount = 0;
+        nextId = 1;
+
+        File file = LittleFS.open(GCODE_INDEX_FILE, "r");
+        if (!file) {
+            LOG_INFO("Хранилище", "Индекс программ не найден, создан пустой каталог");
+            return;
+        }
+
+        IndexHeader header;
+        if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+            header.magic != INDEX_MAGIC || header.version != INDEX_VERSION ||
+            header.count > GCODE_MAX_PROGRAMS) {
+            LOG_WARNING("Хранилище", "Индекс программ поврежден, каталог сброшен");
+            file.close();
+            return;
+        }
+
+        size_t bytes = header.count * sizeof(DirEntry);
+        if (file.read((uint8_t*)entries, bytes) != bytes) {
+            LOG_WARNING("Хранилище", "Индекс программ обрезан, каталог сброшен");
+            file.close();
+            return;
+        }
+        file.close();
+
+        programCount = header.count;
+        nextId = header.nextId;
+    }
+
+    /**
+     * @brief Сохранение индекса каталога
+     *
+     * Индекс записывается во временный файл и заменяет старый переименованием:
+     * rename в LittleFS заменяет существующий файл атомарно, поэтому сбой
+     * питания оставляет либо старый, либо новый индекс. Если временный файл
+     * записан не полностью (например, файловая система заполнена), старый
+     * индекс остается на месте.
+     */
+    void saveIndex() {
+        const char* tmp = GCODE_INDEX_FILE ".tmp";
+        File file = LittleFS.open(tmp, "w");
+        if (!file) {
+            LOG_ERROR("Хранилище", "Не удалось записать индекс программ");
+            return;
+        }
+
+        IndexHeader header = {INDEX_MAGIC, INDEX_VERSION, (uint16_t)programCount, nextId};
+        size_t bytes = programCount * sizeof(DirEntry);
+        bool written = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+                       file.write((const uint8_t*)entries, bytes) == bytes;
+        file.close();
+
+        // Размер проверяется после закрытия: LittleFS сохраняет данные файла при close()
+        file = LittleFS.open(tmp, "r");
+        written = written && file && file.size() == sizeof(header) + bytes;
+        file.close();
+        if (!written) {
+            LOG_ERROR("Хранилище", "Индекс программ записан не полностью, сохранен прежний");
+            LittleFS.remove(tmp);
+            return;
+        }
+
+        if (!LittleFS.rename(tmp, GCODE_INDEX_FILE)) {
+            LOG_ERROR("Хранилище", "Не удалось заменить индекс программ");
+        }
+    }
+
+    /**
+     * @brief Путь к файлу программы по идентификатору
+     */
+    static void programPath(uint32_t id, char* path, size_t size) {
+        snprintf(path, size, GCODE_DIR "/p%lu", (unsigned long)id);
+    }
+
+    /**
+     * @brief Путь к временному файлу записываемой программы
+     */
+    static void tempPath(uint32_t id, char* path, size_t size) {
+        snprintf(path, size, GCODE_DIR "/p%lu.tmp", (unsigned long)id);
+    }
+};
+
+#endif // GCODE_STORAGE_H
@@ -0,0 +1,189 @@
+#ifndef GCODE_STREAMER_H
+#define GCODE_STREAMER_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "RussianLogger.h"
+#include "GCodeParser.h"
+#include "GCodeInterpreter.h"
+#include "SerialReceiver.h"
+
+// Коды ошибок потоковой передачи (продолжают GCODE_ERR_* разборщика)
+#define GCODE_STREAM_ERR_LINE 20    // Строка длиннее GCODE_LINE_MAX
+#define GCODE_STREAM_ERR_OVERFLOW 21 // Хост превысил окно буфера приема
+#define GCODE_STREAM_ERR_FLOW 22    // Переход (WHILE/END, M98) в потоке
+
+/**
+ * @class GCodeStreamer
+ * @brief Прием программы G-кода по последовательному порту с подсчетом символов
+ *
+ * Протокол совпадает с grbl: на каждую принятую строку отвечается "ok" или
+ * "error:N" (N - код GCODE_ERR_*). Хост не ждет ответа на каждую строку, а
+ * держит в пути строки общей длиной не больше GCODE_SERIAL_RX_BUFFER байт,
+ * вычитая длину строки при получении ответа на нее. Ответ отправляется, когда
+ * кадр поставлен в очередь интерпретатора; пока очередь полна, строки не
+ * читаются и остаются в буфере SerialReceiver, размер которого хост и учитывает.
+ * Поэтому очередь всегда заполнена, а размер программы не ограничен флеш-памятью.
+ * Команды реального времени SerialReceiver выделяет из потока еще до строк.
+ *
+ * Строки принимаются только во время запуска в режиме G-кода с выбранным
+ * источником "поток"; до нажатия ВКЛ они ждут в буфере порта. Ошибка в строке
+ * прерывает программу, так как следующие строки рассчитаны на ее исполнение.
+ * Переходы WHILE/END и M98 требуют повторного чтения уже исполненных кадров,
+ * поэтому в потоке не принимаются; присваивания переменных допустимы.
+ * Вызывается из задачи G-кода.
+ */
+class GCodeStreamer {
+private:
+    GCodeInterpreter& interpreter;      // Исполнитель принятых кадров
+    SerialReceiver& receiver;           // Буфер принятых строк
+    GCodeParser parser;                 // Разборщик строк потока
+
+    char line[GCODE_LINE_MAX];          // Принимаемая строка
+    int lineLength;                     // Число символов в строке
+    bool lineOverflow;                  // Строка не поместилась в буфер
+    GCodeBlock pending;                 // Разобранный кадр, ожидающий места в очереди
+    bool hasPending;                    // Есть кадр, ожидающий места в очереди
+    bool active;                        // Идет прием программы
+    uint32_t runId;                     // Запуск интерпретатора, для которого идет прием
+    uint32_t lineCount;                 // Принято строк в текущем запуске
+    uint32_t overflowCount;             // Потери байтов, уже учтенные
+
+public:
+    /**
+     * @brief Конструктор приемника
+     * @param gcodeInterp Ссылка на интерпретатор G-кода
+     * @param serialReceiver Ссылка на приемник последовательного порта
+     */
+    GCodeStreamer(GCodeInterpreter& gcodeInterp, SerialReceiver& serialReceiver)
+        : interpreter(gcodeInterp), receiver(serialReceiver), lineLength(0), lineOverflow(false),
+          hasPending(false), active(false), runId(0), lineCount(0), overflowCount(0) {}
+
+    /**
+     * @brief Начало приема программы для текущего запуска интерпретатора
+     */
+    void startRun() {
+        parser.reset();
+        lineLength = 0;
+        lineOverflow = false;
+        hasPending = false;
+        runId = interpreter.getRunId();
+        lineCount = 0;
+        overflowCount = receiver.getOverflowCount();
+        active = true;
+        LOG_INFO("Поток", "Прием программы по последовательному порту");
+    }
+
+    /**
+     * @brief Прием и разбор доступных строк (вызывать из задачи G-кода)
+     */
+    void update() {
+        if (receiver.takeReset()) {
+            // Сброс с порта: недопринятая строка и кадр отбрасываются, систему выключает задача движения
+            lineLength = 0;
+            lineOverflow = false;
+            hasPending = false;
+            if (active) {
+                active = false;
+                LOG_WARNING("Поток", "Прием прерван сбросом, строк: " + String(lineCount));
+            }
+            return;
+        }
+        if (!active) {
+            return;
+        }
+        if (receiver.getOverflowCount() != overflowCount) {
+            fail(GCODE_STREAM_ERR_OVERFLOW, "Переполнение буфера приема");
+            return;
+        }
+        if (interpreter.isFinished() || interpreter.getRunId() != runId) {
+            // Программа завершена или остановлена - остальные строки ждут следующего запуска
+            active = false;
+            LOG_INFO("Поток", "Прием завершен, строк: " + String(lineCount));
+            return;
+        }
+
+        if (hasPending) {
+            if (!interpreter.queueBlock(pending)) {
+                return;
+            }
+            hasPending = false;
+            Serial.println("ok");
+        }
+
+        while (receiver.available() > 0) {
+            int c = receiver.read();
+            if (c < 0) {
+                break;
+            }
+            if (c == '\n') {
+                processLine();
+                if (hasPending || !active) {
+                    return; // Очередь полна - следующие строки остаются в буфере приемника
+                }
+            } else if (c != '\r') {
+                if (lineLength < GCODE_LINE_MAX - 1) {
+                    line[lineLength++] = (char)c;
+                } else {
+                    lineOverflow = true;
+                }
+            }
+        }
+    }
+
+    // Геттеры состояния
+    bool isActive() const { return active; }
+    uint32_t getLineCount() const { return lineCount; }
+
+private:
+    /**
+     * @brief Разбор принятой строки и постановка кадра в очередь
+     */
+    void processLine() {
+        line[lineLength] = '\0';
+        lineLength = 0;
+        lineCount++;
+
+        if (lineOverflow) {
+            lineOverflow = false;
+            parser.parseLine("", pending); // Номер строки разборщика идет вместе с потоком
+            fail(GCODE_STREAM_ERR_LINE, "Строка слишком длинная");
+            return;
+        }
+        if (!parser.parseLine(line, pending)) {
+            fail(parser.getError(), GCodeParser::getErrorText(parser.getError()));
+            return;
+        }
+
+        if (pending.command == GCODE_CMD_WHILE || pending.command == GCODE_CMD_LOOP_END ||
+            pending.command == GCODE_CMD_CALL) {
+            fail(GCODE_STREAM_ERR_FLOW, "Переходы доступны только в сохраненной программе");
+            return;
+        }
+
+        // Пустые строки и чисто модальные кадры уже учтены разборщиком
+        if (pending.motion == GCODE_MOTION_NONE && pending.command == GCODE_CMD_NONE &&
+            !(pending.flags & GCODE_HAS_F)) {
+            Serial.println("ok");
+            return;
+        }
+        if (!interpreter.queueBlock(pending)) {
+            hasPending = true;
+            return;
+        }
+        Serial.println("ok");
+    }
+
+    /**
+     * @brief Ответ об ошибке и прерывание программы
+     * @param code Код ошибки для хоста
+     * @param message Описание для журнала
+     */
+    void fail(int code, const char* message) {
+        Serial.println("error:" + String(code));
+        interpreter.abort(parser.getLineNumber(), message);
+        active = false;
+    }
+};
+
+#endif // GCODE_STREAMER_H
@@ -0,0 +1,397 @@
+#ifndef GCODE_UPLOADER_H
+#define GCODE_UPLOADER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "Config.h"
+#include "RussianLogger.h"
+#include "GCodeStorage.h"
+#include "MotionController.h"
+#include "SerialReceiver.h"
+
+// Служебные байты порции загрузки
+#define GCODE_UPLOAD_SOF 0x01       // Начало порции (в теле порции не встречается)
+#define GCODE_UPLOAD_ESC 0x10       // Экранирование: следующий байт передан как байт ^ GCODE_UPLOAD_ESC_XOR
+#define GCODE_UPLOAD_ESC_XOR 0x80
+
+// Типы порций
+#define GCODE_UPLOAD_BEGIN 'B'      // Начало или продолжение загрузки: размер, CRC32 файла, имя
+#define GCODE_UPLOAD_DATA 'D'       // Данные файла с заданного смещения
+#define GCODE_UPLOAD_END 'E'        // Проверка файла целиком и сохранение программы
+#define GCODE_UPLOAD_ABORT 'A'      // Отмена загрузки
+
+// Размеры частей порции без экранирования
+#define GCODE_UPLOAD_HEADER 7       // Тип (1), смещение (4), длина данных (2)
+#define GCODE_UPLOAD_TRAILER 4      // CRC32 типа, смещения, длины и данных
+
+// Коды ошибок загрузки (продолжают GCODE_STREAM_ERR_*)
+#define GCODE_UPLOAD_ERR_BUSY 30    // Система включена: запись во флеш-память остановила бы движение
+#define GCODE_UPLOAD_ERR_STORAGE 31 // Нет места в хранилище или ошибка записи файла
+#define GCODE_UPLOAD_ERR_SESSION 32 // Данные без начала загрузки или неверные параметры
+#define GCODE_UPLOAD_ERR_CRC 33     // CRC32 принятого файла не совпал с объявленным
+
+/**
+ * @class GCodeUploader
+ * @brief Загрузка программы в хранилище по последовательному порту порциями с CRC
+ *
+ * Порция: байт GCODE_UPLOAD_SOF, затем с экранированием тип, смещение (uint32),
+ * длина данных (uint16, не больше GCODE_UPLOAD_CHUNK), данные и CRC32 всего
+ * перечисленного; числа - младшим байтом вперед. Экранируются байт начала,
+ * байт экранирования и команды реального времени, поэтому SerialReceiver не
+ * выделяет их из данных, а потерянное начало порции находится по следующему
+ * GCODE_UPLOAD_SOF.
+ *
+ * На каждую порцию отвечается одной строкой: "ok:N" - принято N байт файла,
+ * "resend:N" - порция испорчена или пришла не по порядку, передачу следует
+ * продолжить с N; "done:I" - программа сохранена под номером I; "error:C" или
+ * "error:C:L" - загрузка невозможна (C - GCODE_UPLOAD_ERR_* или ошибка
+ * компиляции GCODE_ERR_* в строке L). Хост держит в пути порции общей длиной
+ * не больше GCODE_SERIAL_RX_BUFFER байт, как строки при потоковой передаче.
+ *
+ * Принятые данные сразу дописываются во временный файл хранилища, в памяти
+ * держится только одна порция. Повторная порция BEGIN с теми же именем,
+ * размером и CRC32 продолжает прерванную загрузку с принятого места.
+ * Программа появляется в хранилище только после проверки CRC32 всего файла и
+ * компиляции (GCodeStorage::commitProgram), поэтому прерванная загрузка не
+ * оставляет частичной программы. Загрузка принимается только при выключенной
+ * системе: запись во флеш-память приостанавливает чтение образа исполняемой
+ * программы.
+ *
+ * Пока загрузка не начата, байты, не начинающие порцию, остаются в буфере
+ * для потоковой передачи, только если выбран источник "поток" и за ними нет
+ * байта GCODE_UPLOAD_SOF. Байт начала порции в строке G-кода не встречается,
+ * поэтому байты перед ним - остаток порции с потерянным началом или помеха,
+ * и они отбрасываются; иначе повторные порции BEGIN копились бы за ними до
+ * переполнения буфера, а следующий запуск потока разбирал бы их как G-код.
+ * Вызывается из задачи G-кода, когда поток не принимается.
+ */
+class GCodeUploader {
+private:
+    GCodeStorage& storage;              // Хранилище, в которое сохраняется программа
+    SerialReceiver& receiver;           // Буфер принятых байтов
+    MotionController& motionController; // Источник состояния системы
+
+    uint8_t frame[GCODE_UPLOAD_HEADER + GCODE_UPLOAD_CHUNK + GCODE_UPLOAD_TRAILER]; // Порция без экранирования
+    int frameLength;                    // Принято байтов порции
+    bool inFrame;                       // Принимается порция
+    bool escaped;                       // Предыдущий байт - экранирование
+    unsigned long frameStart;           // Время начала приема порции
+
+    File file;                          // Временный файл загружаемой программы
+    bool active;                        // Идет загрузка
+    char name[GCODE_NAME_MAX + 1];      // Имя программы
+    uint32_t expectedSize;              // Объявленный размер файла
+    uint32_t expectedCrc;               // Объявленный CRC32 файла
+    uint32_t received;                  // Принято байтов файла
+    uint32_t crc;                       // CRC32 принятых байтов
+
+public:
+    /**
+     * @brief Конструктор загрузчика
+     * @param gcodeStorage Ссылка на хранилище программ
+     * @param serialReceiver Ссылка на приемник последовательного порта
+     * @param motionCtrl Ссылка на контроллер движения
+     */
+    GCodeUploader(GCodeStorage& gcodeStorage, SerialReceiver& serialReceiver, MotionController& motionCtrl)
+        : storage(gcodeStorage), receiver(serialReceiver), motionController(motionCtrl),
+          frameLength(0), inFrame(false), escaped(false), frameStart(0), active(false),
+          expectedSize(0), expectedCrc(0), received(0), crc(0) {
+        name[0] = 0;
+    }
+
+    /**
+     * @brief Прием и обработка доступных порций (вызывать из задачи G-кода)
+     * @param keepLines Выбран источник "поток": строки G-кода ждут запуска в буфере
+     * @return true если сохранена новая программа
+     */
+    bool update(bool keepLines) {
+        if (inFrame && millis() - frameStart > GCODE_UPLOAD_FRAME_TIMEOUT_MS) {
+            inFrame = false;
+            LOG_WARNING("Загрузка", "Порция не пришла целиком");
+            reply("resend:", received);
+        }
+
+        bool saved = false;
+        while (receiver.available() > 0) {
+            if (!inFrame) {
+                int c = receiver.peek();
+                if (c != GCODE_UPLOAD_SOF) {
+                    // Остаток испорченной порции или помеха перед началом следующей
+                    int skipped = receiver.find(GCODE_UPLOAD_SOF);
+                    if (skipped < 0) {
+                        if (!active && keepLines) {
+                            return saved; // Строки G-кода ждут запуска потока
+                        }
+                        skipped = receiver.available();
+                    }
+                    if (!active) {
+                        LOG_WARNING("Загрузка", "Отброшено байт перед порцией: " + String(skipped));
+                    }
+                    receiver.skip(skipped);
+                    continue;
+                }
+                receiver.read();
+                startFrame();
+                continue;
+            }
+
+            int c = receiver.read();
+            if (c == GCODE_UPLOAD_SOF) {
+                // Начало следующей порции до конца текущей: текущая испорчена
+                reply("resend:", received);
+                startFrame();
+                continue;
+            }
+            if (c == GCODE_UPLOAD_ESC) {
+                escaped = true;
+                continue;
+            }
+            if (escaped) {
+                c ^= GCODE_UPLOAD_ESC_XOR;
+                escaped = false;
+            }
+            frame[frameLength++] = (uint8_t)c;
+
+            if (frameLength == GCODE_UPLOAD_HEADER && readU16(frame + 5) > GCODE_UPLOAD_CHUNK) {
+                inFrame = false;
+                reply("resend:", received);
+                continue;
+            }
+            if (frameLength >= GCODE_UPLOAD_HEADER &&
+                frameLength == GCODE_UPLOAD_HEADER + readU16(frame + 5) + GCODE_UPLOAD_TRAILER) {
+                inFrame = false;
+                saved = processFrame() || saved;
+            }
+        }
+        return saved;
+    }
+
+    /**
+     * @brief CRC32 (IEEE 802.3) с продолжением
+     * @param value CRC32 предыдущих данных (0 для начала)
+     * @param data Данные
+     * @param length Длина данных
+     * @return CRC32 предыдущих и новых данных
+     *
+     * Таблица на 16 значений: по полбайта за шаг без таблицы на 1 КБ.
+     */
+    static uint32_t crc32(uint32_t value, const uint8_t* data, size_t length) {
+        static const uint32_t table[16] = {
+            0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+            0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+        value = ~value;
+        for (size_t i = 0; i < length; i++) {
+            value = table[(value ^ data[i]) & 0x0F] ^ (value >> 4);
+            value = table[(value ^ (data[i] >> 4)) & 0x0F] ^ (value >> 4);
+        }
+        return ~value;
+    }
+
+    /**
+     * @brief Нужно ли экранировать байт в теле порции
+     */
+    static bool needsEscape(uint8_t c) {
+        return c == GCODE_UPLOAD_SOF || c == GCODE_UPLOAD_ESC || c == SERIAL_RT_STATUS ||
+               c == SERIAL_RT_FEED_HOLD || c == SERIAL_RT_RESUME || c == SERIAL_RT_RESET;
+    }
+
+    // Геттеры состояния
+    bool isActive() const { return active; }
+    uint32_t getReceived() const { return received; }
+
+private:
+    /**
+     * @brief Начало приема новой порции
+     */
+    void startFrame() {
+        inFrame = true;
+        escaped = false;
+        frameLength = 0;
+        frameStart = millis();
+    }
+
+    /**
+     * @brief Проверка и исполнение принятой порции
+     * @return true если сохранена новая программа
+     */
+    bool processFrame() {
+        int length = frameLength - GCODE_UPLOAD_TRAILER;
+        if (crc32(0, frame, length) != readU32(frame + length)) {
+            LOG_WARNING("Загрузка", "Неверная CRC порции, принято байт: " + String(received));
+            reply("resend:", received);
+            return false;
+        }
+
+        uint8_t type = frame[0];
+        uint32_t offset = readU32(frame + 1);
+        uint16_t dataLength = readU16(frame + 5);
+        const uint8_t* data = frame + GCODE_UPLOAD_HEADER;
+
+        if (type == GCODE_UPLOAD_ABORT) {
+            if (active) {
+                storage.abortProgram(file);
+                active = false;
+                LOG_INFO("Загрузка", "Загрузка программы " + String(name) + " отменена");
+            }
+            reply("ok:", 0);
+            return false;
+        }
+        if (motionController.isEnabled()) {
+            fail(GCODE_UPLOAD_ERR_BUSY, "Загрузка возможна только при выключенной системе");
+            return false;
+        }
+
+        switch (type) {
+            case GCODE_UPLOAD_BEGIN:
+                begin(data, dataLength);
+                return false;
+            case GCODE_UPLOAD_DATA:
+                append(offset, data, dataLength);
+                return false;
+            case GCODE_UPLOAD_END:
+                return commit();
+        }
+        fail(GCODE_UPLOAD_ERR_SESSION, "Неизвестный тип порции");
+        return false;
+    }
+
+    /**
+     * @brief Начало загрузки или продолжение прерванной
+     * @param data Размер файла (uint32), CRC32 файла (uint32), имя программы
+     * @param length Длина данных порции
+     */
+    void begin(const uint8_t* data, uint16_t length) {
+        int nameLength = (int)length - 8;
+        if (nameLength < 1 || nameLength > GCODE_NAME_MAX) {
+            fail(GCODE_UPLOAD_ERR_SESSION, "Неверное имя программы");
+            return;
+        }
+        uint32_t size = readU32(data);
+        uint32_t fileCrc = readU32(data + 4);
+        char newName[GCODE_NAME_MAX + 1];
+        memcpy(newName, data + 8, nameLength);
+        newName[nameLength] = 0;
+
+        if (active && size == expectedSize && fileCrc == expectedCrc && strcmp(newName, name) == 0) {
+            LOG_INFO("Загрузка", "Продолжение загрузки " + String(name) + " с байта " + String(received));
+            reply("ok:", received);
+            return;
+        }
+        if (active) {
+            storage.abortProgram(file);
+            active = false;
+            LOG_WARNING("Загрузка", "Незавершенная загрузка " + String(name) + " отменена");
+        }
+
+        file = storage.beginProgram(newName);
+        if (!file) {
+            fail(GCODE_UPLOAD_ERR_STORAGE, "Не удалось начать запись программы");
+            return;
+        }
+        memcpy(name, newName, sizeof(name));
+        expectedSize = size;
+        expectedCrc = fileCrc;
+        received = 0;
+        crc = 0;
+        active = true;
+        LOG_INFO("Загрузка", "Прием программы " + String(name) + ", " + String(size) + " байт");
+        reply("ok:", 0);
+    }
+
+    /**
+     * @brief Запись данных порции в файл программы
+     * @param offset Смещение данных в файле
+     * @param data Данные
+     * @param length Длина данных
+     *
+     * Повторно присланные байты пропускаются, порция после пропуска
+     * отклоняется: файл пишется строго подряд.
+     */
+    void append(uint32_t offset, const uint8_t* data, uint16_t length) {
+        if (!active) {
+            fail(GCODE_UPLOAD_ERR_SESSION, "Данные без начала загрузки");
+            return;
+        }
+        if (offset > received || offset + length > expectedSize) {
+            reply("resend:", received);
+            return;
+        }
+        uint32_t skip = received - offset;
+        if (skip < length) {
+            uint32_t count = length - skip;
+            if (file.write(data + skip, count) != count) {
+                storage.abortProgram(file);
+                active = false;
+                fail(GCODE_UPLOAD_ERR_STORAGE, "Ошибка записи файла программы");
+                return;
+            }
+            crc = crc32(crc, data + skip, count);
+            received += count;
+        }
+        reply("ok:", received);
+    }
+
+    /**
+     * @brief Проверка файла целиком и сохранение программы
+     * @return true если программа сохранена
+     */
+    bool commit() {
+        if (!active) {
+            fail(GCODE_UPLOAD_ERR_SESSION, "Завершение без начала загрузки");
+            return false;
+        }
+        if (received != expectedSize) {
+            reply("resend:", received);
+            return false;
+        }
+        active = false;
+        if (crc != expectedCrc) {
+            storage.abortProgram(file);
+            fail(GCODE_UPLOAD_ERR_CRC, "CRC32 файла не совпадает");
+            return false;
+        }
+
+        int index = storage.commitProgram(file);
+        if (index < 0) {
+            int error = storage.getLastError();
+            if (error == GCODE_OK) {
+                fail(GCODE_UPLOAD_ERR_STORAGE, "Не удалось сохранить программу");
+            } else {
+                Serial.println("error:" + String(error) + ":" + String(storage.getLastErrorLine()));
+                LOG_ERROR("Загрузка", "Программа " + String(name) + " не сохранена: ошибка в строке " +
+                          String(storage.getLastErrorLine()));
+            }
+            return false;
+        }
+        Serial.println("done:" + String(index));
+        LOG_INFO("Загрузка", "Программа " + String(name) + " загружена, номер " + String(index));
+        return true;
+    }
+
+    /**
+     * @brief Ответ хосту на порцию
+     */
+    void reply(const char* prefix, uint32_t value) {
+        Serial.println(String(prefix) + String(value));
+    }
+
+    /**
+     * @brief Ответ об ошибке загрузки
+     * @param code Код GCODE_UPLOAD_ERR_*
+     * @param message Описание для журнала
+     */
+    void fail(int code, const char* message) {
+        Serial.println("error:" + String(code));
+        LOG_ERROR("Загрузка", message);
+    }
+
+    static uint16_t readU16(const uint8_t* p) {
+        return p[0] | (p[1] << 8);
+    }
+
+    static uint32_t readU32(const uint8_t* p) {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+};
+
+#endif // GCODE_UPLOADER_H
@@ -0,0 +1,84 @@
+#ifndef GEARBOX_H
+#define GEARBOX_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+/**
+ * @class Gearbox
+ * @brief Электронная гитара: перевод импульсов энкодера шпинделя в шаги оси
+ *
+ * Передаточное отношение хранится целочисленной дробью
+ * шаги = импульсы * ход * шагов_двигателя / (ENCODER_STEPS_INT * шаг_винта),
+ * поэтому позиция оси вычисляется от начала синхронизации без накопления
+ * ошибки округления: резьба любой длины остается в фазе со шпинделем.
+ * Используется и режимами клавиатуры, и кадрами G33/G76.
+ */
+class Gearbox {
+private:
+    long long numerator;        // Ход * шагов двигателя на оборот
+    long long denominator;      // Импульсов на оборот * шаг винта
+
+public:
+    /**
+     * @brief Конструктор (нулевое передаточное отношение)
+     */
+    Gearbox() : numerator(0), denominator(1) {}
+
+    /**
+     * @brief Настройка передаточного отношения
+     * @param motorSteps Шагов двигателя оси на оборот винта
+     * @param screwDu Шаг винта оси в деци-микронах
+     * @param leadDu Перемещение оси за оборот шпинделя в деци-микронах (шаг * число заходов)
+     */
+    void set(long motorSteps, long screwDu, long leadDu) {
+        numerator = (long long)leadDu * motorSteps;
+        denominator = (long long)ENCODER_STEPS_INT * screwDu;
+    }
+
+    /**
+     * @brief Позиция оси для позиции шпинделя
+     * @param pulses Позиция шпинделя в счетных импульсах от начала синхронизации
+     * @return Позиция оси в шагах (с округлением вниз)
+     */
+    long toAxisSteps(long pulses) const {
+        return (long)floorDiv((long long)pulses * numerator, denominator);
+    }
+
+    /**
+     * @brief Позиция шпинделя, при которой ось приходит в заданную позицию
+     * @param steps Позиция оси в шагах от начала синхронизации
+     * @return Позиция шпинделя в счетных импульсах (0 при нулевом ходе)
+     */
+    long toSpindlePulses(long steps) const {
+        if (numerator == 0) {
+            return 0;
+        }
+        return (long)floorDiv((long long)steps * denominator, numerator);
+    }
+
+    /**
+     * @brief Скорость оси при заданных оборотах шпинделя
+     * @param rpm Обороты шпинделя в минуту
+     * @return Скорость в шагах в секунду
+     */
+    long getAxisSpeed(int rpm) const {
+        return (long)((long long)rpm * ENCODER_STEPS_INT * llabs(numerator) / denominator / 60);
+    }
+
+    bool isZero() const { return numerator == 0; }
+
+private:
+    /**
+     * @brief Деление с округлением вниз (и для отрицательных позиций)
+     */
+    static long long floorDiv(long long value, long long divisor) {
+        long long quotient = value / divisor;
+        if ((value % divisor != 0) && ((value < 0) != (divisor < 0))) {
+            quotient--;
+        }
+        return quotient;
+    }
+};
+
+#endif // GEARBOX_H
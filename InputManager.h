@@ -7,6 +7,13 @@
 #include "RussianLogger.h"
 #include "MotionController.h"
 #include "AxisController.h"
+#include "KeyRepeat.h"
+#include "NumpadEntry.h"
+#include "KeyLatency.h"
+
+// Биты регистра INT_STAT TCA8418 (сбрасываются записью единицы)
+#define TCA8418_INT_KEY 0x01            // В очереди есть события клавиш
+#define TCA8418_INT_OVERFLOW 0x08       // Очередь переполнялась, события потеряны
 
 /**
  * @class InputManager
@@ -15,15 +22,34 @@
  * Класс обрабатывает все события от кнопок, реализует числовой ввод,
  * навигацию по меню и преобразует аппаратные события в логические команды.
  * Соответствует оригинальной логике обработки ввода из h4.ino.
+ *
+ * Линия INT контроллера TCA8418 будит задачу клавиатуры уведомлением из
+ * прерывания, и update() забирает всю очередь событий за один проход: серия
+ * быстрых нажатий обрабатывается сразу, а не по одному событию за период опроса.
+ * Повторы удерживаемых +, - и забоя и длительное нажатие ВЫКЛ выдает KeyRepeat;
+ * задача спит до ближайшего из них (getWaitMs()).
+ *
+ * Путь каждого нажатия из очереди отмечается в KeyLatency: время прерывания,
+ * чтения события, входа в обработчик и изменения состояния MotionController.
  */
 class InputManager {
 private:
     Adafruit_TCA8418& keypad;          // Ссылка на объект клавиатуры TCA8418
     MotionController& motionController; // Ссылка на контроллер движения
+    AxisController& zAxis;              // Ось Z (упоры, ноль)
+    AxisController& xAxis;              // Ось X (упоры, ноль)
+    AxisController& a1Axis;             // Ось A1 (упоры, ноль)
+    KeyLatency& latency;                // Замер задержки нажатий
+    
+    // Пробуждение задачи клавиатуры по линии INT
+    TaskHandle_t keypadTask;            // Задача, которую будит прерывание (NULL - опрос)
+    unsigned long fifoOverflows;        // Переполнений очереди TCA8418
+    volatile unsigned long interruptUs; // Время последнего прерывания
+    volatile uint32_t interruptCount;   // Число прерываний
+    uint32_t tracedInterrupts;          // Прерываний, учтенных в замере задержки
     
     // Состояние числового ввода
-    int numpadDigits[8];                // Буфер для введенных цифр
-    int numpadIndex;                    // Текущий индекс в буфере
+    NumpadEntry numpad;                 // Введенное число
     bool inNumpadMode;                  // Активен ли режим числового ввода
     
     // Флаги нажатия кнопок (для длительного нажатия)
@@ -37,32 +63,42 @@ private:
     
     // Тайминги
     unsigned long lastKeypadTime;       // Время последней обработки клавиатуры
-    unsigned long resetPressTime;       // Время нажатия кнопки ВЫКЛ для сброса
+    KeyRepeat keyRepeat;                // Повтор и длительное нажатие
     
     // Текущее состояние меню и настройки
     int setupWizardIndex;               // Текущий шаг мастера настройки
     bool auxDirectionForward;           // Направление вспомогательной оси
     int gcodeProgramIndex;              // Индекс текущей программы G-кода
     int gcodeProgramCount;              // Общее число программ G-кода
+    uint32_t gcodeStartLine;            // Строка продолжения программы (0 - с начала)
 
 public:
     /**
      * @brief Конструктор менеджера ввода
      * @param keypadRef Ссылка на объект клавиатуры TCA8418
      * @param motionCtrlRef Ссылка на контроллер движения
+     * @param zAxisRef Ссылка на ось Z
+     * @param xAxisRef Ссылка на ось X
+     * @param a1AxisRef Ссылка на ось A1
+     * @param latencyRef Ссылка на замер задержки нажатий
      */
-    InputManager(Adafruit_TCA8418& keypadRef, MotionController& motionCtrlRef)
-        : keypad(keypadRef), motionController(motionCtrlRef), numpadIndex(0), 
+    InputManager(Adafruit_TCA8418& keypadRef, MotionController& motionCtrlRef,
+                 AxisController& zAxisRef, AxisController& xAxisRef, AxisController& a1AxisRef,
+                 KeyLatency& latencyRef)
+        : keypad(keypadRef), motionController(motionCtrlRef), zAxis(zAxisRef), xAxis(xAxisRef),
+          a1Axis(a1AxisRef), latency(latencyRef), keypadTask(NULL), fifoOverflows(0),
+          interruptUs(0), interruptCount(0), tracedInterrupts(0),
           inNumpadMode(false), leftPressed(false), rightPressed(false),
           upPressed(false), downPressed(false), offPressed(false),
           gearsPressed(false), turnPressed(false), lastKeypadTime(0),
-          resetPressTime(0), setupWizardIndex(0), auxDirectionForward(true),
-          gcodeProgramIndex(0), gcodeProgramCount(0) {
-        
-        // Инициализация буфера числового ввода
-        for (int i = 0; i < 8; i++) {
-            numpadDigits[i] = 0;
-        }
+          setupWizardIndex(0), auxDirectionForward(true),
+          gcodeProgramIndex(0), gcodeProgramCount(0), gcodeStartLine(0) {
+        
+        // +/- меняют шаг, цифру ввода и выбор программы, забой стирает цифры
+        keyRepeat.configure(B_PLUS, true, 0);
+        keyRepeat.configure(B_MINUS, true, 0);
+        keyRepeat.configure(B_BACKSPACE, true, 0);
+        keyRepeat.configure(B_OFF, false, KEY_RESET_HOLD_MS);
     }
     
     /**
@@ -78,57 +114,142 @@ public:
         keypad.matrix(7, 7);
         keypad.flush();
         
+        // INT опускается, пока в очереди есть события
+        pinMode(KEY_INT, INPUT_PULLUP);
+        keypad.enableInterrupts();
+        keypad.writeRegister(TCA8418_REG_INT_STAT, TCA8418_INT_KEY | TCA8418_INT_OVERFLOW);
+        
         LOG_INFO("Клавиатура", "Инициализирована успешно");
         return true;
     }
     
     /**
-     * @brief Обновление состояния ввода (вызывать периодически)
+     * @brief Пробуждение задачи по прерыванию клавиатуры (вызывать из самой задачи)
+     * @param task Задача клавиатуры
+     */
+    void attachTask(TaskHandle_t task) {
+        keypadTask = task;
+        attachInterruptArg(digitalPinToInterrupt(KEY_INT), onKeypadInterrupt, this, FALLING);
+        LOG_INFO("Клавиатура", "Прерывание TCA8418 на контакте " + String(KEY_INT));
+    }
+    
+    /**
+     * @brief Ожидание прерывания клавиатуры
+     * @param timeoutTicks Наибольшее время ожидания в тиках
+     * @return true если было прерывание
+     */
+    bool waitForEvents(TickType_t timeoutTicks) {
+        return ulTaskNotifyTake(pdTRUE, timeoutTicks) > 0;
+    }
+    
+    /**
+     * @brief Обработка всех событий из очереди клавиатуры
      * 
      * Обрабатывает события клавиатуры, обновляет состояние кнопок
      * и выполняет соответствующие действия.
+     * @return true если обработано хотя бы одно событие клавиши
      */
-    void update() {
-        // Обработка событий клавиатуры
-        int event = 0;
-        if (keypad.available() > 0) {
-            event = keypad.getEvent();
+    bool update() {
+        // Флаг прерывания сбрасывается до чтения очереди: событие, пришедшее
+        // во время чтения, снова опустит INT и разбудит задачу
+        uint8_t status = keypad.readRegister(TCA8418_REG_INT_STAT);
+        if (status & (TCA8418_INT_KEY | TCA8418_INT_OVERFLOW)) {
+            keypad.writeRegister(TCA8418_REG_INT_STAT, status & (TCA8418_INT_KEY | TCA8418_INT_OVERFLOW));
+        }
+        if (status & TCA8418_INT_OVERFLOW) {
+            fifoOverflows++;
+            keyRepeat.releaseAll(); // Отпускания могли потеряться
+            LOG_WARNING("Клавиатура", "Очередь TCA8418 переполнена, события потеряны (" +
+                        String(fifoOverflows) + ")");
         }
         
-        if (event == 0) return;
-        
-        // Извлечение кода кнопки и типа события
-        int keyCode = event;
-        bitWrite(keyCode, 7, 0); // Убираем бит события
-        bool isPress = bitRead(event, 7) == 1; // 1 - нажатие, 0 - отпускание
+        // Прерывание относится к первому событию, прочитанному после него
+        uint32_t interrupts = interruptCount;
+        bool fromInterrupt = interrupts != tracedInterrupts;
+        unsigned long irqUs = interruptUs;
+        tracedInterrupts = interrupts;
+        
+        // Пустая очередь читается как 0. Предел - на случай дребезга, не дающего
+        // очереди опустеть
+        int handled = 0;
+        while (handled < KEYPAD_FIFO_SIZE * 2) {
+            int event = keypad.getEvent();
+            if (event == 0) {
+                break;
+            }
+            
+            // Извлечение кода кнопки и типа события
+            int keyCode = event;
+            bitWrite(keyCode, 7, 0); // Убираем бит события
+            bool isPress = bitRead(event, 7) == 1; // 1 - нажатие, 0 - отпускание
+            
+            lastKeypadTime = micros();
+            if (isPress) {
+                latency.beginTrace(keyCode, fromInterrupt, irqUs, lastKeypadTime);
+                keyRepeat.press(keyCode, millis());
+            } else {
+                keyRepeat.release(keyCode);
+            }
+            fromInterrupt = false;
+            
+            // Обработка события кнопки
+            uint32_t stateBefore = motionController.getStateChangeCount();
+            handleButtonEvent(keyCode, isPress);
+            if (isPress) {
+                latency.endTrace(motionController.getStateChangeCount() != stateBefore,
+                                 motionController.getStateChangeUs(), motionController.isEnabled());
+            }
+            handled++;
+        }
         
-        lastKeypadTime = micros();
+        // Наступившие повторы и длительные нажатия
+        KeyAction action;
+        while (keyRepeat.poll(millis(), action)) {
+            handleKeyAction(action);
+            handled++;
+        }
         
-        // Обработка события кнопки
-        handleButtonEvent(keyCode, isPress);
+        // Нажатие, ждущее первого шага, завершается здесь же
+        latency.collect(micros());
+        return handled > 0;
+    }
+    
+    /**
+     * @brief Время сна задачи клавиатуры до следующего повтора или опроса
+     * @return Миллисекунды, не больше KEYPAD_POLL_MS
+     */
+    unsigned long getWaitMs() const {
+        return min(KEYPAD_POLL_MS, keyRepeat.msUntilNext(millis()));
+    }
+    
+    /**
+     * @brief Есть ли в очереди клавиатуры необработанные события
+     */
+    bool hasPendingEvents() {
+        return keypad.available() > 0;
     }
     
     /**
-     * @brief Получение результата числового ввода
+     * @brief Число переполнений очереди TCA8418 с запуска
+     */
+    unsigned long getFifoOverflows() const {
+        return fifoOverflows;
+    }
+    
+    /**
+     * @brief Получение числового ввода
      * @return Введенное число
      */
-    long getNumpadResult() const {
-        long result = 0;
-        for (int i = 0; i < numpadIndex; i++) {
-            result += numpadDigits[i] * pow(10, numpadIndex - 1 - i);
-        }
-        return result;
+    const NumpadEntry& getNumpadEntry() const {
+        return numpad;
     }
     
     /**
      * @brief Сброс числового ввода
      */
     void resetNumpad() {
-        numpadIndex = 0;
+        numpad.clear();
         inNumpadMode = false;
-        for (int i = 0; i < 8; i++) {
-            numpadDigits[i] = 0;
-        }
     }
     
     /**
@@ -146,22 +267,79 @@ public:
     bool isDownPressed() const { return downPressed; }
     bool isGearsPressed() const { return gearsPressed; }
     bool isTurnPressed() const { return turnPressed; }
+    
+    /**
+     * @brief Установка числа программ G-кода в хранилище
+     * @param count Число программ
+     */
+    void setGCodeProgramCount(int count) {
+        if (gcodeProgramCount > 0 && gcodeProgramIndex == gcodeProgramCount) {
+            gcodeProgramIndex = count; // Выбранный поток остается выбранным после загрузки программы
+        } else if (gcodeProgramIndex > count) {
+            gcodeProgramIndex = 0;
+        }
+        gcodeProgramCount = count;
+    }
+    
+    /**
+     * @brief Получение номера выбранной программы G-кода
+     * @return Номер программы в хранилище (равен числу программ для потока)
+     */
+    int getGCodeProgramIndex() const {
+        return gcodeProgramIndex;
+    }
+    
+    /**
+     * @brief Выбран ли прием программы по последовательному порту
+     * @return true если выбран источник за последней сохраненной программой
+     */
+    bool isGCodeStreamSelected() const {
+        return gcodeProgramIndex == gcodeProgramCount;
+    }
+
+    /**
+     * @brief Получение строки, с которой продолжается выбранная программа
+     * @return Номер строки или 0 для запуска с начала
+     */
+    uint32_t getGCodeStartLine() const {
+        return gcodeStartLine;
+    }
+
+    /**
+     * @brief Сброс строки продолжения после запуска программы
+     */
+    void clearGCodeStartLine() {
+        gcodeStartLine = 0;
+    }
 
 private:
+    /**
+     * @brief Прерывание по спаду INT: пробуждение задачи клавиатуры
+     */
+    static void IRAM_ATTR onKeypadInterrupt(void* arg) {
+        InputManager* input = (InputManager*)arg;
+        input->interruptUs = micros();
+        input->interruptCount++;
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(input->keypadTask, &woken);
+        if (woken == pdTRUE) {
+            portYIELD_FROM_ISR();
+        }
+    }
+    
     /**
      * @brief Обработка события нажатия кнопки
      * @param keyCode Код кнопки из Config.h
      * @param isPress true - нажатие, false - отпускание
      */
     void handleButtonEvent(int keyCode, bool isPress) {
+        latency.markHandled(micros());
+        
         // Кнопка ВЫКЛ всегда обрабатывается отдельно
         if (keyCode == B_OFF) {
             offPressed = isPress;
             if (isPress) {
-                handleOnOff(false); // Нажатие - выключение
-                resetPressTime = millis(); // Запоминаем время нажатия для сброса
-            } else {
-                handleOffRelease(); // Отпускание - проверка сброса
+                handleOnOff(false); // Нажатие - выключение, удержание - сброс (handleKeyAction)
             }
         }
         
@@ -334,6 +512,13 @@ private:
             }
         }
         
+        // Десятичная точка (кнопка НАСТРОЙКИ во время ввода числа)
+        if (inNumpadMode && keyCode == B_SETTINGS) {
+            numpad.pressPoint();
+            logNumpad("Введена точка");
+            return true;
+        }
+        
         // Обработка BACKSPACE
         if (keyCode == B_BACKSPACE) {
             numpadBackspace();
@@ -362,19 +547,24 @@ private:
      * @return true если ввод обработан
      */
     bool processNumpadResult(int keyCode) {
-        long newDu = numpadToDeciMicrons();
-        float newConeRatio = numpadToConeRatio();
-        long numpadResult = getNumpadResult();
+        long newDu = numpad.toDeciMicrons(motionController.getMeasure());
+        long coneNum, coneDen;
+        numpad.toRatio(coneNum, coneDen);
+        long numpadResult = numpad.toInteger();
         
         resetNumpad();
         
         // Подтверждение ввода кнопкой ВКЛ
         if (keyCode == B_ON) {
-            if (isPassMode() && setupWizardIndex == 1) {
-                motionController.setTurnPasses(min(PASSES_MAX, (int)numpadResult));
+            if (motionController.getOperationMode() == MODE_GCODE) {
+                // Номер строки, с которой продолжится сохраненная программа
+                gcodeStartLine = numpadResult;
+                LOG_INFO("Клавиатура", "Строка продолжения программы: " + String(gcodeStartLine));
+            } else if (isPassMode() && setupWizardIndex == 1) {
+                motionController.setTurnPasses((int)min(PASSES_MAX, numpadResult));
                 setupWizardIndex++;
             } else if (motionController.getOperationMode() == MODE_CONE && setupWizardIndex == 1) {
-                motionController.setConeRatio(newConeRatio);
+                motionController.setConeRatio(coneNum, coneDen);
                 setupWizardIndex++;
             } else {
                 if (abs(newDu) <= DUPR_MAX) {
@@ -396,31 +586,19 @@ private:
      */
     void numpadPress(int digit) {
         if (!inNumpadMode) {
-            numpadIndex = 0;
+            numpad.clear();
         }
-        
-        if (numpadIndex < 8) {
-            numpadDigits[numpadIndex] = digit;
-            numpadIndex++;
-        } else {
-            // Буфер переполнен - сдвигаем
-            for (int i = 0; i < 7; i++) {
-                numpadDigits[i] = numpadDigits[i + 1];
-            }
-            numpadDigits[7] = digit;
-        }
-        
-        LOG_DEBUG("Клавиатура", "Введена цифра: " + String(digit) + 
-                 ", Буфер: " + String(getNumpadResult()));
+        numpad.pressDigit(digit);
+        logNumpad("Введена цифра " + String(digit));
     }
     
     /**
-     * @brief Удаление последней введенной цифры
+     * @brief Удаление последнего введенного знака
      */
     void numpadBackspace() {
-        if (inNumpadMode && numpadIndex > 0) {
-            numpadIndex--;
-            LOG_DEBUG("Клавиатура", "Удалена цифра, Буфер: " + String(getNumpadResult()));
+        if (inNumpadMode) {
+            numpad.backspace();
+            logNumpad("Удален знак");
         }
     }
     
@@ -429,39 +607,17 @@ private:
      * @param plus true - увеличить, false - уменьшить
      */
     void numpadPlusMinus(bool plus) {
-        if (numpadIndex > 0) {
-            if (numpadDigits[numpadIndex - 1] < 9 && plus) {
-                numpadDigits[numpadIndex - 1]++;
-            } else if (numpadDigits[numpadIndex - 1] > 1 && !plus) {
-                numpadDigits[numpadIndex - 1]--;
-            }
-            // TODO: Реализация перехода через 9 и ниже 1
-            LOG_DEBUG("Клавиатура", "Изменена цифра, Буфер: " + String(getNumpadResult()));
-        }
+        numpad.adjustLastDigit(plus);
+        logNumpad("Изменена цифра");
     }
     
     /**
-     * @brief Преобразование числового ввода в деци-микроны
-     * @return Значение в деци-микронах
+     * @brief Запись состояния числового ввода в журнал
      */
-    long numpadToDeciMicrons() const {
-        long result = getNumpadResult();
-        if (result == 0) {
-            return 0;
-        }
-        
-        // TODO: Реализация преобразования в зависимости от системы измерений
-        // в соответствии с оригинальной логикой
-        
-        return result * 10; // Временная реализация для метрической системы
-    }
-    
-    /**
-     * @brief Преобразование числового ввода в коэффициент конуса
-     * @return Коэффициент соотношения осей
-     */
-    float numpadToConeRatio() const {
-        return getNumpadResult() / 100000.0;
+    void logNumpad(const String& what) const {
+        char text[LCD_NUMBER_MAX];
+        numpad.format(text);
+        LOG_DEBUG("Клавиатура", what + ", Буфер: " + String(text));
     }
     
     /**
@@ -469,6 +625,15 @@ private:
      * @param isPlus true - увеличение, false - уменьшение
      */
     void handlePlusMinus(bool isPlus) {
+        // Выбор программы в режиме G-кода (последний вариант - поток с последовательного порта)
+        if (motionController.getOperationMode() == MODE_GCODE) {
+            int sources = gcodeProgramCount + 1;
+            gcodeProgramIndex = (gcodeProgramIndex + (isPlus ? 1 : sources - 1)) % sources;
+            gcodeStartLine = 0; // Другая программа начинается с начала
+            LOG_DEBUG("Клавиатура", "Выбрана программа G-кода: " + String(gcodeProgramIndex));
+            return;
+        }
+        
         // TODO: Реализация обработки +/- в соответствии с оригинальной логикой
         // - Изменение шага резьбы
         // - Изменение числа заходов в режиме резьбы
@@ -483,8 +648,6 @@ private:
      * @param isOn true - включение, false - выключение
      */
     void handleOnOff(bool isOn) {
-        resetPressTime = millis();
-        
         // Проверка условий для включения
         if (!motionController.isEnabled() && isOn) {
             bool missingZStops = needZStops() && 
@@ -512,13 +675,17 @@ private:
     }
     
     /**
-     * @brief Обработка отпускания кнопки ВЫКЛ (сброс системы)
+     * @brief Обработка повтора и длительного нажатия
+     * @param action Действие удерживаемой клавиши
      */
-    void handleOffRelease() {
-        if (millis() - resetPressTime > 3000) {
-            // Сброс системы при длительном нажатии
+    void handleKeyAction(const KeyAction& action) {
+        if (action.type == KEY_ACTION_LONG && action.key == B_OFF) {
+            // Сброс системы при длительном нажатии, не дожидаясь отпускания
             resetSystem();
             LOG_INFO("Клавиатура", "Выполнен сброс системы");
+        } else if (action.type == KEY_ACTION_REPEAT) {
+            // Повтор действует как новое нажатие (блокировка в режиме G-кода и числовой ввод учитываются)
+            handleButtonEvent(action.key, true);
         }
     }
     
@@ -558,6 +725,9 @@ private:
      */
     void handleMeasureChange() {
         // Переключение между метрической, дюймовой и TPI системами
+        int measure = motionController.getMeasure();
+        motionController.setMeasure(measure == MEASURE_METRIC ? MEASURE_INCH :
+                                    measure == MEASURE_INCH ? MEASURE_TPI : MEASURE_METRIC);
         LOG_DEBUG("Клавиатура", "Смена системы измерений");
     }
     
@@ -0,0 +1,406 @@
+#ifndef KEY_LATENCY_H
+#define KEY_LATENCY_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "RussianLogger.h"
+#include "AxisController.h"
+
+// Классы клавиш, задержка которых учитывается отдельно
+#define KEY_CLASS_ONOFF 0               // ВКЛ и ВЫКЛ
+#define KEY_CLASS_JOG 1                 // Стрелки ручного перемещения
+#define KEY_CLASS_OTHER 2               // Остальные клавиши
+#define KEY_CLASSES 3
+
+// Стадии пути нажатия; задержка стадии отсчитывается от предыдущей
+#define KEY_STAGE_READ 0                // Прерывание INT -> событие прочитано из очереди TCA8418
+#define KEY_STAGE_HANDLE 1              // Чтение -> вход в обработчик клавиши
+#define KEY_STAGE_STATE 2               // Обработчик -> изменение состояния MotionController
+#define KEY_STAGE_STEP 3                // Изменение состояния -> первый шаг любой оси
+#define KEY_STAGE_TOTAL 4               // От первой до последней достигнутой стадии
+#define KEY_STAGES 5
+
+// Корзин гистограммы: верхние границы KEY_LATENCY_FIRST_BUCKET_US, вдвое больше
+// и так далее; последняя корзина без верхней границы
+#define KEY_LATENCY_BUCKETS 12
+
+/**
+ * @struct KeyLatencyHistogram
+ * @brief Распределение задержки одной стадии
+ */
+struct KeyLatencyHistogram {
+    unsigned long count;                // Замеров
+    uint64_t sumUs;                     // Сумма задержек (для среднего)
+    unsigned long worstUs;              // Наибольшая задержка
+    unsigned long buckets[KEY_LATENCY_BUCKETS];
+};
+
+/**
+ * @struct KeyLatencyStats
+ * @brief Задержки нажатий с запуска по классам клавиш и стадиям
+ */
+struct KeyLatencyStats {
+    unsigned long traces[KEY_CLASSES];  // Прослеженных нажатий
+    unsigned long noStep[KEY_CLASSES];  // Изменили состояние, но шага за KEY_LATENCY_STEP_TIMEOUT_MS не было
+    KeyLatencyHistogram stages[KEY_CLASSES][KEY_STAGES];
+};
+
+/**
+ * @class KeyLatency
+ * @brief Замер задержки от нажатия клавиши до движения
+ *
+ * Путь нажатия отмечается по стадиям: прерывание INT (если задачу разбудило
+ * оно), чтение события из очереди TCA8418, вход в обработчик клавиши,
+ * изменение состояния MotionController и первый шаг оси после него. Стадии до
+ * изменения состояния проходят в задаче клавиатуры, первый шаг ловит задача
+ * движения в recordMotionCycle() по времени последнего шага осей.
+ *
+ * Задача клавиатуры взводит ожидание шага номером нажатия, задача движения
+ * записывает время шага и затем подтверждает этот номер, поэтому ожидание,
+ * взведенное заново, не получает шаг предыдущего нажатия. Итоги пишет только
+ * задача клавиатуры и публикует их под счетчиком версии, как Diagnostics.
+ *
+ * Прослеживаются нажатия, прочитанные из очереди; повторы удерживаемых клавиш
+ * и отпускания не учитываются.
+ */
+class KeyLatency {
+private:
+    AxisController& zAxis;              // Ось Z
+    AxisController& xAxis;              // Ось X
+    AxisController& a1Axis;             // Ось A1
+
+    // Текущее нажатие (только задача клавиатуры)
+    bool open;                          // Нажатие прослеживается до конца обработки
+    int traceClass;                     // Класс клавиши (KEY_CLASS_*)
+    bool hasInterrupt;                  // Есть отметка прерывания
+    unsigned long interruptUs;          // Прерывание INT
+    unsigned long readUs;               // Чтение из очереди
+    unsigned long handleUs;             // Вход в обработчик
+    bool handled;                       // Вход в обработчик отмечен
+
+    // Нажатие, ждущее первого шага
+    int stepClass;                      // Класс клавиши
+    unsigned long stepStartUs;          // Первая отметка нажатия (для итога)
+    uint32_t sequence;                  // Номер последнего взведенного ожидания
+    unsigned long completed;            // Завершенных нажатий (для периодического отчета)
+
+    // Обмен с задачей движения
+    volatile uint32_t armedSequence;    // Номер ожидания шага (0 - не ждем)
+    volatile unsigned long stateUs;     // Изменение состояния, после которого ждем шаг
+    volatile unsigned long stepUs;      // Время первого шага
+    volatile uint32_t seenSequence;     // Номер ожидания, для которого записан stepUs
+
+    // Итоги
+    KeyLatencyStats stats;
+    volatile uint32_t version;          // Нечетный во время записи итогов
+
+public:
+    /**
+     * @brief Конструктор
+     * @param zAxisCtrl Ссылка на ось Z
+     * @param xAxisCtrl Ссылка на ось X
+     * @param a1AxisCtrl Ссылка на ось A1
+     */
+    KeyLatency(AxisController& zAxisCtrl, AxisController& xAxisCtrl, AxisController& a1AxisCtrl)
+        : zAxis(zAxisCtrl), xAxis(xAxisCtrl), a1Axis(a1AxisCtrl), open(false), traceClass(0),
+          hasInterrupt(false), interruptUs(0), readUs(0), handleUs(0), handled(false),
+          stepClass(0), stepStartUs(0), sequence(0), completed(0), armedSequence(0), stateUs(0), stepUs(0),
+          seenSequence(0), version(0) {
+        memset(&stats, 0, sizeof(stats));
+    }
+
+    /**
+     * @brief Класс клавиши
+     * @param keyCode Код кнопки
+     * @return KEY_CLASS_*
+     */
+    static int classify(int keyCode) {
+        switch (keyCode) {
+            case B_ON:
+            case B_OFF:
+                return KEY_CLASS_ONOFF;
+            case B_LEFT:
+            case B_RIGHT:
+            case B_UP:
+            case B_DOWN:
+                return KEY_CLASS_JOG;
+            default:
+                return KEY_CLASS_OTHER;
+        }
+    }
+
+    /**
+     * @brief Название класса клавиш
+     */
+    static const char* className(int keyClass) {
+        switch (keyClass) {
+            case KEY_CLASS_ONOFF: return "ВКЛ/ВЫКЛ";
+            case KEY_CLASS_JOG: return "Ручной ход";
+            default: return "Прочие";
+        }
+    }
+
+    /**
+     * @brief Название стадии
+     */
+    static const char* stageName(int stage) {
+        switch (stage) {
+            case KEY_STAGE_READ: return "чтение";
+            case KEY_STAGE_HANDLE: return "обработка";
+            case KEY_STAGE_STATE: return "состояние";
+            case KEY_STAGE_STEP: return "шаг";
+            default: return "всего";
+        }
+    }
+
+    /**
+     * @brief Верхняя граница корзины гистограммы
+     * @param bucket Номер корзины
+     * @return Граница в микросекундах, ULONG_MAX для последней корзины
+     */
+    static unsigned long bucketLimitUs(int bucket) {
+        return bucket < KEY_LATENCY_BUCKETS - 1 ? KEY_LATENCY_FIRST_BUCKET_US << bucket : ULONG_MAX;
+    }
+
+    /**
+     * @brief Начало прослеживания нажатия (задача клавиатуры, сразу после чтения события)
+     * @param keyCode Код кнопки
+     * @param fromInterrupt Задачу разбудило прерывание, и это первое событие после него
+     * @param irqUs Время прерывания
+     * @param eventUs Время чтения события
+     */
+    void beginTrace(int keyCode, bool fromInterrupt, unsigned long irqUs, unsigned long eventUs) {
+        open = true;
+        traceClass = classify(keyCode);
+        hasInterrupt = fromInterrupt;
+        interruptUs = irqUs;
+        readUs = eventUs;
+        handled = false;
+    }
+
+    /**
+     * @brief Вход в обработчик клавиши (повторные вызовы за нажатие не учитываются)
+     * @param nowUs Текущее время
+     */
+    void markHandled(unsigned long nowUs) {
+        if (open && !handled) {
+            handleUs = nowUs;
+            handled = true;
+        }
+    }
+
+    /**
+     * @brief Конец обработки нажатия
+     * @param stateChanged Обработчик изменил состояние MotionController
+     * @param changeUs Время изменения состояния
+     * @param expectSteps После изменения ожидается движение (система включена)
+     */
+    void endTrace(bool stateChanged, unsigned long changeUs, bool expectSteps) {
+        if (!open) {
+            return;
+        }
+        open = false;
+        unsigned long firstUs = hasInterrupt ? interruptUs : readUs;
+        unsigned long lastUs = handled ? handleUs : readUs;
+
+        beginUpdate();
+        stats.traces[traceClass]++;
+        if (hasInterrupt) {
+            record(traceClass, KEY_STAGE_READ, readUs - interruptUs);
+        }
+        if (handled) {
+            record(traceClass, KEY_STAGE_HANDLE, handleUs - readUs);
+        }
+        if (stateChanged) {
+            record(traceClass, KEY_STAGE_STATE, changeUs - lastUs);
+            lastUs = changeUs;
+        }
+        bool waitStep = stateChanged && expectSteps;
+        if (!waitStep) {
+            record(traceClass, KEY_STAGE_TOTAL, lastUs - firstUs);
+        }
+        endUpdate();
+
+        if (!waitStep) {
+            completeTrace();
+        } else {
+            // Незавершенное ожидание предыдущего нажатия уступает новому
+            if (armedSequence != 0) {
+                finishStep(false, micros());
+            }
+            stepClass = traceClass;
+            stepStartUs = firstUs;
+            stateUs = changeUs;
+            stepUs = 0;
+            if (++sequence == 0) {
+                sequence = 1;
+            }
+            __sync_synchronize();
+            armedSequence = sequence;
+        }
+    }
+
+    /**
+     * @brief Учет шагов осей (вызывать задаче движения в каждом цикле)
+     *
+     * Ось делает не больше одного шага за вызов update(), поэтому время
+     * последнего шага, впервые оказавшееся не раньше изменения состояния, -
+     * время первого шага после него.
+     */
+    void recordMotionCycle() {
+        uint32_t armed = armedSequence;
+        if (armed == 0 || armed == seenSequence) {
+            return;
+        }
+        __sync_synchronize();
+        unsigned long sinceUs = stateUs;
+        bool found = false;
+        unsigned long firstUs = 0;
+        AxisController* axes[] = {&zAxis, &xAxis, &a1Axis};
+        for (AxisController* axis : axes) {
+            if (!axis->isActive()) {
+                continue;
+            }
+            unsigned long lastStepUs = axis->getLastStepUs();
+            if ((long)(lastStepUs - sinceUs) < 0) {
+                continue;
+            }
+            if (!found || (long)(lastStepUs - firstUs) < 0) {
+                firstUs = lastStepUs;
+                found = true;
+            }
+        }
+        if (found) {
+            stepUs = firstUs;
+            __sync_synchronize();
+            seenSequence = armed;
+        }
+    }
+
+    /**
+     * @brief Завершение ожидания шага (вызывать задаче клавиатуры при каждом проходе)
+     * @param nowUs Текущее время
+     */
+    void collect(unsigned long nowUs) {
+        uint32_t armed = armedSequence;
+        if (armed == 0) {
+            return;
+        }
+        if (seenSequence == armed) {
+            __sync_synchronize();
+            finishStep(true, nowUs);
+        } else if (nowUs - stateUs >= KEY_LATENCY_STEP_TIMEOUT_MS * 1000UL) {
+            finishStep(false, nowUs);
+        }
+    }
+
+    /**
+     * @brief Чтение итогов (из любой задачи)
+     * @param out Итоги
+     */
+    void read(KeyLatencyStats& out) const {
+        uint32_t before;
+        do {
+            before = version;
+            __sync_synchronize();
+            out = stats;
+            __sync_synchronize();
+        } while ((before & 1) != 0 || before != version);
+    }
+
+    /**
+     * @brief Вывод итогов в журнал: средняя и наибольшая задержка стадий и
+     * распределение полной задержки по классам клавиш
+     */
+    void logReport() const {
+        KeyLatencyStats snapshot;
+        read(snapshot);
+        for (int keyClass = 0; keyClass < KEY_CLASSES; keyClass++) {
+            if (snapshot.traces[keyClass] == 0) {
+                continue;
+            }
+            String line = String(className(keyClass)) + ": нажатий " + String(snapshot.traces[keyClass]) +
+                          ", без шага " + String(snapshot.noStep[keyClass]);
+            for (int stage = 0; stage < KEY_STAGES; stage++) {
+                const KeyLatencyHistogram& h = snapshot.stages[keyClass][stage];
+                if (h.count > 0) {
+                    line += String(", ") + stageName(stage) + " " + String((unsigned long)(h.sumUs / h.count)) +
+                            "/" + String(h.worstUs);
+                }
+            }
+            LOG_INFO("Задержка клавиш", line + " мкс (ср/макс)");
+
+            const KeyLatencyHistogram& total = snapshot.stages[keyClass][KEY_STAGE_TOTAL];
+            String buckets = String(className(keyClass)) + ", всего:";
+            for (int bucket = 0; bucket < KEY_LATENCY_BUCKETS; bucket++) {
+                if (total.buckets[bucket] == 0) {
+                    continue;
+                }
+                buckets += bucket < KEY_LATENCY_BUCKETS - 1 ? " <" + String(bucketLimitUs(bucket)) :
+                                                              " >=" + String(bucketLimitUs(bucket - 1));
+                buckets += ":" + String(total.buckets[bucket]);
+            }
+            LOG_INFO("Задержка клавиш", buckets + " мкс");
+        }
+    }
+
+private:
+    /**
+     * @brief Учет шага или его отсутствия для взведенного ожидания
+     * @param seen Шаг был
+     * @param nowUs Текущее время
+     */
+    void finishStep(bool seen, unsigned long nowUs) {
+        armedSequence = 0;
+        beginUpdate();
+        if (seen) {
+            record(stepClass, KEY_STAGE_STEP, stepUs - stateUs);
+            record(stepClass, KEY_STAGE_TOTAL, stepUs - stepStartUs);
+        } else {
+            stats.noStep[stepClass]++;
+            record(stepClass, KEY_STAGE_TOTAL, stateUs - stepStartUs);
+        }
+        endUpdate();
+
+        LOG_DEBUG("Задержка клавиш", String(className(stepClass)) + (seen ? ": шаг через " : ": нет шага за ") +
+                  String((seen ? stepUs : nowUs) - stateUs) + " мкс после изменения состояния");
+        completeTrace();
+    }
+
+    /**
+     * @brief Учет завершенного нажатия, отчет в журнал каждые KEY_LATENCY_REPORT_TRACES нажатий
+     */
+    void completeTrace() {
+        completed++;
+        if (completed % KEY_LATENCY_REPORT_TRACES == 0) {
+            logReport();
+        }
+    }
+
+    /**
+     * @brief Учет задержки стадии
+     */
+    void record(int keyClass, int stage, unsigned long us) {
+        KeyLatencyHistogram& h = stats.stages[keyClass][stage];
+        h.count++;
+        h.sumUs += us;
+        h.worstUs = max(h.worstUs, us);
+        int bucket = 0;
+        while (bucket < KEY_LATENCY_BUCKETS - 1 && us >= bucketLimitUs(bucket)) {
+            bucket++;
+        }
+        h.buckets[bucket]++;
+    }
+
+    void beginUpdate() {
+        version++;
+        __sync_synchronize();
+    }
+
+    void endUpdate() {
+        __sync_synchronize();
+        version++;
+    }
+};
+
+#endif // KEY_LATENCY_H
@@ -0,0 +1,223 @@
+#ifndef KEY_REPEAT_H
+#define KEY_REPEAT_H
+
+#include <Arduino.h>
+#include "Config.h"
+
+// Действия клавиши
+#define KEY_ACTION_REPEAT 1             // Повтор удерживаемой клавиши
+#define KEY_ACTION_LONG 2               // Клавиша удерживается дольше заданного времени
+
+// Наибольшее число клавиш с настроенным повтором или длительным нажатием
+#define KEY_CONFIG_MAX 8
+
+// Наибольшее число одновременно удерживаемых клавиш, за которыми следят таймеры
+#define KEY_HELD_MAX 4
+
+/**
+ * @struct KeyAction
+ * @brief Действие удерживаемой клавиши, наступившее по времени
+ */
+struct KeyAction {
+    int key;                            // Код кнопки
+    int type;                           // KEY_ACTION_*
+    int repeatCount;                    // Номер повтора (с 1) для KEY_ACTION_REPEAT
+};
+
+/**
+ * @class KeyRepeat
+ * @brief Повтор и длительное нажатие удерживаемых клавиш
+ *
+ * Работает по меткам времени нажатий и отпусканий, без опроса клавиатуры:
+ * press()/release() отмечают события из очереди TCA8418, poll() выдает
+ * наступившие повторы и длительные нажатия, а msUntilNext() говорит задаче
+ * клавиатуры, сколько можно спать до следующего из них.
+ *
+ * Повтор начинается через KEY_REPEAT_DELAY_MS после нажатия с периодом
+ * KEY_REPEAT_INTERVAL_MS; каждые KEY_REPEAT_ACCEL_COUNT повторов период
+ * уменьшается вдвое, но не ниже KEY_REPEAT_MIN_INTERVAL_MS. Длительное
+ * нажатие наступает один раз за удержание.
+ */
+class KeyRepeat {
+private:
+    struct KeyConfig {
+        int key;
+        bool repeat;                    // Повторять при удержании
+        unsigned long longPressMs;      // Время длительного нажатия (0 - нет)
+    };
+
+    struct HeldKey {
+        int key;                        // 0 - слот свободен
+        const KeyConfig* config;
+        unsigned long pressMs;          // Время нажатия
+        unsigned long nextRepeatMs;     // Время следующего повтора
+        unsigned long intervalMs;       // Текущий период повтора
+        int repeatCount;
+        bool longFired;                 // Длительное нажатие уже выдано
+    };
+
+    KeyConfig configs[KEY_CONFIG_MAX];
+    int configCount;
+    HeldKey held[KEY_HELD_MAX];
+
+public:
+    /**
+     * @brief Конструктор (ни одна клавиша не настроена)
+     */
+    KeyRepeat() : configCount(0) {
+        releaseAll();
+    }
+
+    /**
+     * @brief Настройка поведения клавиши при удержании
+     * @param key Код кнопки
+     * @param repeat Повторять при удержании
+     * @param longPressMs Время длительного нажатия, 0 - без длительного нажатия
+     * @return false если таблица настроек заполнена
+     */
+    bool configure(int key, bool repeat, unsigned long longPressMs) {
+        if (configCount >= KEY_CONFIG_MAX) {
+            return false;
+        }
+        configs[configCount].key = key;
+        configs[configCount].repeat = repeat;
+        configs[configCount].longPressMs = longPressMs;
+        configCount++;
+        return true;
+    }
+
+    /**
+     * @brief Нажатие клавиши
+     * @param key Код кнопки
+     * @param nowMs Время события
+     */
+    void press(int key, unsigned long nowMs) {
+        const KeyConfig* config = findConfig(key);
+        if (config == NULL) {
+            return;
+        }
+        HeldKey* slot = findHeld(key);
+        if (slot == NULL) {
+            slot = findHeld(0);
+        }
+        if (slot == NULL) {
+            return; // Удерживается слишком много клавиш: эта работает без повтора
+        }
+        slot->key = key;
+        slot->config = config;
+        slot->pressMs = nowMs;
+        slot->nextRepeatMs = nowMs + KEY_REPEAT_DELAY_MS;
+        slot->intervalMs = KEY_REPEAT_INTERVAL_MS;
+        slot->repeatCount = 0;
+        slot->longFired = false;
+    }
+
+    /**
+     * @brief Отпускание клавиши
+     * @param key Код кнопки
+     * @return true если за это удержание было выдано длительное нажатие
+     */
+    bool release(int key) {
+        HeldKey* slot = findHeld(key);
+        if (slot == NULL) {
+            return false;
+        }
+        bool longFired = slot->longFired;
+        slot->key = 0;
+        return longFired;
+    }
+
+    /**
+     * @brief Забыть все удерживаемые клавиши (отпускания могли потеряться)
+     */
+    void releaseAll() {
+        for (int i = 0; i < KEY_HELD_MAX; i++) {
+            held[i].key = 0;
+        }
+    }
+
+    /**
+     * @brief Выдача наступившего действия
+     * @param nowMs Текущее время
+     * @param action Действие
+     * @return true если действие выдано (вызывать, пока возвращает true)
+     */
+    bool poll(unsigned long nowMs, KeyAction& action) {
+        for (int i = 0; i < KEY_HELD_MAX; i++) {
+            HeldKey& slot = held[i];
+            if (slot.key == 0) {
+                continue;
+            }
+            if (slot.config->longPressMs > 0 && !slot.longFired &&
+                nowMs - slot.pressMs >= slot.config->longPressMs) {
+                slot.longFired = true;
+                action.key = slot.key;
+                action.type = KEY_ACTION_LONG;
+                action.repeatCount = 0;
+                return true;
+            }
+            if (slot.config->repeat && (long)(nowMs - slot.nextRepeatMs) >= 0) {
+                slot.repeatCount++;
+                if (slot.repeatCount % KEY_REPEAT_ACCEL_COUNT == 0) {
+                    slot.intervalMs = max(KEY_REPEAT_MIN_INTERVAL_MS, slot.intervalMs / 2);
+                }
+                // Отсчет от расписания, а не от nowMs: поздний poll() не сдвигает повторы
+                slot.nextRepeatMs += slot.intervalMs;
+                if ((long)(nowMs - slot.nextRepeatMs) >= 0) {
+                    slot.nextRepeatMs = nowMs + slot.intervalMs; // Пропущенные повторы не копятся
+                }
+                action.key = slot.key;
+                action.type = KEY_ACTION_REPEAT;
+                action.repeatCount = slot.repeatCount;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Время до следующего действия
+     * @param nowMs Текущее время
+     * @return Миллисекунды до ближайшего повтора или длительного нажатия,
+     *         ULONG_MAX если ни одна настроенная клавиша не удерживается
+     */
+    unsigned long msUntilNext(unsigned long nowMs) const {
+        unsigned long wait = ULONG_MAX;
+        for (int i = 0; i < KEY_HELD_MAX; i++) {
+            const HeldKey& slot = held[i];
+            if (slot.key == 0) {
+                continue;
+            }
+            if (slot.config->longPressMs > 0 && !slot.longFired) {
+                unsigned long elapsed = nowMs - slot.pressMs;
+                wait = min(wait, elapsed >= slot.config->longPressMs ? 0 : slot.config->longPressMs - elapsed);
+            }
+            if (slot.config->repeat) {
+                long remaining = (long)(slot.nextRepeatMs - nowMs);
+                wait = min(wait, remaining > 0 ? (unsigned long)remaining : 0UL);
+            }
+        }
+        return wait;
+    }
+
+private:
+    const KeyConfig* findConfig(int key) const {
+        for (int i = 0; i < configCount; i++) {
+            if (configs[i].key == key) {
+                return &configs[i];
+            }
+        }
+        return NULL;
+    }
+
+    HeldKey* findHeld(int key) {
+        for (int i = 0; i < KEY_HELD_MAX; i++) {
+            if (held[i].key == key) {
+                return &held[i];
+            }
+        }
+        return NULL;
+    }
+};
+
+#endif // KEY_REPEAT_H
@@ -0,0 +1,158 @@
+#ifndef LCD_FORMAT_H
+#define LCD_FORMAT_H
+
+#include <Arduino.h>
+
+// Размер буфера для любого числа, выводимого функциями format*
+#define LCD_NUMBER_MAX 24
+
+// Деци-микрон в дюйме
+#define LCD_DU_PER_INCH 254000
+
+/*
+ * Вывод чисел с фиксированной точкой для дисплея без плавающей точки и без
+ * выделения памяти. Значение хранится целым с известным числом десятичных
+ * знаков (деци-микроны - 4 знака в мм, угол - 4 знака в градусах) и выводится
+ * с заданным числом знаков после точки. Округление - половина от нуля, как у
+ * "%.*f" для десятичного значения; знак минус ставится и у отрицательного
+ * числа, округленного до нуля, как у "%.*f".
+ *
+ * Функции пишут строку с завершающим нулем в буфер не короче LCD_NUMBER_MAX и
+ * возвращают ее длину. Ширина width выравнивает число вправо пробелами, чтобы
+ * столбцы на дисплее не сдвигались при смене числа знаков.
+ */
+
+/**
+ * @brief Степень десяти
+ * @param power Показатель [0, 18]
+ */
+inline uint64_t lcdPow10(int power) {
+    uint64_t result = 1;
+    while (power-- > 0) {
+        result *= 10;
+    }
+    return result;
+}
+
+/**
+ * @brief Деление с округлением половины от нуля
+ * @param numerator Делимое
+ * @param denominator Делитель (больше нуля)
+ */
+inline int64_t lcdDivRound(int64_t numerator, int64_t denominator) {
+    return numerator >= 0 ? (numerator + denominator / 2) / denominator
+                          : -((-numerator + denominator / 2) / denominator);
+}
+
+/**
+ * @brief Вывод уже округленного значения по модулю и знаку
+ * @param out Буфер не короче LCD_NUMBER_MAX
+ * @param negative Исходное значение отрицательно
+ * @param magnitude Модуль в единицах последнего из precision знаков
+ * @param precision Число знаков после точки
+ * @param width Наименьшая ширина (выравнивание вправо)
+ * @return Длина строки
+ */
+inline int formatMagnitude(char* out, bool negative, uint64_t magnitude, int precision, int width) {
+    // Цифры собираются с конца
+    char digits[LCD_NUMBER_MAX];
+    int count = 0;
+    for (int i = 0; i < precision; i++) {
+        digits[count++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    }
+    if (precision > 0) {
+        digits[count++] = '.';
+    }
+    do {
+        digits[count++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude > 0 && count < LCD_NUMBER_MAX - 2);
+    if (negative) {
+        digits[count++] = '-';
+    }
+
+    int length = 0;
+    for (int i = count; i < width && length < LCD_NUMBER_MAX - 1 - count; i++) {
+        out[length++] = ' ';
+    }
+    while (count > 0) {
+        out[length++] = digits[--count];
+    }
+    out[length] = '\0';
+    return length;
+}
+
+/**
+ * @brief Вывод значения с фиксированной точкой
+ * @param out Буфер не короче LCD_NUMBER_MAX
+ * @param value Значение в единицах последнего из decimals знаков
+ * @param decimals Число десятичных знаков в значении [0, 18]
+ * @param precision Число знаков после точки при выводе [0, decimals]
+ * @param width Наименьшая ширина (выравнивание вправо), 0 - без выравнивания
+ * @return Длина строки
+ */
+inline int formatFixed(char* out, int64_t value, int decimals, int precision, int width = 0) {
+    precision = constrain(precision, 0, decimals);
+    bool negative = value < 0;
+    uint64_t magnitude = negative ? -(uint64_t)value : (uint64_t)value;
+    uint64_t drop = lcdPow10(decimals - precision);
+    return formatMagnitude(out, negative, (magnitude + drop / 2) / drop, precision, width);
+}
+
+/**
+ * @brief Вывод целого числа
+ * @param out Буфер не короче LCD_NUMBER_MAX
+ * @param value Число
+ * @param width Наименьшая ширина (выравнивание вправо)
+ * @return Длина строки
+ */
+inline int formatLong(char* out, long value, int width = 0) {
+    return formatFixed(out, value, 0, 0, width);
+}
+
+/**
+ * @brief Вывод длины в мм
+ * @param du Длина в деци-микронах
+ * @param precision Знаков после точки [0, 4]
+ */
+inline int formatDeciMicrons(char* out, long du, int precision, int width = 0) {
+    return formatFixed(out, du, 4, precision, width);
+}
+
+/**
+ * @brief Вывод длины в дюймах (одно округление, без промежуточных десятитысячных)
+ * @param du Длина в деци-микронах
+ * @param precision Знаков после точки [0, 4]
+ */
+inline int formatInches(char* out, long du, int precision, int width = 0) {
+    precision = constrain(precision, 0, 4);
+    int64_t value = lcdDivRound((int64_t)du * (int64_t)lcdPow10(precision), LCD_DU_PER_INCH);
+    return formatMagnitude(out, du < 0, du < 0 ? -value : value, precision, width);
+}
+
+/**
+ * @brief Вывод числа ниток на дюйм для шага резьбы
+ * @param pitchDu Шаг в деци-микронах (знак шага сохраняется)
+ * @param precision Знаков после точки [0, 4]
+ */
+inline int formatTpi(char* out, long pitchDu, int precision, int width = 0) {
+    precision = constrain(precision, 0, 4);
+    if (pitchDu == 0) {
+        return formatFixed(out, 0, precision, precision, width);
+    }
+    int64_t numerator = (int64_t)LCD_DU_PER_INCH * (int64_t)lcdPow10(precision);
+    int64_t value = lcdDivRound(numerator, pitchDu < 0 ? -(int64_t)pitchDu : pitchDu);
+    return formatMagnitude(out, pitchDu < 0, value, precision, width);
+}
+
+/**
+ * @brief Вывод угла в градусах
+ * @param degrees10000 Угол в десятитысячных долях градуса
+ * @param precision Знаков после точки [0, 4]
+ */
+inline int formatDegrees(char* out, long degrees10000, int precision, int width = 0) {
+    return formatFixed(out, degrees10000, 4, precision, width);
+}
+
+#endif // LCD_FORMAT_H
@@ -0,0 +1,439 @@
+#ifndef LCD_FRAME_BUFFER_H
+#define LCD_FRAME_BUFFER_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "LcdParallel.h"
+#include "LcdGlyphs.h"
+#include "LcdFormat.h"
+
+// Знакоместо, содержимое которого на дисплее неизвестно (перерисовывается обязательно)
+#define LCD_CELL_UNKNOWN 0xFFFF
+
+// Число пользовательских символов HD44780 (ячеек CGRAM)
+#define LCD_CGRAM_SLOTS 8
+
+/**
+ * @class LcdFrameBuffer
+ * @brief Теневой буфер знакомест дисплея с выводом только изменений
+ *
+ * Кадр рисуется в задний буфер целиком, flush() сравнивает его с тем, что
+ * уже показано на дисплее, и пишет в HD44780 только изменившиеся знакоместа,
+ * объединенные в серии по строкам: одна установка курсора на серию, дальше
+ * курсор дисплея сдвигается сам. Знакоместо хранит код символа Unicode (строки
+ * UTF-8 раскладываются по одному символу на знакоместо).
+ *
+ * Символы, которых нет в знакогенераторе (кириллица, значки), выводятся через
+ * пользовательские символы. endFrame() раздает нужные кадру начертания из
+ * LcdGlyphs по 8 ячейкам CGRAM: ячейка, занятая символом этого кадра, не
+ * отбирается, а освобождается давнее всех использованная. Символам, которым
+ * ячейки не хватило, достается похожий символ знакогенератора. Рисунок
+ * загружается в CGRAM только при смене начертания в ячейке, знакоместа со
+ * сменившимся начертанием перерисовываются.
+ *
+ * Очередью записи на дисплей служит сам буфер: ожидают вывода знакоместа,
+ * отличающиеся от показанных. Вывод идет порциями с ограничением времени и
+ * продолжается со следующей порцией с места остановки; новый кадр, нарисованный
+ * до конца вывода, не оставляет в очереди устаревших записей.
+ */
+class LcdFrameBuffer {
+private:
+    uint16_t front[LCD_ROWS * LCD_COLS]; // Показано на дисплее
+    uint16_t back[LCD_ROWS * LCD_COLS];  // Рисуемый кадр
+    int cursor;                          // Позиция вывода в заднем буфере
+    int flushRow;                        // Строка, с которой продолжится вывод
+
+    // Статистика вывода (для оценки нагрузки на шину дисплея)
+    unsigned long flushCount;            // Выведенных кадров
+    unsigned long cellsWritten;          // Записанных знакомест
+    unsigned long cursorMoves;           // Установок курсора
+    unsigned long sliceCount;            // Порций вывода
+    unsigned long sliceOverruns;         // Порций дольше отведенного времени
+    unsigned long worstSliceUs;          // Наибольшая длительность порции
+
+    // Пользовательские символы
+    const LcdGlyph* slotGlyph[LCD_CGRAM_SLOTS]; // Начертание в ячейке CGRAM (nullptr - свободна)
+    unsigned long slotFrame[LCD_CGRAM_SLOTS];   // Кадр последнего использования ячейки
+    uint8_t slotPending;                 // Ячейки, рисунок которых ждет загрузки (биты)
+    unsigned long frameNumber;           // Номер рисуемого кадра
+    unsigned long glyphUploads;          // Загрузок рисунков в CGRAM (по 9 записей на дисплей)
+    int fallbackGlyphs;                  // Символов кадра без ячейки (выводятся похожими)
+
+public:
+    LcdFrameBuffer() : cursor(0), flushRow(0), flushCount(0), cellsWritten(0), cursorMoves(0),
+                       sliceCount(0), sliceOverruns(0), worstSliceUs(0), slotPending(0),
+                       frameNumber(0), glyphUploads(0), fallbackGlyphs(0) {
+        for (int i = 0; i < LCD_CGRAM_SLOTS; i++) {
+            slotGlyph[i] = nullptr;
+            slotFrame[i] = 0;
+        }
+        invalidate();
+        clear();
+    }
+
+    /**
+     * @brief Очистка заднего буфера пробелами и перевод позиции в начало
+     */
+    void clear() {
+        for (int i = 0; i < LCD_ROWS * LCD_COLS; i++) {
+            back[i] = ' ';
+        }
+        cursor = 0;
+    }
+
+    /**
+     * @brief Содержимое дисплея неизвестно: следующий flush() перерисует все
+     *
+     * Рисунки занятых ячеек CGRAM загружаются заново.
+     */
+    void invalidate() {
+        for (int i = 0; i < LCD_ROWS * LCD_COLS; i++) {
+            front[i] = LCD_CELL_UNKNOWN;
+        }
+        for (int i = 0; i < LCD_CGRAM_SLOTS; i++) {
+            if (slotGlyph[i]) {
+                slotPending |= 1 << i;
+            }
+        }
+    }
+
+    /**
+     * @brief Дисплей очищен командой clear() или begin(): на нем пробелы
+     */
+    void markCleared() {
+        for (int i = 0; i < LCD_ROWS * LCD_COLS; i++) {
+            front[i] = ' ';
+        }
+    }
+
+    /**
+     * @brief Установка позиции вывода
+     * @param col Столбец [0, LCD_COLS-1]
+     * @param row Строка [0, LCD_ROWS-1]
+     */
+    void setCursor(int col, int row) {
+        cursor = constrain(row, 0, LCD_ROWS - 1) * LCD_COLS + constrain(col, 0, LCD_COLS - 1);
+    }
+
+    /**
+     * @brief Запись символа в текущую позицию
+     * @param glyph Код символа Unicode
+     * @return 1 если символ поместился на дисплей, иначе 0
+     */
+    int write(uint16_t glyph) {
+        if (cursor >= LCD_ROWS * LCD_COLS) {
+            return 0;
+        }
+        back[cursor] = glyph;
+        cursor++;
+        return 1;
+    }
+
+    /**
+     * @brief Вывод строки UTF-8 с обрезкой по концу строки дисплея
+     * @param text Строка
+     * @return Число занятых знакомест
+     */
+    int print(const char* text) {
+        int row = cursor / LCD_COLS;
+        int cells = 0;
+        const uint8_t* p = (const uint8_t*)text;
+        while (*p) {
+            uint16_t glyph = decodeUtf8(p);
+            if (cursor >= (row + 1) * LCD_COLS) {
+                break; // Вывод не переносится на следующую строку
+            }
+            back[cursor++] = glyph;
+            cells++;
+        }
+        return cells;
+    }
+
+    int print(const String& text) { return print(text.c_str()); }
+
+    /**
+     * @brief Вывод целого числа без выделения памяти
+     * @param value Число
+     * @param width Наименьшая ширина (выравнивание вправо)
+     * @return Число занятых знакомест
+     */
+    int print(long value, int width = 0) {
+        char text[LCD_NUMBER_MAX];
+        formatLong(text, value, width);
+        return print(text);
+    }
+
+    /**
+     * @brief Дозаполнение текущей строки пробелами от позиции вывода
+     */
+    void fillLine() {
+        int end = (cursor / LCD_COLS + 1) * LCD_COLS;
+        while (cursor < end && cursor < LCD_ROWS * LCD_COLS) {
+            back[cursor++] = ' ';
+        }
+    }
+
+    /**
+     * @brief Завершение кадра: раздача ячеек CGRAM символам кадра
+     *
+     * Вызывается после рисования кадра до его вывода. Символы получают ячейки в
+     * порядке появления на дисплее сверху вниз.
+     */
+    void endFrame() {
+        frameNumber++;
+        fallbackGlyphs = 0;
+        for (int i = 0; i < LCD_ROWS * LCD_COLS; i++) {
+            if (back[i] < 0x80) {
+                continue;
+            }
+            const LcdGlyph* glyph = findLcdGlyph(back[i]);
+            if (!glyph || !glyph->custom) {
+                continue;
+            }
+            int slot = findSlot(glyph);
+            if (slot < 0) {
+                slot = pickSlot();
+                if (slot < 0) {
+                    fallbackGlyphs++;
+                    continue;
+                }
+                assignSlot(slot, glyph);
+            }
+            slotFrame[slot] = frameNumber;
+        }
+    }
+
+    /**
+     * @brief Вывод всех изменившихся знакомест на дисплей без ограничения времени
+     * @param lcd Дисплей
+     */
+    void flush(LcdParallel& lcd) {
+        while (!flush(lcd, ULONG_MAX)) {
+        }
+    }
+
+    /**
+     * @brief Вывод изменившихся знакомест порцией с ограничением времени
+     * @param lcd Дисплей
+     * @param budgetUs Время порции в микросекундах (проверяется после каждого знакоместа,
+     *                 порция превышает его не больше чем на запись одного знакоместа
+     *                 и выводит хотя бы одно знакоместо)
+     * @return true если все изменения выведены
+     *
+     * Неизменные знакоместа внутри серии короче LCD_RUN_GAP_MAX переписываются:
+     * запись символа стоит столько же, сколько установка курсора.
+     */
+    bool flush(LcdParallel& lcd, unsigned long budgetUs) {
+        unsigned long startUs = micros();
+        bool done = true;
+        int written = 0;
+        int uploaded = 0;
+
+        // Рисунки загружаются до знакомест, иначе знакоместо ушло бы похожим символом
+        while (slotPending != 0 && done) {
+            if (uploaded > 0 && micros() - startUs >= budgetUs) {
+                done = false;
+                break;
+            }
+            int slot = 0;
+            while (!(slotPending & (1 << slot))) {
+                slot++;
+            }
+            lcd.createChar(slot, slotGlyph[slot]->bitmap);
+            slotPending &= ~(1 << slot);
+            glyphUploads++;
+            uploaded++;
+        }
+
+        for (int n = 0; n < LCD_ROWS && done; n++) {
+            int row = (flushRow + n) % LCD_ROWS;
+            const int rowStart = row * LCD_COLS;
+            int col = 0;
+            while (col < LCD_COLS) {
+                if (back[rowStart + col] == front[rowStart + col]) {
+                    col++;
+                    continue;
+                }
+                if (written + uploaded > 0 && micros() - startUs >= budgetUs) {
+                    flushRow = row; // Следующая порция начнется с этой строки
+                    done = false;
+                    break;
+                }
+
+                // Конец серии: после него LCD_RUN_GAP_MAX неизменных знакомест подряд или конец строки
+                int end = col + 1;
+                int gap = 0;
+                for (int i = end; i < LCD_COLS && gap <= LCD_RUN_GAP_MAX; i++) {
+                    if (back[rowStart + i] != front[rowStart + i]) {
+                        end = i + 1;
+                        gap = 0;
+                    } else {
+                        gap++;
+                    }
+                }
+
+                lcd.setCursor(col, row);
+                cursorMoves++;
+                while (col < end) {
+                    lcd.write(toLcdCode(back[rowStart + col]));
+                    front[rowStart + col] = back[rowStart + col];
+                    col++;
+                    written++;
+                    if (col < end && micros() - startUs >= budgetUs) {
+                        break; // Остаток серии уйдет следующей порцией
+                    }
+                }
+            }
+        }
+
+        unsigned long sliceUs = micros() - startUs;
+        sliceCount++;
+        worstSliceUs = max(worstSliceUs, sliceUs);
+        if (sliceUs > budgetUs) {
+            sliceOverruns++;
+        }
+        cellsWritten += written;
+        if (done) {
+            flushRow = 0;
+            flushCount++;
+        }
+        return done;
+    }
+
+    /**
+     * @brief Число знакомест, ожидающих вывода на дисплей
+     */
+    int getPendingCells() const {
+        int pending = 0;
+        for (int i = 0; i < LCD_ROWS * LCD_COLS; i++) {
+            if (back[i] != front[i]) {
+                pending++;
+            }
+        }
+        return pending;
+    }
+
+    /**
+     * @brief Символ заднего буфера
+     * @param col Столбец
+     * @param row Строка
+     */
+    uint16_t getCell(int col, int row) const {
+        return back[row * LCD_COLS + col];
+    }
+
+    unsigned long getFlushCount() const { return flushCount; }
+    unsigned long getCellsWritten() const { return cellsWritten; }
+    unsigned long getCursorMoves() const { return cursorMoves; }
+    unsigned long getSliceCount() const { return sliceCount; }
+    unsigned long getSliceOverruns() const { return sliceOverruns; }
+    unsigned long getWorstSliceUs() const { return worstSliceUs; }
+    unsigned long getGlyphUploads() const { return glyphUploads; }
+    int getFallbackGlyphs() const { return fallbackGlyphs; }
+
+    /**
+     * @brief Сброс наибольшей длительности порции (начало нового интервала наблюдения)
+     */
+    void resetWorstSlice() { worstSliceUs = 0; }
+
+private:
+    /**
+     * @brief Чтение одного символа UTF-8 со сдвигом указателя
+     * @param p Указатель на текущий байт (сдвигается за символ)
+     * @return Код символа или '?' для неверной последовательности
+     */
+    static uint16_t decodeUtf8(const uint8_t*& p) {
+        uint8_t c = *p++;
+        if (c < 0x80) {
+            return c;
+        }
+        int extra = (c & 0xE0) == 0xC0 ? 1 : (c & 0xF0) == 0xE0 ? 2 : (c & 0xF8) == 0xF0 ? 3 : 0;
+        uint32_t code = c & (0x3F >> extra);
+        for (int i = 0; i < extra; i++) {
+            if ((*p & 0xC0) != 0x80) {
+                return '?';
+            }
+            code = (code << 6) | (*p++ & 0x3F);
+        }
+        return extra > 0 && code <= 0xFFFF ? code : '?';
+    }
+
+    /**
+     * @brief Ячейка CGRAM с начертанием
+     * @return Номер ячейки или -1
+     */
+    int findSlot(const LcdGlyph* glyph) const {
+        for (int i = 0; i < LCD_CGRAM_SLOTS; i++) {
+            if (slotGlyph[i] == glyph) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Выбор ячейки для нового начертания: свободной или давнее всех использованной
+     * @return Номер ячейки или -1 если все ячейки заняты символами текущего кадра
+     */
+    int pickSlot() const {
+        int oldest = -1;
+        for (int i = 0; i < LCD_CGRAM_SLOTS; i++) {
+            if (!slotGlyph[i]) {
+                return i;
+            }
+            if (slotFrame[i] != frameNumber && (oldest < 0 || slotFrame[i] < slotFrame[oldest])) {
+                oldest = i;
+            }
+        }
+        return oldest;
+    }
+
+    /**
+     * @brief Передача ячейки начертанию
+     *
+     * Знакоместа прежнего начертания ячейки и знакоместа нового, выведенные
+     * похожим символом, перерисовываются.
+     */
+    void assignSlot(int slot, const LcdGlyph* glyph) {
+        if (slotGlyph[slot]) {
+            forgetCells(slotGlyph[slot]->code);
+        }
+        forgetCells(glyph->code);
+        slotGlyph[slot] = glyph;
+        slotPending |= 1 << slot;
+    }
+
+    /**
+     * @brief Пометка знакомест с символом как неизвестных на дисплее
+     */
+    void forgetCells(uint16_t code) {
+        for (int i = 0; i < LCD_ROWS * LCD_COLS; i++) {
+            if (front[i] == code) {
+                front[i] = LCD_CELL_UNKNOWN;
+            }
+        }
+    }
+
+    /**
+     * @brief Код знакогенератора HD44780 для символа
+     *
+     * Символ с загруженным рисунком выводится своей ячейкой CGRAM, прочие
+     * символы вне ASCII - похожим символом или знаком '?'.
+     */
+    uint8_t toLcdCode(uint16_t code) const {
+        if (code < 0x80) {
+            return code;
+        }
+        const LcdGlyph* glyph = findLcdGlyph(code);
+        if (!glyph) {
+            return '?';
+        }
+        int slot = glyph->custom ? findSlot(glyph) : -1;
+        if (slot >= 0 && !(slotPending & (1 << slot))) {
+            return slot;
+        }
+        return glyph->fallback;
+    }
+};
+
+#endif // LCD_FRAME_BUFFER_H
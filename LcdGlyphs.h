@@ -0,0 +1,120 @@
+#ifndef LCD_GLYPHS_H
+#define LCD_GLYPHS_H
+
+#include <Arduino.h>
+
+// Значки в области частного использования Unicode (выводятся как символы строк)
+#define LCD_GLYPH_MM 0xE000         // Единица измерения "мм"
+#define LCD_GLYPH_LIMIT_UP 0xE001   // Верхнее ограничение
+
+/**
+ * @struct LcdGlyph
+ * @brief Начертание символа, которого нет в знакогенераторе HD44780
+ *
+ * Символ с рисунком выводится через один из 8 пользовательских символов
+ * (CGRAM), а когда свободного нет - похожим символом знакогенератора. Буквы,
+ * совпадающие по начертанию с латинскими, рисунка не имеют и всегда выводятся
+ * латинскими.
+ */
+struct LcdGlyph {
+    uint16_t code;          // Код символа Unicode
+    char fallback;          // Похожий символ знакогенератора
+    bool custom;            // Есть рисунок для CGRAM
+    uint8_t bitmap[8];      // Рисунок 5x8, строки сверху вниз
+};
+
+// Таблица начертаний, упорядоченная по коду символа
+static const LcdGlyph LCD_GLYPHS[] = {
+    {0x0401, 'E', true, {0b01010, 0b00000, 0b11111, 0b10000, 0b11110, 0b10000, 0b11111, 0b00000}}, // Ё
+    {0x0410, 'A', false, {0, 0, 0, 0, 0, 0, 0, 0}}, // А
+    {0x0411, '6', true, {0b11111, 0b10000, 0b10000, 0b11110, 0b10001, 0b10001, 0b11110, 0b00000}}, // Б
+    {0x0412, 'B', false, {0, 0, 0, 0, 0, 0, 0, 0}}, // В
+    {0x0413, 'r', true, {0b11111, 0b10000, 0b10000, 0b10000, 0b10000, 0b10000, 0b10000, 0b00000}}, // Г
+    {0x0414, 'D', true, {0b00110, 0b01010, 0b01010, 0b01010, 0b01010, 0b11111, 0b10001, 0b00000}}, // Д
+    {0x0415, 'E', false, {0, 0, 0, 0, 0, 0, 0, 0}}, // Е
+    {0x0416, '*', true, {0b10101, 0b10101, 0b10101, 0b01110, 0b10101, 0b10101, 0b10101, 0b00000}}, // Ж
+    {0x0417, '3', true, {0b01110, 0b10001, 0b00001, 0b00110, 0b00001, 0b10001, 0b01110, 0b00000}}, // З
+    {0x0418, 'N', true, {0b10001, 0b10001, 0b10011, 0b10101, 0b11001, 0b10001, 0b10001, 0b00000}}, // И
+    {0x0419, 'N', true, {0b01010, 0b00100, 0b10001, 0b10011, 0b10101, 0b11001, 0b10001, 0b00000}}, // Й
+    {0x041A, 'K', false, {0, 0, 0, 0, 0, 0, 0, 0}}, // К
+    {0x041B, 'J', true, {0b00111, 0b01001, 0b01001, 0b01001, 0b01001, 0b01001, 0b10001, 0b00000}}, // Л
+    {0x041C, 'M', false, {0, 0, 0, 0, 0, 0, 0, 0}}, // М
+    {0x041D, 'H', false, {0, 0, 0, 0, 0, 0, 0, 0}}, // Н
+    {0x041E, 'O', false, {0, 0, 0, 0, 0, 0, 0, 0}}, // О
+    {0x041F, 'n', true, {0b11111, 0b10001, 0b10001, 0b10001, 0b10001, 0b10001, 0b10001, 0b00000}}, // П
+    {0x0420, 'P', false, {0, 0, 0, 0, 0, 0, 0, 0}}, // Р
+    {0x0421, 'C', false, {0, 0, 0, 0, 0, 0, 0, 0}}, // С
+    {0x0422, 'T', false, {0, 0, 0, 0, 0, 0, 0, 0}}, // Т
+    {0x0423, 'Y', true, {0b10001, 0b10001, 0b10001, 0b01111, 0b00001, 0b10001, 0b01110, 0b00000}}, // У
+    {0x0424, 'O', true, {0b00100, 0b01110, 0b10101, 0b10101, 0b10101, 0b01110, 0b00100, 0b00000}}, // Ф
+    {0x0425, 'X', false, {0, 0, 0, 0, 0, 0, 0, 0}}, // Х
+    {0x0426, 'U', true, {0b10010, 0b10010, 0b10010, 0b10010, 0b10010, 0b11111, 0b00001, 0b00000}}, // Ц
+    {0x0427, '4', true, {0b10001, 0b10001, 0b10001, 0b01111, 0b00001, 0b00001, 0b00001, 0b00000}}, // Ч
+    {0x0428, 'W', true, {0b10101, 0b10101, 0b10101, 0b10101, 0b10101, 0b10101, 0b11111, 0b00000}}, // Ш
+    {0x0429, 'W', true, {0b10101, 0b10101, 0b10101, 0b10101, 0b10101, 0b11111, 0b00001, 0b00000}}, // Щ
+    {0x042A, 'b', true, {0b11000, 0b01000, 0b01000, 0b01110, 0b01001, 0b01001, 0b01110, 0b00000}}, // Ъ
+    {0x042B, 'b', true, {0b10001, 0b10001, 0b10001, 0b11101, 0b10011, 0b10011, 0b11101, 0b00000}}, // Ы
+    {0x042C, 'b', true, {0b10000, 0b10000, 0b10000, 0b11110, 0b10001, 0b10001, 0b11110, 0b00000}}, // Ь
+    {0x042D, '3', true, {0b01110, 0b10001, 0b00001, 0b00111, 0b00001, 0b10001, 0b01110, 0b00000}}, // Э
+    {0x042E, 'O', true, {0b10010, 0b10101, 0b10101, 0b11101, 0b10101, 0b10101, 0b10010, 0b00000}}, // Ю
+    {0x042F, 'R', true, {0b01111, 0b10001, 0b10001, 0b01111, 0b00101, 0b01001, 0b10001, 0b00000}}, // Я
+    {0x0430, 'a', false, {0, 0, 0, 0, 0, 0, 0, 0}}, // а
+    {0x0431, '6', true, {0b00011, 0b01100, 0b10000, 0b11110, 0b10001, 0b10001, 0b01110, 0b00000}}, // б
+    {0x0432, 'B', true, {0b00000, 0b00000, 0b11110, 0b10001, 0b11110, 0b10001, 0b11110, 0b00000}}, // в
+    {0x0433, 'r', true, {0b00000, 0b00000, 0b11111, 0b10000, 0b10000, 0b10000, 0b10000, 0b00000}}, // г
+    {0x0434, 'g', true, {0b00000, 0b00000, 0b00110, 0b01010, 0b01010, 0b11111, 0b10001, 0b00000}}, // д
+    {0x0435, 'e', false, {0, 0, 0, 0, 0, 0, 0, 0}}, // е
+    {0x0436, '*', true, {0b00000, 0b00000, 0b10101, 0b10101, 0b01110, 0b10101, 0b10101, 0b00000}}, // ж
+    {0x0437, '3', true, {0b00000, 0b00000, 0b01110, 0b10001, 0b00110, 0b10001, 0b01110, 0b00000}}, // з
+    {0x0438, 'u', true, {0b00000, 0b00000, 0b10001, 0b10011, 0b10101, 0b11001, 0b10001, 0b00000}}, // и
+    {0x0439, 'u', true, {0b01010, 0b00100, 0b10001, 0b10011, 0b10101, 0b11001, 0b10001, 0b00000}}, // й
+    {0x043A, 'k', true, {0b00000, 0b00000, 0b10010, 0b10100, 0b11000, 0b10100, 0b10010, 0b00000}}, // к
+    {0x043B, 'n', true, {0b00000, 0b00000, 0b00111, 0b01001, 0b01001, 0b01001, 0b10001, 0b00000}}, // л
+    {0x043C, 'm', true, {0b00000, 0b00000, 0b10001, 0b11011, 0b10101, 0b10001, 0b10001, 0b00000}}, // м
+    {0x043D, 'H', true, {0b00000, 0b00000, 0b10001, 0b10001, 0b11111, 0b10001, 0b10001, 0b00000}}, // н
+    {0x043E, 'o', false, {0, 0, 0, 0, 0, 0, 0, 0}}, // о
+    {0x043F, 'n', true, {0b00000, 0b00000, 0b11111, 0b10001, 0b10001, 0b10001, 0b10001, 0b00000}}, // п
+    {0x0440, 'p', false, {0, 0, 0, 0, 0, 0, 0, 0}}, // р
+    {0x0441, 'c', false, {0, 0, 0, 0, 0, 0, 0, 0}}, // с
+    {0x0442, 'T', true, {0b00000, 0b00000, 0b11111, 0b00100, 0b00100, 0b00100, 0b00100, 0b00000}}, // т
+    {0x0443, 'y', false, {0, 0, 0, 0, 0, 0, 0, 0}}, // у
+    {0x0444, 'f', true, {0b00100, 0b00100, 0b01110, 0b10101, 0b10101, 0b01110, 0b00100, 0b00000}}, // ф
+    {0x0445, 'x', false, {0, 0, 0, 0, 0, 0, 0, 0}}, // х
+    {0x0446, 'u', true, {0b00000, 0b00000, 0b10010, 0b10010, 0b10010, 0b11111, 0b00001, 0b00000}}, // ц
+    {0x0447, '4', true, {0b00000, 0b00000, 0b10001, 0b10001, 0b01111, 0b00001, 0b00001, 0b00000}}, // ч
+    {0x0448, 'w', true, {0b00000, 0b00000, 0b10101, 0b10101, 0b10101, 0b10101, 0b11111, 0b00000}}, // ш
+    {0x0449, 'w', true, {0b00000, 0b00000, 0b10101, 0b10101, 0b10101, 0b11111, 0b00001, 0b00000}}, // щ
+    {0x044A, 'b', true, {0b00000, 0b00000, 0b11000, 0b01000, 0b01110, 0b01001, 0b01110, 0b00000}}, // ъ
+    {0x044B, 'b', true, {0b00000, 0b00000, 0b10001, 0b10001, 0b11101, 0b10011, 0b11101, 0b00000}}, // ы
+    {0x044C, 'b', true, {0b00000, 0b00000, 0b10000, 0b10000, 0b11110, 0b10001, 0b11110, 0b00000}}, // ь
+    {0x044D, '3', true, {0b00000, 0b00000, 0b01110, 0b10001, 0b00111, 0b10001, 0b01110, 0b00000}}, // э
+    {0x044E, 'o', true, {0b00000, 0b00000, 0b10010, 0b10101, 0b11101, 0b10101, 0b10010, 0b00000}}, // ю
+    {0x044F, 'R', true, {0b00000, 0b00000, 0b01111, 0b10001, 0b01111, 0b01001, 0b10001, 0b00000}}, // я
+    {0x0451, 'e', true, {0b01010, 0b00000, 0b01110, 0b10001, 0b11111, 0b10000, 0b01110, 0b00000}}, // ё
+    {0xE000, 'm', true, {0b11010, 0b10101, 0b10101, 0b00000, 0b11010, 0b10101, 0b10101, 0b00000}}, // мм
+    {0xE001, '^', true, {0b11111, 0b00100, 0b01110, 0b10101, 0b00100, 0b00100, 0b00000, 0b00000}}, // верхнее ограничение
+};
+
+/**
+ * @brief Поиск начертания символа
+ * @param code Код символа Unicode
+ * @return Начертание или nullptr если символа нет в таблице
+ */
+inline const LcdGlyph* findLcdGlyph(uint16_t code) {
+    int low = 0;
+    int high = sizeof(LCD_GLYPHS) / sizeof(LCD_GLYPHS[0]) - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (LCD_GLYPHS[middle].code == code) {
+            return &LCD_GLYPHS[middle];
+        }
+        if (LCD_GLYPHS[middle].code < code) {
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return nullptr;
+}
+
+#endif // LCD_GLYPHS_H
@@ -0,0 +1,212 @@
+#ifndef LCD_PARALLEL_H
+#define LCD_PARALLEL_H
+
+#include <Arduino.h>
+#include <soc/gpio_reg.h>
+#include "Config.h"
+#include "RussianLogger.h"
+
+// Команды HD44780
+#define LCD_CMD_CLEAR 0x01              // Очистка экрана и курсор в начало
+#define LCD_CMD_ENTRY_MODE 0x06         // Курсор вправо после записи, без сдвига экрана
+#define LCD_CMD_DISPLAY_ON 0x0C         // Экран включен, курсор скрыт
+#define LCD_CMD_FUNCTION_8BIT 0x38      // Шина 8 бит, 2 строки, шрифт 5x8
+#define LCD_CMD_SET_CGRAM 0x40          // Адрес в CGRAM
+#define LCD_CMD_SET_DDRAM 0x80          // Адрес в DDRAM
+
+// Число линий данных шины
+#define LCD_DATA_PINS 8
+
+/**
+ * @class LcdParallel
+ * @brief Драйвер HD44780 на 8-битной шине с записью через регистры GPIO
+ *
+ * Повторяет те методы LiquidCrystal, которыми пользуются DisplayManager и
+ * LcdFrameBuffer. Байт выставляется на шину одной записью в регистры
+ * установки и сброса каждого банка GPIO (выводы 0-31 и 32-48) вместо восьми
+ * digitalWrite, строб E держится LCD_ENABLE_PULSE_CYCLES тактов.
+ *
+ * Вывод RW не подключен, поэтому флаг занятости не читается: время выполнения
+ * команды отсчитывается от строба, и ожидание выполняется перед следующей
+ * записью, а не после текущей. Вызывающий код успевает подготовить следующий
+ * символ, пока контроллер обрабатывает предыдущий.
+ */
+class LcdParallel {
+private:
+    uint8_t rsPin;                      // Выбор регистра: 0 - команда, 1 - данные
+    uint8_t enablePin;                  // Строб E
+    uint8_t dataPins[LCD_DATA_PINS];    // D0-D7
+
+    // Маски выводов по банкам: [0] - выводы 0-31, [1] - выводы 32-48
+    uint32_t dataBits[LCD_DATA_PINS][2];
+    uint32_t dataMask[2];
+    uint32_t rsBit[2];
+    uint32_t enableBit[2];
+
+    unsigned long busyStartUs;          // Время последнего строба
+    unsigned long busyUs;               // Время выполнения последней команды
+
+public:
+    /**
+     * @brief Конструктор драйвера (порядок выводов как у LiquidCrystal в 8-битном режиме)
+     * @param rs Вывод RS
+     * @param enable Вывод E
+     * @param d0 - d7 Выводы линий данных
+     */
+    LcdParallel(uint8_t rs, uint8_t enable, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3,
+                uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7)
+        : rsPin(rs), enablePin(enable), busyStartUs(0), busyUs(0) {
+        const uint8_t pins[LCD_DATA_PINS] = {d0, d1, d2, d3, d4, d5, d6, d7};
+        memcpy(dataPins, pins, sizeof(dataPins));
+        dataMask[0] = dataMask[1] = 0;
+        for (int i = 0; i < LCD_DATA_PINS; i++) {
+            pinBits(dataPins[i], dataBits[i]);
+            dataMask[0] |= dataBits[i][0];
+            dataMask[1] |= dataBits[i][1];
+        }
+        pinBits(rsPin, rsBit);
+        pinBits(enablePin, enableBit);
+    }
+
+    /**
+     * @brief Настройка выводов и инициализация контроллера
+     * @param cols Число столбцов (адресация строк рассчитана на 20x4)
+     * @param rows Число строк
+     */
+    void begin(uint8_t cols, uint8_t rows) {
+        if (cols != LCD_COLS || rows != LCD_ROWS) {
+            LOG_WARNING("Дисплей", "Адресация строк рассчитана на " + String(LCD_COLS) + "x" +
+                        String(LCD_ROWS) + ", задано " + String(cols) + "x" + String(rows));
+        }
+        pinMode(rsPin, OUTPUT);
+        pinMode(enablePin, OUTPUT);
+        for (int i = 0; i < LCD_DATA_PINS; i++) {
+            pinMode(dataPins[i], OUTPUT);
+        }
+        clearPins(enableBit);
+
+        // Инициализация по datasheet HD44780: три команды выбора шины с паузами
+        delay(LCD_POWER_ON_MS);
+        send(false, LCD_CMD_FUNCTION_8BIT, LCD_INIT_FIRST_US);
+        send(false, LCD_CMD_FUNCTION_8BIT, LCD_INIT_NEXT_US);
+        send(false, LCD_CMD_FUNCTION_8BIT, LCD_EXEC_US);
+        send(false, LCD_CMD_FUNCTION_8BIT, LCD_EXEC_US);
+        send(false, LCD_CMD_DISPLAY_ON, LCD_EXEC_US);
+        clear();
+        send(false, LCD_CMD_ENTRY_MODE, LCD_EXEC_US);
+        LOG_INFO("Дисплей", "Контроллер HD44780 инициализирован, шина 8 бит через регистры GPIO");
+    }
+
+    /**
+     * @brief Очистка экрана
+     */
+    void clear() {
+        send(false, LCD_CMD_CLEAR, LCD_CLEAR_US);
+    }
+
+    /**
+     * @brief Установка курсора
+     * @param col Столбец
+     * @param row Строка
+     */
+    void setCursor(uint8_t col, uint8_t row) {
+        static const uint8_t rowOffsets[] = {0x00, 0x40, 0x14, 0x54};
+        if (row >= LCD_ROWS) {
+            row = LCD_ROWS - 1;
+        }
+        send(false, LCD_CMD_SET_DDRAM | (rowOffsets[row] + col), LCD_EXEC_US);
+    }
+
+    /**
+     * @brief Запись символа в позицию курсора
+     * @param value Код символа знакогенератора (0-7 - ячейки CGRAM)
+     * @return Число записанных байт
+     */
+    size_t write(uint8_t value) {
+        send(true, value, LCD_EXEC_US);
+        return 1;
+    }
+
+    /**
+     * @brief Загрузка пользовательского символа
+     * @param location Ячейка CGRAM (0-7)
+     * @param charmap Рисунок, 8 строк по 5 точек
+     *
+     * Курсор после загрузки остается в CGRAM: перед выводом знакомест нужен setCursor().
+     */
+    void createChar(uint8_t location, const uint8_t charmap[]) {
+        send(false, LCD_CMD_SET_CGRAM | ((location & 0x07) << 3), LCD_EXEC_US);
+        for (int i = 0; i < 8; i++) {
+            send(true, charmap[i], LCD_EXEC_US);
+        }
+    }
+
+private:
+    /**
+     * @brief Маски вывода для регистров банков GPIO
+     */
+    static void pinBits(uint8_t pin, uint32_t bits[2]) {
+        bits[0] = pin < 32 ? (1UL << pin) : 0;
+        bits[1] = pin < 32 ? 0 : (1UL << (pin - 32));
+    }
+
+    static void setPins(const uint32_t bits[2]) {
+        REG_WRITE(GPIO_OUT_W1TS_REG, bits[0]);
+        REG_WRITE(GPIO_OUT1_W1TS_REG, bits[1]);
+    }
+
+    static void clearPins(const uint32_t bits[2]) {
+        REG_WRITE(GPIO_OUT_W1TC_REG, bits[0]);
+        REG_WRITE(GPIO_OUT1_W1TC_REG, bits[1]);
+    }
+
+    /**
+     * @brief Передача байта контроллеру
+     * @param data true - данные, false - команда
+     * @param value Байт
+     * @param execUs Время выполнения, которое выдерживается перед следующей передачей
+     */
+    void send(bool data, uint8_t value, unsigned long execUs) {
+        uint32_t high[2] = {data ? rsBit[0] : 0, data ? rsBit[1] : 0};
+        for (int i = 0; i < LCD_DATA_PINS; i++) {
+            if (value & (1 << i)) {
+                high[0] |= dataBits[i][0];
+                high[1] |= dataBits[i][1];
+            }
+        }
+        uint32_t low[2] = {(dataMask[0] | rsBit[0]) & ~high[0], (dataMask[1] | rsBit[1]) & ~high[1]};
+
+        // Контроллер еще выполняет предыдущую команду
+        unsigned long elapsedUs = micros() - busyStartUs;
+        if (elapsedUs <= busyUs) {
+            delayMicroseconds(busyUs - elapsedUs + 1);
+        }
+
+        clearPins(low);
+        setPins(high);
+        spinCycles(LCD_SETUP_CYCLES);
+        pulseEnable();
+        busyStartUs = micros();
+        busyUs = execUs;
+    }
+
+    /**
+     * @brief Строб E: данные защелкиваются по спаду
+     */
+    void pulseEnable() {
+        setPins(enableBit);
+        spinCycles(LCD_ENABLE_PULSE_CYCLES);
+        clearPins(enableBit);
+    }
+
+    /**
+     * @brief Задержка в тактах процессора (для интервалов короче микросекунды)
+     */
+    static void spinCycles(uint32_t cycles) {
+        uint32_t start = ESP.getCycleCount();
+        while (ESP.getCycleCount() - start < cycles) {
+        }
+    }
+};
+
+#endif // LCD_PARALLEL_H
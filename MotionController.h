@@ -8,6 +8,8 @@
 #include "RussianLogger.h"
 #include "SpindleEncoder.h"
 #include "AxisController.h"
+#include "Gearbox.h"
+#include "GCodeInterpreter.h"
 
 /**
  * @class MotionController
@@ -24,10 +26,20 @@ private:
     AxisController& zAxis;      // Основная ось Z (продольное движение)
     AxisController& xAxis;      // Ось X (поперечное движение)  
     AxisController& a1Axis;     // Дополнительная ось A1 (делительная головка)
+    GCodeInterpreter& gcode;    // Интерпретатор G-кода для режима MODE_GCODE
     
     // Синхронизация доступа к общим данным
     SemaphoreHandle_t motionMutex;
     
+    // Команды реального времени с последовательного порта (исполняются в update())
+    volatile bool holdRequested;    // Остановка подачи
+    volatile bool resumeRequested;  // Продолжение подачи
+    volatile bool abortRequested;   // Сброс: выключение и остановка программы
+    
+    // Отметка изменения состояния (для замера задержки клавиатуры KeyLatency)
+    volatile uint32_t stateChangeCount; // Число изменений состояния
+    volatile unsigned long stateChangeUs; // Время последнего изменения
+    
     // Текущее состояние системы
     int currentMode;            // Текущий режим работы из Config.h
     bool systemEnabled;         // Включена ли система (обработка команд)
@@ -42,7 +54,9 @@ private:
     int operationPitchSign;     // Знак шага при начале операции (1 или -1)
     
     // Настройки режимов работы
-    float coneRatio;            // Коэффициент соотношения осей в режиме конуса
+    long coneRatioNum;          // Коэффициент конуса (диаметр к длине): числитель
+    long coneRatioDen;          // Коэффициент конуса: знаменатель (больше нуля)
+    int measure;                // Система измерений ввода и дисплея (MEASURE_*)
     int turnPasses;             // Число проходов в режимах точения
     bool auxDirectionForward;   // Направление вспомогательной оси (внешняя/внутренняя обработка)
 
@@ -53,15 +67,20 @@ public:
      * @param zAxisCtrl Ссылка на контроллер оси Z
      * @param xAxisCtrl Ссылка на контроллер оси X
      * @param a1AxisCtrl Ссылка на контроллер оси A1
+     * @param gcodeInterp Ссылка на интерпретатор G-кода
      */
     MotionController(SpindleEncoder& spindleEnc,
                     AxisController& zAxisCtrl, 
                     AxisController& xAxisCtrl,
-                    AxisController& a1AxisCtrl)
-        : spindle(spindleEnc), zAxis(zAxisCtrl), xAxis(xAxisCtrl), a1Axis(a1AxisCtrl),
+                    AxisController& a1AxisCtrl,
+                    GCodeInterpreter& gcodeInterp)
+        : spindle(spindleEnc), zAxis(zAxisCtrl), xAxis(xAxisCtrl), a1Axis(a1AxisCtrl), gcode(gcodeInterp),
+          holdRequested(false), resumeRequested(false), abortRequested(false),
+          stateChangeCount(0), stateChangeUs(0),
           currentMode(0), systemEnabled(false), currentPitch(0), currentStarts(1),
           operationIndex(0), operationSubIndex(0), operationAdvanceFlag(false),
-          operationStartPitch(0), operationPitchSign(1), coneRatio(1.0), turnPasses(3),
+          operationStartPitch(0), operationPitchSign(1), coneRatioNum(1), coneRatioDen(1),
+          measure(MEASURE_METRIC), turnPasses(3),
           auxDirectionForward(true) {
         
         // Создание мьютекса для синхронизации доступа к общим данным
@@ -91,11 +110,16 @@ public:
             return; // Мьютекс занят - пропускаем цикл
         }
         
+        // Команды с порта исполняются в ближайшем цикле, раньше кадров в очереди
+        processRealtimeCommands();
+        
         // Обновление состояния энкодера шпинделя
         spindle.update();
         
         // Если система выключена или шаг нулевой или есть расссинхронизация - пропускаем обработку режимов
-        if (!systemEnabled || currentPitch == 0 || spindle.getSyncOffset() != 0) {
+        // (режиму G-кода шаг не нужен - подача задается программой)
+        if (!systemEnabled || (currentPitch == 0 && currentMode != MODE_GCODE) ||
+            spindle.getSyncOffset() != 0) {
             // Режим не активен - только обновляем оси для завершения текущих движений
         } else {
             // Выбор и выполнение текущего режима работы
@@ -134,6 +158,11 @@ public:
      */
     void setEnabled(bool enable) {
         if (systemEnabled && enable) {
+            // Повторное нажатие ВКЛ продолжает программу после M0/M1
+            if (currentMode == MODE_GCODE) {
+                gcode.resume();
+                markStateChange();
+            }
             return; // Уже включена
         }
         
@@ -141,6 +170,10 @@ public:
             // Выключение системы
             systemEnabled = false;
             operationIndex = 0;
+            if (currentMode == MODE_GCODE) {
+                gcode.stop();
+            }
+            markStateChange();
             LOG_INFO("Контроллер", "Система выключена");
         } else {
             // Включение системы
@@ -151,7 +184,12 @@ public:
             }
             
             // Установка новой точки отсчета для синхронизации
-            setNewOrigin();
+            // (программа G-кода работает в координатах нуля, установленного оператором)
+            if (currentMode == MODE_GCODE) {
+                gcode.start();
+            } else {
+                setNewOrigin();
+            }
             
             // Инициализация переменных операции
             systemEnabled = true;
@@ -160,12 +198,28 @@ public:
             operationIndex = 0;
             operationAdvanceFlag = false;
             operationSubIndex = 0;
+            markStateChange();
             
             LOG_INFO("Контроллер", "Система включена. Режим: " + String(currentMode) + 
                     ", Шаг: " + String(currentPitch) + " du, Заходов: " + String(currentStarts));
         }
     }
     
+    /**
+     * @brief Запрос остановки подачи (из любой задачи или обработчика приема)
+     */
+    void requestFeedHold() { holdRequested = true; }
+    
+    /**
+     * @brief Запрос продолжения подачи после остановки или M0/M1
+     */
+    void requestResume() { resumeRequested = true; }
+    
+    /**
+     * @brief Запрос сброса: выключение системы и остановка программы
+     */
+    void requestAbort() { abortRequested = true; }
+    
     /**
      * @brief Установка режима работы
      * @param mode Режим работы из Config.h (MODE_NORMAL, MODE_TURN, и т.д.)
@@ -184,6 +238,7 @@ public:
         
         currentMode = mode;
         operationIndex = 0;
+        markStateChange();
         
         LOG_INFO("Контроллер", "Установлен режим: " + String(mode));
     }
@@ -207,6 +262,7 @@ public:
         
         // Установка новой точки отсчета для синхронизации
         setNewOrigin();
+        markStateChange();
         
         LOG_INFO("Контроллер", "Установлен шаг: " + String(pitch) + " du");
     }
@@ -227,6 +283,7 @@ public:
         
         // Установка новой точки отсчета для синхронизации
         setNewOrigin();
+        markStateChange();
         
         LOG_INFO("Контроллер", "Установлено заходов: " + String(starts));
     }
@@ -236,17 +293,40 @@ public:
     bool isEnabled() const { return systemEnabled; }
     long getPitch() const { return currentPitch; }
     int getStarts() const { return currentStarts; }
-    float getConeRatio() const { return coneRatio; }
+    long getConeRatioNum() const { return coneRatioNum; }
+    long getConeRatioDen() const { return coneRatioDen; }
+    int getMeasure() const { return measure; }
     int getTurnPasses() const { return turnPasses; }
     bool getAuxDirection() const { return auxDirectionForward; }
+    uint32_t getStateChangeCount() const { return stateChangeCount; }
+    unsigned long getStateChangeUs() const { return stateChangeUs; }
+    
+    /**
+     * @brief Установка коэффициента конуса дробью
+     * @param numerator Числитель (изменение диаметра)
+     * @param denominator Знаменатель (длина), больше нуля
+     */
+    void setConeRatio(long numerator, long denominator) {
+        if (denominator <= 0) {
+            LOG_ERROR("Контроллер", "Недопустимый знаменатель коэффициента конуса: " + String(denominator));
+            return;
+        }
+        coneRatioNum = numerator;
+        coneRatioDen = denominator;
+        LOG_INFO("Контроллер", "Установлен коэффициент конуса: " + String(numerator) + "/" + String(denominator));
+    }
     
     /**
-     * @brief Установка коэффициента конуса
-     * @param ratio Коэффициент соотношения осей
+     * @brief Установка системы измерений
+     * @param newMeasure MEASURE_METRIC, MEASURE_INCH или MEASURE_TPI
      */
-    void setConeRatio(float ratio) {
-        coneRatio = ratio;
-        LOG_INFO("Контроллер", "Установлен коэффициент конуса: " + String(ratio, 5));
+    void setMeasure(int newMeasure) {
+        if (newMeasure != MEASURE_METRIC && newMeasure != MEASURE_INCH && newMeasure != MEASURE_TPI) {
+            LOG_ERROR("Контроллер", "Недопустимая система измерений: " + String(newMeasure));
+            return;
+        }
+        measure = newMeasure;
+        LOG_INFO("Контроллер", "Система измерений: " + String(measure));
     }
     
     /**
@@ -284,6 +364,46 @@ public:
     }
 
 private:
+    /**
+     * @brief Отметка изменения состояния, влияющего на движение (включение,
+     * режим, шаг, заходы)
+     */
+    void markStateChange() {
+        stateChangeUs = micros();
+        stateChangeCount++;
+    }
+    
+    /**
+     * @brief Исполнение команд реального времени с последовательного порта
+     * 
+     * Остановка и продолжение подачи действуют только на программу G-кода:
+     * в остальных режимах оси ведомы шпинделем и останавливаются вместе с ним.
+     */
+    void processRealtimeCommands() {
+        if (abortRequested) {
+            abortRequested = false;
+            holdRequested = false;
+            resumeRequested = false;
+            if (systemEnabled) {
+                setEnabled(false);
+            }
+            LOG_WARNING("Контроллер", "Сброс по команде с последовательного порта");
+            return;
+        }
+        if (holdRequested) {
+            holdRequested = false;
+            if (systemEnabled && currentMode == MODE_GCODE) {
+                gcode.hold();
+            }
+        }
+        if (resumeRequested) {
+            resumeRequested = false;
+            if (systemEnabled && currentMode == MODE_GCODE) {
+                gcode.resume();
+            }
+        }
+    }
+    
     /**
      * @brief Режим нормальной работы (резьбонарезание)
      * 
@@ -326,19 +446,13 @@ private:
      */
     void updateConeMode() {
         // Проверка возможности работы
-        if (zAxis.isMoving() || xAxis.isMoving() || coneRatio == 0) {
+        if (zAxis.isMoving() || xAxis.isMoving() || coneRatioNum == 0) {
             return;
         }
         
-        // Расчет соотношения движения осей Z и X
-        float zToXRatio = -coneRatio / 2 / zAxis.getPositionSteps() * 
-                         xAxis.getPositionSteps() / xAxis.getPositionSteps() * 
-                         zAxis.getPositionSteps() / zAxis.getPositionSteps() * 
-                         (auxDirectionForward ? 1 : -1);
-        
-        if (zToXRatio == 0) {
-            return;
-        }
+        // Перемещение X на перемещение Z: коэффициент задан по диаметру, X - радиус
+        long xNum = -coneRatioNum * (auxDirectionForward ? 1 : -1);
+        long xDen = 2 * coneRatioDen;
         
         // Снятие ограничений скорости для синхронизации
         xAxis.setMaxSpeed(LONG_MAX);
@@ -347,7 +461,7 @@ private:
         // TODO: Реализация алгоритма конического точения
         // с учетом ограничений обеих осей
         
-        LOG_DEBUG("Контроллер", "Режим конического точения активен. Коэффициент: " + String(coneRatio));
+        LOG_DEBUG("Контроллер", "Режим конического точения активен. X/Z: " + String(xNum) + "/" + String(xDen));
     }
     
     /**
@@ -396,9 +510,17 @@ private:
         // Реализация эллиптического точения
     }
     
+    /**
+     * @brief Режим управления по G-коду
+     * 
+     * Исполняет кадры, подготовленные задачей G-кода, и выключает систему
+     * по завершении программы.
+     */
     void updateGCodeMode() {
-        LOG_DEBUG("Контроллер", "Режим G-кода активен");
-        // Реализация управления по G-коду
+        gcode.update();
+        if (gcode.isFinished()) {
+            setIsOnFromLoop(false);
+        }
     }
     
     void updateA1Mode() {
@@ -432,9 +554,10 @@ private:
      * @return Целевая позиция оси в шагах
      */
     long calculateAxisPosition(AxisController& axis, long spindlePos, bool respectStops = true) {
-        // Расчет новой позиции оси на основе позиции шпинделя и шага резьбы
-        long newPos = spindlePos * axis.getPositionSteps() / axis.getPositionSteps() / 
-                     ENCODER_STEPS_INT * currentPitch * currentStarts;
+        // Расчет новой позиции оси через передаточное отношение шаг резьбы * число заходов
+        Gearbox gear;
+        gear.set(axis.getMotorSteps(), axis.getScrewPitch(), currentPitch * currentStarts);
+        long newPos = gear.toAxisSteps(spindlePos);
         
         // Учет ограничений перемещения если требуется
         if (respectStops) {
@@ -455,8 +578,9 @@ private:
      * @return Позиция шпинделя в счетных импульсах
      */
     long calculateSpindlePosition(AxisController& axis, long axisPos) {
-        return axisPos * axis.getPositionSteps() / axis.getPositionSteps() * 
-               ENCODER_STEPS_INT / (currentPitch * currentStarts);
+        Gearbox gear;
+        gear.set(axis.getMotorSteps(), axis.getScrewPitch(), currentPitch * currentStarts);
+        return gear.toSpindlePulses(axisPos);
     }
     
     // Ссылка на оригинальный метод для совместимости
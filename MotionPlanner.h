@@ -0,0 +1,327 @@
+#ifndef MOTION_PLANNER_H
+#define MOTION_PLANNER_H
+
+#include <Arduino.h>
+#include <float.h>
+#include "Config.h"
+#include "GCodeParser.h"
+#include "CannedCycle.h"
+#include "AxisController.h"
+
+// Роль кадра в упреждающем просмотре
+#define PLANNER_BARRIER 0           // Кадр с остановкой до и после (G0, дуга, G33, G4, циклы, M-команды)
+#define PLANNER_LINEAR 1            // Отрезок G1, скорость на стыках рассчитывается
+#define PLANNER_TRANSPARENT 2       // Кадр без движения и команды (F, номер N) - не прерывает стык
+
+/**
+ * @struct PlannerBlock
+ * @brief Кадр в окне упреждающего просмотра
+ *
+ * Запрограммированные точки начала и конца рассчитываются при постановке в
+ * окно, поэтому исполнитель получает их готовыми. Скорости - в деци-микронах
+ * в секунду вдоль отрезка, ускорение - в деци-микронах в секунду за секунду.
+ */
+struct PlannerBlock {
+    GCodeBlock block;           // Исходный кадр
+    uint8_t kind;               // Роль в просмотре (PLANNER_*)
+    bool stopAfter;             // В конце кадра обязательна остановка (G61, M0/M1, M2/M30)
+    long startZ, startX;        // Запрограммированная начальная точка в деци-микронах
+    long endZ, endX;            // Запрограммированная конечная точка в деци-микронах
+    float length;               // Длина отрезка
+    float unitZ, unitX;         // Направляющий вектор отрезка
+    float nominalSpeed;         // Подача, ограниченная скоростью осей
+    float acceleration;         // Допустимое ускорение вдоль отрезка
+    float maxEntrySpeed;        // Предел скорости входа по углу стыка с предыдущим отрезком
+    float entrySpeed;           // Рассчитанная скорость входа
+};
+
+/**
+ * @class MotionPlanner
+ * @brief Упреждающий просмотр кадров и расчет скоростей на стыках отрезков G1
+ *
+ * Окно хранит до GCODE_LOOKAHEAD_BLOCKS кадров, прочитанных впереди
+ * исполняемого. Скорость прохода стыка двух отрезков ограничивается по
+ * отклонению от угла (GCODE_JUNCTION_DEVIATION_DU) и ускорению осей, как в
+ * grbl. При каждом новом кадре обратный проход от конца окна (где скорость
+ * считается нулевой) ограничивает скорости входа возможностью затормозить,
+ * а прямой проход от исполняемого кадра - возможностью разогнаться. Новый
+ * кадр может только повысить рассчитанные скорости, поэтому исполняемый
+ * кадр всегда успевает к скорости выхода, прочитанной в любой момент.
+ *
+ * В режиме G61 и перед кадрами-барьерами оси останавливаются точно в конце
+ * кадра, как и без планировщика.
+ */
+class MotionPlanner {
+private:
+    PlannerBlock blocks[GCODE_LOOKAHEAD_BLOCKS]; // Кольцо кадров окна
+    int head;                           // Индекс первого кадра окна
+    int count;                          // Число кадров в окне
+    PlannerBlock current;               // Исполняемый кадр (вышел из окна)
+    bool hasCurrent;                    // Исполняемый кадр задан
+    int fetchBarriers;                  // Циклы и концы программы в окне
+
+    // Ограничения осей в деци-микронах
+    float zSpeedLimit, xSpeedLimit;     // Скорость, du/s
+    float zAcceleration, xAcceleration; // Ускорение, du/s²
+
+    // Модальное состояние на конце окна
+    long plannedZ, plannedX;            // Запрограммированная позиция
+    long plannedFeed;                   // Подача, du/s
+
+public:
+    /**
+     * @brief Конструктор планировщика (пустое окно)
+     */
+    MotionPlanner() : head(0), count(0), hasCurrent(false), fetchBarriers(0),
+                      zSpeedLimit(0), xSpeedLimit(0), zAcceleration(0), xAcceleration(0),
+                      plannedZ(0), plannedX(0), plannedFeed(GCODE_FEED_DEFAULT_DU_SEC) {}
+
+    /**
+     * @brief Очистка окна перед новой программой
+     * @param zAxis Ось Z (ограничения скорости и ускорения)
+     * @param xAxis Ось X
+     * @param z Запрограммированная позиция Z в деци-микронах
+     * @param x Запрограммированная позиция X в деци-микронах
+     * @param feed Текущая подача в деци-микронах в секунду
+     */
+    void reset(const AxisController& zAxis, const AxisController& xAxis, long z, long x, long feed) {
+        head = 0;
+        count = 0;
+        hasCurrent = false;
+        fetchBarriers = 0;
+        zSpeedLimit = zAxis.stepsToDu(zAxis.getSpeedLimit());
+        xSpeedLimit = xAxis.stepsToDu(xAxis.getSpeedLimit());
+        zAcceleration = zAxis.stepsToDu(zAxis.getAcceleration());
+        xAcceleration = xAxis.stepsToDu(xAxis.getAcceleration());
+        plannedZ = z;
+        plannedX = x;
+        plannedFeed = feed;
+    }
+
+    /**
+     * @brief Постановка кадра в конец окна и пересчет скоростей
+     * @param block Кадр программы
+     */
+    void push(const GCodeBlock& block) {
+        PlannerBlock& planned = blocks[(head + count) % GCODE_LOOKAHEAD_BLOCKS];
+        count++;
+        planned.block = block;
+        planned.stopAfter = (block.flags & GCODE_EXACT_STOP) || block.command != GCODE_CMD_NONE;
+        planned.startZ = plannedZ;
+        planned.startX = plannedX;
+        planned.length = 0;
+        planned.entrySpeed = 0;
+        planned.maxEntrySpeed = 0;
+
+        if (block.flags & GCODE_HAS_F) {
+            plannedFeed = max((long)block.feed, (long)GCODE_FEED_MIN_DU_SEC);
+        }
+        if (isMove(block)) {
+            bool relative = block.flags & GCODE_RELATIVE;
+            if (block.flags & GCODE_HAS_Z) {
+                plannedZ = relative ? plannedZ + block.z : block.z;
+            }
+            if (block.flags & GCODE_HAS_X) {
+                plannedX = relative ? plannedX + block.x : block.x;
+            }
+        }
+        planned.endZ = plannedZ;
+        planned.endX = plannedX;
+
+        if (CannedCycle::isCycle(block.motion) || block.command == GCODE_CMD_END) {
+            fetchBarriers++;
+        }
+
+        float dz = planned.endZ - planned.startZ;
+        float dx = planned.endX - planned.startX;
+        float length = sqrtf(dz * dz + dx * dx);
+        if (block.motion == GCODE_MOTION_LINEAR && isMove(block) && length >= 1) {
+            planned.kind = PLANNER_LINEAR;
+            planned.length = length;
+            planned.unitZ = dz / length;
+            planned.unitX = dx / length;
+            planned.nominalSpeed = min((float)plannedFeed, axisLimit(planned, zSpeedLimit, xSpeedLimit));
+            planned.acceleration = axisLimit(planned, zAcceleration, xAcceleration);
+            planned.maxEntrySpeed = getJunctionSpeed(planned);
+        } else if (block.motion == GCODE_MOTION_NONE && block.command == GCODE_CMD_NONE) {
+            planned.kind = PLANNER_TRANSPARENT;
+        } else {
+            planned.kind = PLANNER_BARRIER;
+        }
+
+        if (planned.kind == PLANNER_LINEAR) {
+            recalculate();
+        }
+    }
+
+    /**
+     * @brief Переход к исполнению первого кадра окна
+     * @return Кадр, ставший исполняемым (действителен до следующего вызова)
+     */
+    const PlannerBlock& next() {
+        current = blocks[head];
+        hasCurrent = true;
+        head = (head + 1) % GCODE_LOOKAHEAD_BLOCKS;
+        count--;
+        if (CannedCycle::isCycle(current.block.motion) || current.block.command == GCODE_CMD_END) {
+            fetchBarriers--;
+        }
+        return current;
+    }
+
+    /**
+     * @brief Скорость, с которой исполняемый отрезок может перейти в следующий
+     * @return Скорость в деци-микронах в секунду (0 - остановка в конце кадра)
+     *
+     * Значение может вырасти по мере поступления кадров, но не уменьшиться.
+     */
+    float getExitSpeed() const {
+        if (!hasCurrent || current.kind != PLANNER_LINEAR || current.stopAfter) {
+            return 0;
+        }
+        for (int i = 0; i < count; i++) {
+            const PlannerBlock& planned = blocks[(head + i) % GCODE_LOOKAHEAD_BLOCKS];
+            if (planned.kind == PLANNER_LINEAR) {
+                return planned.entrySpeed;
+            }
+            if (planned.kind == PLANNER_BARRIER) {
+                return 0;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Скорость на участке исполняемого отрезка
+     * @param from Начало участка от начала отрезка в деци-микронах
+     * @param to Конец участка
+     * @return Наибольшая скорость, при которой отрезок пройден с разгоном от
+     *         скорости входа и торможением до скорости выхода
+     */
+    float getSpeedLimit(float from, float to) const {
+        float entry2 = current.entrySpeed * current.entrySpeed;
+        float exit = getExitSpeed();
+        float exit2 = exit * exit;
+        float accel2 = 2 * current.acceleration;
+        float speed2 = min(entry2 + accel2 * from, exit2 + accel2 * max(0.0f, current.length - to));
+        return min(current.nominalSpeed, sqrtf(speed2));
+    }
+
+    const PlannerBlock& getCurrent() const { return current; }
+    bool isFull() const { return count >= GCODE_LOOKAHEAD_BLOCKS; }
+    bool isEmpty() const { return count == 0; }
+
+    /**
+     * @brief Можно ли читать кадры дальше
+     *
+     * За кадром цикла кадры не читаются, пока он не начнется: проходы цикла
+     * выдает CannedCycle, а после G71 программа продолжается за контуром.
+     * За концом программы кадров нет.
+     */
+    bool canFetch() const { return !isFull() && fetchBarriers == 0; }
+
+    /**
+     * @brief Исполняется ли кадр перемещением (а не только сменой модального состояния)
+     */
+    static bool isMove(const GCodeBlock& block) {
+        return block.motion != GCODE_MOTION_NONE && block.motion != GCODE_MOTION_DWELL &&
+               !CannedCycle::isCycle(block.motion) &&
+               (block.flags & (GCODE_HAS_X | GCODE_HAS_Z | GCODE_HAS_I | GCODE_HAS_K));
+    }
+
+private:
+    /**
+     * @brief Ограничение вдоль отрезка по ограничениям осей
+     * @param planned Отрезок с рассчитанным направлением
+     * @param zLimit Ограничение оси Z
+     * @param xLimit Ограничение оси X
+     * @return Наибольшее значение вдоль отрезка, при котором ни одна ось не превышает своего
+     */
+    static float axisLimit(const PlannerBlock& planned, float zLimit, float xLimit) {
+        float limit = FLT_MAX;
+        if (fabsf(planned.unitZ) > 1e-6f) {
+            limit = min(limit, zLimit / fabsf(planned.unitZ));
+        }
+        if (fabsf(planned.unitX) > 1e-6f) {
+            limit = min(limit, xLimit / fabsf(planned.unitX));
+        }
+        return limit;
+    }
+
+    /**
+     * @brief Предел скорости прохода стыка с предыдущим отрезком
+     * @param planned Новый отрезок (последний в окне)
+     * @return Скорость входа в деци-микронах в секунду
+     *
+     * Стык проходится по дуге, отклоняющейся от угла не больше чем на
+     * GCODE_JUNCTION_DEVIATION_DU, с центростремительным ускорением не больше
+     * допустимого для обоих отрезков.
+     */
+    float getJunctionSpeed(const PlannerBlock& planned) const {
+        const PlannerBlock* previous = nullptr;
+        int i = count - 2;
+        for (; i >= 0; i--) {
+            const PlannerBlock& candidate = blocks[(head + i) % GCODE_LOOKAHEAD_BLOCKS];
+            if (candidate.kind != PLANNER_TRANSPARENT) {
+                previous = &candidate;
+                break;
+            }
+        }
+        if (i < 0 && hasCurrent) {
+            previous = &current;
+        }
+        if (!previous || previous->kind != PLANNER_LINEAR || previous->stopAfter ||
+            (planned.block.flags & GCODE_EXACT_STOP)) {
+            return 0;
+        }
+
+        float cosTheta = -(previous->unitZ * planned.unitZ + previous->unitX * planned.unitX);
+        float limit = min(previous->nominalSpeed, planned.nominalSpeed);
+        if (cosTheta > 0.999999f) {
+            return 0; // Разворот назад
+        }
+        if (cosTheta < -0.999999f) {
+            return limit; // Продолжение по прямой
+        }
+        float sinHalf = sqrtf(0.5f * (1 - cosTheta));
+        float acceleration = min(previous->acceleration, planned.acceleration);
+        float speed = sqrtf(acceleration * GCODE_JUNCTION_DEVIATION_DU * sinHalf / (1 - sinHalf));
+        return min(limit, speed);
+    }
+
+    /**
+     * @brief Обратный и прямой проходы по окну
+     */
+    void recalculate() {
+        // Обратный проход: со скорости входа следующего отрезка должно хватить пути затормозить
+        float nextEntry = 0;
+        for (int i = count - 1; i >= 0; i--) {
+            PlannerBlock& planned = blocks[(head + i) % GCODE_LOOKAHEAD_BLOCKS];
+            if (planned.kind == PLANNER_BARRIER) {
+                nextEntry = 0;
+            } else if (planned.kind == PLANNER_LINEAR) {
+                float reachable = sqrtf(nextEntry * nextEntry + 2 * planned.acceleration * planned.length);
+                planned.entrySpeed = min(planned.maxEntrySpeed, reachable);
+                nextEntry = planned.entrySpeed;
+            }
+        }
+
+        // Прямой проход: от скорости входа предыдущего отрезка должно хватить пути разогнаться
+        float reachable = FLT_MAX;
+        if (hasCurrent && current.kind == PLANNER_LINEAR) {
+            reachable = sqrtf(current.entrySpeed * current.entrySpeed + 2 * current.acceleration * current.length);
+        }
+        for (int i = 0; i < count; i++) {
+            PlannerBlock& planned = blocks[(head + i) % GCODE_LOOKAHEAD_BLOCKS];
+            if (planned.kind == PLANNER_BARRIER) {
+                reachable = FLT_MAX; // Вход следующего отрезка и так нулевой
+            } else if (planned.kind == PLANNER_LINEAR) {
+                planned.entrySpeed = min(planned.entrySpeed, reachable);
+                reachable = sqrtf(planned.entrySpeed * planned.entrySpeed +
+                                  2 * planned.acceleration * planned.length);
+            }
+        }
+    }
+};
+
+#endif // MOTION_PLANNER_H
@@ -0,0 +1,199 @@
+#ifndef NUMPAD_ENTRY_H
+#define NUMPAD_ENTRY_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "LcdFormat.h"
+
+// Наибольшее число цифр ввода (значение помещается в long)
+#define NUMPAD_DIGITS_MAX 8
+
+// Подразумеваемые знаки после точки, если точка не введена: микроны в мм,
+// тысячные дюйма (thou), целые нитки на дюйм, коэффициент конуса в 1/100000
+#define NUMPAD_IMPLIED_METRIC 3
+#define NUMPAD_IMPLIED_INCH 3
+#define NUMPAD_IMPLIED_TPI 0
+#define NUMPAD_IMPLIED_RATIO 5
+
+/**
+ * @class NumpadEntry
+ * @brief Числовой ввод с десятичной точкой в целых числах
+ *
+ * Введенное число хранится мантиссой и числом цифр после точки, поэтому
+ * перевод в деци-микроны и отношения выполняется точно, без float. Без точки
+ * цифры читаются в привычных единицах ввода станка (микроны, thou, целые TPI,
+ * коэффициент конуса в 1/100000), с точкой - в мм, дюймах, TPI и долях.
+ * Лишние знаки после точки округляются половиной вверх, как в LcdFormat.
+ */
+class NumpadEntry {
+private:
+    long mantissa;                      // Введенные цифры без точки
+    int digitCount;                     // Число введенных цифр
+    int fractionDigits;                 // Цифр после точки
+    bool hasPoint;                      // Точка введена
+
+public:
+    NumpadEntry() {
+        clear();
+    }
+
+    /**
+     * @brief Очистка ввода
+     */
+    void clear() {
+        mantissa = 0;
+        digitCount = 0;
+        fractionDigits = 0;
+        hasPoint = false;
+    }
+
+    bool isEmpty() const { return digitCount == 0 && !hasPoint; }
+    bool hasDecimalPoint() const { return hasPoint; }
+
+    /**
+     * @brief Добавление цифры
+     * @param digit Цифра 0-9
+     *
+     * Без точки при заполненном буфере старшая цифра выталкивается, как и
+     * прежде; с точкой лишние цифры не принимаются.
+     */
+    void pressDigit(int digit) {
+        if (digitCount >= NUMPAD_DIGITS_MAX) {
+            if (hasPoint) {
+                return;
+            }
+            mantissa %= (long)lcdPow10(NUMPAD_DIGITS_MAX - 1);
+            digitCount--;
+        }
+        mantissa = mantissa * 10 + digit;
+        digitCount++;
+        if (hasPoint) {
+            fractionDigits++;
+        }
+    }
+
+    /**
+     * @brief Ввод десятичной точки (повторная точка игнорируется)
+     */
+    void pressPoint() {
+        hasPoint = true;
+    }
+
+    /**
+     * @brief Удаление последнего введенного знака (цифры или точки)
+     */
+    void backspace() {
+        if (hasPoint && fractionDigits == 0) {
+            hasPoint = false;
+        } else if (digitCount > 0) {
+            mantissa /= 10;
+            digitCount--;
+            if (hasPoint) {
+                fractionDigits--;
+            }
+        }
+    }
+
+    /**
+     * @brief Изменение последней цифры кнопками +/- (в пределах 1-9)
+     * @param plus true - увеличить, false - уменьшить
+     */
+    void adjustLastDigit(bool plus) {
+        if (digitCount == 0) {
+            return;
+        }
+        long last = mantissa % 10;
+        if (plus && last < 9) {
+            mantissa++;
+        } else if (!plus && last > 1) {
+            mantissa--;
+        }
+    }
+
+    /**
+     * @brief Целое значение (номер строки, число проходов)
+     * @return Введенное число, дробная часть округляется
+     */
+    long toInteger() const {
+        return (long)scaled(fractionDigits, 0);
+    }
+
+    /**
+     * @brief Шаг в деци-микронах
+     * @param measure Система измерений MEASURE_*
+     * @return Шаг в деци-микронах (0 при пустом вводе или нулевом TPI)
+     */
+    long toDeciMicrons(int measure) const {
+        switch (measure) {
+            case MEASURE_INCH: {
+                int fraction = effectiveFraction(NUMPAD_IMPLIED_INCH);
+                return clampLong(lcdDivRound((int64_t)mantissa * LCD_DU_PER_INCH, (int64_t)lcdPow10(fraction)));
+            }
+            case MEASURE_TPI: {
+                if (mantissa == 0) {
+                    return 0;
+                }
+                int fraction = effectiveFraction(NUMPAD_IMPLIED_TPI);
+                return clampLong(lcdDivRound((int64_t)LCD_DU_PER_INCH * (int64_t)lcdPow10(fraction), mantissa));
+            }
+            default:
+                // Деци-микроны - 4 знака после точки в мм
+                return clampLong(scaled(effectiveFraction(NUMPAD_IMPLIED_METRIC), 4));
+        }
+    }
+
+    /**
+     * @brief Отношение в виде несократимой дроби
+     * @param numerator Числитель
+     * @param denominator Знаменатель (больше нуля)
+     */
+    void toRatio(long& numerator, long& denominator) const {
+        numerator = mantissa;
+        denominator = (long)lcdPow10(effectiveFraction(NUMPAD_IMPLIED_RATIO));
+        long a = numerator;
+        long b = denominator;
+        while (b != 0) {
+            long t = a % b;
+            a = b;
+            b = t;
+        }
+        if (a > 1) {
+            numerator /= a;
+            denominator /= a;
+        }
+    }
+
+    /**
+     * @brief Введенное число текстом (для журнала)
+     * @param out Буфер не короче LCD_NUMBER_MAX
+     */
+    int format(char* out) const {
+        int length = formatFixed(out, mantissa, fractionDigits, fractionDigits);
+        if (hasPoint && fractionDigits == 0) {
+            out[length++] = '.';
+            out[length] = '\0';
+        }
+        return length;
+    }
+
+private:
+    int effectiveFraction(int implied) const {
+        return hasPoint ? fractionDigits : implied;
+    }
+
+    /**
+     * @brief Мантисса с fraction знаками после точки, приведенная к scale знакам
+     */
+    int64_t scaled(int fraction, int scale) const {
+        if (fraction <= scale) {
+            return (int64_t)mantissa * (int64_t)lcdPow10(scale - fraction);
+        }
+        return lcdDivRound(mantissa, (int64_t)lcdPow10(fraction - scale));
+    }
+
+    static long clampLong(int64_t value) {
+        return value > LONG_MAX ? LONG_MAX : value < -LONG_MAX ? -LONG_MAX : (long)value;
+    }
+};
+
+#endif // NUMPAD_ENTRY_H
@@ -16,6 +16,7 @@ private:
     bool enabled;                       // Активна ли система логирования
     unsigned long logStartTime;         // Время начала логирования
     String logBuffer;                   // Буфер для хранения логов
+    unsigned long droppedCount;         // Записей, вытесненных из переполненного буфера
     static constexpr int BUFFER_SIZE = 4096; // Максимальный размер буфера
 
 public:
@@ -33,7 +34,7 @@ public:
     /**
      * @brief Конструктор системы логирования
      */
-    RussianLogger() : enabled(true), logStartTime(millis()) {
+    RussianLogger() : enabled(true), logStartTime(millis()), droppedCount(0) {
         logBuffer.reserve(BUFFER_SIZE);
     }
     
@@ -71,6 +72,7 @@ public:
             int newlinePos = logBuffer.indexOf('\n');
             if (newlinePos != -1) {
                 logBuffer = logBuffer.substring(newlinePos + 1) + logEntry + "\n";
+                droppedCount++;
             }
         }
     }
@@ -92,6 +94,13 @@ public:
         return logBuffer; 
     }
     
+    /**
+     * @brief Число записей, вытесненных из буфера логов при переполнении
+     */
+    unsigned long getDroppedCount() const {
+        return droppedCount;
+    }
+    
     /**
      * @brief Очистка буфера логов
      */
@@ -0,0 +1,264 @@
+#ifndef SERIAL_RECEIVER_H
+#define SERIAL_RECEIVER_H
+
+#include <Arduino.h>
+#include "Config.h"
+#include "SpindleEncoder.h"
+#include "AxisController.h"
+#include "GCodeInterpreter.h"
+#include "MotionController.h"
+
+// Однобайтовые команды реального времени (не попадают в строки G-кода)
+#define SERIAL_RT_STATUS '?'        // Запрос состояния
+#define SERIAL_RT_FEED_HOLD '!'     // Остановка подачи
+#define SERIAL_RT_RESUME '~'        // Продолжение подачи (и после M0/M1)
+#define SERIAL_RT_RESET 0x18        // Сброс (Ctrl-X): выключение и очистка принятых строк
+
+// Размер ответа на запрос состояния
+#define SERIAL_STATUS_MAX 112
+
+/**
+ * @class SerialReceiver
+ * @brief Прием байтов последовательного порта с выделением команд реального времени
+ *
+ * receive() вызывается обработчиком приема UART при поступлении байтов и
+ * забирает их из порта целиком. Команды реального времени исполняются сразу:
+ * остановка, продолжение и сброс передаются задаче движения флагами и
+ * действуют в ее ближайшем цикле. Запрос состояния только отмечается, а
+ * ответ без выделения памяти выводит задача G-кода (sendRequestedStatus):
+ * ответы ok/error и загрузчика пишет в порт она же, поэтому строка
+ * состояния не вклинивается в середину другого ответа. Остальные байты
+ * складываются в кольцевой буфер, из которого строки читает GCodeStreamer,
+ * а порции загрузки программ - GCodeUploader. Размер буфера равен окну
+ * подсчета символов хоста, команды реального времени в окно не входят.
+ *
+ * Буфер пишется только в receive() и читается только задачей G-кода, поэтому
+ * обходится без мьютекса.
+ */
+class SerialReceiver {
+private:
+    MotionController& motionController; // Исполнитель остановки, продолжения и сброса
+    GCodeInterpreter& interpreter;      // Источник состояния программы
+    SpindleEncoder& spindle;            // Источник оборотов шпинделя
+    AxisController& zAxis;              // Ось Z
+    AxisController& xAxis;              // Ось X
+
+    char ring[GCODE_SERIAL_RX_BUFFER];  // Принятые байты строк
+    volatile uint32_t head;             // Счетчик записанных байтов (пишет receive())
+    volatile uint32_t tail;             // Счетчик прочитанных байтов (пишет читатель)
+    volatile uint32_t resetHead;        // Значение head в момент сброса
+    volatile uint32_t resetCount;       // Число принятых команд сброса
+    volatile uint32_t overflowCount;    // Число байтов, не поместившихся в буфер
+    volatile uint32_t statusRequests;   // Число принятых запросов состояния
+    uint32_t seenResetCount;            // Сбросы, уже обработанные читателем
+    uint32_t seenStatusRequests;        // Запросы состояния, на которые уже дан ответ
+
+public:
+    /**
+     * @brief Конструктор приемника
+     * @param motionCtrl Ссылка на контроллер движения
+     * @param gcodeInterp Ссылка на интерпретатор G-кода
+     * @param spindleEnc Ссылка на энкодер шпинделя
+     * @param zAxisCtrl Ссылка на ось Z
+     * @param xAxisCtrl Ссылка на ось X
+     */
+    SerialReceiver(MotionController& motionCtrl, GCodeInterpreter& gcodeInterp,
+                   SpindleEncoder& spindleEnc, AxisController& zAxisCtrl, AxisController& xAxisCtrl)
+        : motionController(motionCtrl), interpreter(gcodeInterp), spindle(spindleEnc),
+          zAxis(zAxisCtrl), xAxis(xAxisCtrl), head(0), tail(0), resetHead(0),
+          resetCount(0), overflowCount(0), statusRequests(0), seenResetCount(0), seenStatusRequests(0) {}
+
+    /**
+     * @brief Забор байтов из порта (вызывать из обработчика приема UART)
+     */
+    void receive() {
+        while (Serial.available() > 0) {
+            int c = Serial.read();
+            if (c < 0) {
+                break;
+            }
+            switch (c) {
+                case SERIAL_RT_STATUS:
+                    statusRequests++;
+                    break;
+                case SERIAL_RT_FEED_HOLD:
+                    motionController.requestFeedHold();
+                    break;
+                case SERIAL_RT_RESUME:
+                    motionController.requestResume();
+                    break;
+                case SERIAL_RT_RESET:
+                    motionController.requestAbort();
+                    resetHead = head;
+                    resetCount++;
+                    break;
+                default:
+                    if (head - tail >= (uint32_t)GCODE_SERIAL_RX_BUFFER) {
+                        overflowCount++; // Хост превысил окно - байт теряется
+                    } else {
+                        ring[head % GCODE_SERIAL_RX_BUFFER] = (char)c;
+                        head++;
+                    }
+                    break;
+            }
+        }
+    }
+
+    /**
+     * @brief Отбрасывание байтов, принятых до команды сброса (вызывать читателю)
+     * @return true если с прошлого вызова был сброс
+     */
+    bool takeReset() {
+        uint32_t count = resetCount;
+        if (count == seenResetCount) {
+            return false;
+        }
+        seenResetCount = count;
+        tail = resetHead;
+        return true;
+    }
+
+    /**
+     * @brief Число принятых байтов строк, ожидающих чтения
+     */
+    int available() const {
+        return (int)(head - tail);
+    }
+
+    /**
+     * @brief Следующий байт без извлечения из буфера
+     * @return Байт или -1 если буфер пуст
+     */
+    int peek() const {
+        if (head == tail) {
+            return -1;
+        }
+        return (unsigned char)ring[tail % GCODE_SERIAL_RX_BUFFER];
+    }
+
+    /**
+     * @brief Поиск байта среди ожидающих чтения
+     * @param c Искомый байт
+     * @return Число байтов перед ним или -1 если байта в буфере нет
+     */
+    int find(uint8_t c) const {
+        uint32_t end = head;
+        for (uint32_t i = tail; i != end; i++) {
+            if ((uint8_t)ring[i % GCODE_SERIAL_RX_BUFFER] == c) {
+                return (int)(i - tail);
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Отбрасывание байтов без чтения
+     * @param count Число байтов (не больше available())
+     */
+    void skip(int count) {
+        tail += (uint32_t)count;
+    }
+
+    /**
+     * @brief Чтение байта строки
+     * @return Байт или -1 если буфер пуст
+     */
+    int read() {
+        if (head == tail) {
+            return -1;
+        }
+        char c = ring[tail % GCODE_SERIAL_RX_BUFFER];
+        tail++;
+        return (unsigned char)c;
+    }
+
+    /**
+     * @brief Ответ на запросы состояния, принятые с прошлого вызова (вызывать из задачи G-кода)
+     *
+     * Несколько запросов, пришедших между вызовами, получают один ответ.
+     */
+    void sendRequestedStatus() {
+        uint32_t count = statusRequests;
+        if (count == seenStatusRequests) {
+            return;
+        }
+        seenStatusRequests = count;
+        sendStatus();
+    }
+
+    uint32_t getOverflowCount() const { return overflowCount; }
+
+private:
+    /**
+     * @brief Ответ о состоянии: <состояние|режим|Z:мм|X:мм|RPM:об/мин|Bf:кадров,байт|Ln:строка>
+     *
+     * Bf - свободные места в очереди кадров и в буфере строк.
+     */
+    void sendStatus() {
+        char z[24];
+        char x[24];
+        formatDu(z, sizeof(z), zAxis.getPositionDu());
+        formatDu(x, sizeof(x), xAxis.getPositionDu());
+
+        char status[SERIAL_STATUS_MAX];
+        int length = snprintf(status, sizeof(status), "<%s|%s|Z:%s|X:%s|RPM:%d|Bf:%d,%d|Ln:%lu>\r\n",
+                              getStateName(), getModeName(), z, x, spindle.getRpm(),
+                              interpreter.getQueueSpace(), GCODE_SERIAL_RX_BUFFER - available(),
+                              (unsigned long)interpreter.getCurrentLine());
+        Serial.write((const uint8_t*)status, min(length, (int)sizeof(status) - 1));
+    }
+
+    /**
+     * @brief Состояние исполнения для ответа о состоянии
+     */
+    const char* getStateName() const {
+        if (!motionController.isEnabled()) {
+            return "Off";
+        }
+        if (motionController.getOperationMode() != MODE_GCODE) {
+            return "Run";
+        }
+        if (interpreter.isFinished()) {
+            return "Idle";
+        }
+        if (interpreter.isHeld()) {
+            return "Hold";
+        }
+        if (interpreter.isPaused()) {
+            return "Pause";
+        }
+        return "Run";
+    }
+
+    /**
+     * @brief Режим работы для ответа о состоянии (латиницей, для разбора хостом)
+     */
+    const char* getModeName() const {
+        switch (motionController.getOperationMode()) {
+            case MODE_NORMAL: return "Gears";
+            case MODE_ASYNC: return "Async";
+            case MODE_CONE: return "Cone";
+            case MODE_TURN: return "Turn";
+            case MODE_FACE: return "Face";
+            case MODE_CUT: return "Cut";
+            case MODE_THREAD: return "Thread";
+            case MODE_ELLIPSE: return "Ellipse";
+            case MODE_GCODE: return "GCode";
+            case MODE_A1: return "A1";
+            default: return "Unknown";
+        }
+    }
+
+    /**
+     * @brief Запись позиции в мм с четырьмя знаками без плавающей точки
+     * @param out Буфер результата
+     * @param size Размер буфера
+     * @param du Позиция в деци-микронах
+     */
+    static void formatDu(char* out, size_t size, long du) {
+        unsigned long magnitude = du < 0 ? -(unsigned long)du : (unsigned long)du;
+        snprintf(out, size, "%s%lu.%04lu", du < 0 ? "-" : "", magnitude / 10000, magnitude % 10000);
+    }
+};
+
+#endif // SERIAL_RECEIVER_H
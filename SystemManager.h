@@ -9,9 +9,15 @@
 #include "RussianLogger.h"
 #include "MotionController.h"
 #include "DisplayManager.h"
+#include "DisplayEvents.h"
 #include "InputManager.h"
 #include "SpindleEncoder.h"
 #include "AxisController.h"
+#include "GCodeStorage.h"
+#include "GCodeInterpreter.h"
+#include "SerialReceiver.h"
+#include "GCodeStreamer.h"
+#include "GCodeUploader.h"
 
 // Глобальный экземпляр логгера
 RussianLogger Logger;
@@ -34,6 +40,17 @@ private:
     AxisController& zAxis;
     AxisController& xAxis;
     AxisController& a1Axis;
+    GCodeStorage& gcodeStorage;
+    GCodeInterpreter& gcodeInterpreter;
+    SerialReceiver& serialReceiver;
+    GCodeStreamer& gcodeStreamer;
+    GCodeUploader& gcodeUploader;
+    Diagnostics& diagnostics;
+    KeyLatency& keyLatency;
+    DisplayEvents displayEvents;    // Уведомления задачи дисплея об изменениях
+    
+    // Запуск программ G-кода (только в задаче G-кода)
+    uint32_t gcodeRunId;            // Номер запуска, для которого передан образ программы
     
     // Управление настройками
     Preferences preferences;
@@ -59,6 +76,13 @@ public:
      * @param zAxisCtrl Ссылка на ось Z
      * @param xAxisCtrl Ссылка на ось X
      * @param a1AxisCtrl Ссылка на ось A1
+     * @param storage Ссылка на хранилище программ G-кода
+     * @param interpreter Ссылка на интерпретатор G-кода
+     * @param receiver Ссылка на приемник последовательного порта
+     * @param streamer Ссылка на приемник G-кода с последовательного порта
+     * @param uploader Ссылка на загрузчик программ по последовательному порту
+     * @param diag Ссылка на сборщик показателей диагностики
+     * @param latency Ссылка на замер задержки нажатий
      */
     SystemManager(MotionController& motionCtrl, 
                   DisplayManager& displayMgr,
@@ -66,10 +90,21 @@ public:
                   SpindleEncoder& spindleEnc,
                   AxisController& zAxisCtrl,
                   AxisController& xAxisCtrl,
-                  AxisController& a1AxisCtrl)
+                  AxisController& a1AxisCtrl,
+                  GCodeStorage& storage,
+                  GCodeInterpreter& interpreter,
+                  SerialReceiver& receiver,
+                  GCodeStreamer& streamer,
+                  GCodeUploader& uploader,
+                  Diagnostics& diag,
+                  KeyLatency& latency)
         : motionController(motionCtrl), displayManager(displayMgr), 
           inputManager(inputMgr), spindleEncoder(spindleEnc),
           zAxis(zAxisCtrl), xAxis(xAxisCtrl), a1Axis(a1AxisCtrl),
+          gcodeStorage(storage), gcodeInterpreter(interpreter),
+          serialReceiver(receiver), gcodeStreamer(streamer), gcodeUploader(uploader),
+          diagnostics(diag), keyLatency(latency), displayEvents(motionCtrl, zAxisCtrl, xAxisCtrl, spindleEnc),
+          gcodeRunId(0),
           emergencyState(ESTOP_NONE), lastSaveTime(0), settingsChanged(false),
           displayTaskHandle(NULL), keypadTaskHandle(NULL), 
           motionTaskHandle(NULL), gcodeTaskHandle(NULL) {}
@@ -103,12 +138,23 @@ public:
         // Загрузка настроек из EEPROM
         loadSettings();
         
+        // Хранилище программ G-кода (без него недоступен только режим G-кода)
+        if (gcodeStorage.begin()) {
+            inputManager.setGCodeProgramCount(gcodeStorage.getProgramCount());
+        } else {
+            LOG_WARNING("Система", "Хранилище программ G-кода недоступно");
+        }
+        
         // Проверка целостности системы
         systemIntegrityCheck();
         
         // Создание и запуск задач FreeRTOS
         createTasks();
         
+        // Байты порта забираются по прерыванию приема UART: команды реального
+        // времени исполняются сразу, а не после строк G-кода в очереди
+        Serial.onReceive([this]() { serialReceiver.receive(); });
+        
         LOG_INFO("Система", "Инициализация завершена успешно");
         return true;
     }
@@ -248,13 +294,14 @@ private:
             0                  // Ядро (0)
         );
         
-        // Задача обработки клавиатуры (ядро 0)
+        // Задача обработки клавиатуры (ядро 0, приоритет выше дисплея: нажатие
+        // обрабатывается сразу по прерыванию, не дожидаясь порции вывода)
         xTaskCreatePinnedToCore(
             keypadTask,
             "Keypad", 
             10000,
             this,
-            1,
+            2,
             &keypadTaskHandle,
             0
         );
@@ -281,6 +328,12 @@ private:
             1
         );
         
+        // Запас стека задач показывается на странице диагностики
+        diagnostics.addTask("Дисплей", displayTaskHandle);
+        diagnostics.addTask("Клавиатура", keypadTaskHandle);
+        diagnostics.addTask("Движение", motionTaskHandle);
+        diagnostics.addTask("G-код", gcodeTaskHandle);
+        
         LOG_INFO("Система", "Задачи FreeRTOS созданы");
     }
     
@@ -289,7 +342,7 @@ private:
      */
     void systemIntegrityCheck() {
         // Проверка клавиатуры при запуске
-        if (keypad.available()) {
+        if (inputManager.hasPendingEvents()) {
             emergencyStop(ESTOP_KEY);
             LOG_ERROR("Система", "Аварийная остановка: клавиша нажата при запуске");
             return;
@@ -366,18 +419,30 @@ private:
     // Статические методы для задач FreeRTOS
     static void displayTask(void* parameter) {
         SystemManager* system = (SystemManager*)parameter;
+        system->displayEvents.subscribe(xTaskGetCurrentTaskHandle());
         while (system->emergencyState == ESTOP_NONE) {
-            system->displayManager.update();
-            vTaskDelay(100 / portTICK_PERIOD_MS);
+            bool drawn = system->displayManager.update();
+            // Вывод порциями: клавиатура на том же ядре получает управление между ними
+            while (!system->displayManager.flush(LCD_SLICE_BUDGET_US)) {
+                vTaskDelay(1);
+            }
+            // Ограничение частоты кадров, затем сон до события (заставку досматриваем без сна)
+            vTaskDelay(DISPLAY_MIN_INTERVAL_MS / portTICK_PERIOD_MS);
+            system->displayEvents.wait(drawn ? DISPLAY_IDLE_REFRESH_MS / portTICK_PERIOD_MS : 0);
         }
         vTaskDelete(NULL);
     }
     
     static void keypadTask(void* parameter) {
         SystemManager* system = (SystemManager*)parameter;
+        system->inputManager.attachTask(xTaskGetCurrentTaskHandle());
         while (system->emergencyState == ESTOP_NONE) {
-            system->inputManager.update();
-            vTaskDelay(50 / portTICK_PERIOD_MS);
+            if (system->inputManager.update()) {
+                system->displayEvents.notify(DISPLAY_EVENT_INPUT);
+            }
+            // Сон до прерывания INT или повтора удерживаемой клавиши; по таймауту
+            // очередь проверяется и без прерывания
+            system->inputManager.waitForEvents(system->inputManager.getWaitMs() / portTICK_PERIOD_MS);
         }
         vTaskDelete(NULL);
     }
@@ -385,7 +450,10 @@ private:
     static void motionTask(void* parameter) {
         SystemManager* system = (SystemManager*)parameter;
         while (system->emergencyState == ESTOP_NONE) {
+            system->diagnostics.recordMotionCycle();
             system->motionController.update();
+            system->keyLatency.recordMotionCycle();
+            system->displayEvents.poll();
             vTaskDelay(1 / portTICK_PERIOD_MS);
         }
         vTaskDelete(NULL);
@@ -394,11 +462,70 @@ private:
     static void gcodeTask(void* parameter) {
         SystemManager* system = (SystemManager*)parameter;
         while (system->emergencyState == ESTOP_NONE) {
-            // TODO: Реализация обработки G-кода
+            system->loadGCode();
+            system->serialReceiver.sendRequestedStatus();
+            system->gcodeStreamer.update();
+            // Загруженная программа сразу появляется в выборе программ
+            if (!system->gcodeStreamer.isActive() &&
+                system->gcodeUploader.update(system->inputManager.isGCodeStreamSelected())) {
+                system->inputManager.setGCodeProgramCount(system->gcodeStorage.getProgramCount());
+            }
             vTaskDelay(10 / portTICK_PERIOD_MS);
         }
         vTaskDelete(NULL);
     }
+    
+    /**
+     * @brief Передача образа выбранной программы интерпретатору при запуске
+     * 
+     * Программа уже проверена и скомпилирована при сохранении, поэтому здесь
+     * только отображается ее образ во флеш-памяти. Если введена строка
+     * продолжения, исполнение начинается с ее первого кадра. Если выбран источник "поток",
+     * кадры поступают в очередь интерпретатора с последовательного порта.
+     * Вызывается из задачи G-кода.
+     */
+    void loadGCode() {
+        bool running = motionController.isEnabled() &&
+                       motionController.getOperationMode() == MODE_GCODE &&
+                       !gcodeInterpreter.isFinished();
+        if (!running || gcodeRunId == gcodeInterpreter.getRunId()) {
+            return;
+        }
+        gcodeRunId = gcodeInterpreter.getRunId();
+        
+        if (inputManager.isGCodeStreamSelected()) {
+            gcodeStreamer.startRun();
+            return;
+        }
+        
+        const GCodeBlock* blocks;
+        uint32_t count;
+        int index = inputManager.getGCodeProgramIndex();
+        GCodeBounds bounds;
+        if (!gcodeStorage.getImage(index, blocks, count) || !gcodeStorage.getBounds(index, bounds)) {
+            gcodeInterpreter.abort(0, "Программа не найдена");
+            return;
+        }
+        
+        // Пределы хода, упоры и скорость резьбы проверяются до первого перемещения
+        if (!gcodeInterpreter.checkProgram(bounds)) {
+            return;
+        }
+        
+        // Продолжение с введенной строки: модальное состояние восстанавливается по контрольным точкам образа
+        uint32_t startLine = inputManager.getGCodeStartLine();
+        if (startLine > 0) {
+            inputManager.clearGCodeStartLine();
+            GCodeCheckpoint state;
+            if (!gcodeStorage.findResumePoint(index, startLine, state)) {
+                gcodeInterpreter.abort(startLine, "Продолжение с этой строки невозможно");
+                return;
+            }
+            gcodeInterpreter.runImage(blocks, count, &state);
+            return;
+        }
+        gcodeInterpreter.runImage(blocks, count);
+    }
 };
 
 #endif // SYSTEM_MANAGER_H
\ No newline at end of file
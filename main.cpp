@@ -1,7 +1,6 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include <SPI.h>
-#include <LiquidCrystal.h>
 #include <Preferences.h>
 #include <Adafruit_TCA8418.h>
 #include <driver/pcnt.h>
@@ -13,7 +12,15 @@
 #include "RussianLogger.h"
 #include "SpindleEncoder.h"
 #include "AxisController.h"
+#include "GCodeStorage.h"
+#include "GCodeInterpreter.h"
 #include "MotionController.h"
+#include "SerialReceiver.h"
+#include "GCodeStreamer.h"
+#include "GCodeUploader.h"
+#include "Diagnostics.h"
+#include "KeyLatency.h"
+#include "LcdParallel.h"
 #include "DisplayManager.h"
 #include "InputManager.h"
 #include "SystemManager.h"
@@ -23,7 +30,7 @@
 // =============================================================================
 
 // Аппаратные объекты
-LiquidCrystal lcd(21, 48, 47, 38, 39, 40, 41, 42, 2, 1);
+LcdParallel lcd(21, 48, 47, 38, 39, 40, 41, 42, 2, 1);
 Adafruit_TCA8418 keypad;
 
 // Компоненты системы
@@ -40,19 +47,30 @@ AxisController a1Axis(NAME_A1, ACTIVE_A1, ROTARY_A1, MOTOR_STEPS_A1, SCREW_A1_DU
                      SPEED_START_A1, SPEED_MANUAL_MOVE_A1, ACCELERATION_A1, INVERT_A1,
                      NEEDS_REST_A1, MAX_TRAVEL_MM_A1, BACKLASH_DU_A1, A11, A12, A13);
 
-MotionController motionController(spindleEncoder, zAxis, xAxis, a1Axis);
-DisplayManager displayManager(lcd, motionController);
-InputManager inputManager(keypad, motionController);
+GCodeStorage gcodeStorage;
+GCodeInterpreter gcodeInterpreter(zAxis, xAxis, spindleEncoder);
+MotionController motionController(spindleEncoder, zAxis, xAxis, a1Axis, gcodeInterpreter);
+SerialReceiver serialReceiver(motionController, gcodeInterpreter, spindleEncoder, zAxis, xAxis);
+GCodeStreamer gcodeStreamer(gcodeInterpreter, serialReceiver);
+GCodeUploader gcodeUploader(gcodeStorage, serialReceiver, motionController);
+Diagnostics diagnostics(zAxis, xAxis, spindleEncoder);
+KeyLatency keyLatency(zAxis, xAxis, a1Axis);
+DisplayManager displayManager(lcd, motionController, diagnostics, keyLatency);
+InputManager inputManager(keypad, motionController, zAxis, xAxis, a1Axis, keyLatency);
 SystemManager systemManager(motionController, displayManager, inputManager, 
-                           spindleEncoder, zAxis, xAxis, a1Axis);
+                           spindleEncoder, zAxis, xAxis, a1Axis,
+                           gcodeStorage, gcodeInterpreter, serialReceiver, gcodeStreamer,
+                           gcodeUploader, diagnostics, keyLatency);
 
 // =============================================================================
 // ФУНКЦИИ ARDUINO
 // =============================================================================
 
 void setup() {
-    // Инициализация последовательного порта для отладки
-    Serial.begin(115200);
+    // Последовательный порт: журнал, потоковая передача и загрузка G-кода
+    // (буфер приема задается до begin() и равен окну подсчета символов хоста)
+    Serial.setRxBufferSize(GCODE_SERIAL_RX_BUFFER);
+    Serial.begin(SERIAL_BAUD);
     Serial.println("NanoELS H4 - Запуск системы...");
     
     // Инициализация системы
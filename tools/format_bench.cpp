@@ -0,0 +1,181 @@
+// =============================================================================
+// СРАВНЕНИЕ ЦЕЛОЧИСЛЕННОГО И ПЛАВАЮЩЕГО ВЫВОДА ЧИСЕЛ ДИСПЛЕЯ
+// =============================================================================
+//
+// Прогоняет функции LcdFormat.h по диапазону значений и сравнивает их вывод с
+// прежним путем через double и "%.*f": мм из деци-микронов, дюймы, нитки на
+// дюйм и градусы. Расхождения делятся на два вида: на десятичной половине
+// (0.0045 мм и т.п.), где double хранит число чуть меньше или больше половины
+// и "%.*f" округляет по двоичному значению, и все остальные - их быть не должно.
+// Затем замеряется время обоих путей.
+//
+// Сборка (из корня репозитория):
+//   g++ -std=gnu++17 -O2 -I tools/host -I . tools/format_bench.cpp -o format_bench
+//
+// Запуск:
+//   ./format_bench [-n ПОВТОРОВ] [-v]
+//
+// -v печатает каждое расхождение.
+//
+// Код возврата: 0 - расхождения только на десятичных половинах, 1 - есть другие.
+
+#include <Arduino.h>
+#include <chrono>
+
+#include "LcdFormat.h"
+
+static bool verbose = false;
+
+struct Stats {
+    const char* name;
+    long checked;
+    long ties;          // Расхождения на десятичной половине
+    long mismatches;    // Прочие расхождения
+};
+
+/**
+ * @brief Является ли numerator / denominator ровно половиной последнего знака
+ */
+static bool isTie(int64_t numerator, int64_t denominator) {
+    int64_t remainder = numerator % denominator;
+    if (remainder < 0) {
+        remainder = -remainder;
+    }
+    return remainder * 2 == denominator;
+}
+
+static void compare(Stats& stats, const char* fixed, const char* reference, bool tie, long value, int precision) {
+    stats.checked++;
+    if (strcmp(fixed, reference) == 0) {
+        return;
+    }
+    if (tie) {
+        stats.ties++;
+    } else {
+        stats.mismatches++;
+    }
+    if (verbose || !tie) {
+        printf("%s %ld/%d: целое \"%s\", double \"%s\"%s\n", stats.name, value, precision, fixed, reference,
+               tie ? " (половина)" : "");
+    }
+}
+
+static void report(const Stats& stats) {
+    printf("%-8s проверено %8ld, расхождений на половине %6ld, прочих %ld\n", stats.name, stats.checked,
+           stats.ties, stats.mismatches);
+}
+
+int main(int argc, char** argv) {
+    long repeats = 20;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            repeats = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else {
+            fprintf(stderr, "Использование: %s [-n ПОВТОРОВ] [-v]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    char fixed[LCD_NUMBER_MAX];
+    char reference[64];
+
+    // Мм и градусы: от -20 до 20 мм с шагом 1 деци-микрон и крупные значения
+    Stats mm = {"мм", 0, 0, 0};
+    Stats degrees = {"градусы", 0, 0, 0};
+    for (long du = -200000; du <= 200000; du++) {
+        for (int precision = 0; precision <= 4; precision++) {
+            bool tie = precision < 4 && isTie(du, (int64_t)lcdPow10(4 - precision));
+            formatDeciMicrons(fixed, du, precision);
+            snprintf(reference, sizeof(reference), "%.*f", precision, du / 10000.0);
+            compare(mm, fixed, reference, tie, du, precision);
+            formatDegrees(fixed, du, precision);
+            compare(degrees, fixed, reference, tie, du, precision);
+        }
+    }
+    const long extremes[] = {LONG_MAX, LONG_MIN + 1, 2147483647L, -2147483647L, 9999999995L, 123456789L};
+    for (long du : extremes) {
+        for (int precision = 0; precision <= 4; precision++) {
+            bool tie = precision < 4 && isTie(du, (int64_t)lcdPow10(4 - precision));
+            formatDeciMicrons(fixed, du, precision);
+            snprintf(reference, sizeof(reference), "%.*f", precision, du / 10000.0);
+            // double точно хранит лишь 15-16 значащих цифр
+            if (labs(du) < 1000000000000000L) {
+                compare(mm, fixed, reference, tie, du, precision);
+            }
+        }
+    }
+
+    // Дюймы: от -2 до 2 дюймов с шагом 1 деци-микрон
+    Stats inches = {"дюймы", 0, 0, 0};
+    for (long du = -508000; du <= 508000; du++) {
+        for (int precision = 2; precision <= 4; precision++) {
+            bool tie = isTie((int64_t)du * (int64_t)lcdPow10(precision), LCD_DU_PER_INCH);
+            formatInches(fixed, du, precision);
+            snprintf(reference, sizeof(reference), "%.*f", precision, du / (double)LCD_DU_PER_INCH);
+            compare(inches, fixed, reference, tie, du, precision);
+        }
+    }
+
+    // Нитки на дюйм: шаги от 0.1 до 10 мм в обе стороны
+    Stats tpi = {"TPI", 0, 0, 0};
+    for (long pitch = 1000; pitch <= 100000; pitch++) {
+        for (long sign = -1; sign <= 1; sign += 2) {
+            for (int precision = 0; precision <= 2; precision++) {
+                bool tie = isTie((int64_t)LCD_DU_PER_INCH * (int64_t)lcdPow10(precision), pitch);
+                formatTpi(fixed, sign * pitch, precision);
+                snprintf(reference, sizeof(reference), "%.*f", precision,
+                         (double)LCD_DU_PER_INCH / (sign * pitch));
+                compare(tpi, fixed, reference, tie, sign * pitch, precision);
+            }
+        }
+    }
+
+    // Ширина поля
+    formatDeciMicrons(fixed, -5, 3, 8);
+    if (strcmp(fixed, "  -0.001") != 0) {
+        printf("Ширина поля: \"%s\" вместо \"  -0.001\"\n", fixed);
+        mm.mismatches++;
+    }
+
+    report(mm);
+    report(degrees);
+    report(inches);
+    report(tpi);
+
+    // Время: типичные значения строк дисплея с точностью 3 знака
+    long sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long r = 0; r < repeats; r++) {
+        for (long du = -100000; du <= 100000; du += 7) {
+            sink += formatDeciMicrons(fixed, du, 3);
+        }
+    }
+    double fixedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (long r = 0; r < repeats; r++) {
+        for (long du = -100000; du <= 100000; du += 7) {
+            sink += snprintf(reference, sizeof(reference), "%.*f", 3, du / 10000.0);
+        }
+    }
+    double floatNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (long r = 0; r < repeats; r++) {
+        for (long du = -100000; du <= 100000; du += 7) {
+            sink += String(du / 10000.0, 3).length();
+        }
+    }
+    double stringNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    double calls = repeats * (200000.0 / 7 + 1);
+    printf("formatDeciMicrons  %7.1f нс/вызов\n", fixedNs / calls);
+    printf("snprintf(%%.3f)     %7.1f нс/вызов\n", floatNs / calls);
+    printf("String(double, 3)  %7.1f нс/вызов\n", stringNs / calls);
+    printf("(контрольная сумма %ld)\n", sink);
+
+    bool failed = mm.mismatches + degrees.mismatches + inches.mismatches + tpi.mismatches > 0;
+    return failed ? 1 : 0;
+}
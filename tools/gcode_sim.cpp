@@ -0,0 +1,564 @@
+// =============================================================================
+// СИМУЛЯТОР ПРОГРАММ G-КОДА ДЛЯ РАБОЧЕЙ СТАНЦИИ
+// =============================================================================
+//
+// Прогоняет программу через те же классы, что и прошивка: компилятор G-кода,
+// интерпретатор, MotionController и AxisController с его разгоном и торможением.
+// Время виртуальное, шпиндель вращается с заданными оборотами через модель
+// счетчика импульсов, поэтому время цикла совпадает с временем на станке с
+// точностью до такта задачи движения.
+//
+// Сборка (из корня репозитория):
+//   g++ -std=gnu++17 -O2 -I tools/host -I . tools/gcode_sim.cpp -o gcode_sim
+//
+// Запуск:
+//   ./gcode_sim [-r ОБОРОТЫ] [-c путь.csv] [-s путь.svg] [-t ТАКТ_МКС] [-m МАКС_СЕК] [-l СТРОКА] [-v] программа.nc
+//
+//   ./gcode_sim -k [-t ТАКТ_МКС] [-v]
+//
+// -l СТРОКА продолжает программу с указанной строки, как при вводе номера
+// строки с клавиатуры станка.
+// -k прогоняет встроенные контрольные случаи и сравнивает время их кадров с
+// длиной пути, деленной на подачу.
+//
+// Код возврата: 0 - программа выполнена, 1 - ошибка программы или таймаут,
+// 2 - программа выполнена, но выходила за пределы хода осей. С -k: 0 - все
+// случаи в допуске, 1 - есть случаи вне допуска.
+
+#include <Arduino.h>
+#include <chrono>
+#include <unistd.h>
+#include <vector>
+
+#include "Config.h"
+#include "RussianLogger.h"
+#include "SpindleEncoder.h"
+#include "AxisController.h"
+#include "GCodeReader.h"
+#include "GCodeCompiler.h"
+#include "GCodeInterpreter.h"
+#include "MotionController.h"
+
+RussianLogger Logger;
+
+// Параметры запуска симулятора
+struct SimOptions {
+    const char* programPath = nullptr;  // Файл программы
+    const char* csvPath = nullptr;      // Файл траектории CSV
+    const char* svgPath = nullptr;      // Файл траектории SVG
+    int rpm = 600;                      // Обороты шпинделя
+    long tickUs = 1000;                 // Такт задачи движения (vTaskDelay(1) в прошивке)
+    double maxSeconds = 36000;          // Предел виртуального времени
+    uint32_t startLine = 0;             // Строка продолжения программы (0 - с начала)
+    bool tickSet = false;               // Такт задан ключом -t
+    bool checks = false;                // Прогнать контрольные случаи вместо программы
+    bool verbose = false;               // Выводить журнал прошивки
+};
+
+// Точка траектории
+struct PathPoint {
+    double timeSec;
+    uint32_t line;
+    long zDu;
+    long xDu;
+};
+
+// Выход оси за пределы хода
+struct LimitViolation {
+    char axis;
+    uint32_t line;
+    double timeSec;
+    long positionDu;
+    long limitDu;
+};
+
+// Начало исполнения строки программы
+struct LineStart {
+    uint32_t line;
+    double timeSec;
+};
+
+// Результат прогона программы
+struct SimRun {
+    std::vector<GCodeBlock> blocks;     // Скомпилированные кадры
+    GCodeBounds bounds;                 // Границы перемещений программы
+    std::vector<PathPoint> points;      // Траектория
+    std::vector<LineStart> lineStarts;  // Моменты перехода к следующей строке
+    std::vector<LimitViolation> violations; // Выходы за пределы хода
+    int pauses = 0;                     // Остановок M0/M1
+    double cycleSec = 0;                // Время цикла
+    double wallSec = 0;                 // Реальное время моделирования
+    bool timedOut = false;              // Программа не завершилась за предел времени
+    bool aborted = false;               // Программа прервана ошибкой
+    uint32_t endLine = 0;               // Строка, на которой остановилось исполнение
+    long endZ = 0, endX = 0;            // Конечная позиция в деци-микронах
+};
+
+// Контрольный случай ключа -k: время кадров from..to сравнивается с путем, деленным на подачу
+struct SimCheck {
+    const char* name;                   // Название случая
+    const char* program;                // Текст программы
+    uint32_t fromLine, toLine;          // Проверяемые строки
+    double pathMm;                      // Длина пути проверяемых кадров
+    double feedMmMin;                   // Подача
+    double maxRatio;                    // Наибольшее допустимое отношение времени к пути/F
+};
+
+const long SIM_CHECK_TICK_US = 20;      // Такт контрольных случаев без ключа -t
+const double SIM_CHECK_MIN_RATIO = 0.99; // Кадр не быстрее подачи (с погрешностью дискретизации шагов)
+
+static const SimCheck SIM_CHECKS[] = {
+    // Полуокружность проходится обеими осями: у оси, почти стоящей у края
+    // дуги, скорость не должна падать до единиц шагов в секунду
+    {"дуга G2 180 R10 F200", "G0 X10 Z0\nG2 X10 Z-20 R10 F200\nM30\n", 2, 2, M_PI * 10, 200, 1.1},
+    {"дуга G3 90 R10 F200", "G0 X0 Z0\nG3 X10 Z-10 R10 F200\nM30\n", 2, 2, M_PI * 5, 200, 1.1},
+    {"отрезок G1 20 мм F200", "G0 X10 Z0\nG1 Z-20 F200\nM30\n", 2, 2, 20, 200, 1.1},
+    // Подача ниже начальной скорости оси: ось трогается и тормозит на подаче,
+    // короткие отрезки не проходятся быстрее F
+    {"G61 200x0.1 мм F120", "G0 X10 Z0\nG61\n#1 = 0\nWHILE [#1 LT 200] DO1\n"
+                            "G91 G1 Z-0.1 F120\n#1 = #1 + 1\nEND1\nG90\nM30\n", 5, 7, 20, 120, 1.1},
+    // Подача выше начальной скорости: G61 разгоняется на каждом отрезке,
+    // G64 проходит стыки без остановки, как один отрезок (разгон с места и
+    // торможение занимают около 15% пути)
+    {"G61 200x0.1 мм F600", "G0 X10 Z0\nG61\n#1 = 0\nWHILE [#1 LT 200] DO1\n"
+                            "G91 G1 Z-0.1 F600\n#1 = #1 + 1\nEND1\nG90\nM30\n", 5, 7, 20, 600, 3.0},
+    {"G64 200x0.1 мм F600", "G0 X10 Z0\nG64\n#1 = 0\nWHILE [#1 LT 200] DO1\n"
+                            "G91 G1 Z-0.1 F600\n#1 = #1 + 1\nEND1\nG90\nM30\n", 5, 7, 20, 600, 1.25},
+    {"отрезок G1 20 мм F600", "G0 X10 Z0\nG1 Z-20 F600\nM30\n", 2, 2, 20, 600, 1.25},
+};
+
+// Сравнение двух контрольных случаев: первый должен быть быстрее второго
+struct SimGain {
+    const char* name;                   // Название сравнения
+    const char* fast;                   // Случай, который должен быть быстрее
+    const char* slow;                   // Случай для сравнения
+    double minGain;                     // Наименьшее отношение времени slow к fast
+};
+
+static const SimGain SIM_GAINS[] = {
+    {"G64 быстрее G61 на F600", "G64 200x0.1 мм F600", "G61 200x0.1 мм F600", 1.5},
+};
+
+static void printUsage() {
+    fprintf(stderr, "Использование: gcode_sim [-r ОБОРОТЫ] [-c путь.csv] [-s путь.svg] "
+                    "[-t ТАКТ_МКС] [-m МАКС_СЕК] [-l СТРОКА] [-v] программа.nc\n"
+                    "               gcode_sim -k [-t ТАКТ_МКС] [-v]\n");
+}
+
+static bool parseOptions(int argc, char** argv, SimOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "-r") == 0 && hasValue) {
+            options.rpm = atoi(argv[++i]);
+        } else if (strcmp(arg, "-c") == 0 && hasValue) {
+            options.csvPath = argv[++i];
+        } else if (strcmp(arg, "-s") == 0 && hasValue) {
+            options.svgPath = argv[++i];
+        } else if (strcmp(arg, "-t") == 0 && hasValue) {
+            options.tickUs = max(1L, atol(argv[++i]));
+            options.tickSet = true;
+        } else if (strcmp(arg, "-m") == 0 && hasValue) {
+            options.maxSeconds = atof(argv[++i]);
+        } else if (strcmp(arg, "-l") == 0 && hasValue) {
+            options.startLine = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "-k") == 0) {
+            options.checks = true;
+        } else if (strcmp(arg, "-v") == 0) {
+            options.verbose = true;
+        } else if (arg[0] != '-' && !options.programPath) {
+            options.programPath = arg;
+        } else {
+            return false;
+        }
+    }
+    return options.programPath != nullptr || options.checks;
+}
+
+/**
+ * @brief Компиляция программы тем же компилятором, что и при сохранении на станке
+ * @param path Путь к файлу программы
+ * @param blocks Скомпилированные кадры
+ * @param checkpoints Контрольные точки образа
+ * @param bounds Границы перемещений программы
+ * @return true если программа без ошибок
+ */
+static bool compileProgram(const char* path, std::vector<GCodeBlock>& blocks,
+                           std::vector<GCodeCheckpoint>& checkpoints, GCodeBounds& bounds) {
+    char absolute[PATH_MAX];
+    if (!realpath(path, absolute)) {
+        fprintf(stderr, "Не удалось открыть %s\n", path);
+        return false;
+    }
+    hostFsRoot() = ""; // Пути хостовой LittleFS становятся абсолютными
+
+    GCodeReader reader;
+    if (!reader.open(absolute)) {
+        fprintf(stderr, "Не удалось открыть %s\n", path);
+        return false;
+    }
+
+    GCodeCompiler compiler;
+    GCodeBlock block;
+    GCodeCheckpoint checkpoint;
+    compiler.reset();
+    while (compiler.next(reader, block)) {
+        blocks.push_back(block);
+        if (compiler.takeCheckpoint(checkpoint)) {
+            checkpoints.push_back(checkpoint);
+        }
+    }
+    reader.close();
+    bounds = compiler.getBounds();
+
+    if (compiler.getError() != GCODE_OK) {
+        fprintf(stderr, "%s:%u: %s\n", path, compiler.getErrorLine(),
+                GCodeParser::getErrorText(compiler.getError()));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Проверка, что строка завершает программу (M2/M30 или M99 основной программы)
+ *
+ * Подпрограммы располагаются после M30, поэтому последний кадр образа не
+ * обязательно завершающий.
+ */
+static bool isEndLine(const std::vector<GCodeBlock>& blocks, uint32_t line) {
+    for (const GCodeBlock& block : blocks) {
+        if (block.line == line && (block.command == GCODE_CMD_END || block.command == GCODE_CMD_RETURN)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void writeCsv(const char* path, const std::vector<PathPoint>& points) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Не удалось записать %s\n", path);
+        return;
+    }
+    fprintf(f, "time_s,line,z_mm,x_mm\n");
+    for (const PathPoint& p : points) {
+        fprintf(f, "%.6f,%u,%.4f,%.4f\n", p.timeSec, p.line, p.zDu / 10000.0, p.xDu / 10000.0);
+    }
+    fclose(f);
+}
+
+/**
+ * @brief Запись траектории в SVG: Z по горизонтали, X по вертикали, вид сверху на станок
+ *
+ * Пунктиром показаны пределы хода осей MAX_TRAVEL_MM_*, если они попадают в кадр.
+ */
+static void writeSvg(const char* path, const std::vector<PathPoint>& points) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Не удалось записать %s\n", path);
+        return;
+    }
+
+    double minZ = 0, maxZ = 0, minX = 0, maxX = 0;
+    for (const PathPoint& p : points) {
+        minZ = std::min(minZ, p.zDu / 10000.0);
+        maxZ = std::max(maxZ, p.zDu / 10000.0);
+        minX = std::min(minX, p.xDu / 10000.0);
+        maxX = std::max(maxX, p.xDu / 10000.0);
+    }
+    double margin = std::max(1.0, std::max(maxZ - minZ, maxX - minX) * 0.05);
+    minZ -= margin; maxZ += margin; minX -= margin; maxX += margin;
+
+    fprintf(f, "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"%.4f %.4f %.4f %.4f\">\n",
+            minZ, -maxX, maxZ - minZ, maxX - minX);
+    double stroke = (maxZ - minZ) / 800;
+    fprintf(f, "<g fill=\"none\" stroke-width=\"%.4f\">\n", stroke);
+
+    // Оси координат и пределы хода
+    fprintf(f, "<path stroke=\"#bbb\" d=\"M%.4f 0H%.4fM0 %.4fV%.4f\"/>\n", minZ, maxZ, -maxX, -minX);
+    fprintf(f, "<rect stroke=\"red\" stroke-dasharray=\"%.4f\" x=\"%ld\" y=\"%ld\" width=\"%ld\" height=\"%ld\"/>\n",
+            stroke * 4, -MAX_TRAVEL_MM_Z, -MAX_TRAVEL_MM_X, 2 * MAX_TRAVEL_MM_Z, 2 * MAX_TRAVEL_MM_X);
+
+    fprintf(f, "<polyline stroke=\"blue\" points=\"");
+    for (const PathPoint& p : points) {
+        fprintf(f, "%.4f,%.4f ", p.zDu / 10000.0, -p.xDu / 10000.0);
+    }
+    fprintf(f, "\"/>\n</g>\n</svg>\n");
+    fclose(f);
+}
+
+/**
+ * @brief Прогон программы через объекты прошивки
+ * @param options Параметры запуска
+ * @param run Результат прогона
+ * @return false если программа не скомпилирована или не может быть продолжена со строки
+ */
+static bool runProgram(const SimOptions& options, SimRun& run) {
+    std::vector<GCodeCheckpoint> checkpoints;
+    if (!compileProgram(options.programPath, run.blocks, checkpoints, run.bounds)) {
+        return false;
+    }
+
+    // Продолжение с середины программы - так же, как по номеру строки с клавиатуры
+    GCodeCheckpoint resume;
+    if (options.startLine > 0 &&
+        !GCodeCheckpoint::seek(run.blocks.data(), run.blocks.size(), checkpoints.data(), checkpoints.size(),
+                               options.startLine, resume)) {
+        fprintf(stderr, "%s: со строки %u продолжить нельзя\n", options.programPath, options.startLine);
+        return false;
+    }
+
+    // Те же объекты, что и в main.cpp прошивки
+    SpindleEncoder spindleEncoder;
+    AxisController zAxis(NAME_Z, true, false, MOTOR_STEPS_Z, SCREW_Z_DU, SPEED_START_Z,
+                        SPEED_MANUAL_MOVE_Z, ACCELERATION_Z, INVERT_Z, NEEDS_REST_Z,
+                        MAX_TRAVEL_MM_Z, BACKLASH_DU_Z, Z_ENA, Z_DIR, Z_STEP);
+    AxisController xAxis(NAME_X, true, false, MOTOR_STEPS_X, SCREW_X_DU, SPEED_START_X,
+                        SPEED_MANUAL_MOVE_X, ACCELERATION_X, INVERT_X, NEEDS_REST_X,
+                        MAX_TRAVEL_MM_X, BACKLASH_DU_X, X_ENA, X_DIR, X_STEP);
+    AxisController a1Axis(NAME_A1, false, ROTARY_A1, MOTOR_STEPS_A1, SCREW_A1_DU,
+                         SPEED_START_A1, SPEED_MANUAL_MOVE_A1, ACCELERATION_A1, INVERT_A1,
+                         NEEDS_REST_A1, MAX_TRAVEL_MM_A1, BACKLASH_DU_A1, A11, A12, A13);
+    GCodeInterpreter gcodeInterpreter(zAxis, xAxis, spindleEncoder);
+    MotionController motionController(spindleEncoder, zAxis, xAxis, a1Axis, gcodeInterpreter);
+
+    spindleEncoder.begin();
+    zAxis.begin();
+    xAxis.begin();
+    motionController.begin();
+
+    // Раскрутка шпинделя до заданных оборотов перед запуском программы
+    double pulsesPerTick = (double)options.rpm * ENCODER_STEPS_INT / 60.0 * options.tickUs / 1000000.0;
+    double pulseRemainder = 0;
+    auto spinTick = [&]() {
+        pulseRemainder += pulsesPerTick;
+        int pulses = (int)pulseRemainder;
+        pulseRemainder -= pulses;
+        hostPcntAdd(pulses);
+    };
+    for (long us = 0; us < 1000000; us += options.tickUs) {
+        spinTick();
+        spindleEncoder.update();
+        hostAdvanceMicros(options.tickUs);
+    }
+
+    motionController.setOperationMode(MODE_GCODE);
+    motionController.setEnabled(true);
+    if (gcodeInterpreter.checkProgram(run.bounds)) {
+        gcodeInterpreter.runImage(run.blocks.data(), run.blocks.size(), options.startLine > 0 ? &resume : nullptr);
+    }
+
+    const long limitZ = MAX_TRAVEL_MM_Z * 10000;
+    const long limitX = MAX_TRAVEL_MM_X * 10000;
+    bool outsideZ = false, outsideX = false;
+
+    uint64_t startUs = hostClockUs();
+    uint64_t maxUs = (uint64_t)(options.maxSeconds * 1000000);
+    auto wallStart = std::chrono::steady_clock::now();
+    long lastZ = LONG_MIN, lastX = LONG_MIN;
+    uint32_t lastLine = 0;
+
+    while (!gcodeInterpreter.isFinished()) {
+        uint64_t elapsedUs = hostClockUs() - startUs;
+        if (elapsedUs > maxUs) {
+            run.timedOut = true;
+            break;
+        }
+
+        spinTick();
+        motionController.update();
+
+        // Оператор продолжает программу после M0/M1
+        if (gcodeInterpreter.isPaused()) {
+            run.pauses++;
+            motionController.setEnabled(true);
+        }
+
+        double timeSec = elapsedUs / 1000000.0;
+        uint32_t line = gcodeInterpreter.getCurrentLine();
+        long z = zAxis.getPositionDu();
+        long x = xAxis.getPositionDu();
+        if (line != lastLine) {
+            run.lineStarts.push_back({line, timeSec});
+            lastLine = line;
+        }
+        if (z != lastZ || x != lastX) {
+            run.points.push_back({timeSec, line, z, x});
+            lastZ = z;
+            lastX = x;
+        }
+
+        // Фиксируется каждый выход оси за предел хода (повторно - после возврата)
+        bool zOut = labs(z) > limitZ;
+        bool xOut = labs(x) > limitX;
+        if (zOut && !outsideZ) run.violations.push_back({NAME_Z, line, timeSec, z, limitZ});
+        if (xOut && !outsideX) run.violations.push_back({NAME_X, line, timeSec, x, limitX});
+        outsideZ = zOut;
+        outsideX = xOut;
+
+        hostAdvanceMicros(options.tickUs);
+    }
+
+    run.wallSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    run.cycleSec = (hostClockUs() - startUs) / 1000000.0;
+    run.endLine = gcodeInterpreter.getCurrentLine();
+    run.aborted = !run.timedOut && !isEndLine(run.blocks, run.endLine);
+    run.endZ = zAxis.getPositionDu();
+    run.endX = xAxis.getPositionDu();
+    return true;
+}
+
+/**
+ * @brief Время исполнения кадров с from по to включительно
+ * @return Время в секундах или -1, если кадр from не исполнялся
+ */
+static double blockSeconds(const SimRun& run, uint32_t from, uint32_t to) {
+    double begin = -1;
+    for (const LineStart& start : run.lineStarts) {
+        if (begin < 0 && start.line == from) {
+            begin = start.timeSec;
+        } else if (begin >= 0 && start.line > to) {
+            return start.timeSec - begin;
+        }
+    }
+    return begin < 0 ? -1 : run.cycleSec - begin;
+}
+
+/**
+ * @brief Вывод ячейки таблицы с шириной в символах UTF-8
+ * @param width Ширина, отрицательная - выравнивание влево
+ */
+static void printCell(const char* text, int width) {
+    int length = 0;
+    for (const char* p = text; *p; p++) {
+        length += ((unsigned char)*p & 0xC0) != 0x80;
+    }
+    int pad = max(abs(width) - length, 0);
+    if (width < 0) {
+        printf("%s%*s", text, pad, "");
+    } else {
+        printf("%*s%s", pad, "", text);
+    }
+}
+
+/**
+ * @brief Прогон контрольных случаев (ключ -k)
+ * @param options Параметры запуска (используются обороты и предел времени)
+ * @return 0 если все случаи в допуске, иначе 1
+ *
+ * Время проверяемых кадров сравнивается с длиной пути, деленной на подачу:
+ * быстрее подачи оси идти не должны, а медленнее - не больше чем на запас
+ * на разгон и торможение. Такт задачи движения берется SIM_CHECK_TICK_US,
+ * если не задан ключом -t: при такте 1 мс ось делает не больше одного шага
+ * за такт, и проверялся бы этот предел, а не интерпретатор.
+ */
+static int runChecks(SimOptions options) {
+    if (!options.tickSet) {
+        options.tickUs = SIM_CHECK_TICK_US;
+    }
+    printf("Контрольные случаи, такт %ld мкс\n", options.tickUs);
+    printCell("случай", -26);
+    printCell("время, с", 10);
+    printCell("путь/F, с", 10);
+    printCell("отн.", 7);
+    printf("\n");
+
+    int failed = 0;
+    std::vector<double> results;
+    for (const SimCheck& check : SIM_CHECKS) {
+        char path[] = "/tmp/gcode_sim_XXXXXX.nc";
+        int fd = mkstemps(path, 3);
+        if (fd < 0 || write(fd, check.program, strlen(check.program)) < 0) {
+            fprintf(stderr, "Не удалось записать программу случая %s\n", check.name);
+            return 1;
+        }
+        close(fd);
+
+        options.programPath = path;
+        SimRun run;
+        bool ok = runProgram(options, run) && !run.timedOut && !run.aborted;
+        unlink(path);
+
+        double seconds = ok ? blockSeconds(run, check.fromLine, check.toLine) : -1;
+        double ideal = check.pathMm / (check.feedMmMin / 60.0);
+        double ratio = seconds / ideal;
+        bool pass = seconds > 0 && ratio >= SIM_CHECK_MIN_RATIO && ratio <= check.maxRatio;
+        printCell(check.name, -26);
+        printf("%10.3f%10.3f%7.3f  %s\n", seconds, ideal, ratio, pass ? "ok" : "ОШИБКА");
+        if (!pass) failed++;
+        results.push_back(seconds);
+    }
+
+    // Время случая по названию (-1, если случай не выполнен)
+    auto secondsOf = [&](const char* name) {
+        for (size_t i = 0; i < results.size(); i++) {
+            if (strcmp(SIM_CHECKS[i].name, name) == 0) {
+                return results[i];
+            }
+        }
+        return -1.0;
+    };
+    for (const SimGain& gain : SIM_GAINS) {
+        double fast = secondsOf(gain.fast);
+        double slow = secondsOf(gain.slow);
+        double ratio = fast > 0 && slow > 0 ? slow / fast : 0;
+        bool pass = ratio >= gain.minGain;
+        printCell(gain.name, -26);
+        printf("   x%.2f (не меньше x%.2f)  %s\n", ratio, gain.minGain, pass ? "ok" : "ОШИБКА");
+        if (!pass) failed++;
+    }
+    return failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    SimOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+    Serial.setQuiet(!options.verbose);
+    if (!options.verbose) {
+        Logger.enable(false);
+    }
+    if (options.checks) {
+        return runChecks(options);
+    }
+
+    SimRun run;
+    if (!runProgram(options, run)) {
+        return 1;
+    }
+
+    if (options.csvPath) writeCsv(options.csvPath, run.points);
+    if (options.svgPath) writeSvg(options.svgPath, run.points);
+
+    const GCodeBounds& bounds = run.bounds;
+    printf("Программа: %s, кадров: %zu\n", options.programPath, run.blocks.size());
+    printf("Обороты шпинделя: %d, такт: %ld мкс\n", options.rpm, options.tickUs);
+    if (bounds.hasAxis(GCODE_BOUNDS_AXIS_Z) && bounds.hasAxis(GCODE_BOUNDS_AXIS_X)) {
+        printf("Границы программы: Z %.4f..%.4f мм, X %.4f..%.4f мм%s\n",
+               bounds.low[GCODE_BOUNDS_AXIS_Z] / 10000.0, bounds.high[GCODE_BOUNDS_AXIS_Z] / 10000.0,
+               bounds.low[GCODE_BOUNDS_AXIS_X] / 10000.0, bounds.high[GCODE_BOUNDS_AXIS_X] / 10000.0,
+               (bounds.flags & GCODE_BOUNDS_PARTIAL) ? " (без перемещений, зависящих от исполнения)" : "");
+    }
+    if (run.timedOut) {
+        printf("Таймаут: программа не завершилась за %.0f с (строка %u)\n", options.maxSeconds, run.endLine);
+    } else if (run.aborted) {
+        printf("Программа прервана в строке %u (подробности с ключом -v)\n", run.endLine);
+    } else {
+        printf("Время цикла: %.3f с\n", run.cycleSec);
+    }
+    if (run.pauses > 0) {
+        printf("Остановок M0/M1: %d (не входят в подсчет ожидания оператора)\n", run.pauses);
+    }
+    printf("Конечная позиция: Z %.4f мм, X %.4f мм\n", run.endZ / 10000.0, run.endX / 10000.0);
+    for (const LimitViolation& v : run.violations) {
+        printf("Выход за предел хода: ось %c, строка %u, %.3f с, позиция %.4f мм (предел %.0f мм)\n",
+               v.axis, v.line, v.timeSec, v.positionDu / 10000.0, v.limitDu / 10000.0);
+    }
+    printf("Моделирование: %.3f с реального времени, ускорение x%.0f\n", run.wallSec,
+           run.wallSec > 0 ? run.cycleSec / run.wallSec : 0.0);
+
+    if (run.timedOut || run.aborted) return 1;
+    return run.violations.empty() ? 0 : 2;
+}
@@ -0,0 +1,233 @@
+// =============================================================================
+// ПОТОКОВАЯ ПЕРЕДАЧА ПРОГРАММЫ G-КОДА НА СТАНОК ПО ПОСЛЕДОВАТЕЛЬНОМУ ПОРТУ
+// =============================================================================
+//
+// Отправляет программу построчно с подсчетом символов: в пути держатся строки
+// общей длиной не больше окна (размера буфера приема станка), длина строки
+// освобождается при получении ответа "ok" на нее. Очередь кадров станка при
+// этом не пустеет, а размер программы ограничен только диском хоста.
+// Строки журнала станка, идущие по тому же порту, выводятся в stderr с ключом -v.
+// Ctrl-C посылает станку сброс (0x18), ключ -s запрашивает состояние ('?')
+// с заданным периодом; команды реального времени в окно не входят.
+//
+// Сборка (из корня репозитория):
+//   g++ -std=gnu++17 -O2 -I tools/host -I . tools/gcode_stream.cpp -o gcode_stream
+//
+// Запуск:
+//   ./gcode_stream [-w ОКНО_БАЙТ] [-s ПЕРИОД_МС] [-v] ПОРТ программа.nc
+//   На станке: режим G-кода, источник программы "поток", затем ВКЛ.
+//
+// Код возврата: 0 - вся программа принята, 1 - ошибка в строке, порта или сброс.
+
+#include <Arduino.h>
+#include <deque>
+#include <fcntl.h>
+#include <fstream>
+#include <poll.h>
+#include <signal.h>
+#include <string>
+#include <termios.h>
+#include <vector>
+
+#include "Config.h"
+#include "GCodeParser.h"
+#include "GCodeStreamer.h"
+#include "SerialReceiver.h"
+
+// Параметры передачи
+struct StreamOptions {
+    int window = GCODE_SERIAL_RX_BUFFER;    // Окно подсчета символов
+    bool verbose = false;                   // Выводить журнал станка
+    int statusMs = 0;                       // Период запроса состояния (0 - не запрашивать)
+    const char* port = nullptr;             // Последовательный порт
+    const char* path = nullptr;             // Файл программы
+};
+
+static bool parseOptions(int argc, char** argv, StreamOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "-w") == 0 && hasValue) {
+            options.window = atoi(argv[++i]);
+        } else if (strcmp(arg, "-s") == 0 && hasValue) {
+            options.statusMs = max(0, atoi(argv[++i]));
+        } else if (strcmp(arg, "-v") == 0) {
+            options.verbose = true;
+        } else if (!options.port) {
+            options.port = arg;
+        } else if (!options.path) {
+            options.path = arg;
+        } else {
+            return false;
+        }
+    }
+    return options.port && options.path && options.window >= GCODE_LINE_MAX;
+}
+
+/**
+ * @brief Открытие порта в сыром режиме на скорости прошивки
+ * @param path Путь к устройству порта
+ * @return Дескриптор или -1
+ */
+static int openPort(const char* path) {
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        cfsetspeed(&tio, B115200);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+/**
+ * @brief Текст ошибки по коду ответа "error:N"
+ */
+static const char* getReplyErrorText(int code) {
+    if (code == GCODE_STREAM_ERR_LINE) {
+        return "Строка слишком длинная";
+    }
+    if (code == GCODE_STREAM_ERR_OVERFLOW) {
+        return "Переполнение буфера приема";
+    }
+    if (code == GCODE_STREAM_ERR_FLOW) {
+        return "Переходы доступны только в сохраненной программе";
+    }
+    return GCodeParser::getErrorText(code);
+}
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void onInterrupt(int) {
+    interrupted = 1;
+}
+
+static double elapsedSeconds(const struct timespec& from) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - from.tv_sec) + (now.tv_nsec - from.tv_nsec) / 1e9;
+}
+
+static bool writeAll(int fd, const std::string& data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = write(fd, data.data() + done, data.size() - done);
+        if (n <= 0) {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    StreamOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr, "Использование: gcode_stream [-w ОКНО_БАЙТ] [-s ПЕРИОД_МС] [-v] ПОРТ программа.nc\n");
+        return 1;
+    }
+
+    // Программа читается целиком, чтобы сообщать номера строк в ошибках
+    std::ifstream file(options.path);
+    if (!file) {
+        fprintf(stderr, "Не удалось открыть %s\n", options.path);
+        return 1;
+    }
+    std::vector<std::string> lines;
+    std::string text;
+    while (std::getline(file, text)) {
+        if (!text.empty() && text.back() == '\r') {
+            text.pop_back();
+        }
+        lines.push_back(text);
+    }
+
+    int fd = openPort(options.port);
+    if (fd < 0) {
+        fprintf(stderr, "Не удалось открыть порт %s\n", options.port);
+        return 1;
+    }
+
+    std::deque<int> inFlight;           // Длины отправленных строк без ответа
+    int inFlightBytes = 0;
+    size_t sent = 0;
+    size_t acked = 0;
+    size_t totalBytes = 0;
+    std::string reply;
+    struct timespec startTime;
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    double nextStatus = 0;
+    signal(SIGINT, onInterrupt);
+
+    while (acked < lines.size()) {
+        if (interrupted) {
+            writeAll(fd, std::string(1, (char)SERIAL_RT_RESET));
+            fprintf(stderr, "Сброс, принято строк: %zu из %zu\n", acked, lines.size());
+            return 1;
+        }
+        if (options.statusMs > 0 && elapsedSeconds(startTime) >= nextStatus) {
+            nextStatus += options.statusMs / 1000.0;
+            writeAll(fd, std::string(1, SERIAL_RT_STATUS));
+        }
+
+        // Отправка, пока строки помещаются в окно
+        while (sent < lines.size()) {
+            int length = (int)lines[sent].size() + 1;
+            if (!inFlight.empty() && inFlightBytes + length > options.window) {
+                break;
+            }
+            if (!writeAll(fd, lines[sent] + "\n")) {
+                fprintf(stderr, "Ошибка записи в порт\n");
+                return 1;
+            }
+            inFlight.push_back(length);
+            inFlightBytes += length;
+            totalBytes += length;
+            sent++;
+        }
+
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, options.statusMs > 0 ? min(options.statusMs, 1000) : 1000) <= 0) {
+            continue;
+        }
+        char buffer[256];
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n <= 0) {
+            fprintf(stderr, "Порт закрыт, принято строк: %zu из %zu\n", acked, lines.size());
+            return 1;
+        }
+
+        for (ssize_t i = 0; i < n; i++) {
+            char c = buffer[i];
+            if (c == '\r') {
+                continue;
+            }
+            if (c != '\n') {
+                reply += c;
+                continue;
+            }
+
+            if (reply == "ok" && !inFlight.empty()) {
+                inFlightBytes -= inFlight.front();
+                inFlight.pop_front();
+                acked++;
+            } else if (reply.compare(0, 6, "error:") == 0 && !inFlight.empty()) {
+                int code = atoi(reply.c_str() + 6);
+                fprintf(stderr, "Строка %zu: %s (error:%d)\n  %s\n", acked + 1,
+                        getReplyErrorText(code), code, lines[acked].c_str());
+                return 1;
+            } else if (reply[0] == '<' || (options.verbose && !reply.empty())) {
+                fprintf(stderr, "%s\n", reply.c_str());
+            }
+            reply.clear();
+        }
+    }
+
+    double seconds = elapsedSeconds(startTime);
+    printf("Передано строк: %zu, байт: %zu за %.2f с\n", lines.size(), totalBytes, seconds);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,395 @@
+// =============================================================================
+// ЗАГРУЗКА ПРОГРАММЫ G-КОДА В ХРАНИЛИЩЕ СТАНКА ПО ПОСЛЕДОВАТЕЛЬНОМУ ПОРТУ
+// =============================================================================
+//
+// Передает файл порциями с CRC32 по протоколу GCodeUploader: в пути держатся
+// порции общей длиной не больше окна (размера буфера приема станка), на каждую
+// порцию станок отвечает одной строкой. Испорченная порция передается заново
+// с места, названного станком; если ответы перестали приходить, повторная
+// порция начала загрузки узнает принятое станком место и передача продолжается
+// с него. Программа появляется на станке только после проверки CRC32 всего
+// файла и компиляции.
+// Строки журнала станка, идущие по тому же порту, выводятся в stderr с ключом -v.
+//
+// Сборка (из корня репозитория):
+//   g++ -std=gnu++17 -O2 -I tools/host -I . tools/gcode_upload.cpp -o gcode_upload
+//
+// Запуск:
+//   ./gcode_upload [-n ИМЯ] [-w ОКНО_БАЙТ] [-c ПОРЦИЯ_БАЙТ] [-e N] [-d N] [-g] [-v] ПОРТ программа.nc
+//   -e N портит, а -d N не отправляет в среднем каждую N-ю порцию данных (проверка
+//   повторов; порции выбираются случайно, чтобы порча не совпадала с периодом повторов).
+//   -g отправляет первую порцию начала загрузки без байта начала и с помехой перед ней
+//   (проверка того, что станок отбрасывает байты перед следующей порцией).
+//   На станке система должна быть выключена.
+//
+// Код возврата: 0 - программа сохранена, 1 - ошибка программы, порта или загрузки.
+
+#include <Arduino.h>
+#include <deque>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <poll.h>
+#include <string>
+#include <termios.h>
+#include <vector>
+
+#include "Config.h"
+#include "GCodeParser.h"
+#include "GCodeUploader.h"
+
+// Параметры загрузки
+struct UploadOptions {
+    std::string name;                       // Имя программы на станке (по умолчанию - имя файла)
+    int window = GCODE_SERIAL_RX_BUFFER;    // Окно подсчета байтов
+    int chunk = GCODE_UPLOAD_CHUNK;         // Размер данных в порции
+    int corruptEvery = 0;                   // Портить в среднем каждую N-ю порцию данных
+    int dropEvery = 0;                      // Не отправлять в среднем каждую N-ю порцию данных
+    bool garbleBegin = false;               // Первая порция начала без байта начала, с помехой перед ней
+    bool verbose = false;                   // Выводить журнал станка
+    const char* port = nullptr;             // Последовательный порт
+    const char* path = nullptr;             // Файл программы
+};
+
+// Отправленная порция, ожидающая ответа
+struct InFlight {
+    size_t bytes;                           // Длина порции в порту (с экранированием)
+    int epoch;                              // Номер повтора, при котором порция отправлена
+};
+
+static const double REPLY_TIMEOUT_SEC = 2.0;   // Ожидание ответа перед запросом принятого места
+static const int RETRIES_MAX = 5;              // Запросов подряд без ответа
+
+static bool parseOptions(int argc, char** argv, UploadOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "-n") == 0 && hasValue) {
+            options.name = argv[++i];
+        } else if (strcmp(arg, "-w") == 0 && hasValue) {
+            options.window = atoi(argv[++i]);
+        } else if (strcmp(arg, "-c") == 0 && hasValue) {
+            options.chunk = atoi(argv[++i]);
+        } else if (strcmp(arg, "-e") == 0 && hasValue) {
+            options.corruptEvery = max(0, atoi(argv[++i]));
+        } else if (strcmp(arg, "-d") == 0 && hasValue) {
+            options.dropEvery = max(0, atoi(argv[++i]));
+        } else if (strcmp(arg, "-g") == 0) {
+            options.garbleBegin = true;
+        } else if (strcmp(arg, "-v") == 0) {
+            options.verbose = true;
+        } else if (!options.port) {
+            options.port = arg;
+        } else if (!options.path) {
+            options.path = arg;
+        } else {
+            return false;
+        }
+    }
+    int frameMax = 2 * (GCODE_UPLOAD_HEADER + options.chunk + GCODE_UPLOAD_TRAILER) + 1;
+    return options.port && options.path && options.chunk > 0 && options.chunk <= GCODE_UPLOAD_CHUNK &&
+           options.window >= frameMax && options.corruptEvery != 1 && options.dropEvery != 1;
+}
+
+/**
+ * @brief Открытие порта в сыром режиме на скорости прошивки
+ */
+static int openPort(const char* path) {
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        cfsetspeed(&tio, B115200);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+static bool writeAll(int fd, const std::string& data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = write(fd, data.data() + done, data.size() - done);
+        if (n <= 0) {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+static double nowSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void putU32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out += (char)(value >> (8 * i));
+    }
+}
+
+/**
+ * @brief Сборка порции с экранированием
+ * @param type Тип порции GCODE_UPLOAD_*
+ * @param offset Смещение данных в файле
+ * @param data Данные
+ * @param length Длина данных
+ * @return Байты порции для отправки в порт
+ */
+static std::string encodeFrame(uint8_t type, uint32_t offset, const uint8_t* data, size_t length) {
+    std::string body;
+    body += (char)type;
+    putU32(body, offset);
+    body += (char)(length & 0xFF);
+    body += (char)(length >> 8);
+    body.append((const char*)data, length);
+    putU32(body, GCodeUploader::crc32(0, (const uint8_t*)body.data(), body.size()));
+
+    std::string frame(1, (char)GCODE_UPLOAD_SOF);
+    for (char c : body) {
+        if (GCodeUploader::needsEscape((uint8_t)c)) {
+            frame += (char)GCODE_UPLOAD_ESC;
+            c ^= GCODE_UPLOAD_ESC_XOR;
+        }
+        frame += c;
+    }
+    return frame;
+}
+
+/**
+ * @brief Порция начала загрузки: размер, CRC32 и имя
+ */
+static std::string encodeBegin(uint32_t size, uint32_t crc, const std::string& name) {
+    std::string data;
+    putU32(data, size);
+    putU32(data, crc);
+    data += name;
+    return encodeFrame(GCODE_UPLOAD_BEGIN, 0, (const uint8_t*)data.data(), data.size());
+}
+
+/**
+ * @brief Текст ошибки по коду ответа "error:C"
+ */
+static const char* getReplyErrorText(int code) {
+    switch (code) {
+        case GCODE_UPLOAD_ERR_BUSY: return "Система станка включена";
+        case GCODE_UPLOAD_ERR_STORAGE: return "Нет места в хранилище или ошибка записи";
+        case GCODE_UPLOAD_ERR_SESSION: return "Нарушен порядок загрузки";
+        case GCODE_UPLOAD_ERR_CRC: return "CRC32 файла не совпал";
+    }
+    return GCodeParser::getErrorText(code);
+}
+
+/**
+ * @brief Имя программы по умолчанию: имя файла без каталога и расширения
+ */
+static std::string defaultName(const char* path) {
+    std::string name = path;
+    size_t slash = name.find_last_of('/');
+    if (slash != std::string::npos) {
+        name = name.substr(slash + 1);
+    }
+    size_t dot = name.find_last_of('.');
+    if (dot != std::string::npos && dot > 0) {
+        name = name.substr(0, dot);
+    }
+    return name;
+}
+
+int main(int argc, char** argv) {
+    UploadOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr, "Использование: gcode_upload [-n ИМЯ] [-w ОКНО_БАЙТ] [-c ПОРЦИЯ_БАЙТ] "
+                        "[-e N] [-d N] [-g] [-v] ПОРТ программа.nc\n");
+        return 1;
+    }
+
+    std::ifstream file(options.path, std::ios::binary);
+    if (!file) {
+        fprintf(stderr, "Не удалось открыть %s\n", options.path);
+        return 1;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    uint32_t size = data.size();
+    uint32_t crc = GCodeUploader::crc32(0, data.data(), data.size());
+    std::string name = options.name.empty() ? defaultName(options.path) : options.name;
+    name = name.substr(0, GCODE_NAME_MAX);
+    if (name.empty()) {
+        fprintf(stderr, "Пустое имя программы\n");
+        return 1;
+    }
+
+    int fd = openPort(options.port);
+    if (fd < 0) {
+        fprintf(stderr, "Не удалось открыть порт %s\n", options.port);
+        return 1;
+    }
+
+    std::deque<InFlight> inFlight;      // Порции без ответа в порядке отправки
+    size_t inFlightBytes = 0;
+    uint32_t next = 0;                  // Смещение следующей порции данных
+    uint32_t confirmed = 0;             // Принято станком
+    int epoch = 0;                      // Номер повтора: "resend" на порции прежних повторов не исполняется
+    bool started = false;               // Станок подтвердил начало загрузки
+    bool ending = false;                // Отправлено завершение
+    int retries = 0;
+    long dataFrames = 0;
+    long resends = 0;
+    size_t totalBytes = 0;
+    std::string reply;
+    double startTime = nowSeconds();
+    double lastReply = startTime;
+
+    auto send = [&](const std::string& frame) {
+        if (!writeAll(fd, frame)) {
+            fprintf(stderr, "Ошибка записи в порт\n");
+            exit(1);
+        }
+        inFlight.push_back({frame.size(), epoch});
+        inFlightBytes += frame.size();
+        totalBytes += frame.size();
+    };
+
+    srand(1); // Повторяемая последовательность испорченных порций
+    if (options.garbleBegin) {
+        // Помеха и порция без начала: ответа нет, станок должен отбросить их до повторной порции
+        std::string garbled = "G1 X\xFF\xFE" + encodeBegin(size, crc, name).substr(1);
+        if (!writeAll(fd, garbled)) {
+            fprintf(stderr, "Ошибка записи в порт\n");
+            return 1;
+        }
+        totalBytes += garbled.size();
+    } else {
+        send(encodeBegin(size, crc, name));
+    }
+    while (true) {
+        // Отправка данных, пока порции помещаются в окно
+        while (started && !ending && next < size) {
+            uint32_t length = min((uint32_t)options.chunk, size - next);
+            std::string frame = encodeFrame(GCODE_UPLOAD_DATA, next, data.data() + next, length);
+            if (!inFlight.empty() && inFlightBytes + frame.size() > (size_t)options.window) {
+                break;
+            }
+            dataFrames++;
+            if (options.dropEvery > 0 && rand() % options.dropEvery == 0) {
+                // Потерянная порция: в окне ее нет, ответа на нее не будет
+                totalBytes += frame.size();
+                next += length;
+                continue;
+            }
+            if (options.corruptEvery > 0 && rand() % options.corruptEvery == 0) {
+                frame[frame.size() / 2] ^= 0x40;
+                if (frame[frame.size() / 2] == GCODE_UPLOAD_SOF || frame[frame.size() / 2] == GCODE_UPLOAD_ESC) {
+                    frame[frame.size() / 2] ^= 0x40; // Порча байта служебным значением меняет длину порции
+                    frame[frame.size() - 1] ^= 0x01;
+                }
+            }
+            send(frame);
+            next += length;
+        }
+        if (started && !ending && confirmed == size && inFlight.empty()) {
+            send(encodeFrame(GCODE_UPLOAD_END, size, nullptr, 0));
+            ending = true;
+        }
+
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, 200) <= 0) {
+            if (nowSeconds() - lastReply < REPLY_TIMEOUT_SEC) {
+                continue;
+            }
+            // Ответы не приходят: порция потеряна целиком - запрашиваем принятое место
+            if (++retries > RETRIES_MAX) {
+                fprintf(stderr, "Станок не отвечает, принято байт: %u из %u\n", confirmed, size);
+                return 1;
+            }
+            inFlight.clear();
+            inFlightBytes = 0;
+            epoch++;
+            ending = false;
+            started = false;
+            lastReply = nowSeconds();
+            send(encodeBegin(size, crc, name));
+            continue;
+        }
+        char buffer[256];
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n <= 0) {
+            fprintf(stderr, "Порт закрыт, принято байт: %u из %u\n", confirmed, size);
+            return 1;
+        }
+
+        for (ssize_t i = 0; i < n; i++) {
+            char c = buffer[i];
+            if (c == '\r') {
+                continue;
+            }
+            if (c != '\n') {
+                reply += c;
+                continue;
+            }
+
+            bool answer = reply.compare(0, 3, "ok:") == 0 || reply.compare(0, 7, "resend:") == 0 ||
+                          reply.compare(0, 5, "done:") == 0 || reply.compare(0, 6, "error:") == 0;
+            bool current = true; // Ответ на порцию, отправленную после последнего повтора
+            if (answer) {
+                lastReply = nowSeconds();
+                retries = 0;
+                if (!inFlight.empty()) {
+                    current = inFlight.front().epoch == epoch;
+                    inFlightBytes -= inFlight.front().bytes;
+                    inFlight.pop_front();
+                }
+            }
+
+            if (reply.compare(0, 3, "ok:") == 0) {
+                uint32_t offset = strtoul(reply.c_str() + 3, nullptr, 10);
+                if (!started) {
+                    // Ответ на начало загрузки: передача идет с принятого станком места
+                    started = true;
+                    confirmed = offset;
+                    next = offset;
+                    if (offset > 0) {
+                        printf("Продолжение загрузки с байта %u\n", offset);
+                    }
+                } else if (offset > confirmed) {
+                    confirmed = offset;
+                }
+            } else if (reply.compare(0, 7, "resend:") == 0) {
+                uint32_t offset = strtoul(reply.c_str() + 7, nullptr, 10);
+                if (started && current) {
+                    epoch++;
+                    next = offset;
+                    confirmed = offset;
+                    ending = false;
+                    resends++;
+                }
+            } else if (reply.compare(0, 5, "done:") == 0) {
+                double seconds = nowSeconds() - startTime;
+                printf("Программа %s сохранена под номером %d: %u байт за %.2f с (%.0f байт/с), "
+                       "порций %ld, повторов %ld, передано байт %zu\n",
+                       name.c_str(), atoi(reply.c_str() + 5), size, seconds, size / max(seconds, 1e-3),
+                       dataFrames, resends, totalBytes);
+                close(fd);
+                return 0;
+            } else if (reply.compare(0, 6, "error:") == 0) {
+                int code = atoi(reply.c_str() + 6);
+                size_t lineAt = reply.find(':', 6);
+                if (lineAt != std::string::npos) {
+                    fprintf(stderr, "%s:%s: %s (error:%d)\n", options.path, reply.c_str() + lineAt + 1,
+                            getReplyErrorText(code), code);
+                } else {
+                    fprintf(stderr, "Загрузка отклонена: %s (error:%d)\n", getReplyErrorText(code), code);
+                }
+                close(fd);
+                return 1;
+            } else if (options.verbose && !reply.empty()) {
+                fprintf(stderr, "%s\n", reply.c_str());
+            }
+            reply.clear();
+        }
+    }
+}
@@ -0,0 +1,136 @@
+#ifndef HOST_ADAFRUIT_TCA8418_H
+#define HOST_ADAFRUIT_TCA8418_H
+
+// Хостовая модель контроллера клавиатуры TCA8418 с интерфейсом библиотеки
+// Adafruit. Нажатия и отпускания подает утилита через hostKey(): событие
+// попадает в очередь, взводит K_INT и опускает линию INT, если прерывания
+// разрешены. Каждое обращение к регистру занимает HOST_TCA8418_I2C_US
+// виртуального времени, как транзакция на шине 400 кГц.
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define TCA8418_DEFAULT_ADDR 0x34
+#define TCA8418_REG_CFG 0x01
+#define TCA8418_REG_INT_STAT 0x02
+#define TCA8418_REG_KEY_LCK_EC 0x03
+
+#define HOST_TCA8418_FIFO 10            // Глубина очереди событий
+#define HOST_TCA8418_I2C_US 90          // Чтение или запись регистра (адрес, регистр, данные)
+#define HOST_TCA8418_CFG_KE_IEN 0x01    // Прерывание по событию клавиши
+#define HOST_TCA8418_INT_K 0x01         // K_INT: в очереди есть события
+#define HOST_TCA8418_INT_OVF 0x08       // OVR_FLOW_INT: очередь переполнялась
+
+class Adafruit_TCA8418 {
+private:
+    uint8_t fifo[HOST_TCA8418_FIFO];
+    int head;                           // Самое старое событие
+    int count;                          // Событий в очереди
+    uint8_t config;                     // Регистр CFG
+    uint8_t intStat;                    // Регистр INT_STAT
+    int intPin;                         // Вывод, к которому подключен INT (-1 - не подключен)
+
+public:
+    Adafruit_TCA8418() : head(0), count(0), config(0), intStat(0), intPin(-1) {}
+
+    bool begin(uint8_t = TCA8418_DEFAULT_ADDR, TwoWire* = &Wire) {
+        transaction();
+        return true;
+    }
+
+    bool matrix(uint8_t, uint8_t) {
+        transaction();
+        return true;
+    }
+
+    void flush() {
+        while (getEvent() != 0) {
+        }
+        writeRegister(TCA8418_REG_INT_STAT, HOST_TCA8418_INT_K | HOST_TCA8418_INT_OVF);
+    }
+
+    uint8_t available() {
+        return readRegister(TCA8418_REG_KEY_LCK_EC) & 0x0F;
+    }
+
+    uint8_t getEvent() {
+        transaction();
+        if (count == 0) {
+            return 0;
+        }
+        uint8_t event = fifo[head];
+        head = (head + 1) % HOST_TCA8418_FIFO;
+        count--;
+        return event;
+    }
+
+    void enableInterrupts() {
+        writeRegister(TCA8418_REG_CFG, config | HOST_TCA8418_CFG_KE_IEN);
+    }
+
+    uint8_t readRegister(uint8_t reg) {
+        transaction();
+        switch (reg) {
+            case TCA8418_REG_CFG: return config;
+            case TCA8418_REG_INT_STAT: return intStat;
+            case TCA8418_REG_KEY_LCK_EC: return (uint8_t)count;
+            default: return 0;
+        }
+    }
+
+    void writeRegister(uint8_t reg, uint8_t value) {
+        transaction();
+        if (reg == TCA8418_REG_CFG) {
+            config = value;
+        } else if (reg == TCA8418_REG_INT_STAT) {
+            intStat &= ~value; // Биты сбрасываются записью единицы
+        }
+        updateInt();
+    }
+
+    /**
+     * @brief Подключение линии INT к выводу (в покое подтянута к питанию)
+     */
+    void hostConnectInt(int pin) {
+        intPin = pin;
+        hostDriveInput(intPin, 1);
+        updateInt();
+    }
+
+    /**
+     * @brief Событие клавиши после подавления дребезга
+     * @param keyCode Код кнопки
+     * @param press true - нажатие, false - отпускание
+     * @return false если очередь полна и событие потеряно
+     */
+    bool hostKey(int keyCode, bool press) {
+        if (count >= HOST_TCA8418_FIFO) {
+            intStat |= HOST_TCA8418_INT_OVF;
+            updateInt();
+            return false;
+        }
+        fifo[(head + count) % HOST_TCA8418_FIFO] = (uint8_t)(keyCode | (press ? 0x80 : 0));
+        count++;
+        intStat |= HOST_TCA8418_INT_K;
+        updateInt();
+        return true;
+    }
+
+private:
+    void transaction() {
+        hostAdvanceMicros(HOST_TCA8418_I2C_US);
+    }
+
+    /**
+     * @brief Уровень INT: низкий, пока взведен разрешенный флаг прерывания
+     */
+    void updateInt() {
+        if (intPin < 0) {
+            return;
+        }
+        bool active = (config & HOST_TCA8418_CFG_KE_IEN) && (intStat & (HOST_TCA8418_INT_K | HOST_TCA8418_INT_OVF));
+        hostDriveInput(intPin, active ? 0 : 1);
+    }
+};
+
+#endif // HOST_ADAFRUIT_TCA8418_H
@@ -0,0 +1,248 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// =============================================================================
+// ХОСТОВАЯ РЕАЛИЗАЦИЯ ARDUINO API ДЛЯ СБОРКИ ЗАГОЛОВКОВ ПРОШИВКИ ПОД LINUX
+// =============================================================================
+//
+// Позволяет собрать классы прошивки (оси, интерпретатор G-кода, дисплей) в
+// утилитах командной строки. Время виртуальное: его продвигает сама утилита
+// через hostAdvanceMicros(), поэтому моделирование идет быстрее реального.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <limits.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+
+using std::max;
+using std::min;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define LED_BUILTIN 48
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define PI 3.1415926535897932384626433832795
+#define sq(x) ((x) * (x))
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+
+#define B00000 0
+#define B00100 4
+#define B01110 14
+#define B10101 21
+#define B11010 26
+#define B11111 31
+
+// Виртуальное время в микросекундах
+inline uint64_t& hostClockUs() {
+    static uint64_t clockUs = 0;
+    return clockUs;
+}
+
+inline void hostAdvanceMicros(uint64_t us) { hostClockUs() += us; }
+inline unsigned long micros() { return (unsigned long)hostClockUs(); }
+inline unsigned long millis() { return (unsigned long)(hostClockUs() / 1000); }
+inline void delay(unsigned long ms) { hostAdvanceMicros((uint64_t)ms * 1000); }
+inline void delayMicroseconds(unsigned int us) { hostAdvanceMicros(us); }
+inline void yield() {}
+
+// Состояние выводов хранится для утилит, которые считают шаги по фронтам
+inline uint8_t* hostPins() {
+    static uint8_t pins[64];
+    return pins;
+}
+
+inline void pinMode(int, int) {}
+inline void digitalWrite(int pin, int value) { hostPins()[pin & 63] = value ? 1 : 0; }
+inline int digitalRead(int pin) { return hostPins()[pin & 63]; }
+
+// Прерывания по выводам: обработчик вызывается, когда модель внешнего
+// устройства меняет уровень входа через hostDriveInput()
+#define IRAM_ATTR
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+struct HostInterrupt {
+    void (*handler)(void*) = nullptr;
+    void* arg = nullptr;
+    int mode = 0;
+};
+
+inline HostInterrupt* hostInterrupts() {
+    static HostInterrupt interrupts[64];
+    return interrupts;
+}
+
+inline int digitalPinToInterrupt(int pin) { return pin; }
+
+inline void attachInterruptArg(int pin, void (*handler)(void*), void* arg, int mode) {
+    HostInterrupt& irq = hostInterrupts()[pin & 63];
+    irq.handler = handler;
+    irq.arg = arg;
+    irq.mode = mode;
+}
+
+inline void detachInterrupt(int pin) { hostInterrupts()[pin & 63].handler = nullptr; }
+
+inline void hostDriveInput(int pin, int value) {
+    uint8_t before = hostPins()[pin & 63];
+    uint8_t after = value ? 1 : 0;
+    hostPins()[pin & 63] = after;
+    const HostInterrupt& irq = hostInterrupts()[pin & 63];
+    bool edge = after ? (irq.mode & RISING) != 0 : (irq.mode & FALLING) != 0;
+    if (irq.handler && before != after && edge) {
+        irq.handler(irq.arg);
+    }
+}
+
+/**
+ * @class String
+ * @brief Минимальная совместимая со строками Arduino обертка над std::string
+ */
+class String {
+private:
+    std::string s;
+
+public:
+    String() {}
+    String(const char* str) : s(str ? str : "") {}
+    String(const std::string& str) : s(str) {}
+    String(char c) : s(1, c) {}
+    String(int v) : s(std::to_string(v)) {}
+    String(unsigned int v) : s(std::to_string(v)) {}
+    String(long v) : s(std::to_string(v)) {}
+    String(unsigned long v) : s(std::to_string(v)) {}
+    String(long long v) : s(std::to_string(v)) {}
+    String(unsigned long long v) : s(std::to_string(v)) {}
+    String(double v, int digits = 2) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%.*f", digits, v);
+        s = buf;
+    }
+
+    unsigned int length() const { return s.length(); }
+    const char* c_str() const { return s.c_str(); }
+    void reserve(unsigned int size) { s.reserve(size); }
+    int indexOf(char c) const {
+        size_t p = s.find(c);
+        return p == std::string::npos ? -1 : (int)p;
+    }
+    String substring(unsigned int from) const { return String(s.substr(std::min<size_t>(from, s.size()))); }
+    String substring(unsigned int from, unsigned int to) const {
+        from = std::min<size_t>(from, s.size());
+        return String(s.substr(from, to > from ? to - from : 0));
+    }
+
+    String& operator+=(const String& other) { s += other.s; return *this; }
+    String& operator+=(const char* other) { s += other; return *this; }
+    String& operator+=(char c) { s += c; return *this; }
+    bool operator==(const String& other) const { return s == other.s; }
+    bool operator!=(const String& other) const { return s != other.s; }
+
+    friend String operator+(const String& a, const String& b) { return String(a.s + b.s); }
+    friend String operator+(const String& a, const char* b) { return String(a.s + b); }
+    friend String operator+(const char* a, const String& b) { return String(a + b.s); }
+};
+
+/**
+ * @class HostSerial
+ * @brief Последовательный порт на файловых дескрипторах (по умолчанию stdin/stderr)
+ *
+ * Утилиты могут подключить порт к псевдотерминалу через attach().
+ */
+class HostSerial {
+private:
+    int inFd;
+    int outFd;
+    bool quiet;
+
+public:
+    HostSerial() : inFd(-1), outFd(2), quiet(false) {}
+
+    void attach(int in, int out) { inFd = in; outFd = out; }
+    void setQuiet(bool q) { quiet = q; }
+
+    void begin(unsigned long) {}
+    void setRxBufferSize(size_t) {}
+    operator bool() const { return true; }
+
+    int available() {
+        if (inFd < 0) return 0;
+        int n = 0;
+        return ioctlAvailable(n) ? n : 0;
+    }
+    int read() {
+        unsigned char c;
+        if (inFd < 0 || ::read(inFd, &c, 1) != 1) return -1;
+        return c;
+    }
+    size_t write(uint8_t c) { return writeRaw(&c, 1); }
+    size_t write(const uint8_t* data, size_t len) { return writeRaw(data, len); }
+    size_t print(const String& str) { return writeRaw(str.c_str(), str.length()); }
+    size_t print(const char* str) { return writeRaw(str, strlen(str)); }
+    size_t print(long v) { return print(String(v)); }
+    size_t println(const String& str) { return print(str) + print("\n"); }
+    size_t println(const char* str) { return print(str) + print("\n"); }
+    size_t println() { return print("\n"); }
+    void flush() {}
+
+private:
+    bool ioctlAvailable(int& n);
+    size_t writeRaw(const void* data, size_t len) {
+        if (quiet || outFd < 0) return len;
+        ssize_t written = ::write(outFd, data, len);
+        return written < 0 ? 0 : (size_t)written;
+    }
+};
+
+#include <sys/ioctl.h>
+inline bool HostSerial::ioctlAvailable(int& n) { return ioctl(inFd, FIONREAD, &n) == 0; }
+
+inline HostSerial& hostSerial() {
+    static HostSerial serial;
+    return serial;
+}
+#define Serial hostSerial()
+
+/**
+ * @class HostEsp
+ * @brief Сведения о кристалле (на хосте - размеры кучи ESP32-S3 без нагрузки)
+ */
+class HostEsp {
+private:
+    uint32_t cycleCalls = 0;
+
+public:
+    uint32_t getFreeHeap() const { return 320 * 1024; }
+    uint32_t getMinFreeHeap() const { return 320 * 1024; }
+
+    // Такты 240 МГц по виртуальному времени; каждый вызов добавляет такт, чтобы
+    // ожидание в тактах завершалось без продвижения времени
+    uint32_t getCycleCount() { return (uint32_t)(hostClockUs() * 240) + ++cycleCalls; }
+};
+
+inline HostEsp& hostEsp() {
+    static HostEsp esp;
+    return esp;
+}
+#define ESP hostEsp()
+
+#endif // HOST_ARDUINO_H
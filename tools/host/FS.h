@@ -0,0 +1,43 @@
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+// Хостовая реализация файлов Arduino FS поверх stdio
+
+#include <Arduino.h>
+#include <memory>
+
+/**
+ * @class File
+ * @brief Копируемый дескриптор файла, как fs::File в Arduino
+ */
+class File {
+private:
+    std::shared_ptr<FILE> fp;
+
+public:
+    File() {}
+    explicit File(FILE* f) : fp(f, [](FILE* p) { if (p) fclose(p); }) {}
+
+    operator bool() const { return (bool)fp; }
+    size_t read(uint8_t* buf, size_t size) { return fp ? fread(buf, 1, size, fp.get()) : 0; }
+    int read() {
+        uint8_t c;
+        return read(&c, 1) == 1 ? c : -1;
+    }
+    size_t write(const uint8_t* buf, size_t size) { return fp ? fwrite(buf, 1, size, fp.get()) : 0; }
+    size_t write(uint8_t c) { return write(&c, 1); }
+    bool seek(uint32_t pos) { return fp && fseek(fp.get(), pos, SEEK_SET) == 0; }
+    size_t position() const { return fp ? ftell(fp.get()) : 0; }
+    size_t size() const {
+        if (!fp) return 0;
+        long pos = ftell(fp.get());
+        fseek(fp.get(), 0, SEEK_END);
+        long end = ftell(fp.get());
+        fseek(fp.get(), pos, SEEK_SET);
+        return end;
+    }
+    void flush() { if (fp) fflush(fp.get()); }
+    void close() { fp.reset(); }
+};
+
+#endif // HOST_FS_H
@@ -0,0 +1,210 @@
+#ifndef HOST_LCD_H
+#define HOST_LCD_H
+
+// Хостовая модель контроллера HD44780 на 8-битной шине. Подключается к тем же
+// выводам, что и LcdParallel, и принимает байты по спаду строба E из записей в
+// регистры GPIO (soc/gpio_reg.h). Хранит DDRAM и CGRAM, считает команды, записи
+// данных и время выполнения на шине, а также передачи, пришедшие раньше, чем
+// контроллер закончил предыдущую команду.
+
+#include <Arduino.h>
+#include <soc/gpio_reg.h>
+#include "LcdGlyphs.h"
+
+#define HOST_LCD_COLS 20
+#define HOST_LCD_ROWS 4
+#define HOST_LCD_EXEC_US 37             // Время выполнения команды по datasheet
+#define HOST_LCD_CLEAR_US 1520          // Очистка экрана и возврат курсора
+
+// Счетчики шины
+struct HostLcdStats {
+    unsigned long commands;             // Команды (RS = 0)
+    unsigned long cursorMoves;          // Из них установок адреса DDRAM
+    unsigned long dataWrites;           // Записи данных (RS = 1)
+    unsigned long cgramWrites;          // Из них в CGRAM
+    unsigned long busUs;                // Время выполнения всех передач контроллером
+    unsigned long busyViolations;       // Передачи до окончания предыдущей команды
+};
+
+class HostLcd {
+private:
+    uint8_t rsPin;
+    uint8_t enablePin;
+    uint8_t dataPins[8];
+    uint8_t lastEnable;
+
+    uint8_t ddram[128];
+    uint8_t cgram[64];
+    uint8_t address;                    // Счетчик адреса
+    bool cgramMode;                     // Счетчик адреса указывает в CGRAM
+    bool displayOn;
+    uint64_t busyUntilUs;               // Окончание выполнения предыдущей команды
+
+    HostLcdStats stats;
+
+public:
+    /**
+     * @brief Модель на выводах в порядке конструктора LcdParallel
+     */
+    HostLcd(uint8_t rs, uint8_t enable, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3,
+            uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7)
+        : rsPin(rs), enablePin(enable), lastEnable(0), address(0), cgramMode(false),
+          displayOn(false), busyUntilUs(0) {
+        const uint8_t pins[8] = {d0, d1, d2, d3, d4, d5, d6, d7};
+        memcpy(dataPins, pins, sizeof(dataPins));
+        memset(ddram, ' ', sizeof(ddram));
+        memset(cgram, 0, sizeof(cgram));
+        resetStats();
+        hostGpioHook().listener = onPins;
+        hostGpioHook().context = this;
+    }
+
+    ~HostLcd() {
+        if (hostGpioHook().context == this) {
+            hostGpioHook().listener = nullptr;
+            hostGpioHook().context = nullptr;
+        }
+    }
+
+    const HostLcdStats& getStats() const { return stats; }
+    void resetStats() { memset(&stats, 0, sizeof(stats)); }
+    bool isDisplayOn() const { return displayOn; }
+
+    /**
+     * @brief Код знакоместа
+     */
+    uint8_t getCell(int col, int row) const {
+        return ddram[rowAddress(row) + col];
+    }
+
+    /**
+     * @brief Строка дисплея в UTF-8
+     * @param row Строка
+     * @param out Буфер (символ занимает до 3 байт)
+     * @param size Размер буфера
+     *
+     * Пользовательские символы узнаются по рисунку в LcdGlyphs, неизвестный рисунок
+     * выводится как '#'.
+     */
+    void rowText(int row, char* out, size_t size) const {
+        size_t length = 0;
+        for (int col = 0; col < HOST_LCD_COLS; col++) {
+            char symbol[4];
+            int n = encodeUtf8(cellCode(getCell(col, row)), symbol);
+            if (length + n >= size) {
+                break;
+            }
+            memcpy(out + length, symbol, n);
+            length += n;
+        }
+        out[length] = '\0';
+    }
+
+private:
+    static int rowAddress(int row) {
+        static const uint8_t offsets[HOST_LCD_ROWS] = {0x00, 0x40, 0x14, 0x54};
+        return offsets[row];
+    }
+
+    static void onPins(void* context) {
+        static_cast<HostLcd*>(context)->sample();
+    }
+
+    void sample() {
+        uint8_t enable = hostPins()[enablePin];
+        if (lastEnable && !enable) {
+            uint8_t value = 0;
+            for (int i = 0; i < 8; i++) {
+                value |= hostPins()[dataPins[i]] << i;
+            }
+            transfer(hostPins()[rsPin] != 0, value);
+        }
+        lastEnable = enable;
+    }
+
+    /**
+     * @brief Прием байта по спаду строба
+     */
+    void transfer(bool data, uint8_t value) {
+        uint64_t now = hostClockUs();
+        if (now < busyUntilUs) {
+            stats.busyViolations++;
+        }
+        unsigned long execUs = HOST_LCD_EXEC_US;
+
+        if (data) {
+            stats.dataWrites++;
+            if (cgramMode) {
+                stats.cgramWrites++;
+                cgram[address & 0x3F] = value & 0x1F;
+                address = (address + 1) & 0x3F;
+            } else {
+                ddram[address & 0x7F] = value;
+                address = (address + 1) & 0x7F;
+            }
+        } else {
+            stats.commands++;
+            if (value & 0x80) {
+                stats.cursorMoves++;
+                address = value & 0x7F;
+                cgramMode = false;
+            } else if (value & 0x40) {
+                address = value & 0x3F;
+                cgramMode = true;
+            } else if (value & 0x08) {
+                displayOn = (value & 0x04) != 0;
+            } else if (value == 0x01) {
+                memset(ddram, ' ', sizeof(ddram));
+                address = 0;
+                cgramMode = false;
+                execUs = HOST_LCD_CLEAR_US;
+            } else if ((value & 0xFE) == 0x02) {
+                address = 0;
+                cgramMode = false;
+                execUs = HOST_LCD_CLEAR_US;
+            }
+        }
+
+        stats.busUs += execUs;
+        busyUntilUs = now + execUs;
+    }
+
+    /**
+     * @brief Код Unicode для кода знакогенератора
+     */
+    uint16_t cellCode(uint8_t value) const {
+        if (value < 16) {
+            const uint8_t* bitmap = cgram + (value & 0x07) * 8;
+            for (const LcdGlyph& glyph : LCD_GLYPHS) {
+                if (glyph.custom && memcmp(glyph.bitmap, bitmap, 8) == 0) {
+                    return glyph.code;
+                }
+            }
+            return '#';
+        }
+        switch (value) {
+            case 0x5C: return 0x00A5;   // Знакогенератор A00: ¥ вместо обратной косой
+            case 0x7E: return 0x2192;   // →
+            case 0x7F: return 0x2190;   // ←
+        }
+        return value >= 0x20 && value < 0x80 ? value : '?';
+    }
+
+    static int encodeUtf8(uint16_t code, char* out) {
+        if (code < 0x80) {
+            out[0] = (char)code;
+            return 1;
+        }
+        if (code < 0x800) {
+            out[0] = (char)(0xC0 | (code >> 6));
+            out[1] = (char)(0x80 | (code & 0x3F));
+            return 2;
+        }
+        out[0] = (char)(0xE0 | (code >> 12));
+        out[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (code & 0x3F));
+        return 3;
+    }
+};
+
+#endif // HOST_LCD_H
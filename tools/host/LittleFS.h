@@ -0,0 +1,49 @@
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+// Хостовая LittleFS: файловая система раздела отображается на каталог Linux
+// (по умолчанию текущий, задается hostFsRoot()).
+
+#include <FS.h>
+#include <sys/stat.h>
+
+inline std::string& hostFsRoot() {
+    static std::string root = ".";
+    return root;
+}
+
+class HostLittleFS {
+public:
+    bool begin(bool = false, const char* = "/littlefs", uint8_t = 10, const char* = "spiffs") {
+        ::mkdir(hostFsRoot().c_str(), 0755);
+        return true;
+    }
+    File open(const char* path, const char* mode) { return File(fopen(full(path).c_str(), hostMode(mode))); }
+    bool exists(const char* path) {
+        struct stat st;
+        return stat(full(path).c_str(), &st) == 0;
+    }
+    bool mkdir(const char* path) { return ::mkdir(full(path).c_str(), 0755) == 0; }
+    bool remove(const char* path) { return ::remove(full(path).c_str()) == 0; }
+    bool rename(const char* from, const char* to) { return ::rename(full(from).c_str(), full(to).c_str()) == 0; }
+    size_t totalBytes() { return 1024 * 1024; }
+    size_t usedBytes() { return 0; }
+
+private:
+    static std::string full(const char* path) { return hostFsRoot() + path; }
+    static const char* hostMode(const char* mode) {
+        if (strcmp(mode, "r") == 0) return "rb";
+        if (strcmp(mode, "w") == 0) return "wb";
+        if (strcmp(mode, "a") == 0) return "ab";
+        if (strcmp(mode, "r+") == 0) return "r+b";
+        return mode;
+    }
+};
+
+inline HostLittleFS& hostLittleFS() {
+    static HostLittleFS fs;
+    return fs;
+}
+#define LittleFS hostLittleFS()
+
+#endif // HOST_LITTLEFS_H
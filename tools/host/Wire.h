@@ -0,0 +1,21 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+// Хостовая шина I2C: устройства на шине моделируются отдельно (например,
+// Adafruit_TCA8418.h), сама шина только принимает настройки.
+
+#include <Arduino.h>
+
+class TwoWire {
+public:
+    bool begin(int = -1, int = -1, uint32_t = 0) { return true; }
+    void setClock(uint32_t) {}
+};
+
+inline TwoWire& hostWire() {
+    static TwoWire wire;
+    return wire;
+}
+#define Wire hostWire()
+
+#endif // HOST_WIRE_H
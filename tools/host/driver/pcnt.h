@@ -0,0 +1,51 @@
+#ifndef HOST_DRIVER_PCNT_H
+#define HOST_DRIVER_PCNT_H
+
+// Хостовая модель счетчика импульсов ESP32: утилита задает импульсы энкодера
+// шпинделя через hostPcntAdd(), имитируя вращение с нужными оборотами.
+
+#include <Arduino.h>
+
+typedef int pcnt_unit_t;
+typedef int pcnt_channel_t;
+typedef int pcnt_count_mode_t;
+typedef int pcnt_ctrl_mode_t;
+typedef int esp_err_t;
+
+#define PCNT_UNIT_0 0
+#define PCNT_CHANNEL_0 0
+#define PCNT_COUNT_INC 1
+#define PCNT_COUNT_DEC 2
+#define PCNT_MODE_KEEP 0
+#define PCNT_MODE_REVERSE 1
+#define ESP_OK 0
+
+typedef struct {
+    int pulse_gpio_num;
+    int ctrl_gpio_num;
+    pcnt_ctrl_mode_t lctrl_mode;
+    pcnt_ctrl_mode_t hctrl_mode;
+    pcnt_count_mode_t pos_mode;
+    pcnt_count_mode_t neg_mode;
+    int16_t counter_h_lim;
+    int16_t counter_l_lim;
+    pcnt_unit_t unit;
+    pcnt_channel_t channel;
+} pcnt_config_t;
+
+inline int16_t& hostPcntCounter() {
+    static int16_t counter = 0;
+    return counter;
+}
+
+inline void hostPcntAdd(int delta) { hostPcntCounter() += delta; }
+
+inline esp_err_t pcnt_unit_config(const pcnt_config_t*) { return ESP_OK; }
+inline esp_err_t pcnt_set_filter_value(pcnt_unit_t, uint16_t) { return ESP_OK; }
+inline esp_err_t pcnt_filter_enable(pcnt_unit_t) { return ESP_OK; }
+inline esp_err_t pcnt_counter_pause(pcnt_unit_t) { return ESP_OK; }
+inline esp_err_t pcnt_counter_resume(pcnt_unit_t) { return ESP_OK; }
+inline esp_err_t pcnt_counter_clear(pcnt_unit_t) { hostPcntCounter() = 0; return ESP_OK; }
+inline esp_err_t pcnt_get_counter_value(pcnt_unit_t, int16_t* count) { *count = hostPcntCounter(); return ESP_OK; }
+
+#endif // HOST_DRIVER_PCNT_H
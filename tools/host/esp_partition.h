@@ -0,0 +1,93 @@
+#ifndef HOST_ESP_PARTITION_H
+#define HOST_ESP_PARTITION_H
+
+// Хостовые разделы флеш-памяти: каждый раздел данных - файл "<метка>.part"
+// в каталоге hostFsRoot(), отображаемый в память через mmap. Размеры разделов
+// совпадают с partitions.csv, поэтому образы программ переносимы между запусками.
+
+#include <LittleFS.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+
+typedef enum {
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef int esp_partition_subtype_t;
+#define ESP_PARTITION_SUBTYPE_ANY 0xff
+
+typedef enum {
+    SPI_FLASH_MMAP_DATA,
+    SPI_FLASH_MMAP_INST,
+} spi_flash_mmap_memory_t;
+
+typedef uint32_t spi_flash_mmap_handle_t;
+
+typedef struct {
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+    uint8_t* data;          // Содержимое раздела, отображенное из файла
+} esp_partition_t;
+
+inline const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t,
+                                                       const char* label) {
+    static esp_partition_t gcode = {ESP_PARTITION_TYPE_DATA, 0x40, 0x310000, 0xE0000, "gcode", nullptr};
+    if (type != ESP_PARTITION_TYPE_DATA || !label || strcmp(label, gcode.label) != 0) {
+        return nullptr;
+    }
+    if (!gcode.data) {
+        std::string path = hostFsRoot() + "/" + gcode.label + ".part";
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0 || ftruncate(fd, gcode.size) != 0) {
+            return nullptr;
+        }
+        void* mapped = mmap(nullptr, gcode.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            return nullptr;
+        }
+        gcode.data = (uint8_t*)mapped;
+    }
+    return &gcode;
+}
+
+inline esp_err_t esp_partition_mmap(const esp_partition_t* part, size_t offset, size_t size,
+                                    spi_flash_mmap_memory_t, const void** out, spi_flash_mmap_handle_t* handle) {
+    if (offset + size > part->size) return ESP_ERR_INVALID_ARG;
+    *out = part->data + offset;
+    *handle = 1;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_partition_erase_range(const esp_partition_t* part, size_t offset, size_t size) {
+    if (offset % 4096 || size % 4096 || offset + size > part->size) return ESP_ERR_INVALID_ARG;
+    memset(part->data + offset, 0xFF, size);
+    return ESP_OK;
+}
+
+inline esp_err_t esp_partition_write(const esp_partition_t* part, size_t offset, const void* src, size_t size) {
+    if (offset + size > part->size) return ESP_ERR_INVALID_ARG;
+    // NOR-флеш при записи только сбрасывает биты
+    const uint8_t* bytes = (const uint8_t*)src;
+    for (size_t i = 0; i < size; i++) {
+        part->data[offset + i] &= bytes[i];
+    }
+    return ESP_OK;
+}
+
+inline esp_err_t esp_partition_read(const esp_partition_t* part, size_t offset, void* dst, size_t size) {
+    if (offset + size > part->size) return ESP_ERR_INVALID_ARG;
+    memcpy(dst, part->data + offset, size);
+    return ESP_OK;
+}
+
+#endif // HOST_ESP_PARTITION_H
@@ -0,0 +1,22 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+// Однопоточная хостовая реализация примитивов FreeRTOS, используемых прошивкой.
+// Задачи не создаются: утилита сама вызывает циклы задач по очереди.
+
+#include <Arduino.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffffUL
+#define portTICK_PERIOD_MS 1
+#define portYIELD_FROM_ISR()
+
+inline TickType_t xTaskGetTickCount() { return (TickType_t)millis(); }
+
+#endif // HOST_FREERTOS_H
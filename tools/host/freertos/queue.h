@@ -0,0 +1,52 @@
+#ifndef HOST_FREERTOS_QUEUE_H
+#define HOST_FREERTOS_QUEUE_H
+
+#include <freertos/FreeRTOS.h>
+#include <vector>
+
+// Очередь фиксированной емкости с копированием элементов, как в FreeRTOS
+struct HostQueue {
+    std::vector<uint8_t> storage;
+    size_t itemSize;
+    size_t capacity;
+    size_t head;
+    size_t count;
+};
+typedef HostQueue* QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    HostQueue* q = new HostQueue();
+    q->storage.resize(length * itemSize);
+    q->itemSize = itemSize;
+    q->capacity = length;
+    q->head = 0;
+    q->count = 0;
+    return q;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t) {
+    if (q->count == q->capacity) return pdFALSE;
+    size_t tail = (q->head + q->count) % q->capacity;
+    memcpy(&q->storage[tail * q->itemSize], item, q->itemSize);
+    q->count++;
+    return pdTRUE;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t) {
+    if (q->count == 0) return pdFALSE;
+    memcpy(item, &q->storage[q->head * q->itemSize], q->itemSize);
+    q->head = (q->head + 1) % q->capacity;
+    q->count--;
+    return pdTRUE;
+}
+
+inline BaseType_t xQueueReset(QueueHandle_t q) {
+    q->head = 0;
+    q->count = 0;
+    return pdPASS;
+}
+
+inline UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q) { return q->capacity - q->count; }
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) { return q->count; }
+
+#endif // HOST_FREERTOS_QUEUE_H
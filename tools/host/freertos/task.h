@@ -0,0 +1,69 @@
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include <freertos/FreeRTOS.h>
+
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+// Задержка задачи продвигает виртуальное время
+inline void vTaskDelay(TickType_t ticks) { hostAdvanceMicros((uint64_t)ticks * portTICK_PERIOD_MS * 1000); }
+inline void vTaskDelete(TaskHandle_t) {}
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return (TaskHandle_t)1; }
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 10000; }
+
+// Уведомления задач: на хосте одна задача, биты копятся в общем слове
+enum eNotifyAction { eNoAction, eSetBits, eIncrement, eSetValueWithOverwrite, eSetValueWithoutOverwrite };
+
+inline uint32_t& hostTaskNotifyValue() {
+    static uint32_t value = 0;
+    return value;
+}
+
+inline BaseType_t xTaskNotify(TaskHandle_t, uint32_t value, eNotifyAction action) {
+    if (action == eSetBits) {
+        hostTaskNotifyValue() |= value;
+    } else if (action == eIncrement) {
+        hostTaskNotifyValue()++;
+    } else if (action != eNoAction) {
+        hostTaskNotifyValue() = value;
+    }
+    return pdTRUE;
+}
+
+// Ожидание не блокирует: без уведомления время ожидания просто проходит
+inline BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t* value, TickType_t ticks) {
+    hostTaskNotifyValue() &= ~clearOnEntry;
+    uint32_t current = hostTaskNotifyValue();
+    if (current == 0) {
+        vTaskDelay(ticks);
+        current = hostTaskNotifyValue();
+    }
+    if (value) {
+        *value = current;
+    }
+    hostTaskNotifyValue() &= ~clearOnExit;
+    return current != 0 ? pdTRUE : pdFALSE;
+}
+
+inline void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t* woken) {
+    hostTaskNotifyValue()++;
+    if (woken) {
+        *woken = pdTRUE;
+    }
+}
+
+// Как и xTaskNotifyWait, без уведомления время ожидания просто проходит
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    uint32_t current = hostTaskNotifyValue();
+    if (current == 0) {
+        vTaskDelay(ticks);
+        current = hostTaskNotifyValue();
+    }
+    if (current != 0) {
+        hostTaskNotifyValue() = clearOnExit ? 0 : current - 1;
+    }
+    return current;
+}
+
+#endif // HOST_FREERTOS_TASK_H
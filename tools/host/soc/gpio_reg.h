@@ -0,0 +1,43 @@
+#ifndef HOST_SOC_GPIO_REG_H
+#define HOST_SOC_GPIO_REG_H
+
+// Хостовая модель регистров установки и сброса выходов GPIO ESP32-S3. Запись
+// меняет общее состояние выводов hostPins() и сообщает об изменении слушателю
+// (модели устройства на выводах, например HostLcd).
+
+#include <Arduino.h>
+
+#define GPIO_OUT_W1TS_REG 0x60004008    // Установка выводов 0-31
+#define GPIO_OUT_W1TC_REG 0x6000400C    // Сброс выводов 0-31
+#define GPIO_OUT1_W1TS_REG 0x60004014   // Установка выводов 32-48
+#define GPIO_OUT1_W1TC_REG 0x60004018   // Сброс выводов 32-48
+
+// Слушатель изменений выводов: вызывается после каждой записи в регистр
+typedef void (*HostGpioListener)(void* context);
+
+struct HostGpioHook {
+    HostGpioListener listener = nullptr;
+    void* context = nullptr;
+};
+
+inline HostGpioHook& hostGpioHook() {
+    static HostGpioHook hook;
+    return hook;
+}
+
+inline void hostGpioWrite(uint32_t reg, uint32_t value) {
+    int base = (reg == GPIO_OUT1_W1TS_REG || reg == GPIO_OUT1_W1TC_REG) ? 32 : 0;
+    int level = (reg == GPIO_OUT_W1TS_REG || reg == GPIO_OUT1_W1TS_REG) ? 1 : 0;
+    for (int bit = 0; bit < 32 && base + bit < 64; bit++) {
+        if (value & (1UL << bit)) {
+            hostPins()[base + bit] = level;
+        }
+    }
+    if (hostGpioHook().listener) {
+        hostGpioHook().listener(hostGpioHook().context);
+    }
+}
+
+#define REG_WRITE(reg, value) hostGpioWrite((reg), (value))
+
+#endif // HOST_SOC_GPIO_REG_H
@@ -0,0 +1,346 @@
+// =============================================================================
+// ЗАДЕРЖКА ОТ НАЖАТИЯ КЛАВИШИ ДО ДВИЖЕНИЯ НА РАБОЧЕЙ СТАНЦИИ
+// =============================================================================
+//
+// Проигрывает серию нажатий через InputManager прошивки на модели TCA8418
+// (tools/host/Adafruit_TCA8418.h) и собирает задержки KeyLatency по стадиям:
+// прерывание INT, чтение события, обработчик клавиши, изменение состояния
+// MotionController и первый шаг оси. Задача клавиатуры просыпается по
+// прерыванию или по таймауту getWaitMs(), задача движения идет с тактом 1 мс,
+// шпиндель вращается с заданными оборотами, обращения к TCA8418 занимают время
+// транзакций I2C. Задачи на разных ядрах моделируются по очереди: цикл
+// движения, пришедшийся на обработку нажатия, выполняется сразу после нее.
+//
+// Раунд нажатий: ВКЛ, стрелка ВЛЕВО, РЕВЕРС при включенной системе, ВЫКЛ.
+// Промежутки между нажатиями сдвигаются псевдослучайно с заданным зерном,
+// поэтому нажатия приходятся на разные фазы такта движения, а прогон
+// повторяется один в один.
+//
+// Сборка (из корня репозитория):
+//   g++ -std=gnu++17 -O2 -I tools/host -I . tools/key_latency.cpp -o key_latency
+//
+// Запуск:
+//   ./key_latency [-n РАУНДОВ] [-r ОБОРОТЫ] [-p ШАГ_DU] [-t ТАКТ_МКС] [-z ЗЕРНО] [-i] [-l ПРЕДЕЛ_МС] [-v]
+//
+// -i отключает прерывание INT: задача клавиатуры опрашивает очередь по
+// таймауту, как при неподключенной линии. -l задает предел наибольшей полной
+// задержки любого класса клавиш.
+//
+// Код возврата: 0 - задержки в пределе (или предел не задан), 1 - нет.
+
+#include <Arduino.h>
+#include <freertos/task.h>
+#include <vector>
+
+#include "Config.h"
+#include "RussianLogger.h"
+#include "SpindleEncoder.h"
+#include "AxisController.h"
+#include "GCodeInterpreter.h"
+#include "MotionController.h"
+#include "KeyLatency.h"
+#include "InputManager.h"
+
+RussianLogger Logger;
+
+// Параметры запуска
+struct LatencyOptions {
+    int rounds = 50;                    // Раундов нажатий
+    int rpm = 600;                      // Обороты шпинделя
+    long pitch = 12500;                 // Шаг резьбы, деци-микроны
+    long tickUs = 1000;                 // Такт задачи движения (vTaskDelay(1) в прошивке)
+    uint32_t seed = 1;                  // Зерно сдвигов между нажатиями
+    bool interrupt = true;              // Линия INT подключена
+    double limitMs = 0;                 // Предел полной задержки, 0 - без проверки
+    bool verbose = false;               // Выводить журнал прошивки
+};
+
+// Событие клавиатуры в сценарии
+struct ScriptEvent {
+    uint64_t atUs;                      // Время появления события в очереди TCA8418
+    int key;                            // Код кнопки
+    bool press;                         // Нажатие или отпускание
+};
+
+static void printUsage() {
+    fprintf(stderr, "Использование: key_latency [-n РАУНДОВ] [-r ОБОРОТЫ] [-p ШАГ_DU] [-t ТАКТ_МКС] "
+                    "[-z ЗЕРНО] [-i] [-l ПРЕДЕЛ_МС] [-v]\n");
+}
+
+static bool parseOptions(int argc, char** argv, LatencyOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "-n") == 0 && hasValue) {
+            options.rounds = max(1, atoi(argv[++i]));
+        } else if (strcmp(arg, "-r") == 0 && hasValue) {
+            options.rpm = atoi(argv[++i]);
+        } else if (strcmp(arg, "-p") == 0 && hasValue) {
+            options.pitch = atol(argv[++i]);
+        } else if (strcmp(arg, "-t") == 0 && hasValue) {
+            options.tickUs = max(1L, atol(argv[++i]));
+        } else if (strcmp(arg, "-z") == 0 && hasValue) {
+            options.seed = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "-i") == 0) {
+            options.interrupt = false;
+        } else if (strcmp(arg, "-l") == 0 && hasValue) {
+            options.limitMs = atof(argv[++i]);
+        } else if (strcmp(arg, "-v") == 0) {
+            options.verbose = true;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Вывод ячейки таблицы с шириной в символах UTF-8
+ * @param width Ширина, отрицательная - выравнивание влево
+ */
+static void printCell(const char* text, int width) {
+    int length = 0;
+    for (const char* p = text; *p; p++) {
+        length += ((unsigned char)*p & 0xC0) != 0x80;
+    }
+    int pad = max(abs(width) - length, 0);
+    if (width < 0) {
+        printf("%s%*s", text, pad, "");
+    } else {
+        printf("%*s%s", pad, "", text);
+    }
+}
+
+/**
+ * @brief Сценарий нажатий: раунды ВКЛ, ВЛЕВО, РЕВЕРС, ВЫКЛ со сдвигами
+ */
+static std::vector<ScriptEvent> buildScript(const LatencyOptions& options, uint64_t startUs) {
+    struct Step {
+        int key;
+        unsigned long holdMs;           // Удержание клавиши
+        unsigned long pauseMs;          // Пауза после отпускания
+    };
+    static const Step round[] = {
+        {B_ON, 80, 400},
+        {B_LEFT, 150, 200},
+        {B_REVERSE, 80, 400},
+        {B_OFF, 80, 300},
+    };
+
+    std::vector<ScriptEvent> script;
+    uint32_t random = options.seed;
+    uint64_t atUs = startUs;
+    for (int r = 0; r < options.rounds; r++) {
+        for (const Step& step : round) {
+            // Линейный конгруэнтный генератор: сдвиг 0..20 мс
+            random = random * 1664525u + 1013904223u;
+            atUs += (random >> 8) % 20000;
+            script.push_back({atUs, step.key, true});
+            atUs += step.holdMs * 1000ULL;
+            script.push_back({atUs, step.key, false});
+            atUs += step.pauseMs * 1000ULL;
+        }
+    }
+    return script;
+}
+
+/**
+ * @brief Верхняя граница корзины, в которую попадает заданная доля замеров
+ * @return Граница в микросекундах, ULONG_MAX если доля в последней корзине
+ */
+static unsigned long percentileUs(const KeyLatencyHistogram& h, double fraction) {
+    unsigned long target = (unsigned long)ceil(h.count * fraction);
+    unsigned long seen = 0;
+    for (int bucket = 0; bucket < KEY_LATENCY_BUCKETS; bucket++) {
+        seen += h.buckets[bucket];
+        if (seen >= target) {
+            return KeyLatency::bucketLimitUs(bucket);
+        }
+    }
+    return ULONG_MAX;
+}
+
+static void printMs(unsigned long us, bool bound) {
+    char text[32];
+    if (us == ULONG_MAX) {
+        snprintf(text, sizeof(text), "-");
+    } else {
+        snprintf(text, sizeof(text), "%s%.3f", bound ? "<" : "", us / 1000.0);
+    }
+    printCell(text, 10);
+}
+
+static void printClass(const KeyLatencyStats& stats, int keyClass) {
+    printf("%s: нажатий %lu, без шага %lu\n", KeyLatency::className(keyClass), stats.traces[keyClass],
+           stats.noStep[keyClass]);
+    printf("  ");
+    printCell("стадия", -12);
+    const char* columns[] = {"замеров", "среднее", "медиана", "90%", "макс"};
+    for (const char* column : columns) {
+        printCell(column, 10);
+    }
+    printf("  мс\n");
+    for (int stage = 0; stage < KEY_STAGES; stage++) {
+        const KeyLatencyHistogram& h = stats.stages[keyClass][stage];
+        if (h.count == 0) {
+            continue;
+        }
+        printf("  ");
+        printCell(KeyLatency::stageName(stage), -12);
+        printf("%10lu", h.count);
+        printMs((unsigned long)(h.sumUs / h.count), false);
+        printMs(percentileUs(h, 0.5), true);
+        printMs(percentileUs(h, 0.9), true);
+        printMs(h.worstUs, false);
+        printf("\n");
+    }
+
+    const KeyLatencyHistogram& total = stats.stages[keyClass][KEY_STAGE_TOTAL];
+    if (total.count == 0) {
+        return;
+    }
+    printf("  распределение полной задержки, мс:\n");
+    // Корзины от первой до последней непустой
+    int first = 0;
+    int last = KEY_LATENCY_BUCKETS - 1;
+    while (total.buckets[first] == 0) {
+        first++;
+    }
+    while (total.buckets[last] == 0) {
+        last--;
+    }
+    unsigned long most = *std::max_element(total.buckets, total.buckets + KEY_LATENCY_BUCKETS);
+    for (int bucket = first; bucket <= last; bucket++) {
+        char label[32];
+        if (bucket < KEY_LATENCY_BUCKETS - 1) {
+            snprintf(label, sizeof(label), "<%.3f", KeyLatency::bucketLimitUs(bucket) / 1000.0);
+        } else {
+            snprintf(label, sizeof(label), ">=%.3f", KeyLatency::bucketLimitUs(bucket - 1) / 1000.0);
+        }
+        int bar = (int)((total.buckets[bucket] * 40 + most - 1) / most);
+        printf("  %10s %6lu%s%.*s\n", label, total.buckets[bucket], bar > 0 ? " " : "", bar,
+               "########################################");
+    }
+}
+
+int main(int argc, char** argv) {
+    LatencyOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+    Serial.setQuiet(!options.verbose);
+    if (!options.verbose) {
+        Logger.enable(false);
+    }
+
+    // Те же объекты, что и в main.cpp прошивки
+    SpindleEncoder spindleEncoder;
+    AxisController zAxis(NAME_Z, true, false, MOTOR_STEPS_Z, SCREW_Z_DU, SPEED_START_Z,
+                        SPEED_MANUAL_MOVE_Z, ACCELERATION_Z, INVERT_Z, NEEDS_REST_Z,
+                        MAX_TRAVEL_MM_Z, BACKLASH_DU_Z, Z_ENA, Z_DIR, Z_STEP);
+    AxisController xAxis(NAME_X, true, false, MOTOR_STEPS_X, SCREW_X_DU, SPEED_START_X,
+                        SPEED_MANUAL_MOVE_X, ACCELERATION_X, INVERT_X, NEEDS_REST_X,
+                        MAX_TRAVEL_MM_X, BACKLASH_DU_X, X_ENA, X_DIR, X_STEP);
+    AxisController a1Axis(NAME_A1, false, ROTARY_A1, MOTOR_STEPS_A1, SCREW_A1_DU,
+                         SPEED_START_A1, SPEED_MANUAL_MOVE_A1, ACCELERATION_A1, INVERT_A1,
+                         NEEDS_REST_A1, MAX_TRAVEL_MM_A1, BACKLASH_DU_A1, A11, A12, A13);
+    GCodeInterpreter gcodeInterpreter(zAxis, xAxis, spindleEncoder);
+    MotionController motionController(spindleEncoder, zAxis, xAxis, a1Axis, gcodeInterpreter);
+    KeyLatency keyLatency(zAxis, xAxis, a1Axis);
+    Adafruit_TCA8418 keypad;
+    InputManager inputManager(keypad, motionController, zAxis, xAxis, a1Axis, keyLatency);
+
+    spindleEncoder.begin();
+    zAxis.begin();
+    xAxis.begin();
+    motionController.begin();
+    keypad.hostConnectInt(KEY_INT);
+    inputManager.begin();
+    if (options.interrupt) {
+        inputManager.attachTask(xTaskGetCurrentTaskHandle());
+    }
+    motionController.setPitch(options.pitch);
+
+    // Раскрутка шпинделя до заданных оборотов
+    double pulsesPerTick = (double)options.rpm * ENCODER_STEPS_INT / 60.0 * options.tickUs / 1000000.0;
+    double pulseRemainder = 0;
+    auto spinTick = [&]() {
+        pulseRemainder += pulsesPerTick;
+        int pulses = (int)pulseRemainder;
+        pulseRemainder -= pulses;
+        hostPcntAdd(pulses);
+    };
+    for (long us = 0; us < 1000000; us += options.tickUs) {
+        spinTick();
+        spindleEncoder.update();
+        hostAdvanceMicros(options.tickUs);
+    }
+
+    std::vector<ScriptEvent> script = buildScript(options, hostClockUs());
+    uint64_t endUs = script.back().atUs + KEY_LATENCY_STEP_TIMEOUT_MS * 1000ULL;
+    size_t nextEvent = 0;
+    uint64_t nextMotionUs = hostClockUs();
+    uint64_t keypadWakeUs = hostClockUs();
+    unsigned long lostEvents = 0;
+
+    while (hostClockUs() < endUs) {
+        // События клавиатуры после подавления дребезга в TCA8418
+        while (nextEvent < script.size() && script[nextEvent].atUs <= hostClockUs()) {
+            if (!keypad.hostKey(script[nextEvent].key, script[nextEvent].press)) {
+                lostEvents++;
+            }
+            nextEvent++;
+        }
+
+        // Задача клавиатуры: уведомление из прерывания или таймаут ожидания
+        if (inputManager.waitForEvents(0) || hostClockUs() >= keypadWakeUs) {
+            inputManager.update();
+            keypadWakeUs = hostClockUs() + inputManager.getWaitMs() * 1000ULL;
+            continue;
+        }
+
+        // Задача движения
+        if (hostClockUs() >= nextMotionUs) {
+            spinTick();
+            motionController.update();
+            keyLatency.recordMotionCycle();
+            nextMotionUs += options.tickUs;
+            continue;
+        }
+
+        uint64_t wakeUs = min(nextMotionUs, keypadWakeUs);
+        if (nextEvent < script.size()) {
+            wakeUs = min(wakeUs, script[nextEvent].atUs);
+        }
+        hostAdvanceMicros(wakeUs - hostClockUs());
+    }
+    inputManager.update();
+
+    KeyLatencyStats stats;
+    keyLatency.read(stats);
+    printf("Раундов: %d, клавиатура: %s, шпиндель %d об/мин, шаг %.4f мм, такт движения %ld мкс\n",
+           options.rounds, options.interrupt ? "прерывание INT" : "опрос", options.rpm,
+           options.pitch / 10000.0, options.tickUs);
+    if (!options.interrupt) {
+        printf("Без прерывания время нажатия неизвестно: задержка считается от чтения события\n");
+    }
+    if (lostEvents > 0) {
+        printf("Потеряно событий при переполнении очереди: %lu\n", lostEvents);
+    }
+
+    bool ok = true;
+    for (int keyClass = 0; keyClass < KEY_CLASSES; keyClass++) {
+        if (stats.traces[keyClass] == 0) {
+            continue;
+        }
+        printf("\n");
+        printClass(stats, keyClass);
+        double worstMs = stats.stages[keyClass][KEY_STAGE_TOTAL].worstUs / 1000.0;
+        if (options.limitMs > 0 && worstMs > options.limitMs) {
+            printf("  Превышен предел %.3f мс: %.3f мс\n", options.limitMs, worstMs);
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
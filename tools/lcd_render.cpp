@@ -0,0 +1,343 @@
+// =============================================================================
+// ОТРИСОВКА ЭКРАНОВ ДИСПЛЕЯ НА РАБОЧЕЙ СТАНЦИИ
+// =============================================================================
+//
+// Проводит DisplayManager прошивки через набор экранов: заставку, режимы
+// работы, многозаходную резьбу, шаг в дюймах и TPI и страницы диагностики,
+// включая задержку нажатий. Шаг вводится, как с клавиатуры, через
+// NumpadEntry, поэтому проверяется и путь от ввода до вывода в каждой
+// системе измерений. Вывод идет через LcdParallel на модель HD44780
+// (tools/host/HostLcd.h), подключенную к тем же выводам, что и в main.cpp,
+// поэтому проверяются и отрисовка, и драйвер шины.
+//
+// Для каждого экрана печатается его содержимое и стоимость вывода кадра:
+// команды, из них установки курсора, записи данных, из них в CGRAM, время
+// выполнения на шине по модели и время вывода драйвером. Передачи раньше
+// окончания предыдущей команды считаются нарушениями тайминга.
+//
+// Сборка (из корня репозитория):
+//   g++ -std=gnu++17 -O2 -I tools/host -I . tools/lcd_render.cpp -o lcd_render
+//
+// Запуск:
+//   ./lcd_render [-f] [-q] [-s снимок.txt] [-c снимок.txt]
+//
+// -f перерисовывает каждый экран целиком вместо вывода изменений, -q печатает
+// только таблицу стоимости, -s сохраняет содержимое экранов, -c сравнивает его
+// с сохраненным ранее.
+//
+// Код возврата: 0 - экраны совпали со снимком и тайминги соблюдены, 1 - нет.
+
+#include <Arduino.h>
+#include <freertos/task.h>
+#include <string>
+#include <vector>
+
+#include "Config.h"
+#include "RussianLogger.h"
+#include "SpindleEncoder.h"
+#include "AxisController.h"
+#include "GCodeInterpreter.h"
+#include "MotionController.h"
+#include "Diagnostics.h"
+#include "KeyLatency.h"
+#include "LcdParallel.h"
+#include "DisplayManager.h"
+#include "NumpadEntry.h"
+#include "HostLcd.h"
+
+RussianLogger Logger;
+
+// Параметры запуска
+struct RenderOptions {
+    const char* savePath = nullptr;     // Файл для сохранения снимка
+    const char* comparePath = nullptr;  // Файл снимка для сравнения
+    bool fullRedraw = false;            // Перерисовывать экраны целиком
+    bool quiet = false;                 // Только таблица стоимости
+};
+
+// Экран и стоимость его вывода
+struct RenderedScreen {
+    std::string name;
+    std::string text;                   // Строки дисплея в UTF-8
+    HostLcdStats stats;
+    unsigned long flushUs;              // Время вывода кадра драйвером
+    int slices;                         // Порций вывода по LCD_SLICE_BUDGET_US
+};
+
+static void printUsage() {
+    fprintf(stderr, "Использование: lcd_render [-f] [-q] [-s снимок.txt] [-c снимок.txt]\n");
+}
+
+static bool parseOptions(int argc, char** argv, RenderOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "-s") == 0 && hasValue) {
+            options.savePath = argv[++i];
+        } else if (strcmp(arg, "-c") == 0 && hasValue) {
+            options.comparePath = argv[++i];
+        } else if (strcmp(arg, "-f") == 0) {
+            options.fullRedraw = true;
+        } else if (strcmp(arg, "-q") == 0) {
+            options.quiet = true;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Вывод ячейки таблицы с шириной в символах UTF-8
+ * @param width Ширина, отрицательная - выравнивание влево
+ */
+static void printCell(const char* text, int width) {
+    int length = 0;
+    for (const char* p = text; *p; p++) {
+        length += ((unsigned char)*p & 0xC0) != 0x80;
+    }
+    int pad = max(abs(width) - length, 0);
+    if (width < 0) {
+        printf("%s%*s", text, pad, "");
+    } else {
+        printf("%*s%s", pad, "", text);
+    }
+}
+
+static std::string screenText(const HostLcd& lcd) {
+    std::string text;
+    char row[HOST_LCD_COLS * 3 + 1];
+    for (int r = 0; r < HOST_LCD_ROWS; r++) {
+        lcd.rowText(r, row, sizeof(row));
+        text += "|";
+        text += row;
+        text += "|\n";
+    }
+    return text;
+}
+
+static std::string snapshotText(const std::vector<RenderedScreen>& screens) {
+    std::string text;
+    for (const RenderedScreen& screen : screens) {
+        text += "== " + screen.name + "\n" + screen.text;
+    }
+    return text;
+}
+
+static bool readFile(const char* path, std::string& text) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        text.append(buffer, n);
+    }
+    fclose(f);
+    return true;
+}
+
+/**
+ * @brief Сравнение снимка с сохраненным, печать отличающихся экранов
+ * @return true если снимки совпали
+ */
+static bool compareSnapshot(const char* path, const std::vector<RenderedScreen>& screens) {
+    std::string saved;
+    if (!readFile(path, saved)) {
+        fprintf(stderr, "Не удалось открыть %s\n", path);
+        return false;
+    }
+    bool same = true;
+    for (const RenderedScreen& screen : screens) {
+        std::string header = "== " + screen.name + "\n";
+        size_t start = saved.find(header);
+        if (start == std::string::npos) {
+            printf("Экрана \"%s\" нет в %s\n", screen.name.c_str(), path);
+            same = false;
+            continue;
+        }
+        start += header.size();
+        size_t end = saved.find("== ", start);
+        std::string expected = saved.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        if (expected != screen.text) {
+            printf("Экран \"%s\" отличается\nбыло:\n%sстало:\n%s", screen.name.c_str(), expected.c_str(),
+                   screen.text.c_str());
+            same = false;
+        }
+    }
+    return same;
+}
+
+int main(int argc, char** argv) {
+    RenderOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+    Serial.setQuiet(true);
+    Logger.enable(false);
+
+    // Те же объекты и выводы, что и в main.cpp прошивки
+    SpindleEncoder spindleEncoder;
+    AxisController zAxis(NAME_Z, true, false, MOTOR_STEPS_Z, SCREW_Z_DU, SPEED_START_Z,
+                        SPEED_MANUAL_MOVE_Z, ACCELERATION_Z, INVERT_Z, NEEDS_REST_Z,
+                        MAX_TRAVEL_MM_Z, BACKLASH_DU_Z, Z_ENA, Z_DIR, Z_STEP);
+    AxisController xAxis(NAME_X, true, false, MOTOR_STEPS_X, SCREW_X_DU, SPEED_START_X,
+                        SPEED_MANUAL_MOVE_X, ACCELERATION_X, INVERT_X, NEEDS_REST_X,
+                        MAX_TRAVEL_MM_X, BACKLASH_DU_X, X_ENA, X_DIR, X_STEP);
+    AxisController a1Axis(NAME_A1, false, ROTARY_A1, MOTOR_STEPS_A1, SCREW_A1_DU,
+                         SPEED_START_A1, SPEED_MANUAL_MOVE_A1, ACCELERATION_A1, INVERT_A1,
+                         NEEDS_REST_A1, MAX_TRAVEL_MM_A1, BACKLASH_DU_A1, A11, A12, A13);
+    GCodeInterpreter gcodeInterpreter(zAxis, xAxis, spindleEncoder);
+    MotionController motionController(spindleEncoder, zAxis, xAxis, a1Axis, gcodeInterpreter);
+    Diagnostics diagnostics(zAxis, xAxis, spindleEncoder);
+    diagnostics.addTask("Движение", (TaskHandle_t)1);
+
+    HostLcd model(21, 48, 47, 38, 39, 40, 41, 42, 2, 1);
+    LcdParallel lcd(21, 48, 47, 38, 39, 40, 41, 42, 2, 1);
+    KeyLatency keyLatency(zAxis, xAxis, a1Axis);
+    DisplayManager displayManager(lcd, motionController, diagnostics, keyLatency);
+
+    spindleEncoder.begin();
+    zAxis.begin();
+    xAxis.begin();
+    motionController.begin();
+
+    std::vector<RenderedScreen> screens;
+    auto capture = [&](const char* name) {
+        RenderedScreen screen;
+        screen.name = name;
+        screen.text = screenText(model);
+        screen.stats = model.getStats();
+        screen.flushUs = 0;
+        screen.slices = 0;
+        screens.push_back(screen);
+    };
+    auto render = [&](const char* name) {
+        if (options.fullRedraw) {
+            displayManager.redraw();
+        }
+        model.resetStats();
+        displayManager.update();
+        uint64_t startUs = hostClockUs();
+        int slices = 1;
+        while (!displayManager.flush(LCD_SLICE_BUDGET_US)) {
+            slices++;
+        }
+        capture(name);
+        screens.back().flushUs = hostClockUs() - startUs;
+        screens.back().slices = slices;
+    };
+
+    // Заставка выводится при инициализации, вместе с командами настройки контроллера
+    uint64_t beginUs = hostClockUs();
+    displayManager.begin();
+    capture("заставка");
+    screens.back().flushUs = hostClockUs() - beginUs;
+    screens.back().slices = 1;
+    hostAdvanceMicros((DISPLAY_SPLASH_MS + 1) * 1000ULL);
+
+    // Ввод шага с клавиатуры в текущей системе измерений (точка - кнопкой SETTINGS)
+    auto enterPitch = [&](const char* keys) {
+        NumpadEntry entry;
+        for (const char* key = keys; *key; key++) {
+            if (*key == '.') {
+                entry.pressPoint();
+            } else {
+                entry.pressDigit(*key - '0');
+            }
+        }
+        motionController.setPitch(entry.toDeciMicrons(motionController.getMeasure()));
+    };
+
+    render("резьба выкл");
+    enterPitch("1.25");
+    render("шаг 1.25");
+    motionController.setStarts(3);
+    render("три захода");
+    motionController.setMeasure(MEASURE_INCH);
+    render("шаг в дюймах");
+    motionController.setMeasure(MEASURE_TPI);
+    render("шаг в TPI");
+    enterPitch("20");
+    render("ввод 20 TPI");
+    motionController.setMeasure(MEASURE_METRIC);
+    render("20 TPI в мм");
+    motionController.setEnabled(true);
+    render("резьба вкл");
+    motionController.setEnabled(false);
+    motionController.setStarts(1);
+    motionController.setOperationMode(MODE_TURN);
+    render("точение");
+    motionController.setTurnPasses(12);
+    render("точение 12 проходов");
+    motionController.setOperationMode(MODE_CONE);
+    render("конус");
+    motionController.setOperationMode(MODE_GCODE);
+    render("G-код");
+
+    // Диагностика: окно циклов движения по 1 мс с редкими задержками
+    for (int i = 0; i < 1500; i++) {
+        diagnostics.recordMotionCycle();
+        hostAdvanceMicros(i % 50 == 0 ? 1300 : 1000);
+    }
+    // Задержка нажатий: ВКЛ/ВЫКЛ и стрелки с разной задержкой чтения из очереди
+    for (int i = 0; i < 8; i++) {
+        int key = i % 2 == 0 ? B_ON : B_LEFT;
+        unsigned long irqUs = micros();
+        hostAdvanceMicros(250 + i * 40);
+        keyLatency.beginTrace(key, true, irqUs, micros());
+        hostAdvanceMicros(5);
+        keyLatency.markHandled(micros());
+        hostAdvanceMicros(20);
+        keyLatency.endTrace(key == B_ON, micros(), false);
+    }
+    displayManager.setDisplayMode(false, true);
+    for (int page = 1; page <= DIAG_PAGES; page++) {
+        displayManager.toggleDisplayMode();
+        char name[32];
+        snprintf(name, sizeof(name), "диагностика %d", page);
+        render(name);
+    }
+    displayManager.toggleDisplayMode();
+    render("возврат с диагностики");
+
+    // Итоги
+    unsigned long violations = 0;
+    const char* columns[] = {"команд", "курсор", "данные", "CGRAM", "шина мкс", "вывод мкс", "порций"};
+    printCell("экран", -24);
+    for (const char* column : columns) {
+        printCell(column, 10);
+    }
+    printf("\n");
+    for (const RenderedScreen& screen : screens) {
+        if (!options.quiet) {
+            printf("%s", screen.text.c_str());
+        }
+        printCell(screen.name.c_str(), -24);
+        printf("%10lu%10lu%10lu%10lu%10lu%10lu%10d\n", screen.stats.commands, screen.stats.cursorMoves,
+               screen.stats.dataWrites, screen.stats.cgramWrites, screen.stats.busUs, screen.flushUs,
+               screen.slices);
+        violations += screen.stats.busyViolations;
+    }
+    if (violations > 0) {
+        printf("Нарушений тайминга HD44780: %lu\n", violations);
+    }
+
+    bool ok = violations == 0;
+    if (options.savePath) {
+        FILE* f = fopen(options.savePath, "w");
+        if (!f) {
+            fprintf(stderr, "Не удалось записать %s\n", options.savePath);
+            return 1;
+        }
+        std::string text = snapshotText(screens);
+        fwrite(text.data(), 1, text.size(), f);
+        fclose(f);
+    }
+    if (options.comparePath && !compareSnapshot(options.comparePath, screens)) {
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,276 @@
+// =============================================================================
+// ЗАМЕНИТЕЛЬ СТАНКА НА ПСЕВДОТЕРМИНАЛЕ ДЛЯ ПРОВЕРКИ ПОТОКОВОЙ ПЕРЕДАЧИ G-КОДА
+// =============================================================================
+//
+// Создает псевдотерминал и подключает к нему последовательный порт прошивки.
+// Программу принимает тот же GCodeStreamer, исполняют GCodeInterpreter и
+// MotionController, шпиндель вращается с заданными оборотами, как в gcode_sim.
+// SerialReceiver забирает байты из порта каждый такт, как обработчик приема UART.
+// Запуск соответствует нажатию ВКЛ в режиме G-кода с выбранным источником "поток".
+// С ключом -u система остается выключенной, а порт принимает загрузку программы
+// от gcode_upload в хранилище в заданном каталоге, как GCodeUploader на станке.
+//
+// Сборка (из корня репозитория):
+//   g++ -std=gnu++17 -O2 -I tools/host -I . tools/serial_standin.cpp -o serial_standin
+//
+// Запуск:
+//   ./serial_standin [-r ОБОРОТЫ] [-t ТАКТ_МКС] [-u КАТАЛОГ] [-v]
+//   (имя порта выводится при запуске, его передают gcode_stream или gcode_upload)
+//
+// Код возврата: 0 - программа завершена по M2/M30 (с -u - сохранена), 1 - программа
+// прервана или сброшена (с -u - загрузка не завершена).
+
+#include <Arduino.h>
+#include <fcntl.h>
+#include <termios.h>
+
+#include "Config.h"
+#include "RussianLogger.h"
+#include "SpindleEncoder.h"
+#include "AxisController.h"
+#include "GCodeInterpreter.h"
+#include "MotionController.h"
+#include "SerialReceiver.h"
+#include "GCodeStreamer.h"
+#include "GCodeStorage.h"
+#include "GCodeUploader.h"
+
+RussianLogger Logger;
+
+// Параметры запуска заменителя
+struct StandinOptions {
+    int rpm = 600;                      // Обороты шпинделя
+    long tickUs = 1000;                 // Такт задачи движения
+    bool verbose = false;               // Выводить журнал прошивки в порт (как на станке)
+    const char* uploadDir = nullptr;    // Каталог хранилища для приема загрузки (-u)
+};
+
+static const unsigned long UPLOAD_IDLE_SEC = 10; // Загрузка прекращается после простоя порта
+
+static bool parseOptions(int argc, char** argv, StandinOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "-r") == 0 && hasValue) {
+            options.rpm = atoi(argv[++i]);
+        } else if (strcmp(arg, "-t") == 0 && hasValue) {
+            options.tickUs = max(1L, atol(argv[++i]));
+        } else if (strcmp(arg, "-u") == 0 && hasValue) {
+            options.uploadDir = argv[++i];
+        } else if (strcmp(arg, "-v") == 0) {
+            options.verbose = true;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Создание псевдотерминала в сыром режиме
+ * @param slaveFd Дескриптор подчиненной стороны (держится открытым, чтобы порт не закрывался)
+ * @return Дескриптор ведущей стороны или -1
+ */
+static int openPty(int& slaveFd) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        return -1;
+    }
+    slaveFd = open(ptsname(master), O_RDWR | O_NOCTTY);
+    if (slaveFd < 0) {
+        return -1;
+    }
+
+    // Без эха и преобразования переводов строк, как у UART
+    struct termios tio;
+    tcgetattr(slaveFd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slaveFd, TCSANOW, &tio);
+    return master;
+}
+
+/**
+ * @brief Прием загрузки программы при выключенной системе
+ * @return Код возврата заменителя
+ */
+static int runUpload(const StandinOptions& options, GCodeStorage& storage, GCodeUploader& uploader,
+                     SerialReceiver& receiver, int slaveFd, int masterFd) {
+    hostFsRoot() = options.uploadDir;
+    if (!storage.begin()) {
+        fprintf(stderr, "Не удалось открыть хранилище в %s\n", options.uploadDir);
+        return 1;
+    }
+
+    bool saved = false;
+    uint64_t nextUploadUs = hostClockUs();
+    uint64_t lastDataUs = hostClockUs();
+    bool seenData = false;
+    while (!saved) {
+        int before = receiver.available();
+        receiver.receive();
+        if (receiver.available() != before) {
+            seenData = true;
+            lastDataUs = hostClockUs();
+        }
+
+        // Задача G-кода опрашивает загрузчик раз в 10 мс
+        if (hostClockUs() >= nextUploadUs) {
+            nextUploadUs += 10000;
+            receiver.sendRequestedStatus();
+            // Источник "поток" выбран: байты без начала порции за ними ждут запуска потока
+            saved = uploader.update(true);
+        }
+        if (seenData && hostClockUs() - lastDataUs > UPLOAD_IDLE_SEC * 1000000ULL) {
+            break;
+        }
+        usleep(1000);
+        hostAdvanceMicros(1000);
+    }
+
+    tcdrain(masterFd);
+    usleep(500000);
+    if (saved) {
+        printf("Программ в хранилище: %d\n", storage.getProgramCount());
+        for (int i = 0; i < storage.getProgramCount(); i++) {
+            printf("  %d: %s\n", i, storage.getProgramName(i));
+        }
+    } else {
+        printf("Загрузка не завершена\n");
+    }
+    close(slaveFd);
+    close(masterFd);
+    return saved ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    StandinOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr, "Использование: serial_standin [-r ОБОРОТЫ] [-t ТАКТ_МКС] [-u КАТАЛОГ] [-v]\n");
+        return 1;
+    }
+
+    int slaveFd;
+    int masterFd = openPty(slaveFd);
+    if (masterFd < 0) {
+        fprintf(stderr, "Не удалось создать псевдотерминал\n");
+        return 1;
+    }
+    printf("Порт: %s\n", ptsname(masterFd));
+    fflush(stdout);
+
+    Serial.attach(masterFd, masterFd);
+    if (!options.verbose) {
+        Logger.enable(false);
+    }
+
+    // Те же объекты, что и в main.cpp прошивки
+    SpindleEncoder spindleEncoder;
+    AxisController zAxis(NAME_Z, true, false, MOTOR_STEPS_Z, SCREW_Z_DU, SPEED_START_Z,
+                        SPEED_MANUAL_MOVE_Z, ACCELERATION_Z, INVERT_Z, NEEDS_REST_Z,
+                        MAX_TRAVEL_MM_Z, BACKLASH_DU_Z, Z_ENA, Z_DIR, Z_STEP);
+    AxisController xAxis(NAME_X, true, false, MOTOR_STEPS_X, SCREW_X_DU, SPEED_START_X,
+                        SPEED_MANUAL_MOVE_X, ACCELERATION_X, INVERT_X, NEEDS_REST_X,
+                        MAX_TRAVEL_MM_X, BACKLASH_DU_X, X_ENA, X_DIR, X_STEP);
+    AxisController a1Axis(NAME_A1, false, ROTARY_A1, MOTOR_STEPS_A1, SCREW_A1_DU,
+                         SPEED_START_A1, SPEED_MANUAL_MOVE_A1, ACCELERATION_A1, INVERT_A1,
+                         NEEDS_REST_A1, MAX_TRAVEL_MM_A1, BACKLASH_DU_A1, A11, A12, A13);
+    GCodeInterpreter gcodeInterpreter(zAxis, xAxis, spindleEncoder);
+    MotionController motionController(spindleEncoder, zAxis, xAxis, a1Axis, gcodeInterpreter);
+    SerialReceiver serialReceiver(motionController, gcodeInterpreter, spindleEncoder, zAxis, xAxis);
+    GCodeStreamer gcodeStreamer(gcodeInterpreter, serialReceiver);
+    GCodeStorage gcodeStorage;
+    GCodeUploader gcodeUploader(gcodeStorage, serialReceiver, motionController);
+
+    spindleEncoder.begin();
+    zAxis.begin();
+    xAxis.begin();
+    motionController.begin();
+
+    if (options.uploadDir) {
+        return runUpload(options, gcodeStorage, gcodeUploader, serialReceiver, slaveFd, masterFd);
+    }
+
+    // Раскрутка шпинделя
+    double pulsesPerTick = (double)options.rpm * ENCODER_STEPS_INT / 60.0 * options.tickUs / 1000000.0;
+    double pulseRemainder = 0;
+    auto spinTick = [&]() {
+        pulseRemainder += pulsesPerTick;
+        int pulses = (int)pulseRemainder;
+        pulseRemainder -= pulses;
+        hostPcntAdd(pulses);
+    };
+    for (long us = 0; us < 1000000; us += options.tickUs) {
+        spinTick();
+        spindleEncoder.update();
+        hostAdvanceMicros(options.tickUs);
+    }
+
+    // Оператор нажимает ВКЛ в режиме G-кода с источником "поток"
+    motionController.setOperationMode(MODE_GCODE);
+    motionController.setEnabled(true);
+    motionController.update();
+    gcodeStreamer.startRun();
+
+    uint64_t startUs = hostClockUs();
+    uint64_t nextStreamUs = startUs;
+    int maxRxFill = 0;
+    long starvedTicks = 0;
+    bool started = false;
+
+    while (!gcodeInterpreter.isFinished() && motionController.isEnabled()) {
+        serialReceiver.receive();
+
+        // Задача G-кода опрашивает приемник раз в 10 мс
+        if (hostClockUs() >= nextStreamUs) {
+            nextStreamUs += 10000;
+            maxRxFill = max(maxRxFill, serialReceiver.available());
+            serialReceiver.sendRequestedStatus();
+            gcodeStreamer.update();
+            if (gcodeStreamer.getLineCount() > 0) {
+                started = true;
+            }
+        }
+
+        // Пока хост ничего не прислал, станок стоит: виртуальное время не идет
+        bool starving = !gcodeInterpreter.isExecuting() &&
+                        gcodeInterpreter.getQueueSpace() == GCODE_QUEUE_BLOCKS;
+        if (starving && serialReceiver.available() == 0) {
+            usleep(200);
+            motionController.update(); // Команды реального времени исполняются и при простое
+            continue;
+        }
+        if (starving && started) {
+            starvedTicks++;
+        }
+
+        spinTick();
+        motionController.update();
+        hostAdvanceMicros(options.tickUs);
+    }
+
+    // Последние ответы должны дойти до хоста до закрытия порта
+    tcdrain(masterFd);
+    usleep(500000);
+    double cycleSec = (hostClockUs() - startUs) / 1000000.0;
+    // Система выключается и по завершении программы, сброс с порта ее не завершает
+    bool reset = !gcodeInterpreter.isFinished();
+    bool aborted = reset || gcodeInterpreter.getCurrentLine() != gcodeStreamer.getLineCount();
+
+    printf("Принято строк: %u\n", gcodeStreamer.getLineCount());
+    if (reset) {
+        printf("Сброс с порта в строке %u\n", gcodeInterpreter.getCurrentLine());
+    } else if (aborted) {
+        printf("Программа прервана в строке %u\n", gcodeInterpreter.getCurrentLine());
+    } else {
+        printf("Время цикла: %.3f с\n", cycleSec);
+    }
+    printf("Наибольшее заполнение буфера приема: %d из %d байт\n", maxRxFill, GCODE_SERIAL_RX_BUFFER);
+    printf("Тактов без кадра при поступающих данных: %ld\n", starvedTicks);
+    if (maxRxFill > GCODE_SERIAL_RX_BUFFER) {
+        printf("ПЕРЕПОЛНЕНИЕ: хост превысил окно буфера приема\n");
+    }
+
+    close(slaveFd);
+    close(masterFd);
+    return aborted ? 1 : 0;
+}